@@ -7,9 +7,11 @@
 
 /* AC analysis and outputs the result to file(s) */
 void ac_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, parser_t *parser,
-				 double *dc_op, gsl_vector_complex *sol_x) {
+				 double *dc_op, cs_complex_t *sol_x) {
 	/* Set the flag that we're currently on an AC analysis */
 	mna->ac_analysis_init = true;
+	/* Heap allocations of the frequencies, the first one builds the pattern so it isn't counted */
+	long step_allocs = 0;
 
 	/* Run all the AC analyses according to ac_counter */
 	int ac_counter = parser->netlist->ac_counter;
@@ -29,7 +31,14 @@ void ac_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 		/* Fill sweep_points_freq buffer. This buffer contains all the sweep points (freq) for the AC analysis */
 		get_sweep_points(sweep_points_freq, parser->ac_analysis[i]);
 
+		/* Only the .PLOT nodes are written, the direct solves compute just them when they are few */
+		if (mna->partial != NULL) {
+			set_partial_probes(mna->partial, hash_table, parser->ac_analysis[i].nodes, parser->ac_analysis[i].num_nodes);
+		}
+
 		/* For every sweep point/step solve the corresponding MNA AC system */
+		telemetry_begin(mna->telemetry, "ac", i);
+		long alloc_start = alloc_count();
 		for (int step = 0; step < n_steps; step++) {
 			/* Find the current ω = 2πf */
 			double omega = 2 * M_PI * sweep_points_freq[step];
@@ -39,7 +48,9 @@ void ac_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 			solve_mna_system(mna, &dc_op, sol_x, parser->options);
 			/* Print the output to files */
 			write_ac_out_files(files, parser->ac_analysis[i], hash_table, sol_x, sweep_points_freq[step]);
+			if (step == 0) alloc_start = alloc_count();
 		}
+		step_allocs += alloc_count() - alloc_start;
 		/* Close the file descriptors for the current transient analysis */
 		for (int j = 0; j < parser->ac_analysis[i].num_nodes; j++) {
 			fclose(files[j]);
@@ -49,8 +60,14 @@ void ac_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 	}
 	/* Indicate that we stopped the AC analysis */
 	mna->ac_analysis_init = false;
+	if (mna->partial != NULL) {
+		set_partial_probes(mna->partial, hash_table, NULL, 0);
+	}
 	if (ac_counter) {
 		printf("OK\n");
+		print_ac_factor_info(mna->sp_matrix, parser->options);
+		print_partial_info(mna->partial, "AC");
+		print_alloc_count("AC", step_allocs);
 	}
 }
 
@@ -123,7 +140,7 @@ void create_ac_out_files(FILE *files[], ac_analysis_t ac_analysis) {
 				exit(EXIT_FAILURE);
 		}
 		/* Create the name of the output file */
-		sprintf(file_name, "%s%s)_%g_%g_%s.txt", prefix, ac_analysis.nodes[j], ac_analysis.start_freq,
+		snprintf(file_name, MAX_FILE_NAME, "%s%s)_%g_%g_%s.txt", prefix, ac_analysis.nodes[j], ac_analysis.start_freq,
 		        ac_analysis.end_freq, sweep);
 		/* Open the output file */
 		files[j] = fopen(file_name, "w");
@@ -137,12 +154,12 @@ void create_ac_out_files(FILE *files[], ac_analysis_t ac_analysis) {
 }
 
 /* Writes the output of the current step of the AC analysis to the output files */
-void write_ac_out_files(FILE *files[], ac_analysis_t ac_analysis, hash_table_t *hash_table, gsl_vector_complex *sol_x, double freq_step) {
+void write_ac_out_files(FILE *files[], ac_analysis_t ac_analysis, hash_table_t *hash_table, cs_complex_t *sol_x, double freq_step) {
 	/* Print current solution to file */
 	for (int j = 0; j < ac_analysis.num_nodes; j++) {
 		int offset = ht_get_id(hash_table, ac_analysis.nodes[j]) - 1;
 		/* Convert from complex to polar with magnitude and phase */
-		ac_spec_t curr_ac = rect_to_polar(gsl_vector_complex_get(sol_x, offset));
+		ac_spec_t curr_ac = rect_to_polar(sol_x[offset]);
 		/* In case it is a LOG sweep we need to output 20*log10(magnitude) */
 		switch (ac_analysis.sweep) {
 			case LIN:
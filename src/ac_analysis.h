@@ -5,15 +5,15 @@
 #include "routines.h"
 #include "ac_spec.h"
 
-#define MAX_FILE_NAME 50
+#define MAX_FILE_NAME 256
 
 void ac_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, parser_t *parser, double *dc_op,
-                 gsl_vector_complex *sol_x);
+                 cs_complex_t *sol_x);
 void get_sweep_points(double *array, ac_analysis_t ac_analysis);
 void lin_sweep(double *array, double start, double end, int points);
 void log_sweep(double *array, double start, double end, int points);
 void create_ac_out_files(FILE *files[], ac_analysis_t ac_analysis);
-void write_ac_out_files(FILE *files[], ac_analysis_t ac_analysis, hash_table_t *hash_table,gsl_vector_complex *sol_x,
+void write_ac_out_files(FILE *files[], ac_analysis_t ac_analysis, hash_table_t *hash_table,cs_complex_t *sol_x,
                         double freq_step);
 
 #endif
\ No newline at end of file
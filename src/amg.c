@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "amg.h"
+
+/* Diagonal of A, zero where A has none */
+static double *get_diag(cs *A) {
+	double *d = (double *)calloc(A->n, sizeof(double));
+	assert(d != NULL);
+	for (int j = 0; j < A->n; j++) {
+		for (int p = A->p[j]; p < A->p[j + 1]; p++) {
+			if (A->i[p] == j) d[j] += A->x[p];
+		}
+	}
+	return d;
+}
+
+/* Whether a_ij (i != j) is a strong connection */
+static inline bool is_strong(double aij, double di, double dj) {
+	return fabs(aij) > AMG_THETA * sqrt(fabs(di * dj));
+}
+
+/*
+ * Greedy aggregation of the strong connections of A (Vanek, Mandel, Brezina), returns the number of
+ * aggregates and agg[i] the aggregate of i:
+ * 1. every node whose strong neighbours are all free becomes the root of an aggregate with them,
+ * 2. every free node joins the aggregate of a strong neighbour from the first pass,
+ * 3. what is still free forms aggregates with its free strong neighbours.
+ */
+static int aggregate(cs *A, double *d, int *agg) {
+	int n = A->n, nc = 0;
+	for (int i = 0; i < n; i++) {
+		agg[i] = -1;
+	}
+	for (int i = 0; i < n; i++) {
+		if (agg[i] != -1) continue;
+		bool free_nbrs = true;
+		for (int p = A->p[i]; p < A->p[i + 1] && free_nbrs; p++) {
+			int j = A->i[p];
+			if (j != i && is_strong(A->x[p], d[i], d[j]) && agg[j] != -1) free_nbrs = false;
+		}
+		if (!free_nbrs) continue;
+		agg[i] = nc;
+		for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+			int j = A->i[p];
+			if (j != i && is_strong(A->x[p], d[i], d[j])) agg[j] = nc;
+		}
+		nc++;
+	}
+	/* The nodes of the second pass are marked with -2 - aggregate, so they don't attract others */
+	for (int i = 0; i < n; i++) {
+		if (agg[i] != -1) continue;
+		for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+			int j = A->i[p];
+			if (j != i && agg[j] >= 0 && is_strong(A->x[p], d[i], d[j])) {
+				agg[i] = -2 - agg[j];
+				break;
+			}
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		if (agg[i] != -1) continue;
+		agg[i] = nc;
+		for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+			int j = A->i[p];
+			if (j != i && agg[j] == -1 && is_strong(A->x[p], d[i], d[j])) agg[j] = nc;
+		}
+		nc++;
+	}
+	for (int i = 0; i < n; i++) {
+		if (agg[i] < -1) agg[i] = -2 - agg[i];
+	}
+	return nc;
+}
+
+/* Tentative prolongation, the constant vector on every aggregate normalized to unit length */
+static cs *tentative_prolongation(int n, int nc, int *agg) {
+	cs *T = cs_spalloc(n, nc, n, 1, 0);
+	assert(T != NULL);
+	int *size = (int *)calloc(nc, sizeof(int));
+	assert(size != NULL);
+	for (int i = 0; i < n; i++) {
+		size[agg[i]]++;
+	}
+	T->p[0] = 0;
+	for (int k = 0; k < nc; k++) {
+		T->p[k + 1] = T->p[k] + size[k];
+		size[k] = T->p[k];
+	}
+	for (int i = 0; i < n; i++) {
+		int q = size[agg[i]]++;
+		T->i[q] = i;
+	}
+	for (int k = 0; k < nc; k++) {
+		double v = 1.0 / sqrt((double)(T->p[k + 1] - T->p[k]));
+		for (int q = T->p[k]; q < T->p[k + 1]; q++) {
+			T->x[q] = v;
+		}
+	}
+	free(size);
+	return T;
+}
+
+/*
+ * Spectral radius of inv(D)A from AMG_POWER_ITERS power iterations, with a margin and no larger than its
+ * Gershgorin bound. The bound alone overestimates it and leaves the smoother and the prolongation
+ * underdamped, the iterations of CG then grow with the size of the grid.
+ */
+static double jacobi_radius(cs *A, double *d) {
+	int n = A->n;
+	double bound = 0.0, rho = 0.0;
+	for (int i = 0; i < n; i++) {
+		if (d[i] <= 0.0) continue;
+		double s = 0.0;
+		for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+			s += fabs(A->x[p]);
+		}
+		bound = CS_MAX(bound, s / d[i]);
+	}
+	if (bound == 0.0) return 1.0;
+
+	double *v = (double *)malloc(n * sizeof(double));
+	double *w = (double *)malloc(n * sizeof(double));
+	assert(v != NULL && w != NULL);
+	/* A start vector that isn't smooth, the smooth ones are near the null space of the grid */
+	for (int i = 0; i < n; i++) {
+		v[i] = 0.1 + (double)((i * 7919) % 1000) / 1000.0;
+	}
+	for (int it = 0; it < AMG_POWER_ITERS; it++) {
+		double norm_v = 0.0, norm_w = 0.0;
+		for (int i = 0; i < n; i++) {
+			double s = 0.0;
+			for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+				s += A->x[p] * v[A->i[p]];
+			}
+			w[i] = (d[i] > 0.0) ? s / d[i] : 0.0;
+			norm_v += v[i] * v[i];
+			norm_w += w[i] * w[i];
+		}
+		if (norm_w == 0.0) break;
+		rho = sqrt(norm_w / norm_v);
+		norm_w = sqrt(norm_w);
+		for (int i = 0; i < n; i++) {
+			v[i] = w[i] / norm_w;
+		}
+	}
+	free(v);
+	free(w);
+	return (rho > 0.0) ? CS_MIN(1.05 * rho, bound) : bound;
+}
+
+/* P = (I - omega inv(D) A) T, the Jacobi smoothing of the tentative prolongation */
+static cs *smooth_prolongation(cs *A, cs *T, double *d, double omega) {
+	cs *AT = cs_multiply(A, T);
+	assert(AT != NULL);
+	for (int p = 0; p < AT->p[AT->n]; p++) {
+		int i = AT->i[p];
+		AT->x[p] *= (d[i] > 0.0) ? omega / d[i] : 0.0;
+	}
+	cs *P = cs_add(T, AT, 1.0, -1.0);
+	assert(P != NULL);
+	cs_spfree(AT);
+	cs_dropzeros(P);
+	return P;
+}
+
+/*
+ * Builds the hierarchy of the SPD matrix A, which has to outlive it. The levels are smoothed with damped
+ * Jacobi, or with Chebyshev polynomials of the given degree on the upper part of their spectrum if it's
+ * positive.
+ */
+amg_t *amg_setup(cs *A, int degree) {
+	amg_t *amg = (amg_t *)calloc(1, sizeof(amg_t));
+	assert(amg != NULL);
+	amg->level[0].A = A;
+
+	int l = 0;
+	while (1) {
+		amg_level_t *L = &amg->level[l];
+		L->n = L->A->n;
+		L->r = (double *)malloc(L->n * sizeof(double));
+		assert(L->r != NULL);
+		/* The V-cycle gets the vectors of level 0 from the solver */
+		if (l > 0) {
+			L->x = (double *)malloc(L->n * sizeof(double));
+			L->b = (double *)malloc(L->n * sizeof(double));
+			assert(L->x != NULL && L->b != NULL);
+		}
+		if (L->n <= AMG_COARSE_SIZE || l == AMG_MAX_LEVELS - 1) break;
+
+		double *d = get_diag(L->A);
+		int *agg = (int *)malloc(L->n * sizeof(int));
+		assert(agg != NULL);
+		int nc = aggregate(L->A, d, agg);
+		/* Stop when the aggregates don't reduce the level enough to pay for another one */
+		if (nc == 0 || nc > 0.9 * L->n) {
+			free(d);
+			free(agg);
+			break;
+		}
+		/* The damping 4/(3 rho) is used for both the prolongation and the smoother */
+		double omega = 4.0 / (3.0 * jacobi_radius(L->A, d));
+		cs *T = tentative_prolongation(L->n, nc, agg);
+		L->P = smooth_prolongation(L->A, T, d, omega);
+		L->R = cs_transpose(L->P, 1);
+		cs *AP = cs_multiply(L->A, L->P);
+		cs *Ac = cs_multiply(L->R, AP);
+		assert(L->R != NULL && AP != NULL && Ac != NULL);
+		cs_spfree(T);
+		cs_spfree(AP);
+
+		L->dinv = d;
+		for (int i = 0; i < L->n; i++) {
+			L->dinv[i] = (d[i] > 0.0) ? omega / d[i] : 0.0;
+		}
+		if (degree > 0) {
+			L->cheby = cheby_setup(L->A, degree, CHEBY_SMOOTH_RATIO);
+		}
+		free(agg);
+		amg->level[++l].A = Ac;
+	}
+	amg->num_levels = l + 1;
+
+	/* The coarsest level is solved directly */
+	amg_level_t *L = &amg->level[l];
+	amg->S = cs_schol(1, L->A);
+	amg->N = cs_chol(L->A, amg->S);
+	if (amg->S == NULL || amg->N == NULL) {
+		fprintf(stderr, "\nCholesky method failed on the coarsest AMG level...non SPD matrix\n");
+		exit(EXIT_FAILURE);
+	}
+	amg->w = (double *)malloc(L->n * sizeof(double));
+	assert(amg->w != NULL);
+	return amg;
+}
+
+/* r = b - Ax, A symmetric */
+static void residual(cs *A, double *x, double *b, double *r) {
+	int n = A->n;
+	#pragma omp parallel for schedule(static) if (n > AMG_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		double s = b[i];
+		for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+			s -= A->x[p] * x[A->i[p]];
+		}
+		r[i] = s;
+	}
+}
+
+/* y = M'x for the n x m compressed-column M, a gather over the columns of M */
+static void mult_trans(cs *M, double *x, double *y, bool add) {
+	int m = M->n;
+	#pragma omp parallel for schedule(static) if (m > AMG_PAR_MIN)
+	for (int j = 0; j < m; j++) {
+		double s = add ? y[j] : 0.0;
+		for (int p = M->p[j]; p < M->p[j + 1]; p++) {
+			s += M->x[p] * x[M->i[p]];
+		}
+		y[j] = s;
+	}
+}
+
+/*
+ * V-cycle on level l for Ax = b from x = 0, with one damped Jacobi sweep or Chebyshev polynomial before
+ * and after the coarse correction. The sweeps are the same, so the cycle is a symmetric preconditioner.
+ */
+static void vcycle(amg_t *amg, int l, double *x, double *b) {
+	amg_level_t *L = &amg->level[l];
+	int n = L->n;
+
+	if (l == amg->num_levels - 1) {
+		cs_ipvec(amg->S->pinv, b, amg->w, n);
+		cs_lsolve(amg->N->L, amg->w);
+		cs_ltsolve(amg->N->L, amg->w);
+		cs_pvec(amg->S->pinv, amg->w, x, n);
+		return;
+	}
+
+	/* Pre-smoothing, the first sweep from zero */
+	if (L->cheby != NULL) {
+		cheby_apply(L->cheby, x, b, false);
+	}
+	else {
+		#pragma omp parallel for schedule(static) if (n > AMG_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] = L->dinv[i] * b[i];
+		}
+	}
+	residual(L->A, x, b, L->r);
+
+	/* Coarse correction, restricted with P' and prolongated with P = R' */
+	amg_level_t *C = &amg->level[l + 1];
+	mult_trans(L->P, L->r, C->b, false);
+	vcycle(amg, l + 1, C->x, C->b);
+	mult_trans(L->R, C->x, x, true);
+
+	/* Post-smoothing */
+	residual(L->A, x, b, L->r);
+	if (L->cheby != NULL) {
+		cheby_apply(L->cheby, x, L->r, true);
+		return;
+	}
+	#pragma omp parallel for schedule(static) if (n > AMG_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		x[i] += L->dinv[i] * L->r[i];
+	}
+}
+
+/* z = inv(M) r, one V-cycle */
+void amg_vcycle(amg_t *amg, double *z, double *r) {
+	vcycle(amg, 0, z, r);
+}
+
+/* Prints the sizes of the levels and the operator complexity, the entries of all levels over those of A */
+void print_amg_info(amg_t *amg, char *msg) {
+	double nnz = 0.0;
+	printf("%s preconditioner: AMG, %d levels of", msg, amg->num_levels);
+	for (int l = 0; l < amg->num_levels; l++) {
+		printf(" %d", amg->level[l].n);
+		nnz += amg->level[l].A->p[amg->level[l].n];
+	}
+	printf(" unknowns, operator complexity %.2lf%s\n", nnz / CS_MAX(amg->level[0].A->p[amg->level[0].n], 1),
+	       (amg->level[0].cheby != NULL) ? ", Chebyshev smoothers" : "");
+}
+
+/* Frees the hierarchy, not the matrix of level 0 */
+void free_amg(amg_t *amg) {
+	if (amg == NULL) return;
+	for (int l = 0; l < amg->num_levels; l++) {
+		amg_level_t *L = &amg->level[l];
+		if (l > 0) cs_spfree(L->A);
+		cs_spfree(L->P);
+		cs_spfree(L->R);
+		free(L->dinv);
+		free_cheby(L->cheby);
+		free(L->x);
+		free(L->b);
+		free(L->r);
+	}
+	cs_sfree(amg->S);
+	cs_nfree(amg->N);
+	free(amg->w);
+	free(amg);
+}
@@ -0,0 +1,55 @@
+#ifndef AMG_H
+#define AMG_H
+
+#include <stdbool.h>
+
+#include "chebyshev.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Levels of the hierarchy at most, the coarsening stops earlier at AMG_COARSE_SIZE unknowns */
+#define AMG_MAX_LEVELS		12
+#define AMG_COARSE_SIZE		400
+/* a_ij is a strong connection of i when |a_ij| > AMG_THETA sqrt(a_ii a_jj) */
+#define AMG_THETA			0.08
+/* Power iterations for the spectral radius of inv(D)A, which sets the damping of the smoothers */
+#define AMG_POWER_ITERS		10
+/* Below this many unknowns the smoothers and the transfers of a level run on a single thread */
+#define AMG_PAR_MIN			(1 << 14)
+
+/*
+ * One level of the hierarchy. A is symmetric, so its columns are also its rows and every product with
+ * it is a gather that runs in parallel over the columns. P is the smoothed prolongation from the next
+ * coarser level and R = P'. dinv holds the damped inverse diagonal of the Jacobi smoother, cheby the
+ * polynomial of the Chebyshev one.
+ */
+typedef struct amg_level {
+	int n;
+	cs *A;
+	cs *P;
+	cs *R;
+	double *dinv;
+	cheby_t *cheby;
+	/* Solution, right-hand side and residual of the level in the V-cycle */
+	double *x;
+	double *b;
+	double *r;
+} amg_level_t;
+
+/*
+ * Smoothed aggregation algebraic multigrid for the SPD systems of CG. The coarsest level is factorized
+ * with the sparse Cholesky of CXSparse. Level 0 refers to the matrix the hierarchy was built from.
+ */
+typedef struct amg {
+	int num_levels;
+	amg_level_t level[AMG_MAX_LEVELS];
+	css *S;
+	csn *N;
+	double *w;
+} amg_t;
+
+amg_t *amg_setup(cs *A, int degree);
+void amg_vcycle(amg_t *amg, double *z, double *r);
+void print_amg_info(amg_t *amg, char *msg);
+void free_amg(amg_t *amg);
+
+#endif
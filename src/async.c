@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+#include <omp.h>
+
+#include "async.h"
+#include "ordering.h"
+#include "routines.h"
+
+/*
+ * Splits C = PAP' into the diagonal blocks of the bands and the entries between them. Both are kept
+ * by column, C is symmetric so column i of off also holds the couplings of row i to the other blocks.
+ */
+static void split_blocks(async_t *as, cs *C) {
+	int n = as->n;
+	int *block = (int *)malloc(n * sizeof(int));
+	assert(block != NULL);
+	for (int k = 0; k < as->num_blocks; k++) {
+		for (int i = as->bptr[k]; i < as->bptr[k + 1]; i++) {
+			block[i] = k;
+		}
+	}
+
+	int off_nz = 0;
+	for (int j = 0; j < n; j++) {
+		for (int p = C->p[j]; p < C->p[j + 1]; p++) {
+			off_nz += block[C->i[p]] != block[j];
+		}
+	}
+	as->off = cs_spalloc(n, n, MAX(off_nz, 1), 1, 0);
+	assert(as->off != NULL);
+
+	int q = 0;
+	for (int k = 0; k < as->num_blocks; k++) {
+		int first = as->bptr[k], m = as->bptr[k + 1] - first, nz = 0;
+		for (int p = C->p[first]; p < C->p[first + m]; p++) {
+			nz += block[C->i[p]] == k;
+		}
+		cs *D = cs_spalloc(m, m, MAX(nz, 1), 1, 0);
+		assert(D != NULL);
+		nz = 0;
+		for (int j = first; j < first + m; j++) {
+			D->p[j - first] = nz;
+			as->off->p[j]   = q;
+			for (int p = C->p[j]; p < C->p[j + 1]; p++) {
+				int i = C->i[p];
+				if (block[i] == k) {
+					D->i[nz]   = i - first;
+					D->x[nz++] = C->x[p];
+				}
+				else {
+					as->off->i[q]   = i;
+					as->off->x[q++] = C->x[p];
+				}
+			}
+		}
+		D->p[m] = nz;
+		as->D[k] = D;
+	}
+	as->off->p[n] = q;
+	free(block);
+}
+
+/*
+ * Builds the blocks of A and factorizes them, blocks > 0 sets their number. Without it there is a block
+ * for every ASYNC_BLOCK_SIZE unknowns and at least one for every thread. Frees the previous setup.
+ */
+async_t *async_setup(async_t *as, cs *A, int blocks) {
+	free_async(as);
+	as = (async_t *)calloc(1, sizeof(async_t));
+	assert(as != NULL);
+	int n = as->n = A->n;
+
+	if (blocks > 0) {
+		as->num_blocks = MIN(blocks, n);
+	}
+	else {
+		as->num_blocks = MIN(MAX((n + ASYNC_BLOCK_SIZE - 1) / ASYNC_BLOCK_SIZE, omp_get_max_threads()), n);
+	}
+	as->num_blocks = MAX(as->num_blocks, 1);
+	as->bptr = (int *)malloc((as->num_blocks + 1) * sizeof(int));
+	as->D    = (cs **)calloc(as->num_blocks, sizeof(cs *));
+	as->S    = (css **)calloc(as->num_blocks, sizeof(css *));
+	as->N    = (csn **)calloc(as->num_blocks, sizeof(csn *));
+	as->res  = (double *)malloc(as->num_blocks * sizeof(double));
+	as->x    = (double *)malloc(n * sizeof(double));
+	as->b    = (double *)malloc(n * sizeof(double));
+	as->t    = (double *)malloc(n * sizeof(double));
+	as->w    = (double *)malloc(n * sizeof(double));
+	assert(as->bptr != NULL && as->D != NULL && as->S != NULL && as->N != NULL && as->res != NULL);
+	assert(as->x != NULL && as->b != NULL && as->t != NULL && as->w != NULL);
+	/* Bands of the same size */
+	for (int k = 0; k <= as->num_blocks; k++) {
+		as->bptr[k] = (int)((long)k * n / as->num_blocks);
+	}
+
+	/* The bands of the RCM order are connected and touch only the bands before and after them */
+	as->perm = rcm_order(A);
+	int *pinv = cs_pinv(as->perm, n);
+	cs *C = cs_permute(A, pinv, as->perm, 1);
+	assert(pinv != NULL && C != NULL);
+	split_blocks(as, C);
+	cs_free(pinv);
+	cs_spfree(C);
+
+	for (int k = 0; k < as->num_blocks; k++) {
+		as->S[k] = cs_schol(1, as->D[k]);
+		as->N[k] = cs_chol(as->D[k], as->S[k]);
+		if (as->N[k] == NULL) {
+			fprintf(stderr, "\nASYNC: block %d of the matrix is not SPD\n", k);
+			exit(EXIT_FAILURE);
+		}
+		as->fill += as->N[k]->L->p[as->D[k]->n];
+	}
+	return as;
+}
+
+/* Squared residual of block k with the current x, t gets b - off*x of the block for its solve */
+static double block_residual(async_t *as, int k) {
+	int first = as->bptr[k], m = as->bptr[k + 1] - first;
+	int *Op = as->off->p, *Oi = as->off->i;
+	double *Ox = as->off->x, *x = as->x, *t = as->t + first;
+	cs *D = as->D[k];
+
+	/* The neighbouring blocks are written by the other threads at the same time */
+	for (int i = 0; i < m; i++) {
+		double value = as->b[first + i];
+		for (int p = Op[first + i]; p < Op[first + i + 1]; p++) {
+			double xj;
+			#pragma omp atomic read
+			xj = x[Oi[p]];
+			value -= Ox[p] * xj;
+		}
+		t[i] = value;
+	}
+	/* Only the thread of the block writes its own unknowns */
+	double res = 0.0;
+	for (int i = 0; i < m; i++) {
+		double value = t[i];
+		for (int p = D->p[i]; p < D->p[i + 1]; p++) {
+			value -= D->x[p] * x[first + D->i[p]];
+		}
+		res += value * value;
+	}
+	return res;
+}
+
+/* Relaxes block k, x of the block becomes the solution of D_k x_k = b_k - off_k x */
+static void update_block(async_t *as, int k) {
+	int first = as->bptr[k], m = as->bptr[k + 1] - first;
+	double *t = as->t + first, *w = as->w + first;
+
+	#pragma omp atomic write
+	as->res[k] = block_residual(as, k);
+
+	cs_ipvec(as->S[k]->pinv, t, w, m);
+	cs_lsolve(as->N[k]->L, w);
+	cs_ltsolve(as->N[k]->L, w);
+	cs_pvec(as->S[k]->pinv, w, t, m);
+	for (int i = 0; i < m; i++) {
+		#pragma omp atomic write
+		as->x[first + i] = t[i];
+	}
+}
+
+/*
+ * Solves Ax = b starting from x, stops when the residual of the monitor gets below itol or after maxiter
+ * sweeps. The residuals of the monitor are a little stale, so the residual of the whole x is checked once
+ * all the threads stopped, and the relaxation goes on if it is still above itol. Returns the sweeps.
+ */
+int async_solve(async_t *as, double *x, double *b, double itol, int maxiter, workspace_t *ws) {
+	int n = as->n;
+	double start = omp_get_wtime();
+	for (int i = 0; i < n; i++) {
+		as->x[i] = x[as->perm[i]];
+		as->b[i] = b[as->perm[i]];
+	}
+	double b_norm = norm2(as->b, n);
+	if (b_norm == 0.0) {
+		zero_out_vector(x, n);
+		ws->residual = 0.0;
+		return 0;
+	}
+	/* Stops when sum(res) <= tol, and no block stops it before its first update */
+	double tol = itol * itol * b_norm * b_norm;
+	for (int k = 0; k < as->num_blocks; k++) {
+		as->res[k] = b_norm * b_norm;
+	}
+
+	int sweeps = 0;
+	double rel = INFINITY;
+	while (sweeps < maxiter) {
+		int stop = 0, threads = 1;
+		long total = 0;
+		#pragma omp parallel if (as->num_blocks > 1 && n > ASYNC_PAR_MIN) reduction(+:total)
+		{
+			int tid = omp_get_thread_num(), nt = omp_get_num_threads(), done = 0;
+			if (tid == 0) threads = nt;
+			while (!done) {
+				for (int k = tid; k < as->num_blocks; k += nt) {
+					update_block(as, k);
+				}
+				total++;
+				/* The convergence monitor, every thread checks the residuals after each of its sweeps */
+				double sum = 0.0;
+				for (int k = 0; k < as->num_blocks; k++) {
+					double res;
+					#pragma omp atomic read
+					res = as->res[k];
+					sum += res;
+				}
+				if (tid == 0) ws_trace(ws, sqrt(sum) / b_norm);
+				if (sum <= tol || sweeps + total >= maxiter) {
+					#pragma omp atomic write
+					stop = 1;
+				}
+				#pragma omp atomic read
+				done = stop;
+			}
+		}
+		sweeps += (total + threads - 1) / threads;
+
+		/* The residual of the whole x, the blocks keep it for the monitor if the relaxation goes on */
+		double sum = 0.0;
+		for (int k = 0; k < as->num_blocks; k++) {
+			as->res[k] = block_residual(as, k);
+			sum += as->res[k];
+		}
+		rel = sqrt(sum) / b_norm;
+		if (rel <= itol) break;
+	}
+
+	for (int i = 0; i < n; i++) {
+		x[as->perm[i]] = as->x[i];
+	}
+	ws->residual = rel;
+	as->sweeps += sweeps;
+	as->solves++;
+	as->time += omp_get_wtime() - start;
+	return sweeps;
+}
+
+/* Prints the blocks, their fill and the sweeps and time per solve */
+void print_async_info(async_t *as, char *msg) {
+	if (as == NULL) return;
+	printf("%s ASYNC: %d blocks of ~%d unknowns, nnz(L) %ld, %d threads", msg, as->num_blocks,
+		   as->n / as->num_blocks, as->fill, omp_get_max_threads());
+	if (as->solves > 0) {
+		printf(", %.1lf sweeps and %.6lf s per solve", (double)as->sweeps / as->solves, as->time / as->solves);
+	}
+	printf("\n");
+}
+
+void free_async(async_t *as) {
+	if (as == NULL) return;
+	for (int k = 0; k < as->num_blocks; k++) {
+		cs_spfree(as->D[k]);
+		cs_sfree(as->S[k]);
+		cs_nfree(as->N[k]);
+	}
+	free(as->D);
+	free(as->S);
+	free(as->N);
+	cs_spfree(as->off);
+	cs_free(as->perm);
+	free(as->bptr);
+	free(as->res);
+	free(as->x);
+	free(as->b);
+	free(as->t);
+	free(as->w);
+	free(as);
+}
@@ -0,0 +1,55 @@
+#ifndef ASYNC_H
+#define ASYNC_H
+
+#include <stdbool.h>
+
+#include "workspace.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Unknowns of a block when BLOCKS isn't given */
+#define ASYNC_BLOCK_SIZE	16384
+/* Sweeps at least before giving up, the relaxation needs more of them than CG needs iterations */
+#define ASYNC_MAX_SWEEPS	10000
+/* Below this many unknowns the blocks are relaxed on a single thread */
+#define ASYNC_PAR_MIN		(1 << 14)
+
+/*
+ * Asynchronous (chaotic) block-Jacobi for the SPD systems. The unknowns are split into bands of the RCM
+ * order and the diagonal block of every band is factorized with the sparse Cholesky of CXSparse. Every
+ * thread relaxes its own blocks again and again with the latest values of the neighbouring blocks it
+ * finds in the shared x, there are no barriers between the sweeps, so a slow thread only delays the
+ * blocks it owns. The reads and writes of x and of the block residuals are atomic, every sweep of a
+ * thread sums the residuals the blocks had at their last update and the first thread that finds the sum
+ * below itol stops all of them. Converges for the diagonally dominant M-matrices of the resistive grids.
+ */
+typedef struct async {
+	int n;
+	int num_blocks;
+	/* Unknowns in the RCM order, block k holds the positions bptr[k] to bptr[k + 1] - 1 of it */
+	int *perm;
+	int *bptr;
+	/* Diagonal blocks of PAP' and their Cholesky, the entries of PAP' outside the diagonal blocks */
+	cs **D;
+	css **S;
+	csn **N;
+	cs *off;
+	/* Solution and right-hand side in the RCM order, the squared residual of every block at its last update */
+	double *x;
+	double *b;
+	double *res;
+	/* Scratch of the block solves, every block uses the positions of its own unknowns */
+	double *t;
+	double *w;
+	/* nnz(L) of all the blocks, the sweeps and the seconds of the solves */
+	long fill;
+	long sweeps;
+	int solves;
+	double time;
+} async_t;
+
+async_t *async_setup(async_t *as, cs *A, int blocks);
+int async_solve(async_t *as, double *x, double *b, double itol, int maxiter, workspace_t *ws);
+void print_async_info(async_t *as, char *msg);
+void free_async(async_t *as);
+
+#endif
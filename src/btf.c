@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "btf.h"
+
+/*
+ * Splits C = A(p,q) into its diagonal blocks and the strictly upper off-diagonal part.
+ * Entries below the diagonal blocks can't exist since C is in block upper triangular form.
+ */
+static cs **btf_split(btf_t *btf, cs *C) {
+	int nb = btf->D->nb, *r = btf->D->r, *s = btf->D->s;
+	cs **B = (cs **)malloc(nb * sizeof(cs *));
+	assert(B != NULL);
+
+	btf->off = cs_spalloc(btf->n, btf->n, C->p[btf->n], 1, 0);
+	assert(btf->off != NULL);
+	int nz_off = 0;
+
+	for (int k = 0; k < nb; k++) {
+		int size = r[k + 1] - r[k];
+		int nz = 0;
+		B[k] = NULL;
+		/* Count the entries of the diagonal block first */
+		for (int j = s[k]; j < s[k + 1]; j++) {
+			for (int p = C->p[j]; p < C->p[j + 1]; p++) {
+				if (C->i[p] >= r[k]) nz++;
+			}
+		}
+		if (size > 1) {
+			B[k] = cs_spalloc(size, size, nz, 1, 0);
+			assert(B[k] != NULL);
+		}
+		nz = 0;
+		for (int j = s[k]; j < s[k + 1]; j++) {
+			btf->off->p[j] = nz_off;
+			if (B[k] != NULL) B[k]->p[j - s[k]] = nz;
+			for (int p = C->p[j]; p < C->p[j + 1]; p++) {
+				if (C->i[p] < r[k]) {
+					btf->off->i[nz_off] = C->i[p];
+					btf->off->x[nz_off] = C->x[p];
+					nz_off++;
+				}
+				else if (B[k] != NULL) {
+					B[k]->i[nz] = C->i[p] - r[k];
+					B[k]->x[nz] = C->x[p];
+					nz++;
+				}
+				else {
+					/* Singleton, the only entry of the block is its diagonal */
+					btf->diag[k] += C->x[p];
+				}
+			}
+		}
+		if (B[k] != NULL) B[k]->p[size] = nz;
+	}
+	btf->off->p[btf->n] = nz_off;
+	return B;
+}
+
+/* Sums the ordering info of every diagonal block to the info of the whole matrix */
+static void btf_order_info(btf_t *btf, order_info_t *blocks, order_info_t *info) {
+	int nb = btf->D->nb, *r = btf->D->r;
+	int largest = -1;
+
+	memset(info, 0, sizeof(order_info_t));
+	info->lu = true;
+	for (int k = 0; k < nb; k++) {
+		if (btf->N[k] == NULL) {
+			/* A singleton block is just its diagonal entry in U */
+			info->chosen.nnz++;
+			info->chosen.flops++;
+			info->actual_nnz++;
+			continue;
+		}
+		if (largest < 0 || r[k + 1] - r[k] > r[largest + 1] - r[largest]) {
+			largest = k;
+		}
+		info->chosen.nnz   += blocks[k].chosen.nnz;
+		info->chosen.flops += blocks[k].chosen.flops;
+		info->actual_nnz   += blocks[k].actual_nnz;
+		info->num_candidates = blocks[k].num_candidates;
+		for (int c = 0; c < blocks[k].num_candidates; c++) {
+			info->candidates[c].order  = blocks[k].candidates[c].order;
+			info->candidates[c].nnz   += blocks[k].candidates[c].nnz;
+			info->candidates[c].flops += blocks[k].candidates[c].flops;
+		}
+	}
+	/* The reported ordering is the one of the largest block */
+	info->chosen.order = largest < 0 ? ORD_NATURAL : blocks[largest].chosen.order;
+}
+
+/*
+ * Permutes A to block upper triangular form with the Dulmage-Mendelsohn decomposition and
+ * does an LU factorization on every diagonal block independently. The blocks are factorized
+ * in parallel, singleton blocks are just stored as a value. The info of the orderings of all
+ * blocks is summed up to the supplied info struct.
+ */
+btf_t *btf_factor(cs *A, order_t order, order_info_t *info) {
+	btf_t *btf = (btf_t *)malloc(sizeof(btf_t));
+	assert(btf != NULL);
+	btf->n = A->n;
+
+	btf->D = cs_dmperm(A, 0);
+	assert(btf->D != NULL);
+	int nb = btf->D->nb, *r = btf->D->r, *s = btf->D->s;
+
+	/* Blocks that aren't square means that the matrix is structurally singular */
+	btf->num_singletons = 0;
+	btf->max_block = 0;
+	for (int k = 0; k < nb; k++) {
+		if (r[k + 1] - r[k] != s[k + 1] - s[k]) {
+			fprintf(stderr, "\nLU method failed...structurally singular matrix\n");
+			exit(EXIT_FAILURE);
+		}
+		btf->max_block = MAX(btf->max_block, r[k + 1] - r[k]);
+		if (r[k + 1] - r[k] == 1) {
+			btf->num_singletons++;
+		}
+	}
+
+	btf->S    = (css **)calloc(nb, sizeof(css *));
+	btf->N    = (csn **)calloc(nb, sizeof(csn *));
+	btf->diag = (double *)calloc(nb, sizeof(double));
+	btf->x    = (double *)malloc(btf->n * sizeof(double));
+	btf->temp = (double *)malloc(btf->n * sizeof(double));
+	assert(btf->S != NULL && btf->N != NULL && btf->diag != NULL);
+	assert(btf->x != NULL && btf->temp != NULL);
+
+	/* C = A(p,q) is block upper triangular */
+	int *pinv = cs_pinv(btf->D->p, btf->n);
+	assert(pinv != NULL);
+	cs *C = cs_permute(A, pinv, btf->D->q, 1);
+	assert(C != NULL);
+	cs_free(pinv);
+
+	cs **B = btf_split(btf, C);
+	cs_spfree(C);
+
+	order_info_t *blocks = (order_info_t *)calloc(nb, sizeof(order_info_t));
+	assert(blocks != NULL);
+
+	/* The diagonal blocks are independent of each other so they're factorized in parallel */
+	#pragma omp parallel for schedule(dynamic)
+	for (int k = 0; k < nb; k++) {
+		if (B[k] == NULL) continue;
+		btf->S[k] = order_symbolic(B[k], order, true, &blocks[k]);
+		btf->N[k] = cs_lu(B[k], btf->S[k], 1);
+		if (btf->N[k] != NULL) {
+			set_actual_fill(&blocks[k], btf->N[k], true);
+		}
+	}
+
+	for (int k = 0; k < nb; k++) {
+		if ((B[k] == NULL && btf->diag[k] == 0.0) || (B[k] != NULL && btf->N[k] == NULL)) {
+			fprintf(stderr, "\nLU method failed...singular matrix\n");
+			exit(EXIT_FAILURE);
+		}
+		cs_spfree(B[k]);
+	}
+	free(B);
+
+	btf_order_info(btf, blocks, info);
+	free(blocks);
+
+	return btf;
+}
+
+/*
+ * Solves Ax = b with block back-substitution on the block upper triangular form,
+ * starting from the last diagonal block. b isn't modified.
+ */
+void btf_solve(btf_t *btf, double *b, double *x) {
+	int *r = btf->D->r;
+	cs *off = btf->off;
+
+	/* x = b(p) */
+	cs_pvec(btf->D->p, b, btf->x, btf->n);
+
+	for (int k = btf->D->nb - 1; k >= 0; k--) {
+		int first = r[k], size = r[k + 1] - r[k];
+		if (btf->N[k] == NULL) {
+			btf->x[first] /= btf->diag[k];
+		}
+		else {
+			double *x_k = btf->x + first, *temp_k = btf->temp + first;
+			cs_ipvec(btf->N[k]->pinv, x_k, temp_k, size);
+			cs_lsolve(btf->N[k]->L, temp_k);
+			cs_usolve(btf->N[k]->U, temp_k);
+			cs_ipvec(btf->S[k]->q, temp_k, x_k, size);
+		}
+		/* Remove the contribution of the solved block from the blocks above it */
+		for (int j = first; j < first + size; j++) {
+			for (int p = off->p[j]; p < off->p[j + 1]; p++) {
+				btf->x[off->i[p]] -= off->x[p] * btf->x[j];
+			}
+		}
+	}
+
+	/* x(q) = x */
+	cs_ipvec(btf->D->q, btf->x, x, btf->n);
+}
+
+/*
+ * Block back-substitution like btf_solve, for a panel of k right-hand sides stored row by row.
+ * The two panel workspaces are taken from ws.
+ */
+void btf_solve_block(btf_t *btf, double *B, double *X, int k, workspace_t *ws) {
+	int *r = btf->D->r;
+	cs *off = btf->off;
+	double *x    = ws_panel(ws, 0, k);
+	double *temp = ws_panel(ws, 1, k);
+
+	cs_pvec_block(btf->D->p, B, x, btf->n, k);
+
+	for (int b = btf->D->nb - 1; b >= 0; b--) {
+		int first = r[b], size = r[b + 1] - r[b];
+		double *x_b = x + first * k;
+		if (btf->N[b] == NULL) {
+			for (int c = 0; c < k; c++) {
+				x_b[c] /= btf->diag[b];
+			}
+		}
+		else {
+			double *temp_b = temp + first * k;
+			cs_ipvec_block(btf->N[b]->pinv, x_b, temp_b, size, k);
+			cs_lsolve_block(btf->N[b]->L, temp_b, k);
+			cs_usolve_block(btf->N[b]->U, temp_b, k);
+			cs_ipvec_block(btf->S[b]->q, temp_b, x_b, size, k);
+		}
+		for (int j = first; j < first + size; j++) {
+			for (int p = off->p[j]; p < off->p[j + 1]; p++) {
+				double *x_i = x + off->i[p] * k;
+				for (int c = 0; c < k; c++) {
+					x_i[c] -= off->x[p] * x[j * k + c];
+				}
+			}
+		}
+	}
+
+	cs_ipvec_block(btf->D->q, x, X, btf->n, k);
+}
+
+/* Prints the structure of the block triangular form */
+void print_btf_info(btf_t *btf, char *msg) {
+	printf("%s BTF: %d diagonal blocks, %d singletons, largest block %d of %d\n",
+	       msg, btf->D->nb, btf->num_singletons, btf->max_block, btf->n);
+}
+
+/* Frees the block triangular form and the factorizations of its blocks */
+void btf_free(btf_t *btf) {
+	if (btf == NULL) return;
+	for (int k = 0; k < btf->D->nb; k++) {
+		cs_sfree(btf->S[k]);
+		cs_nfree(btf->N[k]);
+	}
+	free(btf->S);
+	free(btf->N);
+	free(btf->diag);
+	free(btf->x);
+	free(btf->temp);
+	cs_spfree(btf->off);
+	cs_dfree(btf->D);
+	free(btf);
+}
@@ -0,0 +1,39 @@
+#ifndef BTF_H
+#define BTF_H
+
+#include <stdbool.h>
+
+#include "parser.h"
+#include "ordering.h"
+#include "workspace.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Holds the block triangular form of a matrix and the LU factorization of its diagonal blocks */
+typedef struct btf {
+	/* Row/column permutations p, q and block boundaries r, s, nb of A(p,q) */
+	csd *D;
+	/* The strictly upper off-diagonal blocks of A(p,q), used in the block back-substitution */
+	cs *off;
+
+	/* Symbolic and numeric LU for every diagonal block, NULL for the singletons */
+	css **S;
+	csn **N;
+	/* The value of every singleton block */
+	double *diag;
+
+	/* Workspaces of the solve, both of them have the dimension of the matrix */
+	double *x;
+	double *temp;
+
+	int n;
+	int num_singletons;
+	int max_block;
+} btf_t;
+
+btf_t *btf_factor(cs *A, order_t order, order_info_t *info);
+void btf_solve(btf_t *btf, double *b, double *x);
+void btf_solve_block(btf_t *btf, double *B, double *X, int k, workspace_t *ws);
+void print_btf_info(btf_t *btf, char *msg);
+void btf_free(btf_t *btf);
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "chebyshev.h"
+
+/* Number of eigenvalues below x of the m x m symmetric tridiagonal matrix with diagonal a and off-diagonal b */
+static int sturm_count(double *a, double *b, int m, double x) {
+	int count = 0;
+	double q = a[0] - x;
+	for (int i = 0; ; i++) {
+		if (q < 0.0) count++;
+		if (i == m - 1) break;
+		if (q == 0.0) q = 1e-300;
+		q = a[i + 1] - x - b[i + 1] * b[i + 1] / q;
+	}
+	return count;
+}
+
+/* The k-th smallest eigenvalue of the tridiagonal matrix, by bisection in its Gershgorin interval */
+static double tridiag_eig(double *a, double *b, int m, int k) {
+	double lo = a[0], hi = a[0];
+	for (int i = 0; i < m; i++) {
+		double s = ((i > 0) ? fabs(b[i]) : 0.0) + ((i < m - 1) ? fabs(b[i + 1]) : 0.0);
+		lo = CS_MIN(lo, a[i] - s);
+		hi = CS_MAX(hi, a[i] + s);
+	}
+	for (int it = 0; it < 100 && hi - lo > 1e-12 * CS_MAX(fabs(lo), fabs(hi)); it++) {
+		double mid = 0.5 * (lo + hi);
+		if (sturm_count(a, b, m, mid) > k) hi = mid;
+		else lo = mid;
+	}
+	return 0.5 * (lo + hi);
+}
+
+/*
+ * Extreme Ritz values of CHEBY_LANCZOS_STEPS Lanczos steps on the symmetric inv(sqrt(D)) A inv(sqrt(D)),
+ * which has the eigenvalues of inv(D)A. s holds inv(sqrt(D)).
+ */
+static void lanczos_bounds(cs *A, double *s, double *theta_min, double *theta_max) {
+	int n = A->n, m = 0;
+	double *v = (double *)calloc(n, sizeof(double));
+	double *v_old = (double *)calloc(n, sizeof(double));
+	double *w = (double *)malloc(n * sizeof(double));
+	double a[CHEBY_LANCZOS_STEPS], b[CHEBY_LANCZOS_STEPS + 1];
+	assert(v != NULL && v_old != NULL && w != NULL);
+
+	/* A start vector that isn't smooth, like the power iterations of AMG */
+	double norm = 0.0;
+	for (int i = 0; i < n; i++) {
+		v[i] = 0.1 + (double)((i * 7919) % 1000) / 1000.0;
+		norm += v[i] * v[i];
+	}
+	norm = sqrt(norm);
+	for (int i = 0; i < n; i++) {
+		v[i] /= norm;
+	}
+	b[0] = 0.0;
+	while (m < CHEBY_LANCZOS_STEPS && m < n) {
+		double alpha = 0.0, beta = 0.0;
+		#pragma omp parallel for reduction(+:alpha) schedule(static) if (n > CHEBY_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			double t = 0.0;
+			for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+				t += A->x[p] * s[A->i[p]] * v[A->i[p]];
+			}
+			w[i] = s[i] * t - b[m] * v_old[i];
+			alpha += w[i] * v[i];
+		}
+		a[m++] = alpha;
+		#pragma omp parallel for reduction(+:beta) schedule(static) if (n > CHEBY_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			w[i] -= alpha * v[i];
+			beta += w[i] * w[i];
+		}
+		beta = sqrt(beta);
+		/* An invariant subspace, the Ritz values are eigenvalues */
+		if (m == CHEBY_LANCZOS_STEPS || beta <= 1e-12 * fabs(alpha)) break;
+		b[m] = beta;
+		for (int i = 0; i < n; i++) {
+			v_old[i] = v[i];
+			v[i] = w[i] / beta;
+		}
+	}
+	*theta_min = tridiag_eig(a, b, m, 0);
+	*theta_max = tridiag_eig(a, b, m, m - 1);
+	free(v);
+	free(v_old);
+	free(w);
+}
+
+/*
+ * Builds the polynomial of the given degree for the symmetric A, which has to outlive it. lmax is the
+ * largest Ritz value with a margin, no larger than the Gershgorin bound of inv(D)A. With ratio > 0 the
+ * interval is [lmax / ratio, lmax], the smoothers of a multilevel hierarchy, otherwise the lower end is
+ * the smallest Ritz value, the preconditioner on its own. Rows without a positive diagonal are left out.
+ */
+cheby_t *cheby_setup(cs *A, int degree, double ratio) {
+	int n = A->n;
+	cheby_t *ch = (cheby_t *)calloc(1, sizeof(cheby_t));
+	assert(ch != NULL);
+	ch->n = n;
+	ch->degree = CS_MAX(degree, 1);
+	ch->A = A;
+	ch->dinv = (double *)calloc(n, sizeof(double));
+	ch->r = (double *)malloc(n * sizeof(double));
+	ch->d = (double *)malloc(n * sizeof(double));
+	double *s = (double *)calloc(n, sizeof(double));
+	assert(ch->dinv != NULL && ch->r != NULL && ch->d != NULL && s != NULL);
+
+	double bound = 0.0;
+	for (int j = 0; j < n; j++) {
+		double diag = 0.0, sum = 0.0;
+		for (int p = A->p[j]; p < A->p[j + 1]; p++) {
+			if (A->i[p] == j) diag += A->x[p];
+			sum += fabs(A->x[p]);
+		}
+		if (diag <= 0.0) continue;
+		ch->dinv[j] = 1.0 / diag;
+		s[j] = sqrt(ch->dinv[j]);
+		bound = CS_MAX(bound, sum / diag);
+	}
+
+	double theta_min, theta_max;
+	lanczos_bounds(A, s, &theta_min, &theta_max);
+	ch->lmax = (theta_max > 0.0) ? CS_MIN(CHEBY_MARGIN * theta_max, bound) : CS_MAX(bound, 1.0);
+	ch->lmin = (ratio > 0.0) ? ch->lmax / ratio : theta_min;
+	/* The Ritz values of a tiny or badly scaled A, fall back to the smoother interval */
+	if (!(ch->lmin > 0.0 && ch->lmin < ch->lmax)) {
+		ch->lmin = ch->lmax / CHEBY_SMOOTH_RATIO;
+	}
+	free(s);
+	return ch;
+}
+
+/*
+ * z = p(inv(D)A) inv(D) b, or z += p(inv(D)A) inv(D) b when add is set. These are the degree steps of the
+ * Chebyshev iteration for inv(D)Ax = inv(D)b from x = 0 (Saad, Algorithm 12.1), the scalars of every step
+ * only depend on the interval.
+ */
+void cheby_apply(cheby_t *ch, double *z, double *b, bool add) {
+	int n = ch->n;
+	cs *A = ch->A;
+	double *r = ch->r, *d = ch->d, *dinv = ch->dinv;
+	double theta = 0.5 * (ch->lmax + ch->lmin), delta = 0.5 * (ch->lmax - ch->lmin);
+	double sigma = theta / delta, rho = 1.0 / sigma;
+
+	#pragma omp parallel for schedule(static) if (n > CHEBY_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		r[i] = b[i];
+		d[i] = dinv[i] * b[i] / theta;
+		z[i] = add ? z[i] + d[i] : d[i];
+	}
+	for (int k = 1; k < ch->degree; k++) {
+		double rho_new = 1.0 / (2.0 * sigma - rho);
+		double c1 = rho_new * rho, c2 = 2.0 * rho_new / delta;
+		/* r -= Ad, a gather over the rows of the symmetric A */
+		#pragma omp parallel for schedule(static) if (n > CHEBY_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			double t = r[i];
+			for (int p = A->p[i]; p < A->p[i + 1]; p++) {
+				t -= A->x[p] * d[A->i[p]];
+			}
+			r[i] = t;
+		}
+		#pragma omp parallel for schedule(static) if (n > CHEBY_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			d[i] = c1 * d[i] + c2 * dinv[i] * r[i];
+			z[i] += d[i];
+		}
+		rho = rho_new;
+	}
+}
+
+/* Prints the degree and the interval of the polynomial */
+void print_cheby_info(cheby_t *ch, char *msg) {
+	printf("%s preconditioner: CHEBY, degree %d on [%g, %g]\n", msg, ch->degree, ch->lmin, ch->lmax);
+}
+
+/* Frees the polynomial, not its matrix */
+void free_cheby(cheby_t *ch) {
+	if (ch == NULL) return;
+	free(ch->dinv);
+	free(ch->r);
+	free(ch->d);
+	free(ch);
+}
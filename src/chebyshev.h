@@ -0,0 +1,40 @@
+#ifndef CHEBYSHEV_H
+#define CHEBYSHEV_H
+
+#include <stdbool.h>
+
+#include "../cx_sparse/Include/cs.h"
+
+/* Lanczos steps for the bounds of the spectrum of inv(D)A */
+#define CHEBY_LANCZOS_STEPS	12
+/* The largest Ritz value approaches the largest eigenvalue from below, it's raised by this margin */
+#define CHEBY_MARGIN		1.1
+/* The smoothers of a multilevel hierarchy only damp the upper part [lmax / CHEBY_SMOOTH_RATIO, lmax] */
+#define CHEBY_SMOOTH_RATIO	30.0
+/* Below this many unknowns the steps run on a single thread */
+#define CHEBY_PAR_MIN		(1 << 14)
+
+/*
+ * Chebyshev polynomial of inv(D)A for a symmetric A, z = p(inv(D)A) inv(D) r. The polynomial is the one
+ * of degree steps of the Chebyshev iteration from z = 0 on the interval [lmin, lmax] of eig(inv(D)A), so
+ * it is applied with products with A and vector updates only, without inner products. The bounds come
+ * from a few Lanczos steps when it is built. A is symmetric, its columns are also its rows.
+ */
+typedef struct cheby {
+	int n;
+	int degree;
+	cs *A;
+	double *dinv;
+	double lmin;
+	double lmax;
+	/* Residual and update of the iteration */
+	double *r;
+	double *d;
+} cheby_t;
+
+cheby_t *cheby_setup(cs *A, int degree, double ratio);
+void cheby_apply(cheby_t *ch, double *z, double *b, bool add);
+void print_cheby_info(cheby_t *ch, char *msg);
+void free_cheby(cheby_t *ch);
+
+#endif
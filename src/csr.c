@@ -0,0 +1,310 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <omp.h>
+
+#include "csr.h"
+#include "routines.h"
+
+/*
+ * The kernels are also built for AVX2/FMA and AVX-512 and the loader picks the widest one the CPU has,
+ * the Makefile doesn't target a particular CPU
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define CSR_TARGETS __attribute__((target_clones("arch=skylake-avx512", "arch=haswell", "default")))
+#else
+#define CSR_TARGETS
+#endif
+
+/*
+ * y[r] = sum of a[q] * x[j[q]] for the entries q of the rows r0 to r1 - 1. The rows of the CSR and the
+ * columns of the CCF, for the transposed products, are stored the same way.
+ */
+static CSR_TARGETS void gather_rows(double *y, const int *p, const int *j, const double *a, const double *x,
+									int r0, int r1) {
+	for (int r = r0; r < r1; r++) {
+		double sum = 0.0;
+		for (int q = p[r]; q < p[r + 1]; q++) {
+			sum += a[q] * x[j[q]];
+		}
+		y[r] = sum;
+	}
+}
+
+/*
+ * The same and returns the sum of x[r]*w[r] over the rows, the dot product the solvers take next.
+ * w may be y, every y[r] is written before it's read.
+ */
+static CSR_TARGETS double gather_rows_dot(double *y, const int *p, const int *j, const double *a, const double *x,
+										  const double *w, int r0, int r1) {
+	double dot = 0.0;
+	for (int r = r0; r < r1; r++) {
+		double sum = 0.0;
+		for (int q = p[r]; q < p[r + 1]; q++) {
+			sum += a[q] * x[j[q]];
+		}
+		y[r] = sum;
+		dot += x[r] * w[r];
+	}
+	return dot;
+}
+
+/*
+ * Y = AX for the rows r0 to r1 - 1 of a panel of k columns stored by rows, every entry of A is
+ * loaded once for all the columns. Inlined with the width known for the narrow panels.
+ */
+static inline __attribute__((always_inline)) void gather_rows_block(double *Y, const int *p, const int *j,
+																	const double *a, const double *X, int k,
+																	int r0, int r1) {
+	for (int r = r0; r < r1; r++) {
+		double *y = &Y[(size_t)r * k];
+		for (int c = 0; c < k; c++) {
+			y[c] = 0.0;
+		}
+		for (int q = p[r]; q < p[r + 1]; q++) {
+			const double *x = &X[(size_t)j[q] * k];
+			double aq = a[q];
+			for (int c = 0; c < k; c++) {
+				y[c] += aq * x[c];
+			}
+		}
+	}
+}
+
+/*
+ * The complex one on interleaved real and imaginary parts, conj is -1 to take the conjugate of a. The
+ * products are written out, the complex multiplication of C99 checks every one for infinities and NaNs.
+ */
+static CSR_TARGETS void complex_gather_rows(double *y, const int *p, const int *j, const double *a, const double *x,
+											double conj, int r0, int r1) {
+	for (int r = r0; r < r1; r++) {
+		double re = 0.0, im = 0.0;
+		for (int q = p[r]; q < p[r + 1]; q++) {
+			double ar = a[2 * q], ai = conj * a[2 * q + 1];
+			double xr = x[2 * j[q]], xi = x[2 * j[q] + 1];
+			re += ar * xr - ai * xi;
+			im += ar * xi + ai * xr;
+		}
+		y[2 * r] = re;
+		y[2 * r + 1] = im;
+	}
+}
+
+/* Splits the n rows into chunks among the threads */
+static void gather(double *y, const int *p, const int *j, const double *a, const double *x, int n) {
+	#pragma omp parallel for schedule(static) if (n > CSR_PAR_MIN)
+	for (int r = 0; r < n; r += CSR_CHUNK) {
+		gather_rows(y, p, j, a, x, r, MIN(r + CSR_CHUNK, n));
+	}
+}
+
+static double gather_dot(double *y, const int *p, const int *j, const double *a, const double *x, const double *w,
+						 int n) {
+	double dot = 0.0;
+	#pragma omp parallel for reduction(+:dot) schedule(static) if (n > CSR_PAR_MIN)
+	for (int r = 0; r < n; r += CSR_CHUNK) {
+		dot += gather_rows_dot(y, p, j, a, x, w, r, MIN(r + CSR_CHUNK, n));
+	}
+	return dot;
+}
+
+static void gather_block(double *Y, const int *p, const int *j, const double *a, const double *X, int k, int n) {
+	#pragma omp parallel for schedule(static) if (n > CSR_PAR_MIN)
+	for (int r = 0; r < n; r += CSR_CHUNK) {
+		int r1 = MIN(r + CSR_CHUNK, n);
+		switch (k) {
+			case 1: gather_rows_block(Y, p, j, a, X, 1, r, r1); break;
+			case 2: gather_rows_block(Y, p, j, a, X, 2, r, r1); break;
+			case 3: gather_rows_block(Y, p, j, a, X, 3, r, r1); break;
+			case 4: gather_rows_block(Y, p, j, a, X, 4, r, r1); break;
+			default: gather_rows_block(Y, p, j, a, X, k, r, r1); break;
+		}
+	}
+}
+
+static void complex_gather(double *y, const int *p, const int *j, const double *a, const double *x, double conj, int n) {
+	#pragma omp parallel for schedule(static) if (n > CSR_PAR_MIN)
+	for (int r = 0; r < n; r += CSR_CHUNK) {
+		complex_gather_rows(y, p, j, a, x, conj, r, MIN(r + CSR_CHUNK, n));
+	}
+}
+
+/* Row pointers of the transpose of the pattern of A and the position of every entry of A in it */
+static void transpose_pattern(int n, int m, int *Ap, int *Ai, int *p, int *j, int *map) {
+	int *next = (int *)calloc(n + 1, sizeof(int));
+	assert(next != NULL);
+
+	for (int q = 0; q < Ap[m]; q++) {
+		next[Ai[q]]++;
+	}
+	p[0] = 0;
+	for (int r = 0; r < n; r++) {
+		p[r + 1] = p[r] + next[r];
+		next[r] = p[r];
+	}
+	/* The columns of every row come out in increasing order */
+	for (int c = 0; c < m; c++) {
+		for (int q = Ap[c]; q < Ap[c + 1]; q++) {
+			map[q] = next[Ai[q]]++;
+			j[map[q]] = c;
+		}
+	}
+	free(next);
+}
+
+/*
+ * Returns the CSR mirror of A. If R already mirrors A with the same pattern only the values are
+ * copied over, otherwise R is freed and the mirror is built again.
+ */
+csr_t *csr_mirror(csr_t *R, cs *A) {
+	int nnz = A->p[A->n];
+
+	if (R != NULL && R->A == A && R->n == A->m && R->p[R->n] == nnz) {
+		for (int q = 0; q < nnz; q++) {
+			R->x[R->map[q]] = A->x[q];
+		}
+		return R;
+	}
+	free_csr(R);
+
+	R = (csr_t *)malloc(sizeof(csr_t));
+	assert(R != NULL);
+	R->n = A->m;
+	R->A = A;
+	R->p = (int *)malloc((R->n + 1) * sizeof(int));
+	R->j = (int *)malloc(CS_MAX(nnz, 1) * sizeof(int));
+	R->x = (double *)malloc(CS_MAX(nnz, 1) * sizeof(double));
+	R->map = (int *)malloc(CS_MAX(nnz, 1) * sizeof(int));
+	assert(R->p != NULL && R->j != NULL && R->x != NULL && R->map != NULL);
+
+	transpose_pattern(R->n, A->n, A->p, A->i, R->p, R->j, R->map);
+	for (int q = 0; q < nnz; q++) {
+		R->x[R->map[q]] = A->x[q];
+	}
+	return R;
+}
+
+/* y = Ax */
+void csr_mat_vec_mul(double *y, csr_t *R, double *x) {
+	gather(y, R->p, R->j, R->x, x, R->n);
+}
+
+/* y = A'x, a gather over the columns of the CCF */
+void csr_mat_vec_mul_trans(double *y, csr_t *R, double *x) {
+	gather(y, R->A->p, R->A->i, R->A->x, x, R->A->n);
+}
+
+/* y = Ax and returns x*y, the p*q of CG, without another pass over the vectors */
+double csr_mat_vec_mul_dot(double *y, csr_t *R, double *x) {
+	return gather_dot(y, R->p, R->j, R->x, x, y, R->n);
+}
+
+/* y = A'x and returns x*w, the p_tilde*q of Bi-CG is computed along with q_tilde = A'p_tilde */
+double csr_mat_vec_mul_trans_dot(double *y, csr_t *R, double *x, double *w) {
+	return gather_dot(y, R->A->p, R->A->i, R->A->x, x, w, R->A->n);
+}
+
+/* Y = AX for a panel of k right-hand sides, A is streamed once for all of them */
+void csr_mat_mat_mul(double *Y, csr_t *R, double *X, int k) {
+	gather_block(Y, R->p, R->j, R->x, X, k, R->n);
+}
+
+/*
+ * Times the products of the CCF scatter and of the mirror and prints their GFLOP/s and the bandwidth
+ * they reach, counting the matrix, x and y once per product
+ */
+void csr_benchmark(csr_t *R, char *msg) {
+	int n = R->n, nnz = R->p[n];
+	double flops = 2.0 * nnz * CSR_BENCH_RUNS;
+	double bytes = (12.0 * nnz + 20.0 * n + 4.0) * CSR_BENCH_RUNS;
+	double *x = init_val_vector(n, 1.0);
+	double *y = init_vector(n);
+	double t_csc, t_csr, t_trans;
+
+	t_csc = omp_get_wtime();
+	for (int k = 0; k < CSR_BENCH_RUNS; k++) {
+		cs_mat_vec_mul(y, R->A, x);
+	}
+	t_csc = omp_get_wtime() - t_csc;
+
+	t_csr = omp_get_wtime();
+	for (int k = 0; k < CSR_BENCH_RUNS; k++) {
+		csr_mat_vec_mul(y, R, x);
+	}
+	t_csr = omp_get_wtime() - t_csr;
+
+	t_trans = omp_get_wtime();
+	for (int k = 0; k < CSR_BENCH_RUNS; k++) {
+		csr_mat_vec_mul_trans(y, R, x);
+	}
+	t_trans = omp_get_wtime() - t_trans;
+
+	printf("%s SpMV, %d rows, %d entries, %d threads:\n", msg, n, nnz, n > CSR_PAR_MIN ? omp_get_max_threads() : 1);
+	printf("    CCF scatter  %8.3lf GFLOP/s %8.3lf GB/s\n", flops / t_csc * 1e-9, bytes / t_csc * 1e-9);
+	printf("    CSR          %8.3lf GFLOP/s %8.3lf GB/s\n", flops / t_csr * 1e-9, bytes / t_csr * 1e-9);
+	printf("    Transposed   %8.3lf GFLOP/s %8.3lf GB/s\n", flops / t_trans * 1e-9, bytes / t_trans * 1e-9);
+
+	free(x);
+	free(y);
+}
+
+void free_csr(csr_t *R) {
+	if (R == NULL) {
+		return;
+	}
+	free(R->p);
+	free(R->j);
+	free(R->x);
+	free(R->map);
+	free(R);
+}
+
+/* The complex mirror of A, the same way as the real one */
+complex_csr_t *complex_csr_mirror(complex_csr_t *R, cs_ci *A) {
+	int nnz = A->p[A->n];
+
+	if (R != NULL && R->A == A && R->n == A->m && R->p[R->n] == nnz) {
+		for (int q = 0; q < nnz; q++) {
+			R->x[R->map[q]] = A->x[q];
+		}
+		return R;
+	}
+	free_complex_csr(R);
+
+	R = (complex_csr_t *)malloc(sizeof(complex_csr_t));
+	assert(R != NULL);
+	R->n = A->m;
+	R->A = A;
+	R->p = (int *)malloc((R->n + 1) * sizeof(int));
+	R->j = (int *)malloc(CS_MAX(nnz, 1) * sizeof(int));
+	R->x = (cs_complex_t *)malloc(CS_MAX(nnz, 1) * sizeof(cs_complex_t));
+	R->map = (int *)malloc(CS_MAX(nnz, 1) * sizeof(int));
+	assert(R->p != NULL && R->j != NULL && R->x != NULL && R->map != NULL);
+
+	transpose_pattern(R->n, A->n, A->p, A->i, R->p, R->j, R->map);
+	for (int q = 0; q < nnz; q++) {
+		R->x[R->map[q]] = A->x[q];
+	}
+	return R;
+}
+
+/* y = Ax, the complex vectors are read as interleaved real and imaginary parts */
+void complex_csr_mat_vec_mul(cs_complex_t *y, complex_csr_t *R, cs_complex_t *x) {
+	complex_gather((double *)y, R->p, R->j, (double *)R->x, (double *)x, 1.0, R->n);
+}
+
+/* y = A^H x, a gather over the columns of the CCF with the conjugates of its entries */
+void complex_csr_mat_vec_mul_herm(cs_complex_t *y, complex_csr_t *R, cs_complex_t *x) {
+	complex_gather((double *)y, R->A->p, R->A->i, (double *)R->A->x, (double *)x, -1.0, R->A->n);
+}
+
+void free_complex_csr(complex_csr_t *R) {
+	if (R == NULL) {
+		return;
+	}
+	free(R->p);
+	free(R->j);
+	free(R->x);
+	free(R->map);
+	free(R);
+}
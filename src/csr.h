@@ -0,0 +1,55 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include "../cx_sparse/Include/cs.h"
+
+/* Below this many rows the products run on a single thread */
+#define CSR_PAR_MIN		(1 << 14)
+/* Rows of the chunks the threads take, every chunk is one call of the vectorized kernel */
+#define CSR_CHUNK		512
+/* Products of every kernel the benchmark times */
+#define CSR_BENCH_RUNS	50
+
+/*
+ * Compressed-row mirror of a compressed-column matrix A for the products of the iterative solvers.
+ * Every entry of y = Ax is a gather over a row, so the rows are split among the threads without
+ * atomics and the loop over a row vectorizes, where the product of the CCF scatters into y.
+ * map[q] is the position of the entry q of the CCF in the mirror, so when the values of A change
+ * and its pattern doesn't they are copied over without building the mirror again. The transposed
+ * products are gathers over the columns of the CCF, they use A itself.
+ */
+typedef struct csr {
+	int n;
+	int *p;
+	int *j;
+	double *x;
+	int *map;
+	/* The CCF it mirrors */
+	cs *A;
+} csr_t;
+
+/* The same for the complex G + jwC of the AC analysis */
+typedef struct complex_csr {
+	int n;
+	int *p;
+	int *j;
+	cs_complex_t *x;
+	int *map;
+	cs_ci *A;
+} complex_csr_t;
+
+csr_t *csr_mirror(csr_t *R, cs *A);
+void csr_mat_vec_mul(double *y, csr_t *R, double *x);
+void csr_mat_vec_mul_trans(double *y, csr_t *R, double *x);
+double csr_mat_vec_mul_dot(double *y, csr_t *R, double *x);
+double csr_mat_vec_mul_trans_dot(double *y, csr_t *R, double *x, double *w);
+void csr_mat_mat_mul(double *Y, csr_t *R, double *X, int k);
+void csr_benchmark(csr_t *R, char *msg);
+void free_csr(csr_t *R);
+
+complex_csr_t *complex_csr_mirror(complex_csr_t *R, cs_ci *A);
+void complex_csr_mat_vec_mul(cs_complex_t *y, complex_csr_t *R, cs_complex_t *x);
+void complex_csr_mat_vec_mul_herm(cs_complex_t *y, complex_csr_t *R, cs_complex_t *x);
+void free_complex_csr(complex_csr_t *R);
+
+#endif
@@ -41,6 +41,8 @@ void dc_operating_point(hash_table_t *hash_table, double *sol_x) {
 void dc_sweep_analysis(list1_t *head, hash_table_t *hash_table, mna_system_t *mna, parser_t *parser, double *sol_x) {
     /* Run all the DC analyses according to dc_counter */
     int dc_counter = parser->netlist->dc_counter;
+    /* Heap allocations of the sweep steps, the first step (or panel) isn't counted */
+    long step_allocs = 0;
     if (dc_counter) printf("DC Sweep Analysis........");
     for (int i = 0; i < dc_counter; i++) {
         list1_t *curr;
@@ -62,29 +64,62 @@ void dc_sweep_analysis(list1_t *head, hash_table_t *hash_table, mna_system_t *mn
                 int size = parser->netlist->num_nodes + parser->netlist->num_g2_elem;
                 zero_out_vector(sol_x, size);
 
-                //TODO Add a method in mna_dc.c to set the vector, so that we don't copy-pate the below
-                for (int step = 0; step <= n_steps; step++) {
-                    if (parser->dc_analysis[i].volt_source[0] == 'V' || parser->dc_analysis[i].volt_source[0] == 'v') {
-                        mna->b[volt_indx] = value;
+                long alloc_start = alloc_count();
+                telemetry_begin(mna->telemetry, "dc_sweep", i);
+                /* The iterative SPD systems go through the block CG with the panels below, unless ASYNC solves them */
+                if (parser->options->ITER && (!parser->options->SPD || mna->use_async)) {
+                    for (int step = 0; step <= n_steps; step++) {
+                        set_dc_sweep_rhs(mna, parser->dc_analysis[i].volt_source, volt_indx, probe1_id, probe2_id, value);
+                        /* Solve the system */
+                        solve_mna_system(mna, &sol_x, NULL, parser->options);
+                        /* DC analysis output to every file */
+                        write_dc_out_files(files, parser->dc_analysis[i], hash_table, sol_x, value);
+                        /* Increment value of voltage according to the increment step */
+                        value += parser->dc_analysis[i].increment;
+                        if (step == 0) alloc_start = alloc_count();
                     }
-                    else if (parser->dc_analysis[i].volt_source[0] == 'I' || parser->dc_analysis[i].volt_source[0] == 'i') {
-                        if (probe1_id == 0) {
-                            mna->b[probe2_id - 1] = value;
-                        }
-                        else if (probe2_id == 0) {
-                            mna->b[probe1_id - 1] = -value;
+                    step_allocs += alloc_count() - alloc_start;
+                }
+                /* With the sparse factors and few probed nodes the whole sweep takes two solves for them */
+                else if (!dc_sweep_superposition(files, parser->dc_analysis[i], hash_table, mna, parser->options,
+                                                 volt_indx, probe1_id, probe2_id, n_steps, sol_x, &step_allocs)) {
+                    /*
+                     * The matrix is already factorized, so the right-hand sides of up to DC_RHS_BLOCK steps are
+                     * gathered in a panel and solved together with a single pass through the factors. With the
+                     * block CG the panels take DC_ITER_BLOCK steps, every iteration takes a single pass through the
+                     * matrix for the whole panel and every step starts from the last solution of the previous panel.
+                     */
+                    int width = parser->options->ITER ? DC_ITER_BLOCK : DC_RHS_BLOCK;
+                    double *B = (double *)malloc(size * width * sizeof(double));
+                    double *X = (double *)malloc(size * width * sizeof(double));
+                    assert(B != NULL && X != NULL);
+                    double values[width];
+
+                    for (int first = 0; first <= n_steps; first += width) {
+                        int k = MIN(width, n_steps + 1 - first);
+                        for (int c = 0; c < k; c++) {
+                            set_dc_sweep_rhs(mna, parser->dc_analysis[i].volt_source, volt_indx, probe1_id, probe2_id, value);
+                            for (int row = 0; row < size; row++) {
+                                B[row * k + c] = mna->b[row];
+                                X[row * k + c] = sol_x[row];
+                            }
+                            values[c] = value;
+                            value += parser->dc_analysis[i].increment;
                         }
-                        else {
-                            mna->b[probe1_id - 1] = -value;
-                            mna->b[probe2_id - 1] =  value;
+                        /* Solve the system for all the steps of the panel */
+                        solve_mna_system_block(mna, B, X, k, parser->options);
+                        for (int c = 0; c < k; c++) {
+                            for (int row = 0; row < size; row++) {
+                                sol_x[row] = X[row * k + c];
+                            }
+                            /* DC analysis output to every file */
+                            write_dc_out_files(files, parser->dc_analysis[i], hash_table, sol_x, values[c]);
                         }
+                        if (first == 0) alloc_start = alloc_count();
                     }
-                    /* Solve the system */
-                    solve_mna_system(mna, &sol_x, NULL, parser->options);
-                    /* DC analysis output to every file */
-                    write_dc_out_files(files, parser->dc_analysis[i], hash_table, sol_x, value);
-                    /* Increment value of voltage according to the increment step */
-                    value += parser->dc_analysis[i].increment;
+                    step_allocs += alloc_count() - alloc_start;
+                    free(B);
+                    free(X);
                 }
                 /* Close the file descriptors for the current dc analysis */
                 for (int j = 0; j < parser->dc_analysis[i].num_nodes; j++) {
@@ -97,6 +132,84 @@ void dc_sweep_analysis(list1_t *head, hash_table_t *hash_table, mna_system_t *mn
     }
     if (dc_counter) {
         printf("OK\n");
+        print_partial_info(mna->partial, "DC sweep");
+        print_alloc_count("DC sweep", step_allocs);
+    }
+}
+
+/*
+ * Sweeps on the sparse LU/Cholesky factors of A by superposition. set_dc_sweep_rhs only sets the rows of the
+ * swept source, so b(v) = b(0) + v*e with e nonzero at those one or two rows and x(v) = A^-1 b(0) + v*A^-1 e.
+ * The whole sweep takes the two solves, both of them compute only the probed nodes and the one of e goes
+ * along the reach of its rows. Only the probed rows of sol_x are set, the rest keep what the caller left
+ * there. The allocations after the two solves are added to step_allocs. Returns false without those factors
+ * or when the probed nodes are too many for the partial solves to pay, the steps are solved as panels then.
+ */
+bool dc_sweep_superposition(FILE *files[], dc_analysis_t dc_analysis, hash_table_t *hash_table, mna_system_t *mna,
+                            options_t *options, int volt_indx, int probe1_id, int probe2_id, int n_steps, double *sol_x,
+                            long *step_allocs) {
+    partial_t *ps = mna->partial;
+    if (ps == NULL) {
+        return false;
+    }
+    set_partial_probes(ps, hash_table, dc_analysis.nodes, dc_analysis.num_nodes);
+    if (!partial_pays(ps)) {
+        set_partial_probes(ps, hash_table, NULL, 0);
+        return false;
+    }
+    int size = mna->dimension;
+    /* e, x0 and x1 one after the other in a workspace panel */
+    double *e  = ws_panel(mna->ws, 0, 3);
+    double *x0 = e + size;
+    double *x1 = x0 + size;
+    zero_out_vector(x0, size);
+    zero_out_vector(x1, size);
+
+    /* e = b(1) - b(0), exactly the unit entries of the source */
+    set_dc_sweep_rhs(mna, dc_analysis.volt_source, volt_indx, probe1_id, probe2_id, 1.0);
+    memcpy(e, mna->b, size * sizeof(double));
+    set_dc_sweep_rhs(mna, dc_analysis.volt_source, volt_indx, probe1_id, probe2_id, 0.0);
+    for (int i = 0; i < size; i++) {
+        e[i] -= mna->b[i];
+    }
+
+    bool solved = solve_mna_system_probed(mna, mna->b, x0, options) && solve_mna_system_probed(mna, e, x1, options);
+    if (solved) {
+        long alloc_start = alloc_count();
+        double value = dc_analysis.start;
+        for (int step = 0; step <= n_steps; step++) {
+            for (int j = 0; j < ps->num_probes; j++) {
+                int row = ps->probes[j];
+                sol_x[row] = x0[row] + value * x1[row];
+            }
+            /* DC analysis output to every file */
+            write_dc_out_files(files, dc_analysis, hash_table, sol_x, value);
+            value += dc_analysis.increment;
+        }
+        /* Leave b with the last step, as the solves of every step would */
+        set_dc_sweep_rhs(mna, dc_analysis.volt_source, volt_indx, probe1_id, probe2_id, value - dc_analysis.increment);
+        *step_allocs += alloc_count() - alloc_start;
+    }
+    set_partial_probes(ps, hash_table, NULL, 0);
+    return solved;
+}
+
+/* Sets the value of the swept source to the right-hand side of the MNA system */
+void set_dc_sweep_rhs(mna_system_t *mna, char *volt_source, int volt_indx, int probe1_id, int probe2_id, double value) {
+    if (volt_source[0] == 'V' || volt_source[0] == 'v') {
+        mna->b[volt_indx] = value;
+    }
+    else if (volt_source[0] == 'I' || volt_source[0] == 'i') {
+        if (probe1_id == 0) {
+            mna->b[probe2_id - 1] = value;
+        }
+        else if (probe2_id == 0) {
+            mna->b[probe1_id - 1] = -value;
+        }
+        else {
+            mna->b[probe1_id - 1] = -value;
+            mna->b[probe2_id - 1] =  value;
+        }
     }
 }
 
@@ -109,7 +222,7 @@ void create_dc_out_files(FILE *files[], dc_analysis_t dc_analysis) {
     /* Open different files for each node in plot/print array */
     for (int j = 0; j < dc_analysis.num_nodes; j++) {
         /* Create the name of the output file */
-        sprintf(file_name, "%s%s)_%s_%g_%g_%g.txt", prefix, dc_analysis.nodes[j], dc_analysis.volt_source,
+        snprintf(file_name, MAX_FILE_NAME, "%s%s)_%s_%g_%g_%g.txt", prefix, dc_analysis.nodes[j], dc_analysis.volt_source,
                 dc_analysis.start, dc_analysis.end, dc_analysis.increment);
         /* Open the output file */
         files[j] = fopen(file_name, "w");
@@ -5,10 +5,18 @@
 #include "mna.h"
 #include "routines.h"
 
-#define MAX_FILE_NAME 50
+#define MAX_FILE_NAME 256
+/* Maximum number of DC sweep steps that are solved together as a panel of right-hand sides */
+#define DC_RHS_BLOCK  16
+/* The same for the block CG, its iterations cost about the same however many dependent steps the panel has */
+#define DC_ITER_BLOCK BCG_MAX_BLOCK
 
 void dc_operating_point(hash_table_t *hash_table, double *sol_x);
 void dc_sweep_analysis(list1_t *head, hash_table_t *hash_table, mna_system_t *mna, parser_t *parser, double *sol_x);
+bool dc_sweep_superposition(FILE *files[], dc_analysis_t dc_analysis, hash_table_t *hash_table, mna_system_t *mna,
+                            options_t *options, int volt_indx, int probe1_id, int probe2_id, int n_steps, double *sol_x,
+                            long *step_allocs);
+void set_dc_sweep_rhs(mna_system_t *mna, char *volt_source, int volt_indx, int probe1_id, int probe2_id, double value);
 void create_dc_out_files(FILE *files[], dc_analysis_t dc_analysis);
 void write_dc_out_files(FILE *files[], dc_analysis_t dc_analysis, hash_table_t *hash_table, double *sol_x, double value);
 
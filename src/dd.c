@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include <omp.h>
+
+#include "dd.h"
+#include "ordering.h"
+#include "routines.h"
+
+/*
+ * Orders the unknowns for the decomposition. The bands of the RCM order touch only the bands before
+ * and after them, so the unknowns with a neighbour in a later band are enough to separate them. The
+ * interiors of the bands come first, one after the other, and the interface last.
+ */
+static void partition(dd_t *dd, cs *A) {
+	int n = dd->n;
+	int *rcm = rcm_order(A);
+	int *band = (int *)malloc(n * sizeof(int));
+	char *interface = (char *)calloc(n, sizeof(char));
+	assert(rcm != NULL && band != NULL && interface != NULL);
+
+	for (int k = 0; k < dd->num_domains; k++) {
+		int first = (int)((long)k * n / dd->num_domains), last = (int)((long)(k + 1) * n / dd->num_domains);
+		for (int i = first; i < last; i++) {
+			band[rcm[i]] = k;
+		}
+	}
+	for (int j = 0; j < n; j++) {
+		for (int p = A->p[j]; p < A->p[j + 1]; p++) {
+			int i = A->i[p];
+			if (band[i] > band[j]) interface[j] = 1;
+			if (band[j] > band[i]) interface[i] = 1;
+		}
+	}
+
+	int pos = 0;
+	for (int k = 0; k < dd->num_domains; k++) {
+		dd->dptr[k] = pos;
+		int first = (int)((long)k * n / dd->num_domains), last = (int)((long)(k + 1) * n / dd->num_domains);
+		for (int i = first; i < last; i++) {
+			if (!interface[rcm[i]]) dd->perm[pos++] = rcm[i];
+		}
+	}
+	dd->dptr[dd->num_domains] = dd->ni = pos;
+	for (int i = 0; i < n; i++) {
+		if (interface[rcm[i]]) dd->perm[pos++] = rcm[i];
+	}
+	dd->ng = n - dd->ni;
+
+	cs_free(rcm);
+	free(band);
+	free(interface);
+}
+
+/* Copies the entries of C = PAP' with row in [r0, r1) and column in [c0, c1) to a matrix of their own */
+static cs *extract_block(cs *C, int r0, int r1, int c0, int c1) {
+	int nz = 0;
+	for (int p = C->p[c0]; p < C->p[c1]; p++) {
+		nz += C->i[p] >= r0 && C->i[p] < r1;
+	}
+	cs *B = cs_spalloc(r1 - r0, c1 - c0, MAX(nz, 1), 1, 0);
+	assert(B != NULL);
+	nz = 0;
+	for (int j = c0; j < c1; j++) {
+		B->p[j - c0] = nz;
+		for (int p = C->p[j]; p < C->p[j + 1]; p++) {
+			int i = C->i[p];
+			if (i >= r0 && i < r1) {
+				B->i[nz]   = i - r0;
+				B->x[nz++] = C->x[p];
+			}
+		}
+	}
+	B->p[c1 - c0] = nz;
+	return B;
+}
+
+/* Factorizes M with the Cholesky in the given ordering, returns false if M isn't SPD */
+static bool factor_block(cs *M, order_t order, css **S, csn **N) {
+	order_info_t info;
+	*S = order_symbolic(M, order, false, &info);
+	*N = *S != NULL ? cs_chol(M, *S) : NULL;
+	return *N != NULL;
+}
+
+/* v_I = A_II^-1 v_I, every domain solves its own part of v with its own part of the scratch */
+static void interior_solve(dd_t *dd, double *v) {
+	#pragma omp parallel for schedule(dynamic) if (dd->num_domains > 1 && dd->n > DD_PAR_MIN)
+	for (int k = 0; k < dd->num_domains; k++) {
+		int first = dd->dptr[k], m = dd->dptr[k + 1] - first;
+		cs_ipvec(dd->S[k]->pinv, v + first, dd->w + first, m);
+		cs_lsolve(dd->N[k]->L, dd->w + first);
+		cs_ltsolve(dd->N[k]->L, dd->w + first);
+		cs_pvec(dd->S[k]->pinv, dd->w + first, v + first, m);
+	}
+}
+
+/* t = A_IG v */
+static void interior_coupling(dd_t *dd, double *v, double *t) {
+	int *Cp = dd->AIG->p, *Ci = dd->AIG->i;
+	double *Cx = dd->AIG->x;
+
+	#pragma omp parallel for schedule(static) if (dd->ni > VEC_PAR_MIN)
+	for (int j = 0; j < dd->ni; j++) {
+		double value = 0.0;
+		for (int p = Cp[j]; p < Cp[j + 1]; p++) {
+			value += Cx[p] * v[Ci[p]];
+		}
+		t[j] = value;
+	}
+}
+
+/* out = u - A_GI t, plus A_GG v when v isn't NULL */
+static void interface_coupling(dd_t *dd, double *v, double *t, double *u, double *out) {
+	int *Cp = dd->AGI->p, *Ci = dd->AGI->i, *Gp = dd->AGG->p, *Gi = dd->AGG->i;
+	double *Cx = dd->AGI->x, *Gx = dd->AGG->x;
+
+	#pragma omp parallel for schedule(static) if (dd->ng > VEC_PAR_MIN)
+	for (int j = 0; j < dd->ng; j++) {
+		double value = u != NULL ? u[j] : 0.0;
+		for (int p = Cp[j]; p < Cp[j + 1]; p++) {
+			value -= Cx[p] * t[Ci[p]];
+		}
+		/* A_GG is symmetric, its column j is also its row j */
+		if (v != NULL) {
+			for (int p = Gp[j]; p < Gp[j + 1]; p++) {
+				value += Gx[p] * v[Gi[p]];
+			}
+		}
+		out[j] = value;
+	}
+}
+
+/* out = S v = A_GG v - A_GI A_II^-1 A_IG v */
+static void schur_mul(dd_t *dd, double *v, double *out) {
+	interior_coupling(dd, v, dd->t);
+	interior_solve(dd, dd->t);
+	interface_coupling(dd, v, dd->t, NULL, out);
+}
+
+/*
+ * Couplings of the interface unknowns, column j holds those that are coupled to unknown j directly in
+ * A_GG or through a single interior unknown. It is symmetric.
+ */
+static cs *interface_graph(dd_t *dd) {
+	int ng = dd->ng, nz = 0;
+	int *mark = (int *)malloc(ng * sizeof(int));
+	assert(mark != NULL);
+	cs *P = NULL;
+
+	/* The first pass counts the entries, the second one stores them */
+	for (int pass = 0; pass < 2; pass++) {
+		for (int j = 0; j < ng; j++) mark[j] = -1;
+		nz = 0;
+		for (int j = 0; j < ng; j++) {
+			if (P != NULL) P->p[j] = nz;
+			for (int p = dd->AGG->p[j]; p < dd->AGG->p[j + 1]; p++) {
+				int i = dd->AGG->i[p];
+				if (mark[i] != j) {
+					mark[i] = j;
+					if (P != NULL) P->i[nz] = i;
+					nz++;
+				}
+			}
+			for (int p = dd->AGI->p[j]; p < dd->AGI->p[j + 1]; p++) {
+				int k = dd->AGI->i[p];
+				for (int q = dd->AIG->p[k]; q < dd->AIG->p[k + 1]; q++) {
+					int i = dd->AIG->i[q];
+					if (mark[i] != j) {
+						mark[i] = j;
+						if (P != NULL) P->i[nz] = i;
+						nz++;
+					}
+				}
+			}
+		}
+		if (P == NULL) {
+			P = cs_spalloc(ng, ng, MAX(nz, 1), 1, 0);
+			assert(P != NULL);
+		}
+	}
+	P->p[ng] = nz;
+	free(mark);
+	return P;
+}
+
+/* Pattern of the probed approximation of S, the interface unknowns up to DD_PROBE_HOPS couplings apart */
+static cs *probe_pattern(dd_t *dd) {
+	cs *G = interface_graph(dd);
+	for (int p = 0; p < G->p[dd->ng]; p++) {
+		G->x[p] = 1.0;
+	}
+	cs *P = G;
+	for (int hop = 1; hop < DD_PROBE_HOPS; hop++) {
+		cs *Q = cs_multiply(P, G);
+		assert(Q != NULL);
+		if (P != G) cs_spfree(P);
+		P = Q;
+	}
+	if (P != G) cs_spfree(G);
+	return P;
+}
+
+/*
+ * Greedy coloring of the columns of the symmetric pattern P, the columns of a color have no row in common.
+ * Returns the number of colors.
+ */
+static int probe_colors(cs *P, int *color) {
+	int n = P->n, num_colors = 0;
+	int *used = (int *)malloc((n + 1) * sizeof(int));
+	assert(used != NULL);
+	for (int j = 0; j < n; j++) {
+		color[j] = -1;
+		used[j]  = -1;
+	}
+	used[n] = -1;
+
+	for (int j = 0; j < n; j++) {
+		for (int p = P->p[j]; p < P->p[j + 1]; p++) {
+			int i = P->i[p];
+			for (int q = P->p[i]; q < P->p[i + 1]; q++) {
+				if (color[P->i[q]] >= 0) used[color[P->i[q]]] = j;
+			}
+		}
+		int c = 0;
+		while (used[c] == j) c++;
+		color[j] = c;
+		num_colors = MAX(num_colors, c + 1);
+	}
+	free(used);
+	return num_colors;
+}
+
+/*
+ * Factorizes the preconditioner of the Schur complement. S is probed with the sum of the unit vectors
+ * of every color of the pattern, the product gives the entries of the pattern in the columns of the
+ * color up to the entries of S outside it, which decay away from the diagonal. The probed matrix is
+ * symmetrized and factorized, A_GG is factorized instead if it turns out not to be SPD.
+ */
+static void factor_interface(dd_t *dd, order_t order) {
+	int ng = dd->ng;
+	cs *P = probe_pattern(dd);
+	int *color = (int *)malloc(ng * sizeof(int));
+	assert(color != NULL);
+	dd->colors = probe_colors(P, color);
+
+	for (int c = 0; c < dd->colors; c++) {
+		for (int j = 0; j < ng; j++) {
+			dd->p[j] = color[j] == c ? 1.0 : 0.0;
+		}
+		schur_mul(dd, dd->p, dd->q);
+		for (int j = 0; j < ng; j++) {
+			if (color[j] != c) continue;
+			for (int p = P->p[j]; p < P->p[j + 1]; p++) {
+				P->x[p] = dd->q[P->i[p]];
+			}
+		}
+	}
+	cs *Pt = cs_transpose(P, 1);
+	cs *S_probe = cs_add(P, Pt, 0.5, 0.5);
+	assert(Pt != NULL && S_probe != NULL);
+	cs_spfree(P);
+	cs_spfree(Pt);
+	free(color);
+
+	dd->probed = factor_block(S_probe, order, &dd->SG, &dd->NG);
+	cs_spfree(S_probe);
+	if (!dd->probed) {
+		cs_sfree(dd->SG);
+		if (!factor_block(dd->AGG, order, &dd->SG, &dd->NG)) {
+			fprintf(stderr, "\nDD: the interface block of the matrix is not SPD\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	dd->interface_fill = dd->NG->L->p[ng];
+}
+
+/*
+ * Partitions A into its domains and factorizes their interiors and the interface block, domains > 0
+ * sets their number. Without it there is a domain for every DD_DOMAIN_SIZE unknowns and at least one
+ * for every thread. Frees the previous setup.
+ */
+dd_t *dd_setup(dd_t *dd, cs *A, int domains, order_t order) {
+	free_dd(dd);
+	dd = (dd_t *)calloc(1, sizeof(dd_t));
+	assert(dd != NULL);
+	int n = dd->n = A->n;
+
+	if (domains > 0) {
+		dd->num_domains = MIN(domains, n);
+	}
+	else {
+		dd->num_domains = MIN(MAX((n + DD_DOMAIN_SIZE - 1) / DD_DOMAIN_SIZE, omp_get_max_threads()), n);
+	}
+	dd->num_domains = MAX(dd->num_domains, 1);
+	dd->perm = (int *)malloc(n * sizeof(int));
+	dd->dptr = (int *)malloc((dd->num_domains + 1) * sizeof(int));
+	dd->D    = (cs **)calloc(dd->num_domains, sizeof(cs *));
+	dd->S    = (css **)calloc(dd->num_domains, sizeof(css *));
+	dd->N    = (csn **)calloc(dd->num_domains, sizeof(csn *));
+	assert(dd->perm != NULL && dd->dptr != NULL && dd->D != NULL && dd->S != NULL && dd->N != NULL);
+	partition(dd, A);
+
+	int ni = dd->ni, ng = dd->ng;
+	int *pinv = cs_pinv(dd->perm, n);
+	cs *C = cs_permute(A, pinv, dd->perm, 1);
+	assert(pinv != NULL && C != NULL);
+	dd->AIG = extract_block(C, ni, n, 0, ni);
+	dd->AGI = extract_block(C, 0, ni, ni, n);
+	dd->AGG = extract_block(C, ni, n, ni, n);
+	for (int k = 0; k < dd->num_domains; k++) {
+		dd->D[k] = extract_block(C, dd->dptr[k], dd->dptr[k + 1], dd->dptr[k], dd->dptr[k + 1]);
+	}
+	cs_free(pinv);
+	cs_spfree(C);
+
+	/* Every domain is factorized on its own thread */
+	int failed = -1;
+	long fill = 0;
+	#pragma omp parallel for schedule(dynamic) reduction(+:fill) if (dd->num_domains > 1 && n > DD_PAR_MIN)
+	for (int k = 0; k < dd->num_domains; k++) {
+		if (!factor_block(dd->D[k], order, &dd->S[k], &dd->N[k])) {
+			#pragma omp atomic write
+			failed = k;
+		}
+		else {
+			fill += dd->N[k]->L->p[dd->D[k]->n];
+		}
+	}
+	if (failed >= 0) {
+		fprintf(stderr, "\nDD: domain %d of the matrix is not SPD\n", failed);
+		exit(EXIT_FAILURE);
+	}
+	dd->fill = fill;
+
+	dd->x  = (double *)calloc(n, sizeof(double));
+	dd->b  = (double *)malloc(n * sizeof(double));
+	dd->y  = (double *)malloc(MAX(ni, 1) * sizeof(double));
+	dd->t  = (double *)malloc(MAX(ni, 1) * sizeof(double));
+	dd->w  = (double *)malloc(MAX(ni, 1) * sizeof(double));
+	dd->g  = (double *)malloc(MAX(ng, 1) * sizeof(double));
+	dd->r  = (double *)malloc(MAX(ng, 1) * sizeof(double));
+	dd->z  = (double *)malloc(MAX(ng, 1) * sizeof(double));
+	dd->p  = (double *)malloc(MAX(ng, 1) * sizeof(double));
+	dd->q  = (double *)malloc(MAX(ng, 1) * sizeof(double));
+	dd->wg = (double *)malloc(MAX(ng, 1) * sizeof(double));
+	assert(dd->x != NULL && dd->b != NULL && dd->y != NULL && dd->t != NULL && dd->w != NULL);
+	assert(dd->g != NULL && dd->r != NULL && dd->z != NULL && dd->p != NULL && dd->q != NULL && dd->wg != NULL);
+	if (ng > 0) {
+		factor_interface(dd, order);
+	}
+	return dd;
+}
+
+/* z = M^-1 r with the factorized preconditioner of the Schur complement */
+static void schur_precond(dd_t *dd, double *r, double *z) {
+	cs_ipvec(dd->SG->pinv, r, dd->wg, dd->ng);
+	cs_lsolve(dd->NG->L, dd->wg);
+	cs_ltsolve(dd->NG->L, dd->wg);
+	cs_pvec(dd->SG->pinv, dd->wg, z, dd->ng);
+}
+
+/*
+ * Preconditioned CG on S x_G = g from the x_G of the last solve, stops at ||r|| <= DD_TOL * ||g|| or after
+ * MAX(ng, DD_MIN_ITER) iterations, the solve is counted as unconverged then. Returns the iterations.
+ */
+static int schur_conj_grad(dd_t *dd) {
+	int ng = dd->ng, iter = 0, maxiter = MAX(ng, DD_MIN_ITER);
+	double *x = dd->x + dd->ni, *r = dd->r, *z = dd->z, *p = dd->p, *q = dd->q;
+
+	double g_norm = norm2(dd->g, ng);
+	if (g_norm == 0.0) {
+		zero_out_vector(x, ng);
+		return 0;
+	}
+	schur_mul(dd, x, q);
+	sub_vector(r, dd->g, q, ng);
+	schur_precond(dd, r, z);
+	memcpy(p, z, ng * sizeof(double));
+	double rz = dot_product(r, z, ng);
+
+	double r_norm = norm2(r, ng);
+	while (r_norm > DD_TOL * g_norm && iter < maxiter) {
+		schur_mul(dd, p, q);
+		double a = rz / dot_product(p, q, ng);
+		axpy(x, a, p, x, ng);
+		axpy(r, -a, q, r, ng);
+		schur_precond(dd, r, z);
+		double rz_new = dot_product(r, z, ng);
+		axpy(p, rz_new / rz, p, z, ng);
+		rz = rz_new;
+		r_norm = norm2(r, ng);
+		iter++;
+	}
+	if (r_norm > DD_TOL * g_norm) {
+		printf("DD interface CG reached max iterations without convergence.\n");
+		dd->unconverged++;
+	}
+	return iter;
+}
+
+/*
+ * Solves Ax = b, x also holds the initial guess of the interface. The interface is solved to the
+ * relative residual DD_TOL of its Schur complement system. Returns the CG iterations.
+ */
+int dd_solve(dd_t *dd, double *x, double *b) {
+	int n = dd->n, ni = dd->ni;
+	double start = omp_get_wtime();
+	for (int i = 0; i < n; i++) {
+		dd->x[i] = x[dd->perm[i]];
+		dd->b[i] = b[dd->perm[i]];
+	}
+
+	/* g = b_G - A_GI A_II^-1 b_I */
+	memcpy(dd->y, dd->b, ni * sizeof(double));
+	interior_solve(dd, dd->y);
+	interface_coupling(dd, NULL, dd->y, dd->b + ni, dd->g);
+	int iter = schur_conj_grad(dd);
+
+	/* x_I = A_II^-1 b_I - A_II^-1 A_IG x_G */
+	interior_coupling(dd, dd->x + ni, dd->t);
+	interior_solve(dd, dd->t);
+	sub_vector(dd->x, dd->y, dd->t, ni);
+
+	for (int i = 0; i < n; i++) {
+		x[dd->perm[i]] = dd->x[i];
+	}
+	dd->iterations += iter;
+	dd->solves++;
+	dd->time += omp_get_wtime() - start;
+	return iter;
+}
+
+/* Prints the domains, the interface, their fill, the preconditioner and the iterations and time per solve */
+void print_dd_info(dd_t *dd, char *msg) {
+	if (dd == NULL) return;
+	printf("%s DD: %d domains of ~%d interior unknowns, interface %d, nnz(L) %ld + %ld, %d threads", msg,
+		   dd->num_domains, dd->ni / dd->num_domains, dd->ng, dd->fill, dd->interface_fill, omp_get_max_threads());
+	if (dd->ng > 0) {
+		printf(", %s preconditioner", dd->probed ? "probed S" : "A_GG");
+		if (dd->probed) printf(" with %d colors", dd->colors);
+	}
+	if (dd->solves > 0) {
+		printf(", %.1lf CG iterations and %.6lf s per solve", (double)dd->iterations / dd->solves, dd->time / dd->solves);
+		if (dd->unconverged > 0) {
+			printf(", %d of %d solves above %g", dd->unconverged, dd->solves, DD_TOL);
+		}
+	}
+	printf("\n");
+}
+
+void free_dd(dd_t *dd) {
+	if (dd == NULL) return;
+	for (int k = 0; k < dd->num_domains; k++) {
+		cs_spfree(dd->D[k]);
+		cs_sfree(dd->S[k]);
+		cs_nfree(dd->N[k]);
+	}
+	free(dd->D);
+	free(dd->S);
+	free(dd->N);
+	cs_spfree(dd->AIG);
+	cs_spfree(dd->AGI);
+	cs_spfree(dd->AGG);
+	cs_sfree(dd->SG);
+	cs_nfree(dd->NG);
+	free(dd->perm);
+	free(dd->dptr);
+	free(dd->x);
+	free(dd->b);
+	free(dd->y);
+	free(dd->t);
+	free(dd->w);
+	free(dd->g);
+	free(dd->r);
+	free(dd->z);
+	free(dd->p);
+	free(dd->q);
+	free(dd->wg);
+	free(dd);
+}
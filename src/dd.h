@@ -0,0 +1,83 @@
+#ifndef DD_H
+#define DD_H
+
+#include <stdbool.h>
+
+#include "parser.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Unknowns of a domain when DOMAINS isn't given */
+#define DD_DOMAIN_SIZE	65536
+/* Below this many unknowns the domains are solved on a single thread */
+#define DD_PAR_MIN		(1 << 14)
+/* The probed approximation of the Schur complement keeps the interface unknowns up to this many couplings apart */
+#define DD_PROBE_HOPS	4
+/* DD takes the place of the direct solvers, so the interface is solved to this relative residual and not to ITOL */
+#define DD_TOL			1e-12
+/* Iterations of the interface CG at least before it gives up, and at most the size of the interface above it */
+#define DD_MIN_ITER		100
+
+/*
+ * Non-overlapping domain decomposition of the SPD systems. The unknowns are split into bands of the
+ * RCM order, every unknown of a band that is connected to a later band goes to the interface and the
+ * rest are the interior of its domain, which is then connected only to itself and to the interface.
+ * In this order
+ *
+ *     | A_II  A_IG | | x_I |   | b_I |
+ *     | A_GI  A_GG | | x_G | = | b_G |,  A_II = diag(A_11, ..., A_kk)
+ *
+ * and the interiors are factorized with the sparse Cholesky, every domain on its own thread. The
+ * interface is solved with CG on the Schur complement S = A_GG - A_GI A_II^-1 A_IG, which is never
+ * formed: every product with it takes one solve for each domain. S is preconditioned with the Cholesky
+ * of a sparse approximation of it, probed on the interface unknowns that are a few couplings apart in
+ * A_GG or through the interiors. The interiors are recovered at the end from x_I = A_II^-1 (b_I - A_IG x_G).
+ */
+typedef struct dd {
+	int n;
+	int num_domains;
+	/* Unknowns in the DD order, domain k holds the positions dptr[k] to dptr[k + 1] - 1 and the interface the last ng */
+	int *perm;
+	int *dptr;
+	int ni;
+	int ng;
+	/* Interior blocks of the domains and their Cholesky */
+	cs **D;
+	css **S;
+	csn **N;
+	/* A_IG by column of the interior unknowns and A_GI by column of the interface, both gather their products */
+	cs *AIG;
+	cs *AGI;
+	/* Interface block, the Cholesky of the probed S or of A_GG if that isn't SPD, and the colors of the probing */
+	cs *AGG;
+	css *SG;
+	csn *NG;
+	bool probed;
+	int colors;
+	/* Solution and right-hand side in the DD order, A_II^-1 b_I and the scratch of the interior solves */
+	double *x;
+	double *b;
+	double *y;
+	double *t;
+	double *w;
+	/* Right-hand side of the interface and the vectors of its CG */
+	double *g;
+	double *r;
+	double *z;
+	double *p;
+	double *q;
+	double *wg;
+	/* nnz(L) of the domains and of the interface, the CG iterations, the solves that stopped above DD_TOL and their seconds */
+	long fill;
+	long interface_fill;
+	long iterations;
+	int unconverged;
+	int solves;
+	double time;
+} dd_t;
+
+dd_t *dd_setup(dd_t *dd, cs *A, int domains, order_t order);
+int dd_solve(dd_t *dd, double *x, double *b);
+void print_dd_info(dd_t *dd, char *msg);
+void free_dd(dd_t *dd);
+
+#endif
@@ -0,0 +1,433 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "routines.h"
+#include "dense.h"
+
+/* Below this many updated entries a step runs on a single thread */
+#define DENSE_PAR_MIN	(1 << 15)
+
+/* c[j0:j1] = c[j0:j1] - l[0:kd] U(0:kd, j0:j1), four rows of U at a time. Zero multipliers are skipped */
+static inline void update_row(double *c, const double *l, const double *U, int ldu, int j0, int j1, int kd) {
+	int p = 0;
+	for (; p + 4 <= kd; p += 4) {
+		double a0 = l[p], a1 = l[p+1], a2 = l[p+2], a3 = l[p+3];
+		if (a0 == 0.0 && a1 == 0.0 && a2 == 0.0 && a3 == 0.0) {
+			continue;
+		}
+		const double *u0 = U + p * ldu, *u1 = u0 + ldu, *u2 = u1 + ldu, *u3 = u2 + ldu;
+		#pragma omp simd
+		for (int j = j0; j < j1; j++) {
+			c[j] -= a0 * u0[j] + a1 * u1[j] + a2 * u2[j] + a3 * u3[j];
+		}
+	}
+	for (; p < kd; p++) {
+		double a = l[p];
+		if (a == 0.0) {
+			continue;
+		}
+		const double *u = U + p * ldu;
+		#pragma omp simd
+		for (int j = j0; j < j1; j++) {
+			c[j] -= a * u[j];
+		}
+	}
+}
+
+/* Same as update_row, the products are written out on the real and imaginary parts so that they vectorize */
+static inline void complex_update_row(double complex *c, const double complex *l, const double complex *U, int ldu,
+									  int j0, int j1, int kd) {
+	double *cr = (double *)(c + j0);
+	int len = 2 * (j1 - j0);
+	int p = 0;
+	for (; p + 2 <= kd; p += 2) {
+		double ar0 = creal(l[p]), ai0 = cimag(l[p]), ar1 = creal(l[p+1]), ai1 = cimag(l[p+1]);
+		if (ar0 == 0.0 && ai0 == 0.0 && ar1 == 0.0 && ai1 == 0.0) {
+			continue;
+		}
+		const double *u0 = (const double *)(U + p * ldu + j0), *u1 = (const double *)(U + (p + 1) * ldu + j0);
+		#pragma omp simd
+		for (int j = 0; j < len; j += 2) {
+			cr[j]   -= ar0 * u0[j]   - ai0 * u0[j+1] + ar1 * u1[j]   - ai1 * u1[j+1];
+			cr[j+1] -= ar0 * u0[j+1] + ai0 * u0[j]   + ar1 * u1[j+1] + ai1 * u1[j];
+		}
+	}
+	for (; p < kd; p++) {
+		double ar = creal(l[p]), ai = cimag(l[p]);
+		if (ar == 0.0 && ai == 0.0) {
+			continue;
+		}
+		const double *u = (const double *)(U + p * ldu + j0);
+		#pragma omp simd
+		for (int j = 0; j < len; j += 2) {
+			cr[j]   -= ar * u[j]   - ai * u[j+1];
+			cr[j+1] -= ar * u[j+1] + ai * u[j];
+		}
+	}
+}
+
+/*
+ * C = C - L U, where C is m x nc, L is m x kd and U is kd x nc (kd is at most DENSE_BLOCK).
+ * C is split in tiles of DENSE_BLOCK rows and DENSE_TILE columns that are updated in parallel.
+ * With lower set C is square and only its lower triangle is updated.
+ */
+static void gemm_update(double *C, int ldc, const double *L, int ldl, const double *U, int ldu,
+						int m, int nc, int kd, bool lower) {
+	int row_tiles = (m + DENSE_BLOCK - 1) / DENSE_BLOCK, col_tiles = (nc + DENSE_TILE - 1) / DENSE_TILE;
+	#pragma omp parallel for collapse(2) schedule(dynamic) if ((double)m * nc > DENSE_PAR_MIN)
+	for (int ti = 0; ti < row_tiles; ti++) {
+		for (int tj = 0; tj < col_tiles; tj++) {
+			int i0 = ti * DENSE_BLOCK, i1 = MIN(i0 + DENSE_BLOCK, m);
+			int j0 = tj * DENSE_TILE, j1 = MIN(j0 + DENSE_TILE, nc);
+			for (int i = i0; i < i1; i++) {
+				int j_end = lower ? MIN(j1, i + 1) : j1;
+				if (j_end > j0) {
+					update_row(C + (size_t)i * ldc, L + (size_t)i * ldl, U, ldu, j0, j_end, kd);
+				}
+			}
+		}
+	}
+}
+
+static void complex_gemm_update(double complex *C, int ldc, const double complex *L, int ldl, const double complex *U,
+								int ldu, int m, int nc, int kd, bool lower) {
+	int row_tiles = (m + DENSE_BLOCK - 1) / DENSE_BLOCK, col_tiles = (nc + DENSE_TILE - 1) / DENSE_TILE;
+	#pragma omp parallel for collapse(2) schedule(dynamic) if ((double)m * nc > DENSE_PAR_MIN / 4)
+	for (int ti = 0; ti < row_tiles; ti++) {
+		for (int tj = 0; tj < col_tiles; tj++) {
+			int i0 = ti * DENSE_BLOCK, i1 = MIN(i0 + DENSE_BLOCK, m);
+			int j0 = tj * DENSE_TILE, j1 = MIN(j0 + DENSE_TILE, nc);
+			for (int i = i0; i < i1; i++) {
+				int j_end = lower ? MIN(j1, i + 1) : j1;
+				if (j_end > j0) {
+					complex_update_row(C + (size_t)i * ldc, L + (size_t)i * ldl, U, ldu, j0, j_end, kd);
+				}
+			}
+		}
+	}
+}
+
+/* Swaps rows i and j of A and their entries in the permutation */
+static void swap_rows(double *A, int n, int lda, size_t *perm, int i, int j) {
+	double *a = A + (size_t)i * lda, *b = A + (size_t)j * lda;
+	for (int c = 0; c < n; c++) {
+		double temp = a[c];
+		a[c] = b[c];
+		b[c] = temp;
+	}
+	size_t temp = perm[i];
+	perm[i] = perm[j];
+	perm[j] = temp;
+}
+
+static void complex_swap_rows(double complex *A, int n, int lda, size_t *perm, int i, int j) {
+	double complex *a = A + (size_t)i * lda, *b = A + (size_t)j * lda;
+	for (int c = 0; c < n; c++) {
+		double complex temp = a[c];
+		a[c] = b[c];
+		b[c] = temp;
+	}
+	size_t temp = perm[i];
+	perm[i] = perm[j];
+	perm[j] = temp;
+}
+
+/*
+ * Unblocked LU with partial pivoting of the panel A(k0:n, k0:k0+nb). Rows are swapped in their whole length,
+ * so the pivots are also applied to the L computed so far and to the columns right of the panel.
+ */
+static void lu_panel(double *A, int n, int lda, size_t *perm, int k0, int nb) {
+	int k1 = k0 + nb;
+	for (int j = k0; j < k1; j++) {
+		int piv = j;
+		double max = fabs(A[(size_t)j * lda + j]);
+		for (int i = j + 1; i < n; i++) {
+			if (fabs(A[(size_t)i * lda + j]) > max) {
+				max = fabs(A[(size_t)i * lda + j]);
+				piv = i;
+			}
+		}
+		if (max == 0.0) {
+			fprintf(stderr, "LU decomposition failed, the matrix is singular.\n");
+			exit(EXIT_FAILURE);
+		}
+		if (piv != j) {
+			swap_rows(A, n, lda, perm, j, piv);
+		}
+		double *pivot_row = A + (size_t)j * lda;
+		#pragma omp parallel for schedule(static) if ((double)(n - j) * (k1 - j) > DENSE_PAR_MIN)
+		for (int i = j + 1; i < n; i++) {
+			double *row = A + (size_t)i * lda;
+			if (row[j] != 0.0) {
+				row[j] /= pivot_row[j];
+				for (int c = j + 1; c < k1; c++) {
+					row[c] -= row[j] * pivot_row[c];
+				}
+			}
+		}
+	}
+}
+
+static void complex_lu_panel(double complex *A, int n, int lda, size_t *perm, int k0, int nb) {
+	int k1 = k0 + nb;
+	for (int j = k0; j < k1; j++) {
+		int piv = j;
+		double max = cabs(A[(size_t)j * lda + j]);
+		for (int i = j + 1; i < n; i++) {
+			if (cabs(A[(size_t)i * lda + j]) > max) {
+				max = cabs(A[(size_t)i * lda + j]);
+				piv = i;
+			}
+		}
+		if (max == 0.0) {
+			fprintf(stderr, "Complex LU decomposition failed, the matrix is singular.\n");
+			exit(EXIT_FAILURE);
+		}
+		if (piv != j) {
+			complex_swap_rows(A, n, lda, perm, j, piv);
+		}
+		double complex *pivot_row = A + (size_t)j * lda;
+		#pragma omp parallel for schedule(static) if ((double)(n - j) * (k1 - j) > DENSE_PAR_MIN / 4)
+		for (int i = j + 1; i < n; i++) {
+			double complex *row = A + (size_t)i * lda;
+			if (row[j] != 0.0) {
+				row[j] /= pivot_row[j];
+				for (int c = j + 1; c < k1; c++) {
+					row[c] -= CS_COMPLEX_MUL(row[j], pivot_row[c]);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * U12 = L11^-1 A12, where L11 is the unit lower triangle of the panel rows k0:k1 and A12 their part right of the panel.
+ * The columns are split in tiles that are solved in parallel.
+ */
+static void lu_row_solve(double *A, int n, int lda, int k0, int k1) {
+	#pragma omp parallel for schedule(dynamic) if ((double)(k1 - k0) * (n - k1) > DENSE_PAR_MIN)
+	for (int c0 = k1; c0 < n; c0 += DENSE_TILE) {
+		int c1 = MIN(c0 + DENSE_TILE, n);
+		for (int i = k0 + 1; i < k1; i++) {
+			double *row = A + (size_t)i * lda;
+			update_row(row, row + k0, A + (size_t)k0 * lda, lda, c0, c1, i - k0);
+		}
+	}
+}
+
+static void complex_lu_row_solve(double complex *A, int n, int lda, int k0, int k1) {
+	#pragma omp parallel for schedule(dynamic) if ((double)(k1 - k0) * (n - k1) > DENSE_PAR_MIN / 4)
+	for (int c0 = k1; c0 < n; c0 += DENSE_TILE) {
+		int c1 = MIN(c0 + DENSE_TILE, n);
+		for (int i = k0 + 1; i < k1; i++) {
+			double complex *row = A + (size_t)i * lda;
+			complex_update_row(row, row + k0, A + (size_t)k0 * lda, lda, c0, c1, i - k0);
+		}
+	}
+}
+
+/* Blocked right-looking LU decomposition with partial pivoting, PA = LU */
+void dense_lu(double *A, int n, int lda, size_t *perm) {
+	for (int i = 0; i < n; i++) {
+		perm[i] = i;
+	}
+	for (int k0 = 0; k0 < n; k0 += DENSE_BLOCK) {
+		int k1 = MIN(k0 + DENSE_BLOCK, n);
+		lu_panel(A, n, lda, perm, k0, k1 - k0);
+		lu_row_solve(A, n, lda, k0, k1);
+		/* A22 = A22 - L21 U12 */
+		gemm_update(A + (size_t)k1 * lda + k1, lda, A + (size_t)k1 * lda + k0, lda, A + (size_t)k0 * lda + k1, lda,
+					n - k1, n - k1, k1 - k0, false);
+	}
+}
+
+void dense_complex_lu(double complex *A, int n, int lda, size_t *perm) {
+	for (int i = 0; i < n; i++) {
+		perm[i] = i;
+	}
+	for (int k0 = 0; k0 < n; k0 += DENSE_BLOCK) {
+		int k1 = MIN(k0 + DENSE_BLOCK, n);
+		complex_lu_panel(A, n, lda, perm, k0, k1 - k0);
+		complex_lu_row_solve(A, n, lda, k0, k1);
+		complex_gemm_update(A + (size_t)k1 * lda + k1, lda, A + (size_t)k1 * lda + k0, lda, A + (size_t)k0 * lda + k1,
+							lda, n - k1, n - k1, k1 - k0, false);
+	}
+}
+
+/* Solves LUx = Pb with the factors of dense_lu, b and x must not overlap */
+void dense_lu_solve(double *LU, int n, int lda, size_t *perm, double *b, double *x) {
+	assert(b != x);
+	for (int i = 0; i < n; i++) {
+		const double *row = LU + (size_t)i * lda;
+		double sum = b[perm[i]];
+		for (int j = 0; j < i; j++) {
+			sum -= row[j] * x[j];
+		}
+		x[i] = sum;
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		const double *row = LU + (size_t)i * lda;
+		double sum = x[i];
+		for (int j = i + 1; j < n; j++) {
+			sum -= row[j] * x[j];
+		}
+		x[i] = sum / row[i];
+	}
+}
+
+void dense_complex_lu_solve(double complex *LU, int n, int lda, size_t *perm, double complex *b, double complex *x) {
+	assert(b != x);
+	for (int i = 0; i < n; i++) {
+		const double complex *row = LU + (size_t)i * lda;
+		double complex sum = b[perm[i]];
+		for (int j = 0; j < i; j++) {
+			sum -= CS_COMPLEX_MUL(row[j], x[j]);
+		}
+		x[i] = sum;
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		const double complex *row = LU + (size_t)i * lda;
+		double complex sum = x[i];
+		for (int j = i + 1; j < n; j++) {
+			sum -= CS_COMPLEX_MUL(row[j], x[j]);
+		}
+		x[i] = sum / row[i];
+	}
+}
+
+/*
+ * Blocked right-looking Cholesky decomposition, A = LL'. Only the lower triangle of A is read.
+ * The transpose of every block column of L is packed in a workspace so that the trailing update
+ * runs over contiguous rows, the same kernel as the LU one.
+ */
+void dense_cholesky(double *A, int n, int lda) {
+	double *W = (double *)malloc((size_t)DENSE_BLOCK * MAX(n, 1) * sizeof(double));
+	assert(W != NULL);
+	for (int k0 = 0; k0 < n; k0 += DENSE_BLOCK) {
+		int k1 = MIN(k0 + DENSE_BLOCK, n), m = n - k1;
+		/* A11 = L11 L11' */
+		for (int j = k0; j < k1; j++) {
+			double *row_j = A + (size_t)j * lda;
+			for (int i = j; i < k1; i++) {
+				double *row_i = A + (size_t)i * lda;
+				double sum = row_i[j];
+				for (int p = k0; p < j; p++) {
+					sum -= row_i[p] * row_j[p];
+				}
+				if (i == j) {
+					if (sum <= 0.0) {
+						fprintf(stderr, "Cholesky decomposition failed, the matrix is not positive definite.\n");
+						exit(EXIT_FAILURE);
+					}
+					row_j[j] = sqrt(sum);
+				}
+				else {
+					row_i[j] = sum / row_j[j];
+				}
+			}
+		}
+		/* L21 = A21 L11^-T and W = L21' */
+		#pragma omp parallel for schedule(static) if ((double)m * (k1 - k0) > DENSE_PAR_MIN)
+		for (int i = k1; i < n; i++) {
+			double *row_i = A + (size_t)i * lda;
+			for (int j = k0; j < k1; j++) {
+				const double *row_j = A + (size_t)j * lda;
+				double sum = row_i[j];
+				for (int p = k0; p < j; p++) {
+					sum -= row_i[p] * row_j[p];
+				}
+				row_i[j] = sum / row_j[j];
+				W[(size_t)(j - k0) * m + (i - k1)] = row_i[j];
+			}
+		}
+		/* A22 = A22 - L21 L21' */
+		gemm_update(A + (size_t)k1 * lda + k1, lda, A + (size_t)k1 * lda + k0, lda, W, m, m, m, k1 - k0, true);
+	}
+	free(W);
+}
+
+/* Blocked right-looking Cholesky decomposition of a Hermitian matrix, A = LL^H. Only the lower triangle of A is read */
+void dense_complex_cholesky(double complex *A, int n, int lda) {
+	double complex *W = (double complex *)malloc((size_t)DENSE_BLOCK * MAX(n, 1) * sizeof(double complex));
+	assert(W != NULL);
+	for (int k0 = 0; k0 < n; k0 += DENSE_BLOCK) {
+		int k1 = MIN(k0 + DENSE_BLOCK, n), m = n - k1;
+		/* A11 = L11 L11^H */
+		for (int j = k0; j < k1; j++) {
+			double complex *row_j = A + (size_t)j * lda;
+			for (int i = j; i < k1; i++) {
+				double complex *row_i = A + (size_t)i * lda;
+				double complex sum = row_i[j];
+				for (int p = k0; p < j; p++) {
+					sum -= CS_COMPLEX_MUL(row_i[p], conj(row_j[p]));
+				}
+				if (i == j) {
+					if (creal(sum) <= 0.0) {
+						fprintf(stderr, "Complex Cholesky decomposition failed, the matrix is not positive definite.\n");
+						exit(EXIT_FAILURE);
+					}
+					row_j[j] = sqrt(creal(sum));
+				}
+				else {
+					row_i[j] = sum / creal(row_j[j]);
+				}
+			}
+		}
+		/* L21 = A21 L11^-H and W = L21^H */
+		#pragma omp parallel for schedule(static) if ((double)m * (k1 - k0) > DENSE_PAR_MIN / 4)
+		for (int i = k1; i < n; i++) {
+			double complex *row_i = A + (size_t)i * lda;
+			for (int j = k0; j < k1; j++) {
+				const double complex *row_j = A + (size_t)j * lda;
+				double complex sum = row_i[j];
+				for (int p = k0; p < j; p++) {
+					sum -= CS_COMPLEX_MUL(row_i[p], conj(row_j[p]));
+				}
+				row_i[j] = sum / creal(row_j[j]);
+				W[(size_t)(j - k0) * m + (i - k1)] = conj(row_i[j]);
+			}
+		}
+		/* A22 = A22 - L21 L21^H */
+		complex_gemm_update(A + (size_t)k1 * lda + k1, lda, A + (size_t)k1 * lda + k0, lda, W, m, m, m, k1 - k0, true);
+	}
+	free(W);
+}
+
+/* Solves LL'x = b with the factor of dense_cholesky, the backward solve runs over the rows of L */
+void dense_cholesky_solve(double *L, int n, int lda, double *b, double *x) {
+	for (int i = 0; i < n; i++) {
+		const double *row = L + (size_t)i * lda;
+		double sum = b[i];
+		for (int j = 0; j < i; j++) {
+			sum -= row[j] * x[j];
+		}
+		x[i] = sum / row[i];
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		const double *row = L + (size_t)i * lda;
+		x[i] /= row[i];
+		for (int j = 0; j < i; j++) {
+			x[j] -= row[j] * x[i];
+		}
+	}
+}
+
+void dense_complex_cholesky_solve(double complex *L, int n, int lda, double complex *b, double complex *x) {
+	for (int i = 0; i < n; i++) {
+		const double complex *row = L + (size_t)i * lda;
+		double complex sum = b[i];
+		for (int j = 0; j < i; j++) {
+			sum -= CS_COMPLEX_MUL(row[j], x[j]);
+		}
+		x[i] = sum / creal(row[i]);
+	}
+	for (int i = n - 1; i >= 0; i--) {
+		const double complex *row = L + (size_t)i * lda;
+		x[i] /= creal(row[i]);
+		for (int j = 0; j < i; j++) {
+			x[j] -= CS_COMPLEX_MUL(conj(row[j]), x[i]);
+		}
+	}
+}
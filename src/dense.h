@@ -0,0 +1,28 @@
+#ifndef DENSE_H
+#define DENSE_H
+
+#include <stddef.h>
+#include <complex.h>
+
+/* Width of the panels, every panel is factorized column by column and then the trailing matrix is updated at once */
+#define DENSE_BLOCK		64
+/* Columns of a tile in the trailing matrix update, a tile of the panel rows stays in the L2 cache */
+#define DENSE_TILE		256
+
+/*
+ * Blocked right-looking factorizations of dense row major matrices, lda is the distance between two rows.
+ * The LU factorization stores PA = LU in place of A (L with unit diagonal), where row i of PA is row perm[i] of A,
+ * the same layout gsl_linalg_LU_decomp uses. The Cholesky factorizations store L in the lower triangle of A,
+ * A = LL' for real and A = LL^H for complex matrices. The upper triangle is left as it was.
+ */
+void dense_lu(double *A, int n, int lda, size_t *perm);
+void dense_lu_solve(double *LU, int n, int lda, size_t *perm, double *b, double *x);
+void dense_cholesky(double *A, int n, int lda);
+void dense_cholesky_solve(double *L, int n, int lda, double *b, double *x);
+
+void dense_complex_lu(double complex *A, int n, int lda, size_t *perm);
+void dense_complex_lu_solve(double complex *LU, int n, int lda, size_t *perm, double complex *b, double complex *x);
+void dense_complex_cholesky(double complex *A, int n, int lda);
+void dense_complex_cholesky_solve(double complex *L, int n, int lda, double complex *b, double complex *x);
+
+#endif
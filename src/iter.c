@@ -2,23 +2,89 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <assert.h>
 
 #include "iter.h"
 
+/*
+ * The sparse products of the solvers, with the CSR mirror in the workspace when it mirrors the CCF C
+ * the solver got, and with C itself otherwise
+ */
+static inline void op_mat_vec_mul(workspace_t *ws, double *y, cs *C, double *x) {
+	if (ws->csr != NULL && ws->csr->A == C) {
+		csr_mat_vec_mul(y, ws->csr, x);
+	}
+	else {
+		cs_mat_vec_mul(y, C, x);
+	}
+}
+
+static inline void op_mat_vec_mul_trans(workspace_t *ws, double *y, cs *C, double *x) {
+	if (ws->csr != NULL && ws->csr->A == C) {
+		csr_mat_vec_mul_trans(y, ws->csr, x);
+	}
+	else {
+		cs_mat_vec_mul_trans(y, C, x);
+	}
+}
+
+/* y = Ax and returns x*y, in the same pass with the mirror */
+static inline double op_mat_vec_mul_dot(workspace_t *ws, double *y, cs *C, double *x) {
+	if (ws->csr != NULL && ws->csr->A == C) {
+		return csr_mat_vec_mul_dot(y, ws->csr, x);
+	}
+	cs_mat_vec_mul(y, C, x);
+	return dot_product(x, y, C->n);
+}
+
+/* y = A'x and returns x*w, in the same pass with the mirror */
+static inline double op_mat_vec_mul_trans_dot(workspace_t *ws, double *y, cs *C, double *x, double *w) {
+	if (ws->csr != NULL && ws->csr->A == C) {
+		return csr_mat_vec_mul_trans_dot(y, ws->csr, x, w);
+	}
+	cs_mat_vec_mul_trans(y, C, x);
+	return dot_product(x, w, C->n);
+}
+
+static inline void complex_op_mat_vec_mul(workspace_t *ws, cs_complex_t *y, cs_ci *C, cs_complex_t *x) {
+	if (ws->complex_csr != NULL && ws->complex_csr->A == C) {
+		complex_csr_mat_vec_mul(y, ws->complex_csr, x);
+	}
+	else {
+		complex_cs_mat_vec_mul(y, C, x);
+	}
+}
+
+static inline void complex_op_mat_vec_mul_herm(workspace_t *ws, cs_complex_t *y, cs_ci *C, cs_complex_t *x) {
+	if (ws->complex_csr != NULL && ws->complex_csr->A == C) {
+		complex_csr_mat_vec_mul_herm(y, ws->complex_csr, x);
+	}
+	else {
+		complex_cs_mat_vec_mul_herm(y, C, x);
+	}
+}
+
 /* 
  * Solve the SPD system with the iterative conjugate gradient method
  * store the result in vector x and also return the number of iterations
  */ 
-int conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension, double itol, int maxiter, bool SPARSE) {
-	double *Ax = (double *)malloc(dimension * sizeof(double));
+int conj_grad(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+			  workspace_t *ws, recycle_t *rc) {
+	/* The vectors are taken from the workspace */
+	double *Ax = ws->iter[0];
 	/* Residual vector r */
-	double *r  = (double *)malloc(dimension * sizeof(double));
-	/* Alocate z vector: solution of preconditioner */
-	double *z  = (double *)malloc(dimension * sizeof(double));
-	double *p  = (double *)malloc(dimension * sizeof(double));
-	double *q  = (double *)malloc(dimension * sizeof(double));
-	double r_norm, b_norm, rho, rho1, alpha, beta;
+	double *r  = ws->iter[1];
+	/* z vector: solution of preconditioner */
+	double *z  = ws->iter[2];
+	double *p  = ws->iter[3];
+	double *q  = ws->iter[4];
+	double r_norm, b_norm, rho, rho1 = 1.0, alpha, beta, pq;
 	int iter = 0;
+	/*
+	 * With the Jacobi preconditioner and no deflation space z = M*r is never stored, the fused kernels
+	 * apply M on the fly and compute the next rho while they update x and r
+	 */
+	double *d = (M->type == PRE_JACOBI && (rc == NULL || rc->max_m == 0)) ? M->M : NULL;
 
 	if (!SPARSE) {
 		/* Compute A*x and store it to Ax */
@@ -26,11 +92,15 @@ int conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension,
 	}
 	else {
 		/* Compute A*x and store it ot Ax , C is CCF of A */
-		cs_mat_vec_mul(Ax, C, x);
+		op_mat_vec_mul(ws, Ax, C, x);
 	}
 	
 	/* Compute r = b - Ax */
 	sub_vector(r, b, Ax, dimension);
+	if (rc != NULL) {
+		/* Project out the deflation space from the initial residual */
+		recycle_start(rc, x, r);
+	}
 
 	/* Initialize norm2 of b and r vectors */
 	r_norm = norm2(r, dimension);
@@ -38,46 +108,478 @@ int conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension,
 	/* Set b_norm = 1 in case it's zero to avoid seg fault */
 	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
 
-	while (iter < maxiter && (r_norm / b_norm) > itol) {
+	/*
+	 * A guess extrapolated from the previous steps gets at least one iteration even if it's below itol,
+	 * otherwise the errors of the accepted guesses add up from step to step. Only an exact one is kept as is.
+	 */
+	bool refine = rc != NULL && r_norm != 0.0;
+	ws_trace(ws, r_norm / b_norm);
+
+	if (d != NULL) {
+		/* rho = r*z for the first iteration */
+		rho = scaled_dot_product(r, d, r, dimension);
+	}
+	while (iter < maxiter && ((r_norm / b_norm) > itol || (refine && iter == 0))) {
 		iter++;
-		/* Solution of the preconditioner Mz = r */
-		precond_solve(z, M, r, dimension);
-		/* rho = r*z */
-		rho = dot_product(r, z, dimension);
-		if (iter == 1) {
-			/* Set p = z */
-			memcpy(p, z, dimension * sizeof(double));
+		if (d != NULL && iter == 1) {
+			/* Set p = z = d.*r */
+			precond_solve(p, d, r, dimension);
+		}
+		else if (d != NULL) {
+			/* p = z + beta*p with z = d.*r, rho came from the last update */
+			jacobi_xpby(p, d, r, rho / rho1, dimension);
 		}
 		else {
-			beta = rho / rho1;
-			/* p = z + beta*p */
-			axpy(p, beta, p, z, dimension);
+			/* Solution of the preconditioner Mz = r */
+			apply_precond(z, M, r);
+			/* rho = r*z */
+			rho = dot_product(r, z, dimension);
+			if (iter == 1) {
+				/* Set p = z */
+				memcpy(p, z, dimension * sizeof(double));
+			}
+			else {
+				beta = rho / rho1;
+				/* p = z + beta*p */
+				axpy(p, beta, p, z, dimension);
+			}
+			if (rc != NULL) {
+				/* Keep p A-orthogonal to the deflation space */
+				recycle_deflate(rc, p, z);
+			}
 		}
 		rho1 = rho;
 		if (SPARSE) {
-			/* q = A*p, C is CCF of A */
-			cs_mat_vec_mul(q, C, p);
+			/* q = A*p and p*q, C is CCF of A */
+			pq = op_mat_vec_mul_dot(ws, q, C, p);
 		}
 		else {
 			/* q = A*p */
 			mat_vec_mul(q, A, p, dimension);
+			pq = dot_product(p, q, dimension);
+		}
+		if (rc != NULL) {
+			recycle_collect(rc, p, q);
 		}
 		/* a = rho / p*q */
-		alpha = rho / dot_product(p, q, dimension);
-		/* x = x + alpha*p */
-		axpy(x,  alpha, p, x, dimension);
-		/* r = r - alpha*q */
-		axpy(r, -alpha, q, r, dimension);
-		r_norm = norm2(r, dimension);
+		alpha = rho / pq;
+		/* x = x + alpha*p, r = r - alpha*q and the norm of r in one pass */
+		r_norm = sqrt(cg_update(x, r, p, q, alpha, d, &rho, dimension));
+		ws_trace(ws, r_norm / b_norm);
+	}
+
+	if (rc != NULL) {
+		recycle_update(rc, iter);
+	}
+	ws->residual = r_norm / b_norm;
+	return iter;
+}
+
+/* y = Ax with the dense A or the CCF C, for the pipelined CG */
+static inline void pipe_mat_vec_mul(double **A, cs *C, workspace_t *ws, double *y, double *x, int dimension,
+									bool SPARSE) {
+	if (SPARSE) {
+		op_mat_vec_mul(ws, y, C, x);
+	}
+	else {
+		mat_vec_mul(y, A, x, dimension);
+	}
+}
+
+/*
+ * Residual replacement of the pipelined CG: the recurrences of r, u = inv(M)r, w = Au and of s = Ap,
+ * q = inv(M)s, z = Aq drift apart from the vectors they stand for, so they are computed again from x
+ * and p. Returns r*r and sets gamma = r*u and delta = w*u.
+ */
+static double pipe_replace(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, bool SPARSE,
+						   workspace_t *ws, double *gamma, double *delta) {
+	double *r = ws->iter[0], *u = ws->iter[1], *w = ws->iter[2];
+	double *p = ws->iter[5], *s = ws->iter[6], *q = ws->iter[7], *z = ws->iter[8];
+
+	pipe_mat_vec_mul(A, C, ws, w, x, dimension, SPARSE);
+	sub_vector(r, b, w, dimension);
+	apply_precond(u, M, r);
+	pipe_mat_vec_mul(A, C, ws, w, u, dimension, SPARSE);
+	pipe_mat_vec_mul(A, C, ws, s, p, dimension, SPARSE);
+	apply_precond(q, M, s);
+	pipe_mat_vec_mul(A, C, ws, z, q, dimension, SPARSE);
+	*gamma = dot_product(r, u, dimension);
+	*delta = dot_product(w, u, dimension);
+	return dot_product(r, r, dimension);
+}
+
+/*
+ * Solve the SPD system with the pipelined conjugate gradient method of Ghysels and Vanroose, store
+ * the result in vector x and also return the number of iterations. The recurrences of u = inv(M)r,
+ * w = Au and of their search directions take the place of the two dot products of CG that wait on
+ * each other: the dot products of an iteration are computed in the pass that updates the vectors,
+ * so every iteration has one reduction, and the preconditioner and the product with A that follow
+ * don't depend on it. The residuals are replaced every PIPECG_REPLACE iterations and before the
+ * solve stops, the recurrences lose accuracy faster than those of CG. The deflation space of the
+ * transient steps only projects the initial residual, the search directions aren't kept A-orthogonal
+ * to it, and s = Ap is collected along with p for its refreshes.
+ */
+int pipe_conj_grad(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter,
+				   bool SPARSE, workspace_t *ws, recycle_t *rc) {
+	/* The vectors are taken from the workspace */
+	double *r = ws->iter[0];
+	/* u = inv(M)r and w = Au */
+	double *u = ws->iter[1];
+	double *w = ws->iter[2];
+	/* m = inv(M)w and n = Am */
+	double *m = ws->iter[3];
+	double *n = ws->iter[4];
+	/* Search direction p and s = Ap, q = inv(M)s, z = Aq */
+	double *p = ws->iter[5];
+	double *s = ws->iter[6];
+	double *q = ws->iter[7];
+	double *z = ws->iter[8];
+	double rr, b_norm, gamma, gamma1 = 0.0, delta, alpha, alpha1 = 0.0, beta;
+	int iter = 0;
+
+	/* Compute r = b - Ax, n holds A*x */
+	pipe_mat_vec_mul(A, C, ws, n, x, dimension, SPARSE);
+	sub_vector(r, b, n, dimension);
+	if (rc != NULL) {
+		recycle_start(rc, x, r);
+	}
+	apply_precond(u, M, r);
+	pipe_mat_vec_mul(A, C, ws, w, u, dimension, SPARSE);
+	gamma = dot_product(r, u, dimension);
+	delta = dot_product(w, u, dimension);
+	rr = dot_product(r, r, dimension);
+	/* The first search directions are u, w, m and n themselves */
+	memset(p, 0, dimension * sizeof(double));
+	memset(s, 0, dimension * sizeof(double));
+	memset(q, 0, dimension * sizeof(double));
+	memset(z, 0, dimension * sizeof(double));
+
+	b_norm = norm2(b, dimension);
+	/* Set b_norm = 1 in case it's zero to avoid seg fault */
+	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+
+	/* An extrapolated guess gets at least one iteration, like in CG */
+	bool refine = rc != NULL && rr != 0.0;
+	ws_trace(ws, sqrt(rr) / b_norm);
+
+	while (iter < maxiter && ((sqrt(rr) / b_norm) > itol || (refine && iter == 0))) {
+		iter++;
+		/* m = inv(M)w, n = Am, independent of gamma and delta */
+		apply_precond(m, M, w);
+		pipe_mat_vec_mul(A, C, ws, n, m, dimension, SPARSE);
+		if (iter == 1) {
+			beta  = 0.0;
+			alpha = gamma / delta;
+		}
+		else {
+			beta  = gamma / gamma1;
+			alpha = gamma / (delta - beta * gamma / alpha1);
+		}
+		gamma1 = gamma;
+		alpha1 = alpha;
+		/* All the vector updates and the dot products of the next iteration in one pass */
+		rr = pipe_cg_update(x, r, u, w, p, s, q, z, m, n, alpha, beta, &gamma, &delta, dimension);
+		if (rc != NULL) {
+			recycle_collect(rc, p, s);
+		}
+		if (iter % PIPECG_REPLACE == 0 || (sqrt(rr) / b_norm) <= itol) {
+			rr = pipe_replace(A, C, x, b, M, dimension, SPARSE, ws, &gamma, &delta);
+		}
+		ws_trace(ws, sqrt(rr) / b_norm);
+	}
+
+	if (rc != NULL) {
+		recycle_update(rc, iter);
+	}
+	ws->residual = sqrt(rr) / b_norm;
+	return iter;
+}
+
+/* Y = AX for a panel of k columns with the dense A, the CCF C or its mirror */
+static inline void op_mat_mat_mul(workspace_t *ws, double **A, cs *C, double *Y, double *X, int dimension, int k,
+								  bool SPARSE) {
+	if (!SPARSE) {
+		mat_mat_mul(Y, A, X, dimension, k);
+	}
+	else if (ws->csr != NULL && ws->csr->A == C) {
+		csr_mat_mat_mul(Y, ws->csr, X, k);
+	}
+	else {
+		cs_mat_mat_mul(Y, C, X, k);
+	}
+}
+
+/* G = LL' in place for the small SPD G of order s by rows, returns false if it isn't positive definite */
+static bool small_cholesky(double *G, int s) {
+	for (int j = 0; j < s; j++) {
+		for (int i = j; i < s; i++) {
+			double sum = G[i * s + j];
+			for (int t = 0; t < j; t++) {
+				sum -= G[i * s + t] * G[j * s + t];
+			}
+			if (i == j) {
+				if (sum <= 0.0) {
+					return false;
+				}
+				G[j * s + j] = sqrt(sum);
+			}
+			else {
+				G[i * s + j] = sum / G[j * s + j];
+			}
+		}
+	}
+	return true;
+}
+
+/* Solves LL'W = B in place for the s x k matrix W by rows */
+static void small_cholesky_solve(double *L, int s, double *W, int k) {
+	for (int c = 0; c < k; c++) {
+		for (int i = 0; i < s; i++) {
+			double sum = W[i * k + c];
+			for (int t = 0; t < i; t++) {
+				sum -= L[i * s + t] * W[t * k + c];
+			}
+			W[i * k + c] = sum / L[i * s + i];
+		}
+		for (int i = s - 1; i >= 0; i--) {
+			double sum = W[i * k + c];
+			for (int t = i + 1; t < s; t++) {
+				sum -= L[t * s + i] * W[t * k + c];
+			}
+			W[i * k + c] = sum / L[i * s + i];
+		}
+	}
+}
+
+/*
+ * P = orth(Z) for the panel Z of a columns, from the pivoted Cholesky of the Gram matrix of the columns
+ * scaled to unit norm. A column that is dependent on the ones already taken, to BCG_RANK_TOL, is left out,
+ * so the block CG doesn't break down when the residuals of the right-hand sides become dependent, as the
+ * steps of a sweep are. A column of the Gram matrix is computed only when its column is taken, so for s
+ * columns of P this takes s + 2 passes over Z. Returns s.
+ */
+static int block_orth(double *P, double *Z, int a, int n) {
+	/* Row c of L holds the column c of the factor of the scaled Gram matrix */
+	double L[BCG_MAX_BLOCK * BCG_MAX_BLOCK], d[BCG_MAX_BLOCK], g[BCG_MAX_BLOCK], col[BCG_MAX_BLOCK];
+	int piv[BCG_MAX_BLOCK], s;
+
+	block_norms(d, Z, a, n);
+	for (int c = 0; c < a; c++) {
+		/* g is the squared norm of the part of every scaled column outside the columns taken */
+		g[c] = d[c] > 0.0 ? 1.0 : 0.0;
+		d[c] = d[c] > 0.0 ? 1.0 / sqrt(d[c]) : 0.0;
+	}
+	for (s = 0; s < a; s++) {
+		/* The column with the largest part left */
+		int p = 0;
+		for (int c = 1; c < a; c++) {
+			if (g[c] > g[p]) p = c;
+		}
+		if (g[p] <= BCG_RANK_TOL) break;
+		/* Column p of the Gram matrix */
+		block_dot(col, Z + p, a, 1, Z, a, a, n);
+		double l_pp = sqrt(g[p]);
+		for (int c = 0; c < a; c++) {
+			double sum = col[c] * d[c] * d[p];
+			for (int u = 0; u < s; u++) {
+				sum -= L[c * a + u] * L[p * a + u];
+			}
+			L[c * a + s] = sum / l_pp;
+			g[c] -= L[c * a + s] * L[c * a + s];
+		}
+		L[p * a + s] = l_pp;
+		/* Taken */
+		g[p] = -1.0;
+		piv[s] = p;
+	}
+
+	/* Every row of P is the row of the scaled Z(:, piv) times inv(L') */
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		double *z_i = &Z[i * a];
+		double *p_i = &P[i * s];
+		for (int t = 0; t < s; t++) {
+			double *l_t = &L[piv[t] * a];
+			double sum = z_i[piv[t]] * d[piv[t]];
+			for (int u = 0; u < t; u++) {
+				sum -= l_t[u] * p_i[u];
+			}
+			p_i[t] = sum / l_t[t];
+		}
+	}
+	return s;
+}
+
+/*
+ * Drops the converged columns of the panel R of a columns, the rest are moved to the front and map
+ * keeps the right-hand side of every column. Returns the columns left.
+ */
+static int block_deflate(double *R, int *map, double *r_norm, double *b_norm, double itol, int a, int n) {
+	int cols[BCG_MAX_BLOCK], keep = 0;
+
+	for (int c = 0; c < a; c++) {
+		if ((r_norm[map[c]] / b_norm[map[c]]) > itol) {
+			cols[keep++] = c;
+		}
+	}
+	if (keep == a || keep == 0) {
+		return keep;
+	}
+	/* In place, every entry moves to the same or an earlier position */
+	for (int i = 0; i < n; i++) {
+		for (int t = 0; t < keep; t++) {
+			R[i * keep + t] = R[i * a + cols[t]];
+		}
+	}
+	for (int t = 0; t < keep; t++) {
+		map[t] = map[cols[t]];
+	}
+	return keep;
+}
+
+/* Largest relative residual of the k right-hand sides */
+static double block_residual(double *r_norm, double *b_norm, int k) {
+	double res = 0.0;
+	for (int c = 0; c < k; c++) {
+		res = MAX(res, r_norm[c] / b_norm[c]);
+	}
+	return res;
+}
+
+/*
+ * The breakdown-free block CG of Ji and Li for AE = U with the orthonormal panel U of s0 columns and
+ * E = 0 to start with, U is left with the residual. The right-hand side c of the caller is the column
+ * c of UT, the solve stops when all of them reach itol, the norm of the residual of c is computed from
+ * the Gram matrix of the residual. The search directions are an orthonormal basis of the preconditioned
+ * residuals, which leaves out the dependent ones. Returns the number of iterations.
+ */
+static int block_cg_compressed(double **A, cs *C, double *E, double *U, int s0, double *T, int a, int *map,
+							   double *b_norm, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+							   workspace_t *ws, double *Z, double *P, double *Q) {
+	/* P'Q, its factor, the s x s0 coefficients of the updates and the Gram matrix of U */
+	double PQ[BCG_MAX_BLOCK * BCG_MAX_BLOCK], W[BCG_MAX_BLOCK * BCG_MAX_BLOCK], G[BCG_MAX_BLOCK * BCG_MAX_BLOCK];
+	double *temp;
+	int s, iter = 0;
+
+	memset(E, 0, (size_t)dimension * s0 * sizeof(double));
+	/* P = orth(inv(M)U) */
+	apply_precond_block(Z, M, U, s0, ws->iter[0], ws->iter[1]);
+	s = block_orth(P, Z, s0, dimension);
+
+	while (s > 0 && iter < maxiter) {
+		iter++;
+		/* Q = A*P */
+		op_mat_mat_mul(ws, A, C, Q, P, dimension, s, SPARSE);
+		/* P'Q is SPD since P has full rank */
+		block_dot(PQ, P, s, s, Q, s, s, dimension);
+		if (!small_cholesky(PQ, s)) {
+			break;
+		}
+		/* alpha = inv(P'Q) P'U, E = E + P*alpha and U = U - Q*alpha */
+		block_dot(W, P, s, s, U, s0, s0, dimension);
+		small_cholesky_solve(PQ, s, W, s0);
+		block_axpy(E, 1.0, P, s, W, s0, dimension);
+		block_axpy(U, -1.0, Q, s, W, s0, dimension);
+
+		/* ||Ut_c||^2 = t_c'(U'U)t_c for every right-hand side c */
+		block_dot(G, U, s0, s0, U, s0, s0, dimension);
+		double res = 0.0;
+		for (int c = 0; c < a; c++) {
+			double rr = 0.0;
+			for (int i = 0; i < s0; i++) {
+				for (int j = 0; j < s0; j++) {
+					rr += T[i * a + c] * G[i * s0 + j] * T[j * a + c];
+				}
+			}
+			res = MAX(res, sqrt(MAX(rr, 0.0)) / b_norm[map[c]]);
+		}
+		ws_trace(ws, res);
+		if (res <= itol) {
+			break;
+		}
+
+		/* Z = inv(M)U + P*beta with beta = -inv(P'Q) Q'inv(M)U */
+		apply_precond_block(Z, M, U, s0, ws->iter[0], ws->iter[1]);
+		block_dot(W, Q, s, s, Z, s0, s0, dimension);
+		small_cholesky_solve(PQ, s, W, s0);
+		block_axpy(Z, -1.0, P, s, W, s0, dimension);
+		/* The new P = orth(Z) goes in the panel of Q */
+		s = block_orth(Q, Z, s0, dimension);
+		temp = P;
+		P = Q;
+		Q = temp;
 	}
+	return iter;
+}
 
-	/* Free all the memory we allocated */
-	free(Ax);
-	free(r);
-	free(z);
-	free(p);
-	free(q);
+/*
+ * Solve the SPD system for the k right-hand sides of the panel B at once with the block conjugate gradient
+ * method, store the results in the panel X, which holds the initial guesses, and return the number of
+ * iterations. The panels are stored by rows like the ones of the direct block solves. The residuals of
+ * the right-hand sides that haven't converged are compressed to an orthonormal basis U, R = UT, and the
+ * block CG solves AE = U, so when the right-hand sides are dependent, as the steps of a sweep are, every
+ * iteration works on and streams A for the few columns of U instead of all of them. What the compression
+ * left out is taken up by the next pass from the true residuals, and a right-hand side that converged is
+ * dropped from the block, its column of X isn't touched again.
+ */
+int block_conj_grad(double **A, cs *C, double *X, double *B, precond_t *M, int dimension, int k, double itol,
+					int maxiter, bool SPARSE, workspace_t *ws) {
+	/* The panels are taken from the workspace */
+	double *R = ws_panel(ws, 0, k);
+	double *U = ws_panel(ws, 1, k);
+	double *E = ws_panel(ws, 2, k);
+	double *Z = ws_panel(ws, 3, k);
+	double *P = ws_panel(ws, 4, k);
+	double *Q = ws_panel(ws, 5, k);
+	double T[BCG_MAX_BLOCK * BCG_MAX_BLOCK];
+	double r_norm[BCG_MAX_BLOCK], b_norm[BCG_MAX_BLOCK];
+	/* Right-hand side of every column of the compressed residuals */
+	int map[BCG_MAX_BLOCK];
+	int a, s0, iterations, iter = 0;
 
+	assert(k <= BCG_MAX_BLOCK);
+
+	/* Initialize the norms of the columns of B */
+	block_norms(b_norm, B, k, dimension);
+	for (int c = 0; c < k; c++) {
+		/* Set b_norm = 1 in case it's zero to avoid seg fault */
+		b_norm[c] = b_norm[c] == 0.0 ? 1.0 : sqrt(b_norm[c]);
+	}
+	while (true) {
+		/* Compute R = B - AX and the norms of its columns */
+		op_mat_mat_mul(ws, A, C, R, X, dimension, k, SPARSE);
+		sub_vector(R, B, R, dimension * k);
+		block_norms(r_norm, R, k, dimension);
+		for (int c = 0; c < k; c++) {
+			r_norm[c] = sqrt(r_norm[c]);
+			map[c] = c;
+		}
+		if (iter == 0) {
+			ws_trace(ws, block_residual(r_norm, b_norm, k));
+		}
+		/* Drop the right-hand sides that converged */
+		a = block_deflate(R, map, r_norm, b_norm, itol, k, dimension);
+		if (a == 0 || iter >= maxiter) {
+			break;
+		}
+		/* R = UT */
+		s0 = block_orth(U, R, a, dimension);
+		if (s0 == 0) {
+			break;
+		}
+		block_dot(T, U, s0, s0, R, a, a, dimension);
+		/* AE = U and X = X + ET for the right-hand sides left */
+		iterations = block_cg_compressed(A, C, E, U, s0, T, a, map, b_norm, M, dimension, itol, maxiter - iter,
+										 SPARSE, ws, Z, P, Q);
+		block_scatter_axpy(X, k, map, E, s0, T, a, dimension);
+		iter += iterations;
+		/* Nothing left to gain over the true residuals */
+		if (iterations == 0) {
+			break;
+		}
+	}
+
+	ws->residual = block_residual(r_norm, b_norm, k);
 	return iter;
 }
 
@@ -85,78 +587,72 @@ int conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension,
  * Solve the complex SPD system with the iterative conjugate gradient method
  * store the result in vector x and also return the number of iterations
  */ 
-int complex_conj_grad(gsl_matrix_complex *A, cs_ci *C, gsl_vector_complex *x, gsl_vector_complex *b,
- 					  gsl_vector_complex *M, int dimension, double itol, int maxiter, bool SPARSE) {
-	gsl_vector_complex *Ax = init_gsl_complex_vector(dimension);
+int complex_conj_grad(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b,
+ 					  complex_precond_t *M, int dimension, double itol, int maxiter, bool SPARSE, workspace_t *ws) {
+	/* The vectors are taken from the workspace */
+	cs_complex_t *Ax = ws->complex_iter[0];
 	/* Residual vector r */
-	gsl_vector_complex *r = init_gsl_complex_vector(dimension);
-	/* Alocate z vector: solution of preconditioner */
-	gsl_vector_complex *z = init_gsl_complex_vector(dimension);
-	gsl_vector_complex *p = init_gsl_complex_vector(dimension);
-	gsl_vector_complex *q = init_gsl_complex_vector(dimension);
+	cs_complex_t *r = ws->complex_iter[1];
+	/* z vector: solution of preconditioner */
+	cs_complex_t *z = ws->complex_iter[2];
+	cs_complex_t *p = ws->complex_iter[3];
+	cs_complex_t *q = ws->complex_iter[4];
 	double r_norm, b_norm;
-	gsl_complex rho, rho1, alpha, beta;
+	cs_complex_t rho, rho1 = 1.0, alpha, beta;
 	int iter = 0;
 
 	if (SPARSE) {
-		complex_cs_mat_vec_mul(Ax, C, x);
+		complex_op_mat_vec_mul(ws, Ax, C, x);
 	}
 	else {
 		/* Compute A*x and store it to Ax, with Hermitian of A conjugate+transpose */
-		gsl_blas_zgemv(CblasNoTrans, GSL_COMPLEX_ONE, A, x, GSL_COMPLEX_ZERO, Ax);
+		complex_mat_vec_mul(Ax, A, x, dimension);
 	}
 	
 	/* Compute r = b - Ax */
 	/* Computes the y = ax + b, we want r = -Ax + b */
-	complex_axpy(r, GSL_COMPLEX_NEGONE, Ax, b, dimension);
+	complex_axpy(r, -1.0, Ax, b, dimension);
 
 	/* Initialize norm2 of b and r vectors */
 	r_norm = complex_norm2(r, dimension);
 	b_norm = complex_norm2(b, dimension);
 	/* Set b_norm = 1 in case it's zero to avoid seg fault */
 	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
 
 	while (iter < maxiter && (r_norm / b_norm) > itol) {
 		iter++;
 		/* Solution of the preconditioner Mz = r */
-		complex_precond_solve(z, M, r, dimension);
+		apply_complex_precond(z, M, r);
 		/* rho = r*z */
 		rho = complex_dot_product(r, z, dimension);
 		if (iter == 1) {
 			/* Set p = z */
-			gsl_vector_complex_memcpy(p, z);
+			memcpy(p, z, dimension * sizeof(cs_complex_t));
 		}
 		else {
 			/* beta = rho / rho1 */
-			beta = gsl_complex_div(rho, rho1);
+			beta = rho / rho1;
 			/* p = z + beta*p */
 			complex_axpy(p, beta, p, z, dimension);
 		}
 		rho1 = rho;
 		if (SPARSE) {
 			/* q = A*p, C is CCF of A */
-			complex_cs_mat_vec_mul(q, C, p);
+			complex_op_mat_vec_mul(ws, q, C, p);
 		}
 		else {
 			/* q = A*p */
-			gsl_blas_zgemv(CblasNoTrans, GSL_COMPLEX_ONE, A, p, GSL_COMPLEX_ZERO, q);
+			complex_mat_vec_mul(q, A, p, dimension);
 		}
 		/* a = rho / p*q */
-		alpha = gsl_complex_div(rho, complex_dot_product(p, q, dimension));
-		/* x = x + alpha*p */
-		complex_axpy(x, alpha, p, x, dimension);
-		/* r = r - alpha*q */
-		complex_axpy(r, __gsl_complex_neg(alpha), q, r, dimension);
-		r_norm = complex_norm2(r, dimension);
+		alpha = rho / complex_dot_product(p, q, dimension);
+		/* x = x + alpha*p, r = r - alpha*q in one pass */
+		r_norm = sqrt(complex_cg_update(x, r, p, q, alpha, NULL, NULL, dimension));
+		ws_trace(ws, r_norm / b_norm);
 	}
 
-	/* Free all the memory we allocated */
-	gsl_vector_complex_free(Ax);
-	gsl_vector_complex_free(r);
-	gsl_vector_complex_free(z);
-	gsl_vector_complex_free(p);
-	gsl_vector_complex_free(q);
-
+	ws->residual = r_norm / b_norm;
 	return iter;
 }
 
@@ -165,29 +661,32 @@ int complex_conj_grad(gsl_matrix_complex *A, cs_ci *C, gsl_vector_complex *x, gs
  * store the result in vector x and also return the number of iterations
  * or FAILURE in case it fails
  */ 
-int bi_conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension, double itol, int maxiter, bool SPARSE) {
+int bi_conj_grad(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+				 workspace_t *ws, recycle_t *rc) {
 	/* Set maxiter to our threshold in case the provided one is small for Bi-CG */
 	maxiter = MAX(maxiter, MAX_ITER_THRESHOLD);
-	/* Vector to store A*x */
-	double *Ax = (double *)malloc(dimension * sizeof(double));
+	/* The vectors are taken from the workspace, Ax stores A*x */
+	double *Ax = ws->iter[0];
 	/* Residual vector r */
-	double *r  = (double *)malloc(dimension * sizeof(double));
-	/* Alocate z vector: solution of preconditioner */
-	double *z  = (double *)malloc(dimension * sizeof(double));
-	double *p  = (double *)malloc(dimension * sizeof(double));
-	double *q  = (double *)malloc(dimension * sizeof(double));
+	double *r  = ws->iter[1];
+	/* z vector: solution of preconditioner */
+	double *z  = ws->iter[2];
+	double *p  = ws->iter[3];
+	double *q  = ws->iter[4];
 	/* Residual vector r_tilde */
-	double *r_tilde = (double *)malloc(dimension * sizeof(double));
-	/* Alocate z_tilde vector: solution of preconditioner */
-	double *z_tilde = (double *)malloc(dimension * sizeof(double));
-	double *p_tilde = (double *)malloc(dimension * sizeof(double));
-	double *q_tilde = (double *)malloc(dimension * sizeof(double));
-	double r_norm, b_norm, rho, rho1, alpha, beta, omega;
+	double *r_tilde = ws->iter[5];
+	/* z_tilde vector: solution of preconditioner */
+	double *z_tilde = ws->iter[6];
+	double *p_tilde = ws->iter[7];
+	double *q_tilde = ws->iter[8];
+	double r_norm, b_norm, rho, rho1 = 1.0, alpha, beta, omega;
 	int iter = 0;
+	/* With the Jacobi preconditioner z and z_tilde are applied on the fly like in CG, M' = M */
+	double *d = M->type == PRE_JACOBI ? M->M : NULL;
 
 	if (SPARSE) {
 		/* Compute A*x and store it ot Ax , C is CCF of A */
-		cs_mat_vec_mul(Ax, C, x);
+		op_mat_vec_mul(ws, Ax, C, x);
 	}
 	else {
 		/* Compute A*x and store it to Ax */
@@ -205,21 +704,56 @@ int bi_conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimensi
 	b_norm = norm2(b, dimension);
 	/* Set b_norm = 1 in case it's zero to avoid seg fault */
 	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
 	
-	while (iter < maxiter && (r_norm / b_norm) > itol) {
+	/*
+	 * A guess extrapolated from the previous steps gets at least one iteration even if it's below itol,
+	 * otherwise the errors of the accepted guesses add up from step to step. Only an exact one is kept as is.
+	 */
+	bool refine = rc != NULL && r_norm != 0.0;
+
+	if (d != NULL) {
+		/* rho = r_tilde*z for the first iteration */
+		rho = scaled_dot_product(r_tilde, d, r, dimension);
+	}
+	while (iter < maxiter && ((r_norm / b_norm) > itol || (refine && iter == 0))) {
 		iter++;
-		/* Solution of the preconditioner Mz = r */
-		precond_solve(z, M, r, dimension);
-		/* Solution of the preconditioner M'z_tilde = r_tilde, *
-		 * M' = M because is a diagonal matrix                 */
-		precond_solve(z_tilde, M, r_tilde, dimension);
-		/* rho = r_tilde*z */
-		rho = dot_product(r_tilde, z, dimension);
-		/* Check for Algorithm Failure */
+		if (d == NULL) {
+			/* Solution of the preconditioner Mz = r */
+			apply_precond(z, M, r);
+			/* Solution of the preconditioner M'z_tilde = r_tilde */
+			apply_precond_trans(z_tilde, M, r_tilde);
+			/* rho = r_tilde*z */
+			rho = dot_product(r_tilde, z, dimension);
+		}
+		/*
+		 * Check for Algorithm Failure, relative to the size of the vectors once rho is small, a strong
+		 * preconditioner gets there with tiny residuals long before Bi-CG breaks down
+		 */
 		if (fabs(rho) < EPSILON) {
-			return -1;
+			if (d != NULL) {
+				/* The fused kernels don't keep z */
+				precond_solve(z, d, r, dimension);
+			}
+			if (fabs(rho) < EPSILON * norm2(r_tilde, dimension) * norm2(z, dimension)) {
+				if (rc != NULL) {
+					recycle_update(rc, iter);
+				}
+				return -1;
+			}
 		}
-		if (iter == 1) {
+		if (d != NULL && iter == 1) {
+			/* Set p = z and p_tilde = z_tilde */
+			precond_solve(p, d, r, dimension);
+			precond_solve(p_tilde, d, r_tilde, dimension);
+		}
+		else if (d != NULL) {
+			beta = rho / rho1;
+			/* p = z + beta*p and p_tilde = z_tilde + beta*p_tilde with z = d.*r, z_tilde = d.*r_tilde */
+			jacobi_xpby(p, d, r, beta, dimension);
+			jacobi_xpby(p_tilde, d, r_tilde, beta, dimension);
+		}
+		else if (iter == 1) {
 			/* Set p = z */
 			memcpy(p, z, dimension * sizeof(double));
 			/* Set p_tilde = z_tilde */
@@ -235,164 +769,696 @@ int bi_conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimensi
 		rho1 = rho;
 		if (SPARSE) {
 			/* q = A*p, C is CCF of A */
-			cs_mat_vec_mul(q, C, p);
-			/* q_tilde = A'*p_tilde, A' = A, C is CCF of A */
-			cs_mat_vec_mul_trans(q_tilde, C, p_tilde);
+			op_mat_vec_mul(ws, q, C, p);
+			/* q_tilde = A'*p_tilde and omega = p_tilde*q, A' = A, C is CCF of A */
+			omega = op_mat_vec_mul_trans_dot(ws, q_tilde, C, p_tilde, q);
 		}
 		else {
 			/* q = A*p */
 			mat_vec_mul(q, A, p, dimension);
 			/* q_tilde = A'*p_tilde, A' = A */
 			mat_vec_mul_trans(q_tilde, A, p_tilde, dimension);
+			/* omega = p_tilde * q */
+			omega = dot_product(p_tilde, q, dimension);
 		}
-		/* omega = p_tilde * q */
-		omega = dot_product(p_tilde, q, dimension);
 		/* Check for Algorithm Failure */
-		if (fabs(omega) < EPSILON) {
+		if (fabs(omega) < EPSILON && fabs(omega) < EPSILON * norm2(p_tilde, dimension) * norm2(q, dimension)) {
+			if (rc != NULL) {
+				recycle_update(rc, iter);
+			}
 			return -1;
 		}
 		alpha = rho / omega;
-		/* x = x + alpha*p */
-		axpy(x,  alpha, p, x, dimension);
-		/* r = r - alpha*q */
-		axpy(r, -alpha, q, r, dimension);
-		/* r_tilde = r_tilde - alpha*q_tilde */
-		axpy(r_tilde, -alpha, q_tilde, r_tilde, dimension);
-		r_norm = norm2(r, dimension);
+		/* x = x + alpha*p, r = r - alpha*q, r_tilde = r_tilde - alpha*q_tilde and the norm of r in one pass */
+		r_norm = sqrt(bicg_update(x, r, r_tilde, p, q, q_tilde, alpha, d, &rho, dimension));
+		ws_trace(ws, r_norm / b_norm);
+	}
+
+	if (rc != NULL) {
+		recycle_update(rc, iter);
+	}
+	ws->residual = r_norm / b_norm;
+	return iter;
+}
+
+/*
+ * Solve the system with the stabilized bi-conjugate gradient method (BiCGSTAB), preconditioned
+ * from the right and with products with A only, store the result in vector x and also return
+ * the number of iterations or FAILURE in case it breaks down
+ */
+int bicgstab(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+			 workspace_t *ws, recycle_t *rc) {
+	/* Set maxiter to our threshold in case the provided one is small for BiCGSTAB */
+	maxiter = MAX(maxiter, MAX_ITER_THRESHOLD);
+	/* The vectors are taken from the workspace, t stores A*x at first */
+	double *t = ws->iter[0];
+	/* Residual vector r */
+	double *r = ws->iter[1];
+	/* Shadow residual r_hat, fixed to the first residual */
+	double *r_hat = ws->iter[2];
+	double *p = ws->iter[3];
+	double *v = ws->iter[4];
+	/* p_hat, s_hat vectors: solutions of preconditioner */
+	double *p_hat = ws->iter[5];
+	double *s = ws->iter[6];
+	double *s_hat = ws->iter[7];
+	double r_norm, b_norm, s_norm, rho, rho1, alpha, beta, omega, sigma, tt;
+	int iter = 0;
+
+	if (SPARSE) {
+		/* Compute A*x and store it to t, C is CCF of A */
+		op_mat_vec_mul(ws, t, C, x);
+	}
+	else {
+		/* Compute A*x and store it to t */
+		mat_vec_mul(t, A, x, dimension);
 	}
 
-	/* Free all the memory we allocated */
-	free(Ax);
-	free(r);
-	free(z);
-	free(p);
-	free(q);
-	free(r_tilde);
-	free(z_tilde);
-	free(p_tilde);
-	free(q_tilde);
+	/* Compute r = b - Ax */
+	sub_vector(r, b, t, dimension);
+
+	/* Compute r_hat = b - Ax = r */
+	memcpy(r_hat, r, dimension * sizeof(double));
+
+	/* Initialize norm2 of b and r vectors */
+	r_norm = norm2(r, dimension);
+	b_norm = norm2(b, dimension);
+	/* Set b_norm = 1 in case it's zero to avoid seg fault */
+	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
+
+	/* An extrapolated guess gets at least one iteration, like in Bi-CG */
+	bool refine = rc != NULL && r_norm != 0.0;
+
+	rho1 = alpha = omega = 1.0;
+	while (iter < maxiter && ((r_norm / b_norm) > itol || (refine && iter == 0))) {
+		iter++;
+		/* rho = r_hat*r */
+		rho = dot_product(r_hat, r, dimension);
+		/* Check for Algorithm Failure, relative to the size of the vectors like Bi-CG */
+		if (fabs(rho) < EPSILON && fabs(rho) < EPSILON * norm2(r_hat, dimension) * r_norm) {
+			if (rc != NULL) {
+				recycle_update(rc, iter);
+			}
+			return FAILURE;
+		}
+		if (iter == 1) {
+			/* Set p = r */
+			memcpy(p, r, dimension * sizeof(double));
+		}
+		else {
+			beta = (rho / rho1) * (alpha / omega);
+			/* p = r + beta*(p - omega*v) */
+			axpy(p, -omega, v, p, dimension);
+			axpy(p, beta, p, r, dimension);
+		}
+		rho1 = rho;
+		/* Solution of the preconditioner M p_hat = p */
+		apply_precond(p_hat, M, p);
+		if (SPARSE) {
+			/* v = A*p_hat, C is CCF of A */
+			op_mat_vec_mul(ws, v, C, p_hat);
+		}
+		else {
+			/* v = A*p_hat */
+			mat_vec_mul(v, A, p_hat, dimension);
+		}
+		/* sigma = r_hat*v */
+		sigma = dot_product(r_hat, v, dimension);
+		/* Check for Algorithm Failure */
+		if (fabs(sigma) < EPSILON && fabs(sigma) < EPSILON * norm2(r_hat, dimension) * norm2(v, dimension)) {
+			if (rc != NULL) {
+				recycle_update(rc, iter);
+			}
+			return FAILURE;
+		}
+		alpha = rho / sigma;
+		/* s = r - alpha*v */
+		axpy(s, -alpha, v, r, dimension);
+		s_norm = norm2(s, dimension);
+		if ((s_norm / b_norm) <= itol) {
+			/* The half step converged, x = x + alpha*p_hat */
+			axpy(x, alpha, p_hat, x, dimension);
+			memcpy(r, s, dimension * sizeof(double));
+			r_norm = s_norm;
+			ws_trace(ws, r_norm / b_norm);
+			break;
+		}
+		/* Solution of the preconditioner M s_hat = s */
+		apply_precond(s_hat, M, s);
+		if (SPARSE) {
+			/* t = A*s_hat, C is CCF of A */
+			op_mat_vec_mul(ws, t, C, s_hat);
+		}
+		else {
+			/* t = A*s_hat */
+			mat_vec_mul(t, A, s_hat, dimension);
+		}
+		/* omega = t*s / t*t */
+		tt = dot_product(t, t, dimension);
+		omega = tt == 0.0 ? 0.0 : dot_product(t, s, dimension) / tt;
+		/* x = x + alpha*p_hat + omega*s_hat */
+		axpy(x, alpha, p_hat, x, dimension);
+		axpy(x, omega, s_hat, x, dimension);
+		/* r = s - omega*t */
+		axpy(r, -omega, t, s, dimension);
+		r_norm = norm2(r, dimension);
+		ws_trace(ws, r_norm / b_norm);
+		/* A zero omega stalls every next step */
+		if (fabs(omega) < EPSILON && (r_norm / b_norm) > itol) {
+			if (rc != NULL) {
+				recycle_update(rc, iter);
+			}
+			return FAILURE;
+		}
+	}
 
+	if (rc != NULL) {
+		recycle_update(rc, iter);
+	}
+	ws->residual = r_norm / b_norm;
 	return iter;
 }
 
+/*
+ * Solve the system with the restarted generalized minimal residual method GMRES(m), preconditioned
+ * from the right and with products with A only, store the result in vector x and also return
+ * the number of iterations. It doesn't break down, but it can stagnate, so it returns FAILURE if it
+ * reaches maxiter above itol, x keeps its last approximation then
+ */
+int gmres(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, int restart,
+		  bool SPARSE, workspace_t *ws, recycle_t *rc) {
+	/* Set maxiter to our threshold in case the provided one is small for GMRES */
+	maxiter = MAX(maxiter, MAX_ITER_THRESHOLD);
+	/* The Krylov space can't grow past the dimension of the system */
+	int m = MIN(restart, dimension);
+	/* Arnoldi basis V, column k at V + k*dimension, and the (m+1) x m Hessenberg matrix H by columns */
+	double *H;
+	double *V = ws_krylov(ws, m, &H);
+	/* Givens rotations (c, s), the rotated right-hand side g and the least squares solution y */
+	double *c = H + (size_t)(m + 1) * m;
+	double *s = c + m;
+	double *g = s + m;
+	double *y = g + m + 1;
+	/* The vectors are taken from the workspace, w stores A*x at first */
+	double *w = ws->iter[0];
+	/* Residual vector r */
+	double *r = ws->iter[1];
+	/* z vector: solution of preconditioner */
+	double *z = ws->iter[2];
+	double *h, *v, r_norm, b_norm, temp;
+	int i, j, k, iter = 0;
+	bool lucky;
+
+	if (SPARSE) {
+		/* Compute A*x and store it to w, C is CCF of A */
+		op_mat_vec_mul(ws, w, C, x);
+	}
+	else {
+		/* Compute A*x and store it to w */
+		mat_vec_mul(w, A, x, dimension);
+	}
+
+	/* Compute r = b - Ax */
+	sub_vector(r, b, w, dimension);
+
+	/* Initialize norm2 of b and r vectors */
+	r_norm = norm2(r, dimension);
+	b_norm = norm2(b, dimension);
+	/* Set b_norm = 1 in case it's zero to avoid seg fault */
+	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
+
+	/* An extrapolated guess gets at least one iteration, like in Bi-CG */
+	bool refine = rc != NULL && r_norm != 0.0;
+
+	while (iter < maxiter && r_norm != 0.0 && ((r_norm / b_norm) > itol || (refine && iter == 0))) {
+		/* v_0 = r / ||r|| and g = ||r|| e_0 */
+		for (i = 0; i < dimension; i++) {
+			V[i] = r[i] / r_norm;
+		}
+		memset(g, 0, (m + 1) * sizeof(double));
+		g[0] = r_norm;
+
+		for (k = 0; k < m && iter < maxiter; ) {
+			iter++;
+			v = V + (size_t)k * dimension;
+			h = H + (size_t)k * (m + 1);
+			/* w = A*inv(M)*v_k */
+			apply_precond(z, M, v);
+			if (SPARSE) {
+				op_mat_vec_mul(ws, w, C, z);
+			}
+			else {
+				mat_vec_mul(w, A, z, dimension);
+			}
+			/* Modified Gram-Schmidt against the basis */
+			for (i = 0; i <= k; i++) {
+				h[i] = dot_product(w, V + (size_t)i * dimension, dimension);
+				axpy(w, -h[i], V + (size_t)i * dimension, w, dimension);
+			}
+			h[k + 1] = norm2(w, dimension);
+			/* The Krylov space is invariant, the least squares solution is exact */
+			lucky = h[k + 1] == 0.0;
+			if (!lucky) {
+				for (i = 0; i < dimension; i++) {
+					v[dimension + i] = w[i] / h[k + 1];
+				}
+			}
+			/* Apply the previous rotations to the new column */
+			for (i = 0; i < k; i++) {
+				temp = c[i] * h[i] + s[i] * h[i + 1];
+				h[i + 1] = -s[i] * h[i] + c[i] * h[i + 1];
+				h[i] = temp;
+			}
+			/* The rotation that zeroes h[k + 1] */
+			temp = hypot(h[k], h[k + 1]);
+			c[k] = temp == 0.0 ? 1.0 : h[k] / temp;
+			s[k] = temp == 0.0 ? 0.0 : h[k + 1] / temp;
+			h[k] = temp;
+			h[k + 1] = 0.0;
+			g[k + 1] = -s[k] * g[k];
+			g[k] = c[k] * g[k];
+			k++;
+			ws_trace(ws, fabs(g[k]) / b_norm);
+			/* |g[k]| is the norm of the residual at the least squares solution */
+			if (lucky || (fabs(g[k]) / b_norm) <= itol) {
+				break;
+			}
+		}
+
+		/* Back substitution of the upper triangular H(0:k, 0:k) y = g(0:k) */
+		for (i = k - 1; i >= 0; i--) {
+			temp = g[i];
+			for (j = i + 1; j < k; j++) {
+				temp -= H[i + (size_t)j * (m + 1)] * y[j];
+			}
+			y[i] = H[i + (size_t)i * (m + 1)] == 0.0 ? 0.0 : temp / H[i + (size_t)i * (m + 1)];
+		}
+		/* x = x + inv(M)*V*y */
+		memset(w, 0, dimension * sizeof(double));
+		for (j = 0; j < k; j++) {
+			axpy(w, y[j], V + (size_t)j * dimension, w, dimension);
+		}
+		apply_precond(z, M, w);
+		axpy(x, 1.0, z, x, dimension);
+
+		/* The true residual of the restart */
+		if (SPARSE) {
+			op_mat_vec_mul(ws, w, C, x);
+		}
+		else {
+			mat_vec_mul(w, A, x, dimension);
+		}
+		sub_vector(r, b, w, dimension);
+		r_norm = norm2(r, dimension);
+	}
+
+	if (rc != NULL) {
+		recycle_update(rc, iter);
+	}
+	ws->residual = r_norm / b_norm;
+	return (r_norm / b_norm) > itol ? FAILURE : iter;
+}
+
 /* 
  * Solve the complex system with the iterative bi-conjugate gradient method
  * store the result in vector x and also return the number of iterations
  * or FAILURE in case it fails
  */ 
-int complex_bi_conj_grad(gsl_matrix_complex *A, cs_ci *C,  gsl_vector_complex *x, gsl_vector_complex *b,
- 						 gsl_vector_complex *M, gsl_vector_complex *M_conj, int dimension, double itol,
-						 int maxiter, bool SPARSE) {
+int complex_bi_conj_grad(gsl_matrix_complex *A, cs_ci *C,  cs_complex_t *x, cs_complex_t *b,
+ 						 complex_precond_t *M, int dimension, double itol,
+						 int maxiter, bool SPARSE, workspace_t *ws) {
 	/* Set maxiter to our threshold in case the provided one is small for Bi-CG */
 	maxiter = MAX(maxiter, MAX_ITER_THRESHOLD);
-	/* Vector to store A*x */
-	gsl_vector_complex *Ax = init_gsl_complex_vector(dimension);
+	/* The vectors are taken from the workspace, Ax stores A*x */
+	cs_complex_t *Ax = ws->complex_iter[0];
 	/* Residual vector r */
-	gsl_vector_complex *r = init_gsl_complex_vector(dimension);
-	/* Alocate z vector: solution of preconditioner */
-	gsl_vector_complex *z = init_gsl_complex_vector(dimension);
-	gsl_vector_complex *p = init_gsl_complex_vector(dimension);
-	gsl_vector_complex *q = init_gsl_complex_vector(dimension);
+	cs_complex_t *r = ws->complex_iter[1];
+	/* z vector: solution of preconditioner */
+	cs_complex_t *z = ws->complex_iter[2];
+	cs_complex_t *p = ws->complex_iter[3];
+	cs_complex_t *q = ws->complex_iter[4];
 	/* Residual vector r_tilde */
-	gsl_vector_complex *r_tilde = init_gsl_complex_vector(dimension);
-	/* Alocate z_tilde vector: solution of preconditioner */
-	gsl_vector_complex *z_tilde = init_gsl_complex_vector(dimension);
-	gsl_vector_complex *p_tilde = init_gsl_complex_vector(dimension);
-	gsl_vector_complex *q_tilde = init_gsl_complex_vector(dimension);
+	cs_complex_t *r_tilde = ws->complex_iter[5];
+	/* z_tilde vector: solution of preconditioner */
+	cs_complex_t *z_tilde = ws->complex_iter[6];
+	cs_complex_t *p_tilde = ws->complex_iter[7];
+	cs_complex_t *q_tilde = ws->complex_iter[8];
 	double r_norm, b_norm;
-	gsl_complex rho, rho1, alpha, beta, omega;
+	cs_complex_t rho, rho1 = 1.0, alpha, beta, omega;
 	int iter = 0;
 
 	if (SPARSE) {
 		/* Compute A*x and store it ot Ax , C is CCF of A */
-		complex_cs_mat_vec_mul(Ax, C, x);
+		complex_op_mat_vec_mul(ws, Ax, C, x);
 	}
 	else {
 		/* Compute A*x and store it to Ax */
-		gsl_blas_zgemv(CblasNoTrans, GSL_COMPLEX_ONE, A, x, GSL_COMPLEX_ZERO, Ax);
+		complex_mat_vec_mul(Ax, A, x, dimension);
 	}
 	
 	/* Compute r = b - Ax */
 	/* Computes the y = ax + b, we want r = -Ax + b */
-	complex_axpy(r, GSL_COMPLEX_NEGONE, Ax, b, dimension);
+	complex_axpy(r, -1.0, Ax, b, dimension);
 
 	/* Compute r_tilde = b - Ax = r */
-	gsl_vector_complex_memcpy(r_tilde, r);
+	memcpy(r_tilde, r, dimension * sizeof(cs_complex_t));
 
 	/* Initialize norm2 of b and r vectors */
 	r_norm = complex_norm2(r, dimension);
 	b_norm = complex_norm2(b, dimension);
 	/* Set b_norm = 1 in case it's zero to avoid seg fault */
 	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
 
 	while (iter < maxiter && (r_norm / b_norm) > itol) {
 		iter++;
 		/* Solution of the preconditioner Mz = r */
-		complex_precond_solve(z, M, r, dimension);
-		/* Solution of the preconditioner M'z_tilde = r_tilde, *
-		 * M_conj = M* because is a diagonal matrix                 */
-		complex_precond_solve(z_tilde, M_conj, r_tilde, dimension);
+		apply_complex_precond(z, M, r);
+		/* Solution of the preconditioner M^H z_tilde = r_tilde */
+		apply_complex_precond_herm(z_tilde, M, r_tilde);
 		/* rho = r_tilde*z */
 		rho = complex_dot_product(r_tilde, z, dimension);
-		/* Check for Algorithm Failure */
-		if (complex_abs(rho) < EPSILON) {
+		/* Check for Algorithm Failure, relative to the size of the vectors like the real one */
+		if (cabs(rho) < EPSILON &&
+			cabs(rho) < EPSILON * complex_norm2(r_tilde, dimension) * complex_norm2(z, dimension)) {
 			return -1;
 		}
 		if (iter == 1) {
 			/* Set p = z */
-			gsl_vector_complex_memcpy(p, z);
+			memcpy(p, z, dimension * sizeof(cs_complex_t));
 			/* Set p_tilde = z_tilde */
-			gsl_vector_complex_memcpy(p_tilde, z_tilde);
+			memcpy(p_tilde, z_tilde, dimension * sizeof(cs_complex_t));
 		}
 		else {
 			/* beta = rho / rho1 */
-			beta = gsl_complex_div(rho, rho1);
+			beta = rho / rho1;
 			/* p = z + beta*p */
 			complex_axpy(p, beta, p, z, dimension);
 			/* p_tilde = z_tilde + beta_conj*p_tilde */
-			complex_axpy(p_tilde, __gsl_complex_conj(beta), p_tilde, z_tilde, dimension);
+			complex_axpy(p_tilde, conj(beta), p_tilde, z_tilde, dimension);
 		}
 		rho1 = rho;
 		if (SPARSE) {
 			/* q = A*p, C is CCF of A */
-			complex_cs_mat_vec_mul(q, C, p);
+			complex_op_mat_vec_mul(ws, q, C, p);
 			/* q_tilde = A^H*p_tilde, A^H = A*', C is CCF of A */
-			complex_cs_mat_vec_mul_herm(q_tilde, C, p_tilde);
+			complex_op_mat_vec_mul_herm(ws, q_tilde, C, p_tilde);
 		}
 		else {
 			/* q = A*p */
-			gsl_blas_zgemv(CblasNoTrans, GSL_COMPLEX_ONE, A, p, GSL_COMPLEX_ZERO, q);
+			complex_mat_vec_mul(q, A, p, dimension);
 			/* q_tilde = A^H*p_tilde */
-			gsl_blas_zgemv(CblasConjTrans, GSL_COMPLEX_ONE, A, p_tilde, GSL_COMPLEX_ZERO, q_tilde);
+			complex_mat_vec_mul_herm(q_tilde, A, p_tilde, dimension);
 		}
 		/* omega = p_tilde * q */
 		omega = complex_dot_product(p_tilde, q, dimension);
 		
 		/* Check for Algorithm Failure */
-		if (complex_abs(omega) < EPSILON) {
+		if (cabs(omega) < EPSILON &&
+			cabs(omega) < EPSILON * complex_norm2(p_tilde, dimension) * complex_norm2(q, dimension)) {
 			return -1;
 		}
 		/* alpha = rho / omega */
-		alpha = gsl_complex_div(rho, omega);
-		/* x = x + alpha*p */
-		complex_axpy(x, alpha, p, x, dimension);
-		/* r = r - alpha*q */
-		complex_axpy(r, __gsl_complex_neg(alpha), q, r, dimension);
-		/* r_tilde = r_tilde - alpha_conj*q_tilde */
-		complex_axpy(r_tilde, __gsl_complex_neg(__gsl_complex_conj(alpha)), q_tilde, r_tilde, dimension);
-		r_norm = complex_norm2(r, dimension);
+		alpha = rho / omega;
+		/* x = x + alpha*p, r = r - alpha*q, r_tilde = r_tilde - alpha_conj*q_tilde in one pass */
+		r_norm = sqrt(complex_cg_update(x, r, p, q, alpha, r_tilde, q_tilde, dimension));
+		ws_trace(ws, r_norm / b_norm);
+	}
+
+	ws->residual = r_norm / b_norm;
+	return iter;
+}
+/*
+ * Solve the complex system with the stabilized bi-conjugate gradient method (BiCGSTAB), with
+ * products with A only, store the result in vector x and also return the number of iterations
+ * or FAILURE in case it breaks down
+ */
+int complex_bicgstab(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b,
+					 complex_precond_t *M, int dimension, double itol, int maxiter, bool SPARSE, workspace_t *ws) {
+	/* Set maxiter to our threshold in case the provided one is small for BiCGSTAB */
+	maxiter = MAX(maxiter, MAX_ITER_THRESHOLD);
+	/* The vectors are taken from the workspace, t stores A*x at first */
+	cs_complex_t *t = ws->complex_iter[0];
+	/* Residual vector r */
+	cs_complex_t *r = ws->complex_iter[1];
+	/* Shadow residual r_hat, fixed to the first residual */
+	cs_complex_t *r_hat = ws->complex_iter[2];
+	cs_complex_t *p = ws->complex_iter[3];
+	cs_complex_t *v = ws->complex_iter[4];
+	/* p_hat, s_hat vectors: solutions of preconditioner */
+	cs_complex_t *p_hat = ws->complex_iter[5];
+	cs_complex_t *s = ws->complex_iter[6];
+	cs_complex_t *s_hat = ws->complex_iter[7];
+	double r_norm, b_norm, s_norm, tt;
+	cs_complex_t rho, rho1, alpha, beta, omega, sigma;
+	int iter = 0;
+
+	if (SPARSE) {
+		/* Compute A*x and store it to t, C is CCF of A */
+		complex_op_mat_vec_mul(ws, t, C, x);
+	}
+	else {
+		/* Compute A*x and store it to t */
+		complex_mat_vec_mul(t, A, x, dimension);
 	}
 
-	/* Free all the memory we allocated */
-	gsl_vector_complex_free(Ax);
-	gsl_vector_complex_free(r);
-	gsl_vector_complex_free(z);
-	gsl_vector_complex_free(p);
-	gsl_vector_complex_free(q);
-	gsl_vector_complex_free(r_tilde);
-	gsl_vector_complex_free(z_tilde);
-	gsl_vector_complex_free(p_tilde);
-	gsl_vector_complex_free(q_tilde);
+	/* Compute r = b - Ax */
+	complex_axpy(r, -1.0, t, b, dimension);
+
+	/* Compute r_hat = b - Ax = r */
+	memcpy(r_hat, r, dimension * sizeof(cs_complex_t));
+
+	/* Initialize norm2 of b and r vectors */
+	r_norm = complex_norm2(r, dimension);
+	b_norm = complex_norm2(b, dimension);
+	/* Set b_norm = 1 in case it's zero to avoid seg fault */
+	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
+
+	rho1 = alpha = omega = 1.0;
+	while (iter < maxiter && (r_norm / b_norm) > itol) {
+		iter++;
+		/* rho = r_hat*r */
+		rho = complex_dot_product(r_hat, r, dimension);
+		/* Check for Algorithm Failure, relative to the size of the vectors like Bi-CG */
+		if (cabs(rho) < EPSILON && cabs(rho) < EPSILON * complex_norm2(r_hat, dimension) * r_norm) {
+			return FAILURE;
+		}
+		if (iter == 1) {
+			/* Set p = r */
+			memcpy(p, r, dimension * sizeof(cs_complex_t));
+		}
+		else {
+			/* beta = (rho / rho1) * (alpha / omega) */
+			beta = (rho / rho1) * (alpha / omega);
+			/* p = r + beta*(p - omega*v) */
+			complex_axpy(p, -omega, v, p, dimension);
+			complex_axpy(p, beta, p, r, dimension);
+		}
+		rho1 = rho;
+		/* Solution of the preconditioner M p_hat = p */
+		apply_complex_precond(p_hat, M, p);
+		if (SPARSE) {
+			/* v = A*p_hat, C is CCF of A */
+			complex_op_mat_vec_mul(ws, v, C, p_hat);
+		}
+		else {
+			/* v = A*p_hat */
+			complex_mat_vec_mul(v, A, p_hat, dimension);
+		}
+		/* sigma = r_hat*v */
+		sigma = complex_dot_product(r_hat, v, dimension);
+		/* Check for Algorithm Failure */
+		if (cabs(sigma) < EPSILON &&
+			cabs(sigma) < EPSILON * complex_norm2(r_hat, dimension) * complex_norm2(v, dimension)) {
+			return FAILURE;
+		}
+		/* alpha = rho / sigma */
+		alpha = rho / sigma;
+		/* s = r - alpha*v */
+		complex_axpy(s, -alpha, v, r, dimension);
+		s_norm = complex_norm2(s, dimension);
+		if ((s_norm / b_norm) <= itol) {
+			/* The half step converged, x = x + alpha*p_hat */
+			complex_axpy(x, alpha, p_hat, x, dimension);
+			r_norm = s_norm;
+			ws_trace(ws, r_norm / b_norm);
+			break;
+		}
+		/* Solution of the preconditioner M s_hat = s */
+		apply_complex_precond(s_hat, M, s);
+		if (SPARSE) {
+			/* t = A*s_hat, C is CCF of A */
+			complex_op_mat_vec_mul(ws, t, C, s_hat);
+		}
+		else {
+			/* t = A*s_hat */
+			complex_mat_vec_mul(t, A, s_hat, dimension);
+		}
+		/* omega = t*s / t*t */
+		tt = complex_norm2(t, dimension);
+		omega = tt == 0.0 ? 0.0 : complex_dot_product(t, s, dimension) / (tt * tt);
+		/* x = x + alpha*p_hat + omega*s_hat */
+		complex_axpy(x, alpha, p_hat, x, dimension);
+		complex_axpy(x, omega, s_hat, x, dimension);
+		/* r = s - omega*t */
+		complex_axpy(r, -omega, t, s, dimension);
+		r_norm = complex_norm2(r, dimension);
+		ws_trace(ws, r_norm / b_norm);
+		/* A zero omega stalls every next step */
+		if (cabs(omega) < EPSILON && (r_norm / b_norm) > itol) {
+			return FAILURE;
+		}
+	}
 
+	ws->residual = r_norm / b_norm;
 	return iter;
-}
\ No newline at end of file
+}
+
+/*
+ * Solve the complex system with the restarted generalized minimal residual method GMRES(m),
+ * preconditioned from the right and with products with A only, store the result in vector x
+ * and also return the number of iterations or FAILURE if it stagnates at maxiter, like the real one
+ */
+int complex_gmres(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b,
+				  complex_precond_t *M, int dimension, double itol, int maxiter, int restart, bool SPARSE,
+				  workspace_t *ws) {
+	/* Set maxiter to our threshold in case the provided one is small for GMRES */
+	maxiter = MAX(maxiter, MAX_ITER_THRESHOLD);
+	/* The Krylov space can't grow past the dimension of the system */
+	int m = MIN(restart, dimension);
+	/* Arnoldi basis V, column k at V + k*dimension, and the (m+1) x m Hessenberg matrix H by columns */
+	cs_complex_t *H;
+	cs_complex_t *V = ws_complex_krylov(ws, m, &H);
+	/* Givens rotations (c, s), the rotated right-hand side g and the least squares solution y */
+	cs_complex_t *c = H + (size_t)(m + 1) * m;
+	cs_complex_t *s = c + m;
+	cs_complex_t *g = s + m;
+	cs_complex_t *y = g + m + 1;
+	/* The vectors are taken from the workspace, w stores A*x at first */
+	cs_complex_t *w = ws->complex_iter[0];
+	/* Residual vector r */
+	cs_complex_t *r = ws->complex_iter[1];
+	/* z vector: solution of preconditioner */
+	cs_complex_t *z = ws->complex_iter[2];
+	cs_complex_t *h, *v, temp;
+	double r_norm, b_norm, h_next, norm;
+	int i, j, k, iter = 0;
+	bool lucky;
+
+	if (SPARSE) {
+		/* Compute A*x and store it to w, C is CCF of A */
+		complex_op_mat_vec_mul(ws, w, C, x);
+	}
+	else {
+		/* Compute A*x and store it to w */
+		complex_mat_vec_mul(w, A, x, dimension);
+	}
+
+	/* Compute r = b - Ax */
+	complex_axpy(r, -1.0, w, b, dimension);
+
+	/* Initialize norm2 of b and r vectors */
+	r_norm = complex_norm2(r, dimension);
+	b_norm = complex_norm2(b, dimension);
+	/* Set b_norm = 1 in case it's zero to avoid seg fault */
+	b_norm = b_norm == 0.0 ? 1.0 : b_norm;
+	ws_trace(ws, r_norm / b_norm);
+
+	while (iter < maxiter && r_norm != 0.0 && (r_norm / b_norm) > itol) {
+		/* v_0 = r / ||r|| and g = ||r|| e_0 */
+		for (i = 0; i < dimension; i++) {
+			V[i] = r[i] / r_norm;
+		}
+		for (i = 0; i <= m; i++) {
+			g[i] = 0.0;
+		}
+		g[0] = r_norm;
+
+		for (k = 0; k < m && iter < maxiter; ) {
+			iter++;
+			v = V + (size_t)k * dimension;
+			h = H + (size_t)k * (m + 1);
+			/* w = A*inv(M)*v_k */
+			apply_complex_precond(z, M, v);
+			if (SPARSE) {
+				complex_op_mat_vec_mul(ws, w, C, z);
+			}
+			else {
+				complex_mat_vec_mul(w, A, z, dimension);
+			}
+			/* Modified Gram-Schmidt against the basis, h_ik = v_i^H w */
+			for (i = 0; i <= k; i++) {
+				h[i] = complex_dot_product(V + (size_t)i * dimension, w, dimension);
+				complex_axpy(w, -h[i], V + (size_t)i * dimension, w, dimension);
+			}
+			h_next = complex_norm2(w, dimension);
+			h[k + 1] = h_next;
+			/* The Krylov space is invariant, the least squares solution is exact */
+			lucky = h_next == 0.0;
+			if (!lucky) {
+				v = V + (size_t)(k + 1) * dimension;
+				for (i = 0; i < dimension; i++) {
+					v[i] = w[i] / h_next;
+				}
+			}
+			/* Apply the previous rotations to the new column */
+			for (i = 0; i < k; i++) {
+				temp = c[i] * h[i] + s[i] * h[i + 1];
+				h[i + 1] = -conj(s[i]) * h[i] + c[i] * h[i + 1];
+				h[i] = temp;
+			}
+			/* The rotation that zeroes h[k + 1], c is real */
+			norm = hypot(cabs(h[k]), h_next);
+			if (cabs(h[k]) == 0.0) {
+				c[k] = 0.0;
+				s[k] = 1.0;
+			}
+			else {
+				c[k] = cabs(h[k]) / norm;
+				s[k] = (h[k] / cabs(h[k])) * h_next / norm;
+			}
+			h[k] = c[k] * h[k] + s[k] * h[k + 1];
+			h[k + 1] = 0.0;
+			g[k + 1] = -conj(s[k]) * g[k];
+			g[k] = c[k] * g[k];
+			k++;
+			ws_trace(ws, cabs(g[k]) / b_norm);
+			/* |g[k]| is the norm of the residual at the least squares solution */
+			if (lucky || (cabs(g[k]) / b_norm) <= itol) {
+				break;
+			}
+		}
+
+		/* Back substitution of the upper triangular H(0:k, 0:k) y = g(0:k) */
+		for (i = k - 1; i >= 0; i--) {
+			temp = g[i];
+			for (j = i + 1; j < k; j++) {
+				temp -= H[i + (size_t)j * (m + 1)] * y[j];
+			}
+			y[i] = H[i + (size_t)i * (m + 1)] == 0.0 ? 0.0 : temp / H[i + (size_t)i * (m + 1)];
+		}
+		/* x = x + inv(M)*V*y */
+		memset(w, 0, dimension * sizeof(cs_complex_t));
+		for (j = 0; j < k; j++) {
+			complex_axpy(w, y[j], V + (size_t)j * dimension, w, dimension);
+		}
+		apply_complex_precond(z, M, w);
+		complex_axpy(x, 1.0, z, x, dimension);
+
+		/* The true residual of the restart */
+		if (SPARSE) {
+			complex_op_mat_vec_mul(ws, w, C, x);
+		}
+		else {
+			complex_mat_vec_mul(w, A, x, dimension);
+		}
+		complex_axpy(r, -1.0, w, b, dimension);
+		r_norm = complex_norm2(r, dimension);
+	}
+
+	ws->residual = r_norm / b_norm;
+	return (r_norm / b_norm) > itol ? FAILURE : iter;
+}
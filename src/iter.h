@@ -5,19 +5,44 @@
 #include <gsl/gsl_blas.h>
 
 #include "routines.h"
+#include "workspace.h"
+#include "recycle.h"
+#include "precond.h"
 #include "../cx_sparse/Include/cs.h"
 
 #define EPSILON				1e-16
 #define MAX_ITER_THRESHOLD 	20
+/* A GMRES(m) that stagnates is restarted with twice the m, up to this one */
+#define GMRES_MAX_RESTART	240
+/* Iterations of the pipelined CG between the replacements of its residuals */
+#define PIPECG_REPLACE		50
+/* Right-hand sides of the block CG and the Gram tolerance below which a search direction is dependent */
+#define BCG_MAX_BLOCK		BLOCK_MAX_WIDTH
+#define BCG_RANK_TOL		1e-12
 
-int conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension, double itol, int maxiter, bool SPARSE);
-int bi_conj_grad(double **A, cs *C, double *x, double *b, double *M, int dimension, double itol, int maxiter, bool SPARSE);
+int conj_grad(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+              workspace_t *ws, recycle_t *rc);
+int pipe_conj_grad(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter,
+                   bool SPARSE, workspace_t *ws, recycle_t *rc);
+int block_conj_grad(double **A, cs *C, double *X, double *B, precond_t *M, int dimension, int k, double itol,
+                    int maxiter, bool SPARSE, workspace_t *ws);
+int bi_conj_grad(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+                 workspace_t *ws, recycle_t *rc);
+int bicgstab(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, bool SPARSE,
+             workspace_t *ws, recycle_t *rc);
+int gmres(double **A, cs *C, double *x, double *b, precond_t *M, int dimension, double itol, int maxiter, int restart,
+          bool SPARSE, workspace_t *ws, recycle_t *rc);
 
-int complex_conj_grad(gsl_matrix_complex *A, cs_ci *C, gsl_vector_complex *x, gsl_vector_complex *b, gsl_vector_complex *M,
-                      int dimension, double itol, int maxiter, bool SPARSE);
+int complex_conj_grad(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b, complex_precond_t *M,
+                      int dimension, double itol, int maxiter, bool SPARSE, workspace_t *ws);
 
-int complex_bi_conj_grad(gsl_matrix_complex *A, cs_ci *C, gsl_vector_complex *x, gsl_vector_complex *b,
-                         gsl_vector_complex *M, gsl_vector_complex *M_conj, int dimension, double itol,
-                         int maxiter, bool SPARSE);
+int complex_bi_conj_grad(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b,
+                         complex_precond_t *M, int dimension, double itol,
+                         int maxiter, bool SPARSE, workspace_t *ws);
+int complex_bicgstab(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b,
+                     complex_precond_t *M, int dimension, double itol, int maxiter, bool SPARSE, workspace_t *ws);
+int complex_gmres(gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x, cs_complex_t *b,
+                  complex_precond_t *M, int dimension, double itol, int maxiter, int restart, bool SPARSE,
+                  workspace_t *ws);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,610 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "ldl.h"
+
+/* Size of block b */
+#define BSIZE(ldl, b) ((ldl)->bstart[(b) + 1] - (ldl)->bstart[b])
+
+/*
+ * Pairs every unknown with a zero diagonal entry with the unpaired unknown it's most strongly
+ * coupled to, mag[p] is the magnitude of entry p of A. Returns the number of blocks, blk[i] is
+ * the block of unknown i and first/second hold the members of every block (second is -1 for 1x1).
+ * diag and mate are workspaces of size n.
+ */
+static int ldl_pairs(int n, int *Ap, int *Ai, double *mag, double *diag, int *mate, int *blk, int *first, int *second,
+					 int *num_pairs) {
+	int nb = 0;
+
+	for (int j = 0; j < n; j++) {
+		diag[j] = 0.0;
+		mate[j] = -1;
+		for (int p = Ap[j]; p < Ap[j+1]; p++) {
+			if (Ai[p] == j) diag[j] += mag[p];
+		}
+	}
+	*num_pairs = 0;
+	for (int j = 0; j < n; j++) {
+		if (diag[j] != 0.0 || mate[j] >= 0) continue;
+		int best = -1;
+		for (int p = Ap[j]; p < Ap[j+1]; p++) {
+			int i = Ai[p];
+			if (i == j || mate[i] >= 0 || mag[p] == 0.0) continue;
+			if (best < 0 || mag[p] > mag[best]) best = p;
+		}
+		if (best >= 0) {
+			mate[j] = Ai[best];
+			mate[Ai[best]] = j;
+			(*num_pairs)++;
+		}
+	}
+	for (int i = 0; i < n; i++) blk[i] = -1;
+	for (int i = 0; i < n; i++) {
+		if (blk[i] >= 0) continue;
+		if (first != NULL) {
+			first[nb]  = i;
+			second[nb] = mate[i];
+		}
+		blk[i] = nb;
+		if (mate[i] >= 0) blk[mate[i]] = nb;
+		nb++;
+	}
+	return nb;
+}
+
+/* Returns the pattern of A with every block of unknowns compressed to a single node */
+static cs *ldl_compress(int n, int *Ap, int *Ai, int *blk, int nb) {
+	cs *T = cs_spalloc(nb, nb, Ap[n], 1, 1);
+	assert(T != NULL);
+	for (int j = 0; j < n; j++) {
+		for (int p = Ap[j]; p < Ap[j+1]; p++) {
+			cs_entry(T, blk[Ai[p]], blk[j], 1.0);
+		}
+	}
+	cs *Ac = cs_compress(T);
+	assert(Ac != NULL);
+	cs_spfree(T);
+	cs_dupl(Ac);
+	return Ac;
+}
+
+/*
+ * Symbolic analysis of a symmetric matrix with pattern Ap, Ai and entry magnitudes mag. The pairs of
+ * unknowns are ordered as one node with the requested fill-reducing ordering, then the exact number of
+ * block entries and values of every column of L is found from the elimination tree.
+ */
+static ldl_t *ldl_analyze(int n, int *Ap, int *Ai, double *mag, order_t order) {
+	ldl_t *ldl = (ldl_t *)calloc(1, sizeof(ldl_t));
+	assert(ldl != NULL);
+	ldl->n = n;
+	ldl->nnz_A = Ap[n];
+
+	/* Static pivoting, group the unknowns in 1x1 and 2x2 blocks */
+	ldl->blk    = (int *)malloc(n * sizeof(int));
+	ldl->diag   = (double *)malloc(n * sizeof(double));
+	ldl->mate   = (int *)malloc(n * sizeof(int));
+	ldl->pairs  = (int *)malloc(n * sizeof(int));
+	int *first  = (int *)malloc(n * sizeof(int));
+	int *second = (int *)malloc(n * sizeof(int));
+	assert(ldl->blk != NULL && ldl->diag != NULL && ldl->mate != NULL && ldl->pairs != NULL);
+	assert(first != NULL && second != NULL);
+	int nb = ldl->nb = ldl_pairs(n, Ap, Ai, mag, ldl->diag, ldl->mate, ldl->blk, first, second, &ldl->num_pairs);
+
+	/* Fill-reducing ordering and elimination tree of the compressed matrix */
+	cs *Ac = ldl_compress(n, Ap, Ai, ldl->blk, nb);
+	order_info_t info;
+	css *S = order_symbolic(Ac, order, false, &info);
+	assert(S != NULL);
+	ldl->order = info.chosen.order;
+	ldl->C = cs_symperm(Ac, S->pinv, 0);
+	assert(ldl->C != NULL);
+	cs_spfree(Ac);
+	ldl->parent = (int *)malloc(nb * sizeof(int));
+	assert(ldl->parent != NULL);
+	memcpy(ldl->parent, S->parent, nb * sizeof(int));
+
+	/* Permuted order of the scalar unknowns */
+	ldl->bstart = (int *)malloc((nb + 1) * sizeof(int));
+	ldl->perm   = (int *)malloc(n * sizeof(int));
+	ldl->iperm  = (int *)malloc(n * sizeof(int));
+	ldl->sblk   = (int *)malloc(n * sizeof(int));
+	assert(ldl->bstart != NULL && ldl->perm != NULL && ldl->iperm != NULL && ldl->sblk != NULL);
+	int *size = (int *)calloc(nb, sizeof(int));
+	assert(size != NULL);
+	for (int b = 0; b < nb; b++) {
+		size[S->pinv[b]] = (second[b] >= 0) ? 2 : 1;
+	}
+	cs_cumsum(ldl->bstart, size, nb);
+	for (int b = 0; b < nb; b++) {
+		int k0 = ldl->bstart[S->pinv[b]];
+		ldl->perm[k0] = first[b];
+		if (second[b] >= 0) ldl->perm[k0 + 1] = second[b];
+	}
+	for (int k = 0; k < n; k++) {
+		ldl->iperm[ldl->perm[k]] = k;
+	}
+	for (int b = 0; b < nb; b++) {
+		for (int k = ldl->bstart[b]; k < ldl->bstart[b + 1]; k++) {
+			ldl->sblk[k] = b;
+		}
+	}
+	free(first);
+	free(second);
+	free(size);
+	cs_sfree(S);
+
+	/* Count the block entries and values of every column of L */
+	ldl->iwork = (int *)calloc(4 * nb, sizeof(int));
+	int *s    = ldl->iwork;
+	int *w    = ldl->iwork + nb;
+	int *cnt  = (int *)calloc(nb + 1, sizeof(int));
+	int *vcnt = (int *)calloc(nb + 1, sizeof(int));
+	assert(ldl->iwork != NULL && cnt != NULL && vcnt != NULL);
+	for (int k = 0; k < nb; k++) {
+		int top = cs_ereach(ldl->C, k, ldl->parent, s, w);
+		for (int t = top; t < nb; t++) {
+			cnt[s[t]]++;
+			vcnt[s[t]] += BSIZE(ldl, k) * BSIZE(ldl, s[t]);
+		}
+	}
+	ldl->Lp  = (int *)malloc((nb + 1) * sizeof(int));
+	ldl->Lvp = (int *)malloc((nb + 1) * sizeof(int));
+	assert(ldl->Lp != NULL && ldl->Lvp != NULL);
+	int nnz_blocks = cs_cumsum(ldl->Lp, cnt, nb);
+	ldl->nnz = cs_cumsum(ldl->Lvp, vcnt, nb);
+	ldl->Li = (int *)malloc(MAX(nnz_blocks, 1) * sizeof(int));
+	assert(ldl->Li != NULL);
+	free(cnt);
+	free(vcnt);
+	return ldl;
+}
+
+/* Inverts the bk x bk block D (row by row, stride 2) to Dinv, returns false if the pivot is too small */
+static bool ldl_invert_pivot(double D[2][2], int bk, double *Dinv, double norm_A) {
+	if (bk == 1) {
+		if (fabs(D[0][0]) <= LDL_PIVOT_TOL * norm_A) return false;
+		Dinv[0] = 1.0 / D[0][0];
+		Dinv[1] = Dinv[2] = Dinv[3] = 0.0;
+	}
+	else {
+		double det = D[0][0] * D[1][1] - D[0][1] * D[1][0];
+		if (fabs(det) <= LDL_PIVOT_TOL * norm_A * norm_A) return false;
+		Dinv[0] =  D[1][1] / det;
+		Dinv[1] = -D[0][1] / det;
+		Dinv[2] = -D[1][0] / det;
+		Dinv[3] =  D[0][0] / det;
+	}
+	return true;
+}
+
+static bool ldl_complex_invert_pivot(cs_complex_t D[2][2], int bk, cs_complex_t *Dinv, double norm_A) {
+	if (bk == 1) {
+		if (cabs(D[0][0]) <= LDL_PIVOT_TOL * norm_A) return false;
+		Dinv[0] = 1.0 / D[0][0];
+		Dinv[1] = Dinv[2] = Dinv[3] = 0.0;
+	}
+	else {
+		cs_complex_t det = D[0][0] * D[1][1] - D[0][1] * D[1][0];
+		if (cabs(det) <= LDL_PIVOT_TOL * norm_A * norm_A) return false;
+		Dinv[0] =  D[1][1] / det;
+		Dinv[1] = -D[0][1] / det;
+		Dinv[2] = -D[1][0] / det;
+		Dinv[3] =  D[0][0] / det;
+	}
+	return true;
+}
+
+/*
+ * Numeric up-looking factorization over the blocks, like cs_chol. Block row k of L is found with a sparse
+ * triangular solve over the pattern given by the elimination tree. Returns false if a pivot is too small.
+ */
+static bool ldl_numeric(ldl_t *ldl, cs *A) {
+	int n = ldl->n, nb = ldl->nb;
+	int *s     = ldl->iwork;
+	int *w     = ldl->iwork + nb;
+	int *next  = ldl->iwork + 2 * nb;
+	int *vnext = ldl->iwork + 3 * nb;
+	/* Y holds up to 2 columns for every unknown, the block column k of the upper part */
+	double *Y = ldl->Y;
+	memset(w, 0, nb * sizeof(int));
+	memset(Y, 0, 2 * n * sizeof(double));
+	memcpy(next, ldl->Lp, nb * sizeof(int));
+	memcpy(vnext, ldl->Lvp, nb * sizeof(int));
+	double norm_A = cs_norm(A);
+	bool failed = false;
+
+	for (int k = 0; k < nb && !failed; k++) {
+		int bk = BSIZE(ldl, k), k0 = ldl->bstart[k];
+		double D[2][2] = {{0.0, 0.0}, {0.0, 0.0}};
+
+		/* Scatter the upper part of block column k of PAP' to Y */
+		for (int c = 0; c < bk; c++) {
+			int col = ldl->perm[k0 + c];
+			for (int p = A->p[col]; p < A->p[col+1]; p++) {
+				int row = ldl->iperm[A->i[p]];
+				if (ldl->sblk[row] <= k) Y[row * 2 + c] += A->x[p];
+			}
+		}
+		for (int a = 0; a < bk; a++) {
+			for (int c = 0; c < bk; c++) {
+				D[a][c] = Y[(k0 + a) * 2 + c];
+				Y[(k0 + a) * 2 + c] = 0.0;
+			}
+		}
+
+		/* Block row k of L, over the pattern of row k which is given by the elimination tree */
+		int top = cs_ereach(ldl->C, k, ldl->parent, s, w);
+		for (int t = top; t < nb; t++) {
+			int i = s[t], bi = BSIZE(ldl, i), i0 = ldl->bstart[i];
+			double Yi[2][2] = {{0.0, 0.0}, {0.0, 0.0}};
+			/* L_ki is kept row by row, the way it's stored in Lx */
+			double Lki[4] = {0.0, 0.0, 0.0, 0.0};
+			for (int a = 0; a < bi; a++) {
+				for (int c = 0; c < bk; c++) {
+					Yi[a][c] = Y[(i0 + a) * 2 + c];
+					Y[(i0 + a) * 2 + c] = 0.0;
+				}
+			}
+			/* Sparse triangular solve with the columns of L that are already computed */
+			double *L_ri = ldl->Lx + ldl->Lvp[i];
+			for (int p = ldl->Lp[i]; p < next[i]; L_ri += BSIZE(ldl, ldl->Li[p]) * bi, p++) {
+				int r = ldl->Li[p], br = BSIZE(ldl, r), r0 = ldl->bstart[r];
+				for (int a = 0; a < br; a++) {
+					for (int c = 0; c < bk; c++) {
+						double sum = 0.0;
+						for (int m = 0; m < bi; m++) {
+							sum += L_ri[a * bi + m] * Yi[m][c];
+						}
+						Y[(r0 + a) * 2 + c] -= sum;
+					}
+				}
+			}
+			/* L_ki = Yi' Dinv_i and D_k = D_k - L_ki Yi */
+			double *Dinv_i = ldl->Dinv + 4 * i;
+			for (int c = 0; c < bk; c++) {
+				for (int m = 0; m < bi; m++) {
+					for (int q = 0; q < bi; q++) {
+						Lki[c * bi + m] += Yi[q][c] * Dinv_i[q * 2 + m];
+					}
+				}
+			}
+			for (int c = 0; c < bk; c++) {
+				for (int d = 0; d < bk; d++) {
+					for (int m = 0; m < bi; m++) {
+						D[c][d] -= Lki[c * bi + m] * Yi[m][d];
+					}
+				}
+			}
+			/* Append the block to column i of L */
+			ldl->Li[next[i]++] = k;
+			memcpy(ldl->Lx + vnext[i], Lki, bk * bi * sizeof(double));
+			vnext[i] += bk * bi;
+		}
+		failed = !ldl_invert_pivot(D, bk, ldl->Dinv + 4 * k, norm_A);
+	}
+
+	ldl->num_numeric++;
+	return !failed;
+}
+
+/* The same as ldl_numeric for a complex symmetric matrix, the transposes are not conjugated */
+static bool ldl_complex_numeric(ldl_t *ldl, cs_ci *A) {
+	int n = ldl->n, nb = ldl->nb;
+	int *s     = ldl->iwork;
+	int *w     = ldl->iwork + nb;
+	int *next  = ldl->iwork + 2 * nb;
+	int *vnext = ldl->iwork + 3 * nb;
+	cs_complex_t *Y = ldl->Yz;
+	memset(w, 0, nb * sizeof(int));
+	memset(Y, 0, 2 * n * sizeof(cs_complex_t));
+	memcpy(next, ldl->Lp, nb * sizeof(int));
+	memcpy(vnext, ldl->Lvp, nb * sizeof(int));
+	double norm_A = cs_ci_norm(A);
+	bool failed = false;
+
+	for (int k = 0; k < nb && !failed; k++) {
+		int bk = BSIZE(ldl, k), k0 = ldl->bstart[k];
+		cs_complex_t D[2][2] = {{0.0, 0.0}, {0.0, 0.0}};
+
+		for (int c = 0; c < bk; c++) {
+			int col = ldl->perm[k0 + c];
+			for (int p = A->p[col]; p < A->p[col+1]; p++) {
+				int row = ldl->iperm[A->i[p]];
+				if (ldl->sblk[row] <= k) Y[row * 2 + c] += A->x[p];
+			}
+		}
+		for (int a = 0; a < bk; a++) {
+			for (int c = 0; c < bk; c++) {
+				D[a][c] = Y[(k0 + a) * 2 + c];
+				Y[(k0 + a) * 2 + c] = 0.0;
+			}
+		}
+
+		int top = cs_ereach(ldl->C, k, ldl->parent, s, w);
+		for (int t = top; t < nb; t++) {
+			int i = s[t], bi = BSIZE(ldl, i), i0 = ldl->bstart[i];
+			cs_complex_t Yi[2][2] = {{0.0, 0.0}, {0.0, 0.0}};
+			cs_complex_t Lki[4] = {0.0, 0.0, 0.0, 0.0};
+			for (int a = 0; a < bi; a++) {
+				for (int c = 0; c < bk; c++) {
+					Yi[a][c] = Y[(i0 + a) * 2 + c];
+					Y[(i0 + a) * 2 + c] = 0.0;
+				}
+			}
+			cs_complex_t *L_ri = ldl->Lz + ldl->Lvp[i];
+			for (int p = ldl->Lp[i]; p < next[i]; L_ri += BSIZE(ldl, ldl->Li[p]) * bi, p++) {
+				int r = ldl->Li[p], br = BSIZE(ldl, r), r0 = ldl->bstart[r];
+				for (int a = 0; a < br; a++) {
+					for (int c = 0; c < bk; c++) {
+						cs_complex_t sum = 0.0;
+						for (int m = 0; m < bi; m++) {
+							sum += CS_COMPLEX_MUL(L_ri[a * bi + m], Yi[m][c]);
+						}
+						Y[(r0 + a) * 2 + c] -= sum;
+					}
+				}
+			}
+			cs_complex_t *Dinv_i = ldl->Dinvz + 4 * i;
+			for (int c = 0; c < bk; c++) {
+				for (int m = 0; m < bi; m++) {
+					for (int q = 0; q < bi; q++) {
+						Lki[c * bi + m] += CS_COMPLEX_MUL(Yi[q][c], Dinv_i[q * 2 + m]);
+					}
+				}
+			}
+			for (int c = 0; c < bk; c++) {
+				for (int d = 0; d < bk; d++) {
+					for (int m = 0; m < bi; m++) {
+						D[c][d] -= CS_COMPLEX_MUL(Lki[c * bi + m], Yi[m][d]);
+					}
+				}
+			}
+			ldl->Li[next[i]++] = k;
+			memcpy(ldl->Lz + vnext[i], Lki, bk * bi * sizeof(cs_complex_t));
+			vnext[i] += bk * bi;
+		}
+		failed = !ldl_complex_invert_pivot(D, bk, ldl->Dinvz + 4 * k, norm_A);
+	}
+
+	ldl->num_numeric++;
+	return !failed;
+}
+
+/*
+ * Sparse LDL' factorization of the symmetric indefinite matrix A with static 1x1 and 2x2 pivots.
+ * Returns NULL if a pivot is too small, in that case the caller has to use a factorization with
+ * numerical pivoting.
+ */
+ldl_t *ldl_factor(cs *A, order_t order) {
+	double *mag = (double *)malloc(MAX(A->p[A->n], 1) * sizeof(double));
+	assert(mag != NULL);
+	for (int p = 0; p < A->p[A->n]; p++) {
+		mag[p] = fabs(A->x[p]);
+	}
+	ldl_t *ldl = ldl_analyze(A->n, A->p, A->i, mag, order);
+	free(mag);
+
+	ldl->Lx   = (double *)malloc(MAX(ldl->nnz, 1) * sizeof(double));
+	ldl->Dinv = (double *)malloc(4 * ldl->nb * sizeof(double));
+	ldl->x    = (double *)malloc(ldl->n * sizeof(double));
+	ldl->Y    = (double *)malloc(2 * ldl->n * sizeof(double));
+	assert(ldl->Lx != NULL && ldl->Dinv != NULL && ldl->x != NULL && ldl->Y != NULL);
+	if (!ldl_numeric(ldl, A)) {
+		ldl_free(ldl);
+		return NULL;
+	}
+	return ldl;
+}
+
+/*
+ * Sparse LDL' factorization of the complex symmetric matrix A (A = A', e.g. G + jwC of the AC analysis).
+ * If prev is the factorization of a matrix with the same pattern and the same pivot pairs, its symbolic
+ * analysis is kept and only the numeric factorization is done again, otherwise prev is freed.
+ * Returns NULL if a pivot is too small.
+ */
+ldl_t *ldl_complex_factor(cs_ci *A, order_t order, ldl_t *prev) {
+	int n = A->n;
+	ldl_t *ldl = prev;
+	if (ldl != NULL && (ldl->n != n || ldl->nnz_A != A->p[n])) {
+		ldl_free(ldl);
+		ldl = NULL;
+	}
+	/* While the pattern is the same the workspaces of prev are used, so the check doesn't allocate */
+	double *mag = (ldl != NULL) ? ldl->mag : (double *)malloc(MAX(A->p[n], 1) * sizeof(double));
+	assert(mag != NULL);
+	for (int p = 0; p < A->p[n]; p++) {
+		mag[p] = cabs(A->x[p]);
+	}
+	if (ldl != NULL) {
+		int num_pairs;
+		ldl_pairs(n, A->p, A->i, mag, ldl->diag, ldl->mate, ldl->pairs, NULL, NULL, &num_pairs);
+		if (memcmp(ldl->pairs, ldl->blk, n * sizeof(int)) != 0) {
+			/* The magnitudes are still needed for the new analysis */
+			ldl->mag = NULL;
+			ldl_free(ldl);
+			ldl = NULL;
+		}
+	}
+	if (ldl == NULL) {
+		ldl = ldl_analyze(n, A->p, A->i, mag, order);
+		ldl->mag   = mag;
+		ldl->Lz    = (cs_complex_t *)malloc(MAX(ldl->nnz, 1) * sizeof(cs_complex_t));
+		ldl->Dinvz = (cs_complex_t *)malloc(4 * ldl->nb * sizeof(cs_complex_t));
+		ldl->z     = (cs_complex_t *)malloc(n * sizeof(cs_complex_t));
+		ldl->Yz    = (cs_complex_t *)malloc(2 * n * sizeof(cs_complex_t));
+		assert(ldl->Lz != NULL && ldl->Dinvz != NULL && ldl->z != NULL && ldl->Yz != NULL);
+	}
+
+	if (!ldl_complex_numeric(ldl, A)) {
+		ldl_free(ldl);
+		return NULL;
+	}
+	return ldl;
+}
+
+/* Solves PAP' = LDL' for a panel of k right-hand sides stored row by row, x is a panel workspace */
+static void ldl_solve_panel(ldl_t *ldl, double *B, double *X, double *x, int k) {
+	/* x = B(P) */
+	for (int i = 0; i < ldl->n; i++) {
+		memcpy(&x[i * k], &B[ldl->perm[i] * k], k * sizeof(double));
+	}
+	/* Forward solve with L */
+	for (int j = 0; j < ldl->nb; j++) {
+		int bj = BSIZE(ldl, j), j0 = ldl->bstart[j];
+		double *L_rj = ldl->Lx + ldl->Lvp[j];
+		for (int p = ldl->Lp[j]; p < ldl->Lp[j+1]; L_rj += BSIZE(ldl, ldl->Li[p]) * bj, p++) {
+			int r = ldl->Li[p], br = BSIZE(ldl, r), r0 = ldl->bstart[r];
+			for (int a = 0; a < br; a++) {
+				for (int m = 0; m < bj; m++) {
+					double l = L_rj[a * bj + m];
+					double *x_r = &x[(r0 + a) * k], *x_j = &x[(j0 + m) * k];
+					for (int c = 0; c < k; c++) {
+						x_r[c] -= l * x_j[c];
+					}
+				}
+			}
+		}
+	}
+	/* Diagonal solve with D */
+	for (int j = 0; j < ldl->nb; j++) {
+		double *Dinv = ldl->Dinv + 4 * j, *x_0 = &x[ldl->bstart[j] * k];
+		if (BSIZE(ldl, j) == 1) {
+			for (int c = 0; c < k; c++) {
+				x_0[c] *= Dinv[0];
+			}
+		}
+		else {
+			double *x_1 = x_0 + k;
+			for (int c = 0; c < k; c++) {
+				double t0 = x_0[c], t1 = x_1[c];
+				x_0[c] = Dinv[0] * t0 + Dinv[1] * t1;
+				x_1[c] = Dinv[2] * t0 + Dinv[3] * t1;
+			}
+		}
+	}
+	/* Backward solve with L' */
+	for (int j = ldl->nb - 1; j >= 0; j--) {
+		int bj = BSIZE(ldl, j), j0 = ldl->bstart[j];
+		double *L_rj = ldl->Lx + ldl->Lvp[j];
+		for (int p = ldl->Lp[j]; p < ldl->Lp[j+1]; L_rj += BSIZE(ldl, ldl->Li[p]) * bj, p++) {
+			int r = ldl->Li[p], br = BSIZE(ldl, r), r0 = ldl->bstart[r];
+			for (int a = 0; a < br; a++) {
+				for (int m = 0; m < bj; m++) {
+					double l = L_rj[a * bj + m];
+					double *x_r = &x[(r0 + a) * k], *x_j = &x[(j0 + m) * k];
+					for (int c = 0; c < k; c++) {
+						x_j[c] -= l * x_r[c];
+					}
+				}
+			}
+		}
+	}
+	/* X(P) = x */
+	for (int i = 0; i < ldl->n; i++) {
+		memcpy(&X[ldl->perm[i] * k], &x[i * k], k * sizeof(double));
+	}
+}
+
+/* Solves Ax = b with the LDL' factorization */
+void ldl_solve(ldl_t *ldl, double *b, double *x) {
+	ldl_solve_panel(ldl, b, x, ldl->x, 1);
+}
+
+/* Solves AX = B for a panel of k right-hand sides stored row by row, the panel workspace is taken from ws */
+void ldl_solve_block(ldl_t *ldl, double *B, double *X, int k, workspace_t *ws) {
+	ldl_solve_panel(ldl, B, X, ws_panel(ws, 0, k), k);
+}
+
+/* Solves Ax = b with the complex symmetric LDL' factorization */
+void ldl_complex_solve(ldl_t *ldl, cs_complex_t *b, cs_complex_t *x) {
+	cs_complex_t *z = ldl->z;
+	for (int i = 0; i < ldl->n; i++) {
+		z[i] = b[ldl->perm[i]];
+	}
+	/* Forward solve with L */
+	for (int j = 0; j < ldl->nb; j++) {
+		int bj = BSIZE(ldl, j), j0 = ldl->bstart[j];
+		cs_complex_t *L_rj = ldl->Lz + ldl->Lvp[j];
+		for (int p = ldl->Lp[j]; p < ldl->Lp[j+1]; L_rj += BSIZE(ldl, ldl->Li[p]) * bj, p++) {
+			int r = ldl->Li[p], br = BSIZE(ldl, r), r0 = ldl->bstart[r];
+			for (int a = 0; a < br; a++) {
+				for (int m = 0; m < bj; m++) {
+					z[r0 + a] -= CS_COMPLEX_MUL(L_rj[a * bj + m], z[j0 + m]);
+				}
+			}
+		}
+	}
+	/* Diagonal solve with D */
+	for (int j = 0; j < ldl->nb; j++) {
+		cs_complex_t *Dinv = ldl->Dinvz + 4 * j, *z_0 = &z[ldl->bstart[j]];
+		if (BSIZE(ldl, j) == 1) {
+			z_0[0] = CS_COMPLEX_MUL(Dinv[0], z_0[0]);
+		}
+		else {
+			cs_complex_t t0 = z_0[0], t1 = z_0[1];
+			z_0[0] = CS_COMPLEX_MUL(Dinv[0], t0) + CS_COMPLEX_MUL(Dinv[1], t1);
+			z_0[1] = CS_COMPLEX_MUL(Dinv[2], t0) + CS_COMPLEX_MUL(Dinv[3], t1);
+		}
+	}
+	/* Backward solve with L' */
+	for (int j = ldl->nb - 1; j >= 0; j--) {
+		int bj = BSIZE(ldl, j), j0 = ldl->bstart[j];
+		cs_complex_t *L_rj = ldl->Lz + ldl->Lvp[j];
+		for (int p = ldl->Lp[j]; p < ldl->Lp[j+1]; L_rj += BSIZE(ldl, ldl->Li[p]) * bj, p++) {
+			int r = ldl->Li[p], br = BSIZE(ldl, r), r0 = ldl->bstart[r];
+			for (int a = 0; a < br; a++) {
+				for (int m = 0; m < bj; m++) {
+					z[j0 + m] -= CS_COMPLEX_MUL(L_rj[a * bj + m], z[r0 + a]);
+				}
+			}
+		}
+	}
+	for (int i = 0; i < ldl->n; i++) {
+		x[ldl->perm[i]] = z[i];
+	}
+}
+
+/* Prints the pivots, the fill and the memory of the factorization */
+void print_ldl_info(ldl_t *ldl, char *msg) {
+	double value_size = (ldl->Lz != NULL) ? sizeof(cs_complex_t) : sizeof(double);
+	double bytes = 2.0 * (ldl->nb + 1) * sizeof(int) + (double)ldl->Lp[ldl->nb] * sizeof(int) +
+	               (ldl->nnz + 4.0 * ldl->nb) * value_size;
+	printf("%s LDL': %s ordering, %d 2x2 pivots, nnz(L) = %.0lf, factor memory %.2lf MB",
+	       msg, order_name(ldl->order), ldl->num_pairs, ldl->nnz, bytes / (1024.0 * 1024.0));
+	if (ldl->num_numeric > 1) {
+		printf(", %d numeric factorizations on one symbolic", ldl->num_numeric);
+	}
+	printf("\n");
+}
+
+/* Frees the LDL' factorization */
+void ldl_free(ldl_t *ldl) {
+	if (ldl == NULL) return;
+	free(ldl->bstart);
+	free(ldl->perm);
+	free(ldl->iperm);
+	free(ldl->sblk);
+	free(ldl->blk);
+	cs_spfree(ldl->C);
+	free(ldl->parent);
+	free(ldl->Lp);
+	free(ldl->Li);
+	free(ldl->Lvp);
+	free(ldl->Lx);
+	free(ldl->Dinv);
+	free(ldl->Lz);
+	free(ldl->Dinvz);
+	free(ldl->x);
+	free(ldl->z);
+	free(ldl->mag);
+	free(ldl->diag);
+	free(ldl->mate);
+	free(ldl->pairs);
+	free(ldl->iwork);
+	free(ldl->Y);
+	free(ldl->Yz);
+	free(ldl);
+}
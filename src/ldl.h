@@ -0,0 +1,91 @@
+#ifndef LDL_H
+#define LDL_H
+
+#include <stdbool.h>
+
+#include "parser.h"
+#include "ordering.h"
+#include "routines.h"
+#include "workspace.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* A pivot is rejected if its magnitude (or |det| for 2x2) is below LDL_PIVOT_TOL * ||A|| (squared for 2x2) */
+#define LDL_PIVOT_TOL	1e-12
+
+/*
+ * Holds the sparse LDL' factorization of a symmetric indefinite matrix, PAP' = LDL'.
+ * The unknowns are grouped in blocks of 1 or 2. Every zero diagonal entry (group 2 elements)
+ * is paired with a node it's connected to, and the pair is eliminated as a static 2x2 pivot.
+ * L is stored by block columns, every entry of it is a dense block of 1x1 up to 2x2.
+ * Complex symmetric matrices (A = A', not Hermitian) are factorized the same way with complex values.
+ */
+typedef struct ldl {
+	int n;
+	/* Number of blocks and the number of the 2x2 ones */
+	int nb;
+	int num_pairs;
+
+	/* The scalar unknowns of block b are bstart[b] ... bstart[b+1]-1 in the permuted order */
+	int *bstart;
+	/* perm[k] is the original unknown that is in position k of the permuted order, iperm is its inverse */
+	int *perm;
+	int *iperm;
+	/* Block of every unknown in the permuted order */
+	int *sblk;
+
+	/*
+	 * Symbolic analysis, kept so that a matrix with the same pattern and pivots can be factorized again:
+	 * blk is the block of every original unknown, C the permuted pattern of the blocks and parent its elimination tree
+	 */
+	int *blk;
+	int nnz_A;
+	cs *C;
+	int *parent;
+
+	/* Block column j of L has entries Lp[j] ... Lp[j+1]-1, with block row Li[p] */
+	int *Lp;
+	int *Li;
+	/*
+	 * The values of block column j start at Lx + Lvp[j], every entry is a dense block stored
+	 * row by row right after the previous one of the same column
+	 */
+	int *Lvp;
+	double *Lx;
+	/* Inverse of every diagonal block of D, always stored as 2x2 row by row */
+	double *Dinv;
+	/* The same for a complex symmetric matrix, Lx and Dinv are NULL in that case */
+	cs_complex_t *Lz;
+	cs_complex_t *Dinvz;
+
+	/* Workspaces of the solve */
+	double *x;
+	cs_complex_t *z;
+
+	/*
+	 * Workspaces of the numeric factorization, kept so that factorizing again on the same analysis doesn't
+	 * allocate: mag holds the magnitudes of the entries of A, diag/mate/pairs are for the pivot check,
+	 * iwork is 4 * nb ints and Y (Yz if complex) 2 columns for every unknown
+	 */
+	double *mag;
+	double *diag;
+	int *mate;
+	int *pairs;
+	int *iwork;
+	double *Y;
+	cs_complex_t *Yz;
+
+	/* The ordering that was used, the number of scalar entries of L and the numeric factorizations done */
+	order_t order;
+	double nnz;
+	int num_numeric;
+} ldl_t;
+
+ldl_t *ldl_factor(cs *A, order_t order);
+ldl_t *ldl_complex_factor(cs_ci *A, order_t order, ldl_t *prev);
+void ldl_solve(ldl_t *ldl, double *b, double *x);
+void ldl_solve_block(ldl_t *ldl, double *B, double *X, int k, workspace_t *ws);
+void ldl_complex_solve(ldl_t *ldl, cs_complex_t *b, cs_complex_t *x);
+void print_ldl_info(ldl_t *ldl, char *msg);
+void ldl_free(ldl_t *ldl);
+
+#endif
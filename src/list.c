@@ -99,7 +99,7 @@ int add_to_list1(index_t *index, char **tokens, hash_table_t *hash_table) {
 #endif
 	}
 	/* Set new node struct fields */
-	strncpy(&new_node->type, &tokens[1][0], 1);
+	new_node->type = tokens[1][0];
 	new_node->element = (char *)malloc((strlen(&tokens[1][0]) + 1) * sizeof(char));
 	new_node->probe1  = (char *)malloc((strlen(&tokens[2][0]) + 1) * sizeof(char));
 	new_node->probe2  = (char *)malloc((strlen(&tokens[3][0]) + 1) * sizeof(char));
@@ -239,7 +239,7 @@ int add_to_list2(index_t *index, char **tokens, hash_table_t *hash_table) {
 #endif
 	}
 	/* Set new node struct fields */
-	strncpy(&new_node->type, &tokens[1][0], 1);
+	new_node->type = tokens[1][0];
 	new_node->element = (char *)malloc(strlen(&tokens[1][0]) * sizeof(char));
 	assert(new_node->element != NULL);
 	strcpy(new_node->element, &tokens[1][0]);
@@ -31,6 +31,17 @@ int main(int argc, char *argv[]) {
     /* Parse the netlist filename is in argv[1] */
     parse_netlist(parser, argv[1], index, hash_table);
 
+    /* The random walks estimate the .PLOT nodes on their own, the parser rejects the analyses that need the MNA system */
+    if (parser->options->RANDWALK) {
+        random_walk_analysis(index, hash_table, parser);
+        stop_timer();
+        print_exec_time("Total execution time");
+        free_index(&index);
+        free_parser(&parser);
+        ht_free(&hash_table);
+        return 0;
+    }
+
     /* Initialize the MNA_system */
     mna_system_t *mna = init_mna_system(parser->netlist->num_nodes, parser->netlist->num_g2_elem, parser->options, parser->netlist->nz);
     
@@ -46,10 +57,16 @@ int main(int argc, char *argv[]) {
     double *dc_op = (double *)calloc(dimension, sizeof(double));
 
     /* Solve the MNA system */
+    telemetry_begin(mna->telemetry, "dc_op", -1);
     solve_mna_system(mna, &sol_x, NULL, parser->options);
 
     /* DC Operating Point to file */
     dc_operating_point(hash_table, sol_x);
+
+    /* Effective resistances of the nodes to the supply to file */
+    if (parser->options->SELINV != SELINV_NONE) {
+        effective_resistance_analysis(index, hash_table, parser);
+    }
     
     /* Hold DC operating point values for transient and ac analyses */
     memcpy(dc_op, sol_x, mna->dimension * sizeof(double));
@@ -61,9 +78,12 @@ int main(int argc, char *argv[]) {
     tr_analysis(index, hash_table, mna, parser, dc_op, sol_x);
 
     /* AC analysis to file */
-    gsl_vector_complex *x_complex = init_gsl_complex_vector(mna->dimension);
+    cs_complex_t *x_complex = init_complex_vector(mna->dimension);
     ac_analysis(index, hash_table, mna, parser, dc_op, x_complex);
 
+    /* Iterations, residuals and time of the iterative solves of every analysis to file */
+    write_telemetry(mna->telemetry, TELEMETRY_FILE);
+
     /* Stop the timer and print the execution time */
     stop_timer();
     print_exec_time("Total execution time");
@@ -73,7 +93,7 @@ int main(int argc, char *argv[]) {
     free_mna_system(&mna, parser->options);
     free_parser(&parser);
     ht_free(&hash_table);
-    gsl_vector_complex_free(x_complex);
+    free(x_complex);
     free(sol_x);
     free(dc_op);
 
@@ -9,6 +9,8 @@
 #include "dc_analysis.h"
 #include "transient_analysis.h"
 #include "ac_analysis.h"
+#include "random_walk.h"
+#include "selinv.h"
 #include "time_tools.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,548 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "mixed.h"
+
+/* Allocates a single precision factor of order n with room for nzmax entries */
+static cs_float_t *cs_float_alloc(int n, int nzmax) {
+	cs_float_t *F = (cs_float_t *)malloc(sizeof(cs_float_t));
+	assert(F != NULL);
+	F->n = n;
+	F->p = (int *)malloc((n + 1) * sizeof(int));
+	F->i = (int *)malloc(MAX(nzmax, 1) * sizeof(int));
+	F->x = (float *)malloc(MAX(nzmax, 1) * sizeof(float));
+	assert(F->p != NULL && F->i != NULL && F->x != NULL);
+	return F;
+}
+
+/* Changes the room of F to nzmax entries */
+static void cs_float_realloc(cs_float_t *F, int nzmax) {
+	F->i = (int *)realloc(F->i, MAX(nzmax, 1) * sizeof(int));
+	F->x = (float *)realloc(F->x, MAX(nzmax, 1) * sizeof(float));
+	assert(F->i != NULL && F->x != NULL);
+}
+
+static void cs_float_free(cs_float_t *F) {
+	if (F == NULL) return;
+	free(F->p);
+	free(F->i);
+	free(F->x);
+	free(F);
+}
+
+/*
+ * Left-looking LU with partial pivoting like cs_lu, but the values of A are rounded to float as they are
+ * scattered and the factorization runs in single precision. Returns L and sets U and the row permutation,
+ * or returns NULL if A is singular in single precision.
+ */
+static cs_float_t *float_lu(cs *A, css *S, cs_float_t **U_out, int **pinv_out) {
+	int n = A->n, *q = S->q;
+	int lnz_max = S->lnz, unz_max = S->unz, lnz = 0, unz = 0;
+	cs_float_t *L = cs_float_alloc(n, lnz_max);
+	cs_float_t *U = cs_float_alloc(n, unz_max);
+	int *pinv = (int *)malloc(n * sizeof(int));
+	int *xi   = (int *)malloc(2 * n * sizeof(int));
+	float *x  = (float *)calloc(n, sizeof(float));
+	assert(pinv != NULL && xi != NULL && x != NULL);
+	/* The pattern of L for cs_reach, which only reads n, p and i */
+	cs G = {.m = n, .n = n, .nz = -1};
+
+	for (int i = 0; i < n; i++) pinv[i] = -1;
+	for (int k = 0; k <= n; k++) L->p[k] = 0;
+	for (int k = 0; k < n; k++) {
+		L->p[k] = lnz;
+		U->p[k] = unz;
+		if (lnz + n > lnz_max) {
+			lnz_max = 2 * lnz_max + n;
+			cs_float_realloc(L, lnz_max);
+		}
+		if (unz + n > unz_max) {
+			unz_max = 2 * unz_max + n;
+			cs_float_realloc(U, unz_max);
+		}
+
+		/* x = L \ A(:,col), L has a unit diagonal */
+		int col = q ? q[k] : k;
+		G.nzmax = lnz_max;
+		G.p = L->p;
+		G.i = L->i;
+		int top = cs_reach(&G, A, col, xi, pinv);
+		for (int p = top; p < n; p++) x[xi[p]] = 0.0f;
+		for (int p = A->p[col]; p < A->p[col+1]; p++) x[A->i[p]] = (float)A->x[p];
+		for (int px = top; px < n; px++) {
+			int j = xi[px], J = pinv[j];
+			if (J < 0) continue;
+			for (int p = L->p[J] + 1; p < L->p[J+1]; p++) {
+				x[L->i[p]] -= L->x[p] * x[j];
+			}
+		}
+
+		/* The largest candidate is the pivot, the diagonal one on a tie */
+		int ipiv = -1;
+		float a = -1.0f;
+		for (int p = top; p < n; p++) {
+			int i = xi[p];
+			if (pinv[i] < 0) {
+				if (fabsf(x[i]) > a) {
+					a = fabsf(x[i]);
+					ipiv = i;
+				}
+			}
+			else {
+				U->i[unz] = pinv[i];
+				U->x[unz++] = x[i];
+			}
+		}
+		if (ipiv == -1 || a <= 0.0f) {
+			cs_float_free(L);
+			cs_float_free(U);
+			free(pinv);
+			free(xi);
+			free(x);
+			return NULL;
+		}
+		if (pinv[col] < 0 && fabsf(x[col]) >= a) ipiv = col;
+
+		float pivot = x[ipiv];
+		U->i[unz] = k;
+		U->x[unz++] = pivot;
+		pinv[ipiv] = k;
+		L->i[lnz] = ipiv;
+		L->x[lnz++] = 1.0f;
+		for (int p = top; p < n; p++) {
+			int i = xi[p];
+			if (pinv[i] < 0) {
+				L->i[lnz] = i;
+				L->x[lnz++] = x[i] / pivot;
+			}
+			x[i] = 0.0f;
+		}
+	}
+	L->p[n] = lnz;
+	U->p[n] = unz;
+	/* The rows of L are permuted at the end, like in cs_lu */
+	for (int p = 0; p < lnz; p++) L->i[p] = pinv[L->i[p]];
+	cs_float_realloc(L, lnz);
+	cs_float_realloc(U, unz);
+
+	free(xi);
+	free(x);
+	*U_out = U;
+	*pinv_out = pinv;
+	return L;
+}
+
+/*
+ * Up-looking Cholesky like cs_chol, with the values of PAP' rounded to float and the factorization in
+ * single precision. Returns NULL if A is not positive definite in single precision.
+ */
+static cs_float_t *float_chol(cs *A, css *S) {
+	int n = A->n, *cp = S->cp;
+	cs *C = S->pinv ? cs_symperm(A, S->pinv, 1) : A;
+	cs_float_t *L = cs_float_alloc(n, cp[n]);
+	int *c   = (int *)malloc(2 * n * sizeof(int));
+	float *x = (float *)malloc(n * sizeof(float));
+	assert(C != NULL && c != NULL && x != NULL);
+	int *s = c + n;
+	bool spd = true;
+
+	for (int k = 0; k < n; k++) {
+		L->p[k] = c[k] = cp[k];
+	}
+	for (int k = 0; k < n && spd; k++) {
+		/* x = triu(C(:,k)) on the pattern of L(k,:) */
+		int top = cs_ereach(C, k, S->parent, s, c);
+		x[k] = 0.0f;
+		for (int p = C->p[k]; p < C->p[k+1]; p++) {
+			if (C->i[p] <= k) x[C->i[p]] = (float)C->x[p];
+		}
+		float d = x[k];
+		x[k] = 0.0f;
+		/* Solve L(0:k-1,0:k-1) * x = C(:,k) */
+		for ( ; top < n; top++) {
+			int i = s[top];
+			float lki = x[i] / L->x[L->p[i]];
+			x[i] = 0.0f;
+			for (int p = L->p[i] + 1; p < c[i]; p++) {
+				x[L->i[p]] -= L->x[p] * lki;
+			}
+			d -= lki * lki;
+			int p = c[i]++;
+			L->i[p] = k;
+			L->x[p] = lki;
+		}
+		if (d <= 0.0f) {
+			spd = false;
+			break;
+		}
+		int p = c[k]++;
+		L->i[p] = k;
+		L->x[p] = sqrtf(d);
+	}
+	L->p[n] = cp[n];
+
+	if (C != A) cs_spfree(C);
+	free(c);
+	free(x);
+	if (!spd) {
+		cs_float_free(L);
+		return NULL;
+	}
+	return L;
+}
+
+/* Memory in bytes that a factor takes with values of the given size */
+static double factor_bytes(cs_float_t *F, size_t value_size) {
+	if (F == NULL) return 0.0;
+	return (F->n + 1) * sizeof(int) + (double)F->p[F->n] * (sizeof(int) + value_size);
+}
+
+/*
+ * Triangular solves with single precision factors. Only the factors are stored in single precision,
+ * the arithmetic is done in double, so the solve moves half the bytes of the double precision one.
+ */
+static void float_lsolve(cs_float_t *L, double *x) {
+	for (int j = 0; j < L->n; j++) {
+		x[j] /= L->x[L->p[j]];
+		for (int p = L->p[j] + 1; p < L->p[j+1]; p++) {
+			x[L->i[p]] -= L->x[p] * x[j];
+		}
+	}
+}
+
+static void float_ltsolve(cs_float_t *L, double *x) {
+	for (int j = L->n - 1; j >= 0; j--) {
+		for (int p = L->p[j] + 1; p < L->p[j+1]; p++) {
+			x[j] -= L->x[p] * x[L->i[p]];
+		}
+		x[j] /= L->x[L->p[j]];
+	}
+}
+
+static void float_usolve(cs_float_t *U, double *x) {
+	for (int j = U->n - 1; j >= 0; j--) {
+		x[j] /= U->x[U->p[j+1] - 1];
+		for (int p = U->p[j]; p < U->p[j+1] - 1; p++) {
+			x[U->i[p]] -= U->x[p] * x[j];
+		}
+	}
+}
+
+/* Solves Ax = b with the factorization in use, single precision or double after a fallback */
+static void mixed_base_solve(mixed_t *mixed, double *b, double *x) {
+	if (mixed->lu) {
+		cs_ipvec(mixed->fallback ? mixed->N->pinv : mixed->pinv, b, mixed->temp, mixed->n);
+		if (mixed->fallback) {
+			cs_lsolve(mixed->N->L, mixed->temp);
+			cs_usolve(mixed->N->U, mixed->temp);
+		}
+		else {
+			float_lsolve(mixed->L, mixed->temp);
+			float_usolve(mixed->U, mixed->temp);
+		}
+		cs_ipvec(mixed->S->q, mixed->temp, x, mixed->n);
+	}
+	else {
+		cs_ipvec(mixed->S->pinv, b, mixed->temp, mixed->n);
+		if (mixed->fallback) {
+			cs_lsolve(mixed->N->L, mixed->temp);
+			cs_ltsolve(mixed->N->L, mixed->temp);
+		}
+		else {
+			float_lsolve(mixed->L, mixed->temp);
+			float_ltsolve(mixed->L, mixed->temp);
+		}
+		cs_pvec(mixed->S->pinv, mixed->temp, x, mixed->n);
+	}
+}
+
+/* Infinity norm of vector x */
+static double norm_inf(double *x, int n) {
+	double norm = 0.0;
+	for (int i = 0; i < n; i++) {
+		norm = MAX(norm, fabs(x[i]));
+	}
+	return norm;
+}
+
+/* Replaces the single precision factors with a full double precision factorization of A */
+static void mixed_fallback(mixed_t *mixed) {
+	mixed->N = mixed->lu ? cs_lu(mixed->A, mixed->S, 1) : cs_chol(mixed->A, mixed->S);
+	if (mixed->N == NULL) {
+		fprintf(stderr, "\n%s\n", mixed->lu ? "LU method failed...singular matrix" : "Cholesky method failed...non SPD matrix");
+		exit(EXIT_FAILURE);
+	}
+	cs_float_free(mixed->L);
+	cs_float_free(mixed->U);
+	mixed->L = NULL;
+	mixed->U = NULL;
+	mixed->fallback = true;
+}
+
+/*
+ * Factorizes A in single precision on the symbolic analysis S, or in double precision if that fails.
+ * A and S are owned by the returned struct from now on, A is needed for the residuals.
+ */
+mixed_t *mixed_factor(cs *A, css *S, bool lu) {
+	mixed_t *mixed = (mixed_t *)malloc(sizeof(mixed_t));
+	assert(mixed != NULL);
+
+	mixed->A  = A;
+	mixed->S  = S;
+	mixed->N  = NULL;
+	mixed->lu = lu;
+	mixed->n  = A->n;
+	mixed->norm_A = cs_norm(A);
+
+	mixed->L = NULL;
+	mixed->U = NULL;
+	mixed->pinv = NULL;
+	mixed->fallback = false;
+	if (S != NULL) {
+		mixed->L = lu ? float_lu(A, S, &mixed->U, &mixed->pinv) : float_chol(A, S);
+	}
+	if (mixed->L == NULL) {
+		mixed_fallback(mixed);
+	}
+
+	mixed->r    = (double *)malloc(A->n * sizeof(double));
+	mixed->d    = (double *)malloc(A->n * sizeof(double));
+	mixed->temp = (double *)malloc(A->n * sizeof(double));
+	assert(mixed->r != NULL && mixed->d != NULL && mixed->temp != NULL);
+
+	mixed->num_solves = 0;
+	mixed->num_refine = 0;
+
+	return mixed;
+}
+
+/* nnz(L+U) of the factorization in use */
+double mixed_nnz(mixed_t *mixed) {
+	if (mixed->fallback) {
+		return mixed->N->L->p[mixed->n] + (mixed->lu ? mixed->N->U->p[mixed->n] - mixed->n : 0);
+	}
+	return mixed->L->p[mixed->n] + (mixed->lu ? mixed->U->p[mixed->n] - mixed->n : 0);
+}
+
+/*
+ * Solves Ax = b with the single precision factors and refines x with the residual of the double
+ * precision A, until x is accurate to double precision. In case the refinement doesn't converge,
+ * A is factorized again in double precision which is then used for this and all the next solves.
+ */
+void mixed_solve(mixed_t *mixed, double *b, double *x) {
+	int n = mixed->n;
+	mixed->num_solves++;
+
+	mixed_base_solve(mixed, b, x);
+	if (mixed->fallback) return;
+
+	double norm_b = norm_inf(b, n);
+	double prev_norm_r = INFINITY;
+	for (int iter = 0; iter <= MIXED_MAX_REFINE; iter++) {
+		/* r = b - Ax */
+		cs_mat_vec_mul(mixed->r, mixed->A, x);
+		sub_vector(mixed->r, b, mixed->r, n);
+
+		double norm_r = norm_inf(mixed->r, n);
+		if (norm_r <= MIXED_TOL * (mixed->norm_A * norm_inf(x, n) + norm_b)) {
+			return;
+		}
+		if (iter == MIXED_MAX_REFINE || norm_r > MIXED_MIN_DECREASE * prev_norm_r) {
+			break;
+		}
+		prev_norm_r = norm_r;
+
+		/* x = x + A^-1 r */
+		mixed_base_solve(mixed, mixed->r, mixed->d);
+		add_vector(x, x, mixed->d, n);
+		mixed->num_refine++;
+	}
+
+	mixed_fallback(mixed);
+	mixed_base_solve(mixed, b, x);
+}
+
+/* Panel versions of the single precision triangular solves, the panels are stored row by row */
+static void float_lsolve_block(cs_float_t *L, double *X, int k) {
+	for (int j = 0; j < L->n; j++) {
+		double *x_j = &X[j * k];
+		double diag = L->x[L->p[j]];
+		for (int c = 0; c < k; c++) {
+			x_j[c] /= diag;
+		}
+		for (int p = L->p[j] + 1; p < L->p[j+1]; p++) {
+			double *x_i = &X[L->i[p] * k];
+			double l = L->x[p];
+			for (int c = 0; c < k; c++) {
+				x_i[c] -= l * x_j[c];
+			}
+		}
+	}
+}
+
+static void float_ltsolve_block(cs_float_t *L, double *X, int k) {
+	for (int j = L->n - 1; j >= 0; j--) {
+		double *x_j = &X[j * k];
+		for (int p = L->p[j] + 1; p < L->p[j+1]; p++) {
+			double *x_i = &X[L->i[p] * k];
+			double l = L->x[p];
+			for (int c = 0; c < k; c++) {
+				x_j[c] -= l * x_i[c];
+			}
+		}
+		double diag = L->x[L->p[j]];
+		for (int c = 0; c < k; c++) {
+			x_j[c] /= diag;
+		}
+	}
+}
+
+static void float_usolve_block(cs_float_t *U, double *X, int k) {
+	for (int j = U->n - 1; j >= 0; j--) {
+		double *x_j = &X[j * k];
+		double diag = U->x[U->p[j+1] - 1];
+		for (int c = 0; c < k; c++) {
+			x_j[c] /= diag;
+		}
+		for (int p = U->p[j]; p < U->p[j+1] - 1; p++) {
+			double *x_i = &X[U->i[p] * k];
+			double u = U->x[p];
+			for (int c = 0; c < k; c++) {
+				x_i[c] -= u * x_j[c];
+			}
+		}
+	}
+}
+
+/* mixed_base_solve for a panel of k right-hand sides, temp is a panel workspace */
+static void mixed_base_solve_block(mixed_t *mixed, double *B, double *X, double *temp, int k) {
+	int n = mixed->n;
+	if (mixed->lu) {
+		cs_ipvec_block(mixed->fallback ? mixed->N->pinv : mixed->pinv, B, temp, n, k);
+		if (mixed->fallback) {
+			cs_lsolve_block(mixed->N->L, temp, k);
+			cs_usolve_block(mixed->N->U, temp, k);
+		}
+		else {
+			float_lsolve_block(mixed->L, temp, k);
+			float_usolve_block(mixed->U, temp, k);
+		}
+		cs_ipvec_block(mixed->S->q, temp, X, n, k);
+	}
+	else {
+		cs_ipvec_block(mixed->S->pinv, B, temp, n, k);
+		if (mixed->fallback) {
+			cs_lsolve_block(mixed->N->L, temp, k);
+			cs_ltsolve_block(mixed->N->L, temp, k);
+		}
+		else {
+			float_lsolve_block(mixed->L, temp, k);
+			float_ltsolve_block(mixed->L, temp, k);
+		}
+		cs_pvec_block(mixed->S->pinv, temp, X, n, k);
+	}
+}
+
+/*
+ * mixed_solve for a panel of k right-hand sides stored row by row. The whole panel is refined
+ * together until every column has converged, or falls back to double precision if any of them stagnates.
+ */
+void mixed_solve_block(mixed_t *mixed, double *B, double *X, int k, workspace_t *ws) {
+	int n = mixed->n;
+	cs *A = mixed->A;
+	double *R    = ws_panel(ws, 0, k);
+	double *D    = ws_panel(ws, 1, k);
+	double *temp = ws_panel(ws, 2, k);
+	/* Norms of b, x, r of every column and r of the previous step */
+	double norms[4 * k];
+	double *norm_b = norms, *norm_x = norms + k, *norm_r = norms + 2 * k, *prev_norm_r = norms + 3 * k;
+	mixed->num_solves += k;
+
+	mixed_base_solve_block(mixed, B, X, temp, k);
+
+	if (!mixed->fallback) {
+		bool stagnated = true;
+		for (int c = 0; c < k; c++) {
+			norm_b[c] = 0.0;
+			prev_norm_r[c] = INFINITY;
+		}
+		for (int i = 0; i < n * k; i++) {
+			norm_b[i % k] = MAX(norm_b[i % k], fabs(B[i]));
+		}
+		for (int iter = 0; iter <= MIXED_MAX_REFINE; iter++) {
+			/* R = B - AX */
+			memcpy(R, B, n * k * sizeof(double));
+			for (int j = 0; j < n; j++) {
+				for (int p = A->p[j]; p < A->p[j+1]; p++) {
+					double *r_i = &R[A->i[p] * k];
+					for (int c = 0; c < k; c++) {
+						r_i[c] -= A->x[p] * X[j * k + c];
+					}
+				}
+			}
+			for (int c = 0; c < k; c++) {
+				norm_x[c] = norm_r[c] = 0.0;
+			}
+			for (int i = 0; i < n * k; i++) {
+				norm_x[i % k] = MAX(norm_x[i % k], fabs(X[i]));
+				norm_r[i % k] = MAX(norm_r[i % k], fabs(R[i]));
+			}
+			bool converged = true;
+			stagnated = (iter == MIXED_MAX_REFINE);
+			for (int c = 0; c < k; c++) {
+				if (norm_r[c] > MIXED_TOL * (mixed->norm_A * norm_x[c] + norm_b[c])) {
+					converged = false;
+					stagnated |= (norm_r[c] > MIXED_MIN_DECREASE * prev_norm_r[c]);
+				}
+				prev_norm_r[c] = norm_r[c];
+			}
+			if (converged) {
+				stagnated = false;
+				break;
+			}
+			if (stagnated) break;
+
+			/* X = X + A^-1 R */
+			mixed_base_solve_block(mixed, R, D, temp, k);
+			for (int i = 0; i < n * k; i++) {
+				X[i] += D[i];
+			}
+			mixed->num_refine++;
+		}
+		if (stagnated) {
+			mixed_fallback(mixed);
+			mixed_base_solve_block(mixed, B, X, temp, k);
+		}
+	}
+
+}
+
+/* Prints the memory of the factors and the refinement statistics */
+void print_mixed_info(mixed_t *mixed, char *msg) {
+	if (mixed->fallback) {
+		printf("%s mixed precision: refinement did not converge, fell back to double precision factors\n", msg);
+		return;
+	}
+	double single_mb = (factor_bytes(mixed->L, sizeof(float)) + factor_bytes(mixed->U, sizeof(float))) / (1024.0 * 1024.0);
+	double double_mb = (factor_bytes(mixed->L, sizeof(double)) + factor_bytes(mixed->U, sizeof(double))) / (1024.0 * 1024.0);
+	printf("%s mixed precision: factor memory %.2lf MB (double %.2lf MB), %d refinement steps in %d solves\n",
+	       msg, single_mb, double_mb, mixed->num_refine, mixed->num_solves);
+}
+
+/* Frees the factors, the symbolic analysis and the matrix A */
+void mixed_free(mixed_t *mixed) {
+	if (mixed == NULL) return;
+	cs_spfree(mixed->A);
+	cs_sfree(mixed->S);
+	cs_nfree(mixed->N);
+	cs_float_free(mixed->L);
+	cs_float_free(mixed->U);
+	free(mixed->pinv);
+	free(mixed->r);
+	free(mixed->d);
+	free(mixed->temp);
+	free(mixed);
+}
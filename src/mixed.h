@@ -0,0 +1,63 @@
+#ifndef MIXED_H
+#define MIXED_H
+
+#include <stdbool.h>
+
+#include "routines.h"
+#include "workspace.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Refinement stops when ||b - Ax|| <= MIXED_TOL * (||A|| ||x|| + ||b||) */
+#define MIXED_TOL			1e-14
+/* Maximum refinement steps for a single solve */
+#define MIXED_MAX_REFINE	20
+/* The residual has to drop at least by this factor in every refinement step, otherwise we fall back */
+#define MIXED_MIN_DECREASE	0.5
+
+/* Compressed column matrix with single precision values, used for the L/U factors */
+typedef struct cs_float {
+	int n;
+	int *p;
+	int *i;
+	float *x;
+} cs_float_t;
+
+/* Holds a single precision factorization and what is needed for the iterative refinement */
+typedef struct mixed {
+	/* The double precision matrix, the residuals are computed against this */
+	cs *A;
+	/* Symbolic analysis of A, used for the permutations and the fallback factorization */
+	css *S;
+	/* Row permutation of the LU factorization, NULL for Cholesky */
+	int *pinv;
+
+	/* Single precision factors, U is NULL for Cholesky */
+	cs_float_t *L;
+	cs_float_t *U;
+
+	/* Double precision factorization, only after a fallback */
+	csn *N;
+
+	bool lu;
+	int n;
+	double norm_A;
+
+	/* Workspaces of the solve */
+	double *r;
+	double *d;
+	double *temp;
+
+	/* Statistics of all the solves */
+	int num_solves;
+	int num_refine;
+	bool fallback;
+} mixed_t;
+
+mixed_t *mixed_factor(cs *A, css *S, bool lu);
+double mixed_nnz(mixed_t *mixed);
+void mixed_solve(mixed_t *mixed, double *b, double *x);
+void mixed_solve_block(mixed_t *mixed, double *B, double *X, int k, workspace_t *ws);
+void print_mixed_info(mixed_t *mixed, char *msg);
+void mixed_free(mixed_t *mixed);
+
+#endif
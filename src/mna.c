@@ -2,9 +2,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <omp.h>
 
 #include "mna.h"
 
+/* Allocates a preconditioner with the parameters of the options */
+static precond_t *new_precond(int n, precond_type_t type, options_t *options) {
+	precond_t *P = init_precond(n, type, options->SPD);
+	P->omega = options->OMEGA;
+	P->degree = options->DEGREE;
+	P->smoother = options->SMOOTHER;
+	return P;
+}
+
 /* Allocate memory for the MNA system */
 mna_system_t *init_mna_system(int num_nodes, int num_g2_elem, options_t *options, int nz) {
 	/* Allocate for the whole struct */
@@ -23,21 +33,45 @@ mna_system_t *init_mna_system(int num_nodes, int num_g2_elem, options_t *options
 
 	mna->resp = NULL;
 	/* Set the preconditioner pointers to NULL */
-	mna->M 	  = mna->M_trans   = NULL; 
-	mna->M_ac = mna->M_ac_conj = NULL;
+	mna->M 	  = mna->M_trans = NULL; 
+	mna->M_ac = NULL;
+	mna->async = mna->async_trans = NULL;
+	mna->solver = mna->complex_solver = options->SOLVER;
+	mna->restart = mna->complex_restart = options->RESTART;
+	mna->use_async = options->ITER && options->ASYNC;
+	mna->use_dd = options->DD;
 
 	/* In case we will use iterative methods allocate memory for the prerequisites */
 	if (options->ITER) {
-		// TODO PERHAPS REMOVE THE BELOW and just allocate preconditioner sets by default to 1.0 in case it founds 0.0
-		mna->M = init_val_vector(mna->dimension, 1.0);
+		/* The incomplete factorizations need the sparse matrices, the dense solvers use Jacobi */
+		precond_type_t type = options->SPARSE ? options->PRECOND : PRE_JACOBI;
+		if (type == PRE_AMG && !options->SPD) {
+			printf("AMG preconditions CG on SPD systems, ILU0 is used instead.\n");
+			type = PRE_ILU0;
+		}
+		if (type == PRE_CHEBY && !options->SPD) {
+			printf("CHEBY preconditions CG on SPD systems, JACOBI is used instead.\n");
+			type = PRE_JACOBI;
+		}
+		if (options->ASYNC && !(options->SPD && options->SPARSE)) {
+			printf("ASYNC solves the sparse SPD systems, %s is used instead.\n", options->SPD ? "CG" : solver_name(options->SOLVER));
+			mna->use_async = false;
+		}
+		mna->M = new_precond(mna->dimension, type, options);
 		if (options->TRAN) {
-			mna->M_trans = init_val_vector(mna->dimension, 1.0);
+			mna->M_trans = new_precond(mna->dimension, type, options);
 		}
 		if (options->AC) {
-			mna->M_ac      = init_gsl_complex_vector(mna->dimension);
-			mna->M_ac_conj = init_gsl_complex_vector(mna->dimension);
+			mna->M_ac = init_complex_precond(mna->dimension, type, options->SPD);
 		}
 	}
+	/* The domain decomposition takes the place of the sparse Cholesky */
+	if (options->DD && (options->ITER || !options->SPARSE || !options->SPD)) {
+		const char *solver = options->ITER ? (options->SPD ? "CG" : solver_name(options->SOLVER)) :
+							 options->SPD ? "Cholesky" : options->LDL ? "LDL'" : "LU";
+		printf("DD solves the sparse SPD systems without ITER, %s is used instead.\n", solver);
+		mna->use_dd = false;
+	}
 
 	/* 
 	 * In case netlist has .TRAN, allocate the resp_t struct that holds the transient response or DC value
@@ -57,6 +91,12 @@ mna_system_t *init_mna_system(int num_nodes, int num_g2_elem, options_t *options
 	}
 	/* Allocate the rhs vector */
 	mna->b = init_vector(mna->dimension);
+	/* Allocate the scratch vectors once, the analyses reuse them in every step */
+	mna->ws = init_workspace(mna->dimension, options);
+	/* Only CG deflates, Bi-CG gets the extrapolated guesses */
+	mna->recycle = (options->ITER && options->TRAN) ? init_recycle(mna->dimension, options->SPD ? options->DEFLATE : 0) : NULL;
+	mna->telemetry = options->ITER ? init_telemetry(options->TRACE) : NULL;
+	mna->partial = (options->SPARSE && !options->ITER) ? init_partial(mna->dimension, options->AC) : NULL;
 
 	/* Initialize the other fields of the mna system */
 	mna->is_decomp        = false;
@@ -102,7 +142,7 @@ void init_dense_matrix(mna_system_t *mna, options_t *options) {
 
 	if (options->AC) {
 		mna->matrix->G_ac = init_gsl_complex_array(mna->dimension, mna->dimension);
-		mna->matrix->e_ac = init_gsl_complex_vector(mna->dimension);
+		mna->matrix->e_ac = init_complex_vector(mna->dimension);
 	}
 
 	if (options->TRAN || options->AC) {
@@ -125,8 +165,26 @@ void init_sparse_matrix(mna_system_t *mna, options_t *options, int nz) {
 	mna->sp_matrix->aGhC   = NULL;
 	mna->sp_matrix->sGhC   = NULL;
 	mna->sp_matrix->G_ac   = NULL;
+	mna->sp_matrix->G_ac_g = NULL;
+	mna->sp_matrix->G_ac_c = NULL;
 	mna->sp_matrix->e_ac   = NULL;
+	mna->sp_matrix->A_csr    = NULL;
+	mna->sp_matrix->aGhC_csr = NULL;
+	mna->sp_matrix->G_ac_csr = NULL;
 	mna->sp_matrix->A_base = NULL;
+	mna->sp_matrix->A_symbolic = NULL;
+	mna->sp_matrix->A_numeric  = NULL;
+	mna->sp_matrix->A_btf      = NULL;
+	mna->sp_matrix->A_mixed    = NULL;
+	mna->sp_matrix->A_ldl      = NULL;
+	mna->sp_matrix->A_dd       = NULL;
+	mna->sp_matrix->A_Ut       = NULL;
+	mna->sp_matrix->A_qinv     = NULL;
+	mna->sp_matrix->G_ac_symbolic = NULL;
+	mna->sp_matrix->G_ac_numeric  = NULL;
+	mna->sp_matrix->G_ac_qinv     = NULL;
+	mna->sp_matrix->G_ac_ldl   = NULL;
+	mna->sp_matrix->G_ac_fallbacks = 0;
 
 	mna->matrix = NULL;
 
@@ -218,7 +276,7 @@ void create_dense_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_tabl
 				/* We treat the Inductor like a voltage source with value 0 */
 				value = 0.0;
 			}
-			else if (curr->type == 'V' || curr->type == 'v') {
+			else {
 				value = curr->value;
 			}
 			/* Save the g2 element source you find, keep indexing */
@@ -250,7 +308,7 @@ void create_dense_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_tabl
 
 	if (options->ITER) {
 		/* Compute the M preconditioner */
-		jacobi_precond(mna->M, mna->matrix->A, NULL, mna->dimension, options->SPARSE);
+		build_precond(mna->M, mna->matrix->A, NULL, options->DROPTOL, options->SPARSE);
 	}
 
 	/* Copy the data from A to A_base before LU factorization to build matrices in AC and TRAN analysis */
@@ -349,7 +407,7 @@ void create_dense_trans_mna(mna_system_t *mna, index_t *index, hash_table_t *has
 
 	if (options->ITER) {
 		/* Compute the M preconditioner */
-		jacobi_precond(mna->M_trans, mna->matrix->aGhC, NULL, mna->dimension, options->SPARSE);
+		build_precond(mna->M_trans, mna->matrix->aGhC, NULL, options->DROPTOL, options->SPARSE);
 	}
 
 	/* Free what is no longer needed, in case it's trapezoidal method */
@@ -363,111 +421,70 @@ void create_dense_trans_mna(mna_system_t *mna, index_t *index, hash_table_t *has
 void create_dense_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_table, options_t *options, int offset, double omega) {
 	list1_t *curr;
 	int volt_sources_cnt = 0;
+	/* The rows of the gsl matrix are written in place, G_ac[i][j] is at G[i * tda + j] */
+	cs_complex_t *G = (cs_complex_t *)mna->matrix->G_ac->data;
+	cs_complex_t *e_ac = mna->matrix->e_ac;
+	size_t tda = mna->matrix->G_ac->tda;
 
 	/* Copy the base of the AC matrix to G_ac and zero-out the vector for the next step */
 	for (int i = 0; i < mna->dimension; i++) {
-		gsl_complex z;
 		for (int j = 0; j < mna->dimension; j++) {
-			// mna->matrix->G_ac[i][j] = mna->matrix->A_base[i][j];
-			z = gsl_complex_rect(mna->matrix->A_base[i][j], 0.0);
-			gsl_matrix_complex_set(mna->matrix->G_ac, i, j, z);
+			G[i * tda + j] = mna->matrix->A_base[i][j];
 		}
-		// mna->matrix->e_ac[i] = 0.0 + I * 0.0;
+		e_ac[i] = 0.0;
 	}
-	gsl_vector_complex_set_zero(mna->matrix->e_ac);
 
 	for (curr = index->head1; curr != NULL; curr = curr->next) {
 		int probe1_id = ht_get_id(hash_table, curr->probe1);
 		int probe2_id = ht_get_id(hash_table, curr->probe2);
 		int i = probe1_id - 1;
 		int j = probe2_id - 1;
-		gsl_complex z, z_prev;
+		cs_complex_t z;
 		if (curr->type == 'C' || curr->type == 'c') {
-			// value = I * omega * curr->value;
-			z = gsl_complex_rect(0.0, omega * curr->value);
+			z = CMPLX(0.0, omega * curr->value);
 			if (probe1_id == 0) {
-				// mna->matrix->G_ac[j][j] += value;
-				z_prev = gsl_matrix_complex_get(mna->matrix->G_ac, j, j);
-				gsl_matrix_complex_set(mna->matrix->G_ac, j, j, gsl_complex_add(z_prev, z));
+				G[j * tda + j] += z;
 			}
 			else if (probe2_id == 0) {
-				// mna->matrix->G_ac[i][i] += value;
-				z_prev = gsl_matrix_complex_get(mna->matrix->G_ac, i, i);
-				gsl_matrix_complex_set(mna->matrix->G_ac, i, i, gsl_complex_add(z_prev, z));
+				G[i * tda + i] += z;
 			}
 			else {
-				// mna->matrix->G_ac[i][i] += value;
-				z_prev = gsl_matrix_complex_get(mna->matrix->G_ac, i, i);
-				gsl_matrix_complex_set(mna->matrix->G_ac, i, i, gsl_complex_add(z_prev, z));
-				// mna->matrix->G_ac[j][j] += value;
-				z_prev = gsl_matrix_complex_get(mna->matrix->G_ac, j, j);
-				gsl_matrix_complex_set(mna->matrix->G_ac, j, j, gsl_complex_add(z_prev, z));
-				// mna->matrix->G_ac[i][j] -= value;
-				z_prev = gsl_matrix_complex_get(mna->matrix->G_ac, i, j);
-				gsl_matrix_complex_set(mna->matrix->G_ac, i, j, gsl_complex_sub(z_prev, z));
-				// mna->matrix->G_ac[j][i] -= value;
-				z_prev = gsl_matrix_complex_get(mna->matrix->G_ac, j, i);
-				gsl_matrix_complex_set(mna->matrix->G_ac, j, i, gsl_complex_sub(z_prev, z));
+				G[i * tda + i] += z;
+				G[j * tda + j] += z;
+				G[i * tda + j] -= z;
+				G[j * tda + i] -= z;
 			}
 		}
 		else if (curr->type == 'I' || curr->type == 'i') {
-			if (curr->ac_spec == NULL) {
-				// value = 0;
-				z = gsl_complex_rect(0.0, 0.0);
-			}
-			else {
-				// value = __cs_pol_to_rect(curr->ac_spec->magnitude, curr->ac_spec->phase);
-				z = __gsl_pol_to_rect(curr->ac_spec->magnitude, curr->ac_spec->phase);
-			}
+			z = curr->ac_spec == NULL ? 0.0 : __cs_pol_to_rect(curr->ac_spec->magnitude, curr->ac_spec->phase);
 			if (probe1_id == 0) {
-				// mna->matrix->e_ac[j] += value;
-				z_prev = gsl_vector_complex_get(mna->matrix->e_ac, j);
-				gsl_vector_complex_set(mna->matrix->e_ac, j, gsl_complex_add(z_prev, z));
+				e_ac[j] += z;
 			}
 			else if (probe2_id == 0) {
-				// mna->matrix->e_ac[i] -= value;
-				z_prev = gsl_vector_complex_get(mna->matrix->e_ac, i);
-				gsl_vector_complex_set(mna->matrix->e_ac, i, gsl_complex_sub(z_prev, z));
+				e_ac[i] -= z;
 			}
 			else {
-				// mna->matrix->e_ac[i] -= value;
-				z_prev = gsl_vector_complex_get(mna->matrix->e_ac, i);
-				gsl_vector_complex_set(mna->matrix->e_ac, i, gsl_complex_sub(z_prev, z));
-				// mna->matrix->e_ac[j] += value;
-				z_prev = gsl_vector_complex_get(mna->matrix->e_ac, j);
-				gsl_vector_complex_set(mna->matrix->e_ac, j, gsl_complex_add(z_prev, z));
+				e_ac[i] -= z;
+				e_ac[j] += z;
 			}
 		}
 		else if (curr->type == 'L' || curr->type == 'l') {
 			/* Set the L value in the diagonal of g2 area in matrix */
-			// mna->matrix->G_ac[offset + volt_sources_cnt][offset + volt_sources_cnt] = - I * omega * curr->value;
-			z = gsl_complex_rect(0.0, -omega * curr->value);
-			gsl_matrix_complex_set(mna->matrix->G_ac, offset + volt_sources_cnt, offset + volt_sources_cnt, z);
+			G[(offset + volt_sources_cnt) * tda + offset + volt_sources_cnt] = CMPLX(0.0, -omega * curr->value);
 			/* Keep track of how many voltage sources or inductors (which are treated like voltages with 0), we have already found */
 			volt_sources_cnt++;
 		}
 		else if (curr->type == 'V' || curr->type == 'v') {
-			if (curr->ac_spec == NULL) {
-				// value = 0;
-				z = gsl_complex_rect(0.0, 0.0);
-			}
-			else {
-				// value = __cs_pol_to_rect(curr->ac_spec->magnitude, curr->ac_spec->phase);
-				z = __gsl_pol_to_rect(curr->ac_spec->magnitude, curr->ac_spec->phase);
-			}
-			/* Keep track of how many voltage sources or inductors, we have already found */
-			// mna->matrix->e_ac[offset + volt_sources_cnt] += value;
-			z_prev = gsl_vector_complex_get(mna->matrix->e_ac, offset + volt_sources_cnt);
-			gsl_vector_complex_set(mna->matrix->e_ac, offset + volt_sources_cnt, gsl_complex_add(z_prev, z));
+			z = curr->ac_spec == NULL ? 0.0 : __cs_pol_to_rect(curr->ac_spec->magnitude, curr->ac_spec->phase);
+			e_ac[offset + volt_sources_cnt] += z;
 			/* Keep track of how many voltage sources or inductors, we have already found */
 			volt_sources_cnt++;
 		}
 	}
 
 	if (options->ITER) {
-		/* Compute the M_ac M_ac_conj preconditioners */
-		complex_jacobi_precond(mna->M_ac, mna->matrix->G_ac, NULL, mna->dimension, options->SPARSE);
-		vector_conjugate(mna->M_ac_conj, mna->M_ac, mna->dimension);
+		/* Compute the M_ac preconditioner */
+		build_complex_precond(mna->M_ac, mna->matrix->G_ac, NULL, options->DROPTOL, options->SPARSE);
 	}
 }
 
@@ -519,7 +536,7 @@ void create_sparse_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_tab
 				/* We treat the Inductor like a voltage source with value 0 */
 				value = 0.0;
 			}
-			else if (curr->type == 'V' || curr->type == 'v') {
+			else {
 				value = curr->value;
 			}
 			/* Save the g2 element source you find, keep indexing */
@@ -566,8 +583,12 @@ void create_sparse_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_tab
 	cs_di_dupl(mna->sp_matrix->A);
 
 	if (options->ITER) {
-		/* Compute the M Jacobi Preconditioner */
-		jacobi_precond(mna->M, NULL, C, mna->dimension, options->SPARSE);
+		/* Compute the M Preconditioner */
+		build_precond(mna->M, NULL, C, options->DROPTOL, options->SPARSE);
+		mna->sp_matrix->A_csr = csr_mirror(mna->sp_matrix->A_csr, C);
+		if (mna->use_async) {
+			mna->async = async_setup(mna->async, C, options->BLOCKS);
+		}
 	}
 }
 
@@ -668,25 +689,61 @@ void create_sparse_trans_mna(mna_system_t *mna, index_t *index, hash_table_t *ha
 	
 	if (options->ITER) {
 		/* Compute the M preconditioner */
-		jacobi_precond(mna->M_trans, NULL, mna->sp_matrix->aGhC, mna->dimension, options->SPARSE);
+		build_precond(mna->M_trans, NULL, mna->sp_matrix->aGhC, options->DROPTOL, options->SPARSE);
+		mna->sp_matrix->aGhC_csr = csr_mirror(mna->sp_matrix->aGhC_csr, mna->sp_matrix->aGhC);
+		if (mna->use_async) {
+			mna->async_trans = async_setup(mna->async_trans, mna->sp_matrix->aGhC, options->BLOCKS);
+		}
 	}
 }
 
 /* Constructs the sparse AC MNA system */
 void create_sparse_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_table, options_t *options, int offset, double omega) {
+	/* The pattern is built at the first frequency, after that only the values of G_ac change */
+	if (mna->sp_matrix->G_ac == NULL) {
+		create_sparse_ac_pattern(mna, index, hash_table, offset);
+	}
+
+	/* G_ac = G + jwC */
+	cs_ci *G_ac = mna->sp_matrix->G_ac;
+	for (int p = 0; p < G_ac->p[G_ac->n]; p++) {
+		G_ac->x[p] = CMPLX(mna->sp_matrix->G_ac_g[p], omega * mna->sp_matrix->G_ac_c[p]);
+	}
+
+	if (options->ITER) {
+		/* Compute the M Preconditioner, the factorizations keep the pattern of G_ac */
+		build_complex_precond(mna->M_ac, NULL, mna->sp_matrix->G_ac, options->DROPTOL, options->SPARSE);
+		/* Only the values of the mirror are updated after the first frequency */
+		mna->sp_matrix->G_ac_csr = complex_csr_mirror(mna->sp_matrix->G_ac_csr, mna->sp_matrix->G_ac);
+	}
+}
+
+/*
+ * Builds the pattern of the sparse AC MNA system and the right-hand side e_ac, which doesn't depend on
+ * the frequency. The entries of A_base are the real part of G_ac and the C/L stamps for w = 1 the imaginary
+ * part, they are kept apart in G_ac_g and G_ac_c so that any frequency is G_ac_g + jw G_ac_c.
+ */
+void create_sparse_ac_pattern(mna_system_t *mna, index_t *index, hash_table_t *hash_table, int offset) {
 	list1_t *curr;
 	int volt_sources_cnt = 0;
-	
-	/*
-	 * We need to free everytime the G_ac matrix because in every sweep step we convert the A_base
-	 * into a complex sparse matrix G_ac. Thus, every time the last pointer value would be lost.
-	 */
-	if (mna->sp_matrix->G_ac != NULL) {
-		cs_ci_spfree(mna->sp_matrix->G_ac);
+	cs *A_base = mna->sp_matrix->A_base;
+
+	/* A_base is still in triplet form, unless a transient analysis compressed it */
+	int base_nz = (A_base->nz >= 0) ? A_base->nz : A_base->p[A_base->n];
+	cs_ci *T = cs_ci_spalloc(mna->dimension, mna->dimension, base_nz + mna->dimension, 1, 1);
+	assert(T != NULL);
+	if (A_base->nz >= 0) {
+		for (int p = 0; p < A_base->nz; p++) {
+			cs_ci_entry(T, A_base->i[p], A_base->p[p], A_base->x[p]);
+		}
+	}
+	else {
+		for (int j = 0; j < A_base->n; j++) {
+			for (int p = A_base->p[j]; p < A_base->p[j+1]; p++) {
+				cs_ci_entry(T, A_base->i[p], j, A_base->x[p]);
+			}
+		}
 	}
-
-	/* Copy the base for the AC matrix and zero-out the vector for the next step */
-	mna->sp_matrix->G_ac = cs_i_complex(mna->sp_matrix->A_base, 1);
 
 	//TODO create a function for the below
 	for (int i = 0; i < mna->dimension; i++) {
@@ -701,24 +758,24 @@ void create_sparse_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_
 		cs_complex_t z;
 		if (curr->type == 'C' || curr->type == 'c') {
 			// value = I * omega * curr->value;
-			z = 0.0 + (omega * curr->value * I);
+			z = 0.0 + (curr->value * I);
 			if (probe1_id == 0) {
 				// mna->matrix->G_ac[j][j] += value;
-				cs_ci_entry(mna->sp_matrix->G_ac, j, j, z);
+				cs_ci_entry(T, j, j, z);
 			}
 			else if (probe2_id == 0) {
 				// mna->matrix->G_ac[i][i] += value;
-				cs_ci_entry(mna->sp_matrix->G_ac, i, i, z);
+				cs_ci_entry(T, i, i, z);
 			}
 			else {
 				// mna->matrix->G_ac[i][i] += value;
-				cs_ci_entry(mna->sp_matrix->G_ac, i, i, z);
+				cs_ci_entry(T, i, i, z);
 				// mna->matrix->G_ac[j][j] += value;
-				cs_ci_entry(mna->sp_matrix->G_ac, j, j, z);
+				cs_ci_entry(T, j, j, z);
 				// mna->matrix->G_ac[i][j] -= value;
-				cs_ci_entry(mna->sp_matrix->G_ac, i, j, CS_COMPLEX_NEG(z));
+				cs_ci_entry(T, i, j, CS_COMPLEX_NEG(z));
 				// mna->matrix->G_ac[j][i] -= value;
-				cs_ci_entry(mna->sp_matrix->G_ac, j, i, CS_COMPLEX_NEG(z));
+				cs_ci_entry(T, j, i, CS_COMPLEX_NEG(z));
 			}
 		}
 		else if (curr->type == 'I' || curr->type == 'i') {
@@ -733,7 +790,7 @@ void create_sparse_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_
 				mna->sp_matrix->e_ac[j] += z;
 			}
 			else if (probe2_id == 0) {
-				mna->sp_matrix->e_ac[j] -= z;
+				mna->sp_matrix->e_ac[i] -= z;
 			}
 			else {
 				mna->sp_matrix->e_ac[i] -= z;
@@ -743,8 +800,8 @@ void create_sparse_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_
 		else if (curr->type == 'L' || curr->type == 'l') {
 			/* Set the L value in the diagonal of g2 area in matrices */
 			// mna->matrix->G_ac[offset + volt_sources_cnt][offset + volt_sources_cnt] = - I * omega * curr->value;
-			z = 0.0 - (omega * curr->value * I);
-			cs_ci_entry(mna->sp_matrix->G_ac, offset + volt_sources_cnt, offset + volt_sources_cnt, z);
+			z = 0.0 - (curr->value * I);
+			cs_ci_entry(T, offset + volt_sources_cnt, offset + volt_sources_cnt, z);
 			/* Keep track of how many voltage sources or inductors (which are treated like voltages with 0), we have already found */
 			volt_sources_cnt++;
 		}
@@ -764,23 +821,176 @@ void create_sparse_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_
 	}
 
 	/* Convert to compressed-column format (CCF) from triplet */
-	cs_ci *C = cs_ci_compress(mna->sp_matrix->G_ac);
-	cs_ci_spfree(mna->sp_matrix->G_ac);
-	mna->sp_matrix->G_ac = C;
+	mna->sp_matrix->G_ac = cs_ci_compress(T);
+	assert(mna->sp_matrix->G_ac != NULL);
+	cs_ci_spfree(T);
 	cs_ci_dupl(mna->sp_matrix->G_ac);
 
-	if (options->ITER) {
-		/* Compute the M Jacobi Preconditioner */
-		gsl_vector_complex_set_all(mna->M_ac, GSL_COMPLEX_ONE);
-		complex_jacobi_precond(mna->M_ac, NULL, mna->sp_matrix->G_ac, mna->dimension, options->SPARSE);
-		vector_conjugate(mna->M_ac_conj, mna->M_ac, mna->dimension);
+	/* Split the summed entries into the conductances and the coefficients of w */
+	int nz = mna->sp_matrix->G_ac->p[mna->dimension];
+	mna->sp_matrix->G_ac_g = (double *)malloc(MAX(nz, 1) * sizeof(double));
+	mna->sp_matrix->G_ac_c = (double *)malloc(MAX(nz, 1) * sizeof(double));
+	assert(mna->sp_matrix->G_ac_g != NULL && mna->sp_matrix->G_ac_c != NULL);
+	for (int p = 0; p < nz; p++) {
+		mna->sp_matrix->G_ac_g[p] = creal(mna->sp_matrix->G_ac->x[p]);
+		mna->sp_matrix->G_ac_c[p] = cimag(mna->sp_matrix->G_ac->x[p]);
+	}
+}
+
+/* Solves the SPD system with CG, with the pipelined CG with PIPECG option or the block-Jacobi with ASYNC */
+static int solve_iter_spd(mna_system_t *mna, double **A, cs *C, double *x, precond_t *M, int maxiter,
+						  options_t *options, recycle_t *rc) {
+	if (mna->use_async) {
+		return async_solve(mna->tr_analysis_init ? mna->async_trans : mna->async, x, mna->b, options->ITOL, maxiter,
+						   mna->ws);
+	}
+	if (options->PIPECG) {
+		return pipe_conj_grad(A, C, x, mna->b, M, mna->dimension, options->ITOL, maxiter, options->SPARSE,
+							  mna->ws, rc);
+	}
+	return conj_grad(A, C, x, mna->b, M, mna->dimension, options->ITOL, maxiter, options->SPARSE, mna->ws, rc);
+}
+
+/*
+ * Doubles the restart length of a GMRES(m) that stagnated, up to GMRES_MAX_RESTART and the dimension.
+ * Returns false if it can't grow any more.
+ */
+static bool grow_restart(int *restart, int dimension, const char *msg) {
+	int m = MIN(2 * *restart, MIN(GMRES_MAX_RESTART, dimension));
+	if (m <= *restart) {
+		return false;
+	}
+	fprintf(stderr, "%sGMRES(%d) stagnated, switching to GMRES(%d).\n", msg, *restart, m);
+	*restart = m;
+	return true;
+}
+
+/*
+ * Solves the non-SPD system with the current solver of the mna system. A solver that breaks down
+ * hands its x over to the next one of Bi-CG, BiCGSTAB and GMRES(m) and the rest of the run keeps it,
+ * a GMRES(m) that stagnates goes on from its x with a longer restart. A solve that still ends above
+ * ITOL is reported.
+ */
+static int solve_iter_nonsym(mna_system_t *mna, double **A, cs *C, double *x, precond_t *M, int maxiter,
+							 options_t *options, recycle_t *rc) {
+	int iterations;
+
+	while (true) {
+		switch (mna->solver) {
+			case SOL_BICG:
+				iterations = bi_conj_grad(A, C, x, mna->b, M, mna->dimension, options->ITOL, maxiter,
+										  options->SPARSE, mna->ws, rc);
+				break;
+			case SOL_BICGSTAB:
+				iterations = bicgstab(A, C, x, mna->b, M, mna->dimension, options->ITOL, maxiter,
+									  options->SPARSE, mna->ws, rc);
+				break;
+			default:
+				iterations = gmres(A, C, x, mna->b, M, mna->dimension, options->ITOL, maxiter, mna->restart,
+								   options->SPARSE, mna->ws, rc);
+				break;
+		}
+		if (iterations != FAILURE) {
+			break;
+		}
+		if (mna->solver == SOL_GMRES) {
+			telemetry_breakdown(mna->telemetry);
+			if (grow_restart(&mna->restart, mna->dimension, "")) {
+				continue;
+			}
+			iterations = MAX(maxiter, MAX_ITER_THRESHOLD);
+			break;
+		}
+		fprintf(stderr, "%s broke down, switching to %s.\n", solver_name(mna->solver), solver_name(mna->solver + 1));
+		telemetry_breakdown(mna->telemetry);
+		mna->solver++;
+	}
+	if (mna->ws->residual > options->ITOL) {
+		printf("%s reached max iterations without convergence.\n", solver_name(mna->solver));
+	}
+	return iterations;
+}
+
+/* The same for the complex systems of the AC analysis */
+static int solve_complex_iter_nonsym(mna_system_t *mna, gsl_matrix_complex *A, cs_ci *C, cs_complex_t *x,
+									 cs_complex_t *b, int maxiter, options_t *options) {
+	int iterations;
+
+	while (true) {
+		switch (mna->complex_solver) {
+			case SOL_BICG:
+				iterations = complex_bi_conj_grad(A, C, x, b, mna->M_ac, mna->dimension, options->ITOL, maxiter,
+												  options->SPARSE, mna->ws);
+				break;
+			case SOL_BICGSTAB:
+				iterations = complex_bicgstab(A, C, x, b, mna->M_ac, mna->dimension, options->ITOL, maxiter,
+											  options->SPARSE, mna->ws);
+				break;
+			default:
+				iterations = complex_gmres(A, C, x, b, mna->M_ac, mna->dimension, options->ITOL, maxiter,
+										   mna->complex_restart, options->SPARSE, mna->ws);
+				break;
+		}
+		if (iterations != FAILURE) {
+			break;
+		}
+		if (mna->complex_solver == SOL_GMRES) {
+			telemetry_breakdown(mna->telemetry);
+			if (grow_restart(&mna->complex_restart, mna->dimension, "Complex ")) {
+				continue;
+			}
+			iterations = MAX(maxiter, MAX_ITER_THRESHOLD);
+			break;
+		}
+		fprintf(stderr, "Complex %s broke down, switching to %s.\n", solver_name(mna->complex_solver),
+				solver_name(mna->complex_solver + 1));
+		telemetry_breakdown(mna->telemetry);
+		mna->complex_solver++;
+	}
+	if (mna->ws->residual > options->ITOL) {
+		printf("%s reached max iterations without convergence.\n", solver_name(mna->complex_solver));
+	}
+	return iterations;
+}
+
+/*
+ * Solves the DC system from x = 0 with the synchronous CG, preconditioned with M, and with the asynchronous
+ * block-Jacobi and prints the time of both, to see how they scale with the threads
+ */
+static void async_benchmark(mna_system_t *mna, options_t *options) {
+	int n = mna->dimension;
+	double *x = (double *)calloc(n, sizeof(double));
+	assert(x != NULL);
+
+	double start = omp_get_wtime();
+	int iterations = conj_grad(NULL, mna->sp_matrix->A, x, mna->b, mna->M, n, options->ITOL, n, true, mna->ws, NULL);
+	double cg_time = omp_get_wtime() - start;
+
+	zero_out_vector(x, n);
+	start = omp_get_wtime();
+	int sweeps = async_solve(mna->async, x, mna->b, options->ITOL, MAX(n, ASYNC_MAX_SWEEPS), mna->ws);
+	double async_time = omp_get_wtime() - start;
+
+	printf("DC benchmark with %d threads: %s-CG %d iterations in %.6lf s, ASYNC %d sweeps in %.6lf s\n",
+		   omp_get_max_threads(), precond_name(mna->M->type), iterations, cg_time, sweeps, async_time);
+	free(x);
+}
+
+/* Name of the solver the telemetry records for the current iterative solve */
+static const char *iter_solver_label(mna_system_t *mna, options_t *options) {
+	if (options->SPD && mna->use_async && !mna->ac_analysis_init) {
+		return "ASYNC";
+	}
+	if (options->SPD) {
+		return (options->PIPECG && !mna->ac_analysis_init) ? "PIPECG" : "CG";
 	}
+	return solver_name(mna->ac_analysis_init ? mna->complex_solver : mna->solver);
 }
 
 /* Solves the mna system according to the specified method provided by options argument
  * (LU, Cholesky, Iterative Conj_Grad / Bi-Conj_Grad) and stores the solution on the supplied vector x
  */
-void solve_mna_system(mna_system_t *mna, double **x, gsl_vector_complex *x_complex, options_t *options) {
+void solve_mna_system(mna_system_t *mna, double **x, cs_complex_t *x_complex, options_t *options) {
 	/* In case we're in the DC operating point print */
 	if (!mna->is_decomp) {
 		if (!mna->ac_analysis_init && !mna->tr_analysis_init) {
@@ -790,100 +1000,98 @@ void solve_mna_system(mna_system_t *mna, double **x, gsl_vector_complex *x_compl
 
 	/* Set the maximum number of iterations CG/bi-CG */
 	int iterations, maxiter = mna->dimension;
+	if (mna->use_async && !mna->ac_analysis_init) {
+		maxiter = MAX(maxiter, ASYNC_MAX_SWEEPS);
+	}
+	/* The transient steps carry the previous solutions and Krylov information to the next step */
+	recycle_t *recycle = mna->tr_analysis_init ? mna->recycle : NULL;
 
 	if (options->SPARSE) {
 		/* Pointer to set the appropriate matrix */
 		cs *matrix_ptr = NULL;
-		double *M_precond = NULL;;
-		gsl_vector_complex *gsl_e_ac = NULL;
-		cs_complex_t *cs_x_complex = NULL;
+		precond_t *M_precond = NULL;
 
 		/* In case we are not currently in an AC analysis */
 		if (!mna->ac_analysis_init) {
 			if (mna->tr_analysis_init) {
 				matrix_ptr = mna->sp_matrix->aGhC;
 				M_precond  = mna->M_trans;
+				mna->ws->csr = mna->sp_matrix->aGhC_csr;
 			}
 			/* We are in DC analysis */
 			else {
 				matrix_ptr = mna->sp_matrix->A;
 				M_precond  = mna->M;
+				mna->ws->csr = mna->sp_matrix->A_csr;
 			}
 		}
+		else {
+			mna->ws->complex_csr = mna->sp_matrix->G_ac_csr;
+		}
 		if (options->ITER) {
 			if (mna->ac_analysis_init) {
 				/* Convert x vector (which is the DC operating point) to a complex one in case we're in an AC analysis */
-				real_to_gsl_complex_vector(x_complex, *x, mna->dimension);
-				/* Also conver cs_complex_t *e_ac into a gsl_vector for the iterative solvers */
-				gsl_e_ac = init_gsl_complex_vector(mna->dimension);
-				cs_complex_to_gsl(gsl_e_ac, mna->sp_matrix->e_ac, mna->dimension);
+				real_to_cs_complex_vector(x_complex, *x, mna->dimension);
 			}
+			telemetry_start_solve(mna->telemetry, mna->ws);
 			if (options->SPD) {
 				/* Check if AC analysis has started (complex), otherwise call ordinary solvers */
 				if (mna->ac_analysis_init) {
-					iterations = complex_conj_grad(NULL, mna->sp_matrix->G_ac, x_complex, gsl_e_ac,
-					 							   mna->M_ac, mna->dimension, options->ITOL, maxiter, options->SPARSE);
+					iterations = complex_conj_grad(NULL, mna->sp_matrix->G_ac, x_complex, mna->sp_matrix->e_ac,
+					 							   mna->M_ac, mna->dimension, options->ITOL, maxiter, options->SPARSE, mna->ws);
 				}
 				else {
-					iterations = conj_grad(NULL, matrix_ptr, *x, mna->b, M_precond, mna->dimension,
-			 							   options->ITOL, maxiter, options->SPARSE);
+					iterations = solve_iter_spd(mna, NULL, matrix_ptr, *x, M_precond, maxiter, options, recycle);
 				}
-				//printf("Conjugate gradient method did %d iterations.\n", iterations);
 			}
 			else {
 				/* Check if AC analysis has started (complex), otherwise call ordinary solvers */
 				if (mna->ac_analysis_init) {
-					iterations = complex_bi_conj_grad(NULL, mna->sp_matrix->G_ac, x_complex, gsl_e_ac,
-													  mna->M_ac, mna->M_ac_conj, mna->dimension, options->ITOL,
-													  maxiter, options->SPARSE);
+					iterations = solve_complex_iter_nonsym(mna, NULL, mna->sp_matrix->G_ac, x_complex, mna->sp_matrix->e_ac,
+														   maxiter, options);
 				}
 				else {
-					iterations = bi_conj_grad(NULL, matrix_ptr, *x, mna->b, M_precond, mna->dimension, 
-										  	  options->ITOL, maxiter, options->SPARSE);
-				}
-				if (iterations == FAILURE) {
-					fprintf(stderr, "Bi-Conjugate gradient method failed.\n");
-					exit(EXIT_FAILURE);
+					iterations = solve_iter_nonsym(mna, NULL, matrix_ptr, *x, M_precond, maxiter, options, recycle);
 				}
-				// printf("Bi-Conjugate gradient method did %d iterations.\n", iterations);
 			}
+			telemetry_end_solve(mna->telemetry, mna->ws, iter_solver_label(mna, options), iterations,
+								options->SPD ? maxiter : MAX(maxiter, MAX_ITER_THRESHOLD), options->ITOL);
 		}
 		else { /* Non iterative solvers */
-			if (mna->ac_analysis_init) {
-				cs_x_complex = (cs_complex_t *)malloc(mna->dimension * sizeof(cs_complex_t));
-			}
 			if (options->SPD) {
 				/* Check if AC analysis has started (complex), otherwise call ordinary solvers */
+				/* G + jwC is complex symmetric, not Hermitian, so it goes through LDL' instead of Cholesky */
 				if (mna->ac_analysis_init) {
-					solve_complex_sparse_cholesky(mna, cs_x_complex);
+					solve_complex_sparse_ldl(mna, x_complex, options);
+				}
+				else if (mna->use_dd) {
+					solve_sparse_dd(mna, matrix_ptr, x, options);
 				}
 				else {
-					solve_sparse_cholesky(mna, matrix_ptr, x);
+					solve_sparse_cholesky(mna, matrix_ptr, x, options);
 				}
 			}
 			else {
 				/* Check if AC analysis has started (complex), otherwise call ordinary solvers */
-				if (mna->ac_analysis_init) {
-					solve_complex_sparse_lu(mna, cs_x_complex);
+				if (mna->ac_analysis_init && options->LDL) {
+					solve_complex_sparse_ldl(mna, x_complex, options);
+				}
+				else if (mna->ac_analysis_init) {
+					solve_complex_sparse_lu(mna, x_complex);
+				}
+				else if (options->LDL) {
+					solve_sparse_ldl(mna, matrix_ptr, x, options);
 				}
 				else {
-					solve_sparse_lu(mna, matrix_ptr, x);
+					solve_sparse_lu(mna, matrix_ptr, x, options);
 				}
 			}
-			if (mna->ac_analysis_init) {
-				cs_complex_to_gsl(x_complex, cs_x_complex, mna->dimension);
-			}
-		}
-		/* Free the converted e_ac to gsl and cs_x_complex in case it was allocated for AC analysis */
-		if (mna->ac_analysis_init) {
-			gsl_vector_complex_free(gsl_e_ac);
-			free(cs_x_complex);
 		}
 	}
 	else { /* Dense */
 		/* Pointer to set the appropriate matrix */
 		double **matrix_ptr = NULL;
-		double *M_precond   = NULL;
+		precond_t *M_precond = NULL;
 		gsl_vector_view view_x;
 		/* Set general pointers for matrices, vectors to use for the solvers */
 		if (!mna->ac_analysis_init) {
@@ -900,40 +1108,31 @@ void solve_mna_system(mna_system_t *mna, double **x, gsl_vector_complex *x_compl
 		if (options->ITER) {
 			/* Convert x vector (which is the DC operating point) to a complex one in case we're in an AC analysis */
 			if (mna->ac_analysis_init) {
-				real_to_gsl_complex_vector(x_complex, *x, mna->dimension);
+				real_to_cs_complex_vector(x_complex, *x, mna->dimension);
 			}
+			telemetry_start_solve(mna->telemetry, mna->ws);
 			if (options->SPD) {
 				/* Check if AC analysis has started (complex), otherwise call ordinary solvers */
 				if (mna->ac_analysis_init) {
 					iterations = complex_conj_grad(mna->matrix->G_ac, NULL, x_complex, mna->matrix->e_ac, mna->M_ac, 
-												   mna->dimension, options->ITOL, maxiter, options->SPARSE);
+												   mna->dimension, options->ITOL, maxiter, options->SPARSE, mna->ws);
 				}
 				else {
-			 		iterations = conj_grad(matrix_ptr, NULL, *x, mna->b, M_precond, mna->dimension,
-			 							   options->ITOL, maxiter, options->SPARSE);
+					iterations = solve_iter_spd(mna, matrix_ptr, NULL, *x, M_precond, maxiter, options, recycle);
 				}
-				//printf("Conjugate gradient method did %d iterations.\n", iterations);
 			}
 			else {
 				/* Check if AC analysis has started (complex), otherwise call ordinary solvers */
 				if (mna->ac_analysis_init) {
-					iterations = complex_bi_conj_grad(mna->matrix->G_ac, NULL, x_complex, mna->matrix->e_ac, mna->M_ac,
-												   	  mna->M_ac_conj, mna->dimension, options->ITOL, maxiter, options->SPARSE);
+					iterations = solve_complex_iter_nonsym(mna, mna->matrix->G_ac, NULL, x_complex, mna->matrix->e_ac,
+														   maxiter, options);
 				}
 				else {
-					iterations = bi_conj_grad(matrix_ptr, NULL, *x, mna->b, M_precond, mna->dimension, 
-											  options->ITOL, maxiter, options->SPARSE);
-				}
-				if (iterations == FAILURE) {
-					fprintf(stderr, "Bi-Conjugate gradient method failed.\n");
-					exit(EXIT_FAILURE);
+					iterations = solve_iter_nonsym(mna, matrix_ptr, NULL, *x, M_precond, maxiter, options, recycle);
 				}
-				else if ((maxiter < MAX_ITER_THRESHOLD && iterations == MAX_ITER_THRESHOLD) || 
-						 (maxiter > MAX_ITER_THRESHOLD && iterations == maxiter)) {
-					printf("Bi-Conjugate gradient reached max iterations without convergence.\n");
-				}
-				//printf("Bi-Conjugate gradient method did %d iterations.\n", iterations);
 			}
+			telemetry_end_solve(mna->telemetry, mna->ws, iter_solver_label(mna, options), iterations,
+								options->SPD ? maxiter : MAX(maxiter, MAX_ITER_THRESHOLD), options->ITOL);
 		}
 		else {
 			// TODO perhaps add INLINE MACRO for these flags i.e. mna->ac_analysis_init, mna->tr_analysis_init
@@ -963,59 +1162,220 @@ void solve_mna_system(mna_system_t *mna, double **x, gsl_vector_complex *x_compl
 		mna->is_decomp = true;
 		if (!mna->ac_analysis_init && !mna->tr_analysis_init) {
 			printf("OK\n");
+			if (options->SPARSE && !options->ITER) {
+				print_factor_info(mna->sp_matrix, options, "DC");
+			}
+			else if (options->SPARSE) {
+				print_precond_info(mna->M, mna->sp_matrix->A, "DC");
+				print_async_info(mna->async, "DC");
+				if (options->BENCH) {
+					csr_benchmark(mna->sp_matrix->A_csr, "DC");
+					if (mna->use_async) {
+						async_benchmark(mna, options);
+					}
+				}
+			}
     	}
 	}
 }
 
+/* Solves the SPD system for a panel of right-hand sides with the block CG, X holds the initial guesses */
+static void solve_iter_block(mna_system_t *mna, double *B, double *X, int k, options_t *options) {
+	double **A = NULL;
+	cs *C = NULL;
+	precond_t *M_precond = mna->tr_analysis_init ? mna->M_trans : mna->M;
+
+	if (options->SPARSE) {
+		C = mna->tr_analysis_init ? mna->sp_matrix->aGhC : mna->sp_matrix->A;
+		mna->ws->csr = mna->tr_analysis_init ? mna->sp_matrix->aGhC_csr : mna->sp_matrix->A_csr;
+	}
+	else {
+		A = mna->tr_analysis_init ? mna->matrix->aGhC : mna->matrix->A;
+	}
+	telemetry_start_solve(mna->telemetry, mna->ws);
+	int iterations = block_conj_grad(A, C, X, B, M_precond, mna->dimension, k, options->ITOL, mna->dimension,
+									 options->SPARSE, mna->ws);
+	telemetry_end_solve(mna->telemetry, mna->ws, "BCG", iterations, mna->dimension, options->ITOL);
+}
+
+/*
+ * Solves the already factorized MNA system for a panel of k right-hand sides B and stores the
+ * solutions to X. Both panels are stored row by row, X[i * k + c] is the i-th entry of solution c.
+ * Every entry of the factors is applied to all k columns at once. The iterative SPD systems are
+ * solved with the block CG instead, starting from the guesses in X.
+ */
+void solve_mna_system_block(mna_system_t *mna, double *B, double *X, int k, options_t *options) {
+	if (options->ITER) {
+		assert(options->SPD);
+		solve_iter_block(mna, B, X, k, options);
+		return;
+	}
+	assert(mna->is_decomp);
+	if (options->SPARSE) {
+		if (mna->use_dd) {
+			/* Column by column, X holds the initial guesses of the interface */
+			double *b = mna->ws->temp[0], *x = mna->ws->temp[1];
+			for (int c = 0; c < k; c++) {
+				for (int i = 0; i < mna->dimension; i++) {
+					b[i] = B[i * k + c];
+					x[i] = X[i * k + c];
+				}
+				dd_solve(mna->sp_matrix->A_dd, x, b);
+				for (int i = 0; i < mna->dimension; i++) {
+					X[i * k + c] = x[i];
+				}
+			}
+		}
+		else if (options->SPD) {
+			solve_sparse_cholesky_block(mna, B, X, k, options);
+		}
+		else if (mna->sp_matrix->A_ldl != NULL) {
+			ldl_solve_block(mna->sp_matrix->A_ldl, B, X, k, mna->ws);
+		}
+		else {
+			solve_sparse_lu_block(mna, B, X, k, options);
+		}
+	}
+	else {
+		double **matrix_ptr = mna->tr_analysis_init ? mna->matrix->aGhC : mna->matrix->A;
+		if (options->SPD) {
+			solve_cholesky_block(matrix_ptr, B, X, mna->dimension, k);
+		}
+		else {
+			solve_lu_block(matrix_ptr, mna->matrix->P, B, X, mna->dimension, k);
+		}
+	}
+}
+
 /* Solve the MNA system using LU decomposition and store the result in vector x */
 void solve_lu(double **A, double *b, gsl_vector_view x, gsl_permutation *P, int dimension, bool is_decomp) {
-	/* The sign of the permutation matrix */
-	int signum;
-	gsl_matrix_view view_A = gsl_matrix_view_array(A[0], dimension, dimension);
-	gsl_vector_view view_b = gsl_vector_view_array(b, dimension);
 	if (!is_decomp) {
-		/* LU decomposition on A, PA = LU */
-		gsl_linalg_LU_decomp(&view_A.matrix, P, &signum);
+		/* Blocked LU decomposition on A, PA = LU */
+		dense_lu(A[0], dimension, dimension, P->data);
 	}
-	gsl_linalg_LU_solve(&view_A.matrix, P, &view_b.vector, &x.vector);
+	dense_lu_solve(A[0], dimension, dimension, P->data, b, x.vector.data);
 }
 
 /* Solve the MNA system using complex LU decomposition and store the result in vector x */
-void solve_complex_lu(gsl_matrix_complex *A, gsl_vector_complex *b, gsl_vector_complex *x, gsl_permutation *P, int dimension) {
-	/* The sign of the permutation matrix */
-	int signum;
-	/* LU decomposition on A, PA = LU */
-	gsl_linalg_complex_LU_decomp(A, P, &signum);
-	gsl_linalg_complex_LU_solve(A, P, b, x);
+void solve_complex_lu(gsl_matrix_complex *A, cs_complex_t *b, cs_complex_t *x, gsl_permutation *P, int dimension) {
+	/* The gsl complex storage is the same as an array of double complex */
+	/* Blocked LU decomposition on A, PA = LU */
+	dense_complex_lu((double complex *)A->data, dimension, A->tda, P->data);
+	dense_complex_lu_solve((double complex *)A->data, dimension, A->tda, P->data, b, x);
 }
 
 /* Solves the sparse mna system with LU factorization and store the result in vector x */
-void solve_sparse_lu(mna_system_t *mna, cs *A, double **x) {
-	double *temp_b = (double *)malloc(mna->dimension * sizeof(double));
-	memcpy(temp_b, mna->b, mna->dimension * sizeof(double));
+void solve_sparse_lu(mna_system_t *mna, cs *A, double **x, options_t *options) {
+	/* Solve on the block triangular form, the diagonal blocks are factorized separately */
+	if (options->BTF) {
+		if (!mna->is_decomp) {
+			free_sparse_factors(mna->sp_matrix);
+			mna->sp_matrix->A_btf = btf_factor(A, options->ORDER, &mna->sp_matrix->A_order);
+			cs_spfree(A);
+		}
+		btf_solve(mna->sp_matrix->A_btf, mna->b, *x);
+		return;
+	}
 
 	if (!mna->is_decomp) {
-		mna->sp_matrix->A_symbolic = cs_sqr(2, A, 0);
-		mna->sp_matrix->A_numeric  = cs_lu(A, mna->sp_matrix->A_symbolic, 1);
-		cs_spfree(A);
+		free_sparse_factors(mna->sp_matrix);
+		mna->sp_matrix->A_symbolic = order_symbolic(A, options->ORDER, true, &mna->sp_matrix->A_order);
+		if (options->MIXED) {
+			/* The mixed precision solver factorizes A in single precision and keeps it for the refinement */
+			mna->sp_matrix->A_mixed = mixed_factor(A, mna->sp_matrix->A_symbolic, true);
+			mna->sp_matrix->A_order.actual_nnz = mixed_nnz(mna->sp_matrix->A_mixed);
+			mna->sp_matrix->A_symbolic = NULL;
+		}
+		else {
+			mna->sp_matrix->A_numeric  = cs_lu(A, mna->sp_matrix->A_symbolic, 1);
+			if (mna->sp_matrix->A_numeric == NULL || mna->sp_matrix->A_symbolic == NULL) {
+				fprintf(stderr, "\nLU method failed...singular matrix\n");
+				exit(EXIT_FAILURE);
+			}
+			set_actual_fill(&mna->sp_matrix->A_order, mna->sp_matrix->A_numeric, true);
+			cs_spfree(A);
+		}
+	}
+	if (options->MIXED) {
+		mixed_solve(mna->sp_matrix->A_mixed, mna->b, *x);
+		return;
 	}
 
+	double *temp_b = mna->ws->temp[0];
+	memcpy(temp_b, mna->b, mna->dimension * sizeof(double));
+
 	cs_ipvec(mna->sp_matrix->A_numeric->pinv, temp_b, *x, mna->dimension);
 	cs_lsolve(mna->sp_matrix->A_numeric->L, *x);
 	cs_usolve(mna->sp_matrix->A_numeric->U, *x);
 	cs_ipvec(mna->sp_matrix->A_symbolic->q, *x, temp_b, mna->dimension);
 
 	memcpy(*x, temp_b, mna->dimension * sizeof(double));
-	free(temp_b);
+}
+
+/* Solves the sparse LU factorized mna system for a panel of k right-hand sides */
+void solve_sparse_lu_block(mna_system_t *mna, double *B, double *X, int k, options_t *options) {
+	if (options->BTF) {
+		btf_solve_block(mna->sp_matrix->A_btf, B, X, k, mna->ws);
+		return;
+	}
+	if (options->MIXED) {
+		mixed_solve_block(mna->sp_matrix->A_mixed, B, X, k, mna->ws);
+		return;
+	}
+	double *temp = ws_panel(mna->ws, 0, k);
+
+	cs_ipvec_block(mna->sp_matrix->A_numeric->pinv, B, temp, mna->dimension, k);
+	cs_lsolve_block(mna->sp_matrix->A_numeric->L, temp, k);
+	cs_usolve_block(mna->sp_matrix->A_numeric->U, temp, k);
+	cs_ipvec_block(mna->sp_matrix->A_symbolic->q, temp, X, mna->dimension, k);
+}
+
+/*
+ * Solves the sparse mna system with the symmetric indefinite LDL' factorization and stores the result
+ * in vector x. In case a static pivot is too small, LU with partial pivoting is used instead.
+ */
+void solve_sparse_ldl(mna_system_t *mna, cs *A, double **x, options_t *options) {
+	if (!mna->is_decomp) {
+		free_sparse_factors(mna->sp_matrix);
+		mna->sp_matrix->A_ldl = ldl_factor(A, options->ORDER);
+		if (mna->sp_matrix->A_ldl == NULL) {
+			solve_sparse_lu(mna, A, x, options);
+			return;
+		}
+		cs_spfree(A);
+	}
+	if (mna->sp_matrix->A_ldl == NULL) {
+		solve_sparse_lu(mna, A, x, options);
+		return;
+	}
+	ldl_solve(mna->sp_matrix->A_ldl, mna->b, *x);
 }
 
 /* Solves the sparse mna system with LU factorization and store the result in vector x */
 void solve_complex_sparse_lu(mna_system_t *mna, cs_complex_t *x) {
-	cs_complex_t *temp_b = (cs_complex_t *)malloc(mna->dimension * sizeof(cs_complex_t));
+	cs_complex_t *temp_b = mna->ws->complex_temp[1];
 	memcpy(temp_b, mna->sp_matrix->e_ac, mna->dimension * sizeof(cs_complex_t));
 
-	mna->sp_matrix->G_ac_symbolic = cs_ci_sqr(2, mna->sp_matrix->G_ac, 0);
-	mna->sp_matrix->G_ac_numeric  = cs_ci_lu(mna->sp_matrix->G_ac, mna->sp_matrix->G_ac_symbolic, 1);
+	/* The pattern of G_ac is the same for every frequency, so the symbolic analysis is done only once */
+	if (mna->sp_matrix->G_ac_symbolic == NULL) {
+		mna->sp_matrix->G_ac_symbolic = cs_ci_sqr(2, mna->sp_matrix->G_ac, 0);
+	}
+	mna->sp_matrix->G_ac_numeric = cs_ci_lu(mna->sp_matrix->G_ac, mna->sp_matrix->G_ac_symbolic, 1);
+
+	/* The AC analysis writes only its .PLOT nodes, their solves may take the reach of e_ac and skip the rest */
+	if (mna->partial != NULL && mna->partial->num_probes > 0) {
+		cs_cin *N = mna->sp_matrix->G_ac_numeric;
+		if (mna->sp_matrix->G_ac_qinv == NULL && mna->sp_matrix->G_ac_symbolic->q != NULL) {
+			mna->sp_matrix->G_ac_qinv = cs_ci_pinv(mna->sp_matrix->G_ac_symbolic->q, mna->dimension);
+		}
+		/* values -1 is the plain transpose U.', 1 would conjugate it */
+		cs_ci *Ut = partial_pays(mna->partial) ? cs_ci_transpose(N->U, -1) : NULL;
+		partial_complex_solve(mna->partial, N->L, N->U, Ut, N->pinv, mna->sp_matrix->G_ac_qinv, mna->sp_matrix->e_ac, x);
+		cs_ci_spfree(Ut);
+		cs_ci_nfree(N);
+		mna->sp_matrix->G_ac_numeric = NULL;
+		return;
+	}
 
 	cs_ci_ipvec(mna->sp_matrix->G_ac_numeric->pinv, temp_b, x, mna->dimension);
 	cs_ci_lsolve(mna->sp_matrix->G_ac_numeric->L, x);
@@ -1023,85 +1383,186 @@ void solve_complex_sparse_lu(mna_system_t *mna, cs_complex_t *x) {
 	cs_ci_ipvec(mna->sp_matrix->G_ac_symbolic->q, x, temp_b, mna->dimension);
 
 	memcpy(x, temp_b, mna->dimension * sizeof(cs_complex_t));
-	free(temp_b);
 
-	/*
-	 * Symbolic and Numeric factorizations have to be freed in every step
-	 * because in the next step/factorization the pointers will be lost otherwise
-	 */
-	cs_ci_sfree(mna->sp_matrix->G_ac_symbolic);
+	/* The numeric factorization has to be freed in every step, the next frequency gets a new one */
 	cs_ci_nfree(mna->sp_matrix->G_ac_numeric);
+	mna->sp_matrix->G_ac_numeric = NULL;
+}
+
+/*
+ * Solves the complex symmetric AC system with LDL' and stores the result in vector x. The factorization
+ * of the previous frequency is passed along, so its symbolic analysis is reused while the pattern and
+ * the pivots don't change. Falls back to LU when a static pivot is too small.
+ */
+void solve_complex_sparse_ldl(mna_system_t *mna, cs_complex_t *x, options_t *options) {
+	mna->sp_matrix->G_ac_ldl = ldl_complex_factor(mna->sp_matrix->G_ac, options->ORDER, mna->sp_matrix->G_ac_ldl);
+	if (mna->sp_matrix->G_ac_ldl == NULL) {
+		mna->sp_matrix->G_ac_fallbacks++;
+		solve_complex_sparse_lu(mna, x);
+		return;
+	}
+	ldl_complex_solve(mna->sp_matrix->G_ac_ldl, mna->sp_matrix->e_ac, x);
 }
 
 /* Solve the MNA system using cholesky decomposition and store the result in vector x */
 void solve_cholesky(double **A, double *b, gsl_vector_view x, int dimension, bool is_decomp) {
-	gsl_matrix_view view_A = gsl_matrix_view_array(A[0], dimension, dimension);
-	gsl_vector_view view_b = gsl_vector_view_array(b, dimension);
 	if (!is_decomp) {
-		/* Cholesky decomposition A = LL^T*/
-		gsl_linalg_cholesky_decomp(&view_A.matrix);
+		/* Blocked Cholesky decomposition A = LL^T */
+		dense_cholesky(A[0], dimension, dimension);
+	}
+	dense_cholesky_solve(A[0], dimension, dimension, b, x.vector.data);
+}
+
+/* Solves the dense LU factorized (PA = LU) system for a panel of k right-hand sides */
+void solve_lu_block(double **A, gsl_permutation *P, double *B, double *X, int dimension, int k) {
+	for (int i = 0; i < dimension; i++) {
+		memcpy(&X[i * k], &B[gsl_permutation_get(P, i) * k], k * sizeof(double));
+	}
+	/* L has unit diagonal */
+	for (int i = 0; i < dimension; i++) {
+		for (int j = 0; j < i; j++) {
+			for (int c = 0; c < k; c++) {
+				X[i * k + c] -= A[i][j] * X[j * k + c];
+			}
+		}
+	}
+	for (int i = dimension - 1; i >= 0; i--) {
+		for (int j = i + 1; j < dimension; j++) {
+			for (int c = 0; c < k; c++) {
+				X[i * k + c] -= A[i][j] * X[j * k + c];
+			}
+		}
+		for (int c = 0; c < k; c++) {
+			X[i * k + c] /= A[i][i];
+		}
+	}
+}
+
+/* Solves the dense Cholesky factorized system (L stored in the lower triangle) for a panel of k right-hand sides */
+void solve_cholesky_block(double **A, double *B, double *X, int dimension, int k) {
+	memcpy(X, B, dimension * k * sizeof(double));
+	for (int i = 0; i < dimension; i++) {
+		for (int j = 0; j < i; j++) {
+			for (int c = 0; c < k; c++) {
+				X[i * k + c] -= A[i][j] * X[j * k + c];
+			}
+		}
+		for (int c = 0; c < k; c++) {
+			X[i * k + c] /= A[i][i];
+		}
+	}
+	for (int i = dimension - 1; i >= 0; i--) {
+		for (int j = i + 1; j < dimension; j++) {
+			for (int c = 0; c < k; c++) {
+				X[i * k + c] -= A[j][i] * X[j * k + c];
+			}
+		}
+		for (int c = 0; c < k; c++) {
+			X[i * k + c] /= A[i][i];
+		}
 	}
-	gsl_linalg_cholesky_solve(&view_A.matrix, &view_b.vector, &x.vector);
 }
 
 /* Solve the MNA system using complex cholesky decomposition and store the result in vector x */
-void solve_complex_cholesky(gsl_matrix_complex *A, gsl_vector_complex *b, gsl_vector_complex *x, int dimension) {
-	/* Cholesky decomposition A = LL^T*/
-	gsl_linalg_complex_cholesky_decomp(A);
-	gsl_linalg_complex_cholesky_solve(A, b, x);
+void solve_complex_cholesky(gsl_matrix_complex *A, cs_complex_t *b, cs_complex_t *x, int dimension) {
+	/* Blocked Cholesky decomposition A = LL^H */
+	dense_complex_cholesky((double complex *)A->data, dimension, A->tda);
+	dense_complex_cholesky_solve((double complex *)A->data, dimension, A->tda, b, x);
 }
 
 /* Solves the sparse mna system with Cholesky factorization and store the result in vector x */
-void solve_sparse_cholesky(mna_system_t *mna, cs *A, double **x) {
-	double *temp_b = (double *)malloc(mna->dimension * sizeof(double));
-	memcpy(temp_b, mna->b, mna->dimension * sizeof(double));
-
+void solve_sparse_cholesky(mna_system_t *mna, cs *A, double **x, options_t *options) {
 	if (!mna->is_decomp) {
-		mna->sp_matrix->A_symbolic = cs_schol(1, A);
-		mna->sp_matrix->A_numeric  = cs_chol(A, mna->sp_matrix->A_symbolic);
-		if (mna->sp_matrix->A_numeric == NULL || mna->sp_matrix->A_symbolic == NULL) {
-			fprintf(stderr, "\nCholesky method failed...non SPD matrix\n");
-			exit(EXIT_FAILURE);
+		free_sparse_factors(mna->sp_matrix);
+		mna->sp_matrix->A_symbolic = order_symbolic(A, options->ORDER, false, &mna->sp_matrix->A_order);
+		if (options->MIXED) {
+			/* The mixed precision solver factorizes A in single precision and keeps it for the refinement */
+			mna->sp_matrix->A_mixed = mixed_factor(A, mna->sp_matrix->A_symbolic, false);
+			mna->sp_matrix->A_order.actual_nnz = mixed_nnz(mna->sp_matrix->A_mixed);
+			mna->sp_matrix->A_symbolic = NULL;
 		}
-		cs_spfree(A);
+		else {
+			mna->sp_matrix->A_numeric  = cs_chol(A, mna->sp_matrix->A_symbolic);
+			if (mna->sp_matrix->A_numeric == NULL || mna->sp_matrix->A_symbolic == NULL) {
+				fprintf(stderr, "\nCholesky method failed...non SPD matrix\n");
+				exit(EXIT_FAILURE);
+			}
+			set_actual_fill(&mna->sp_matrix->A_order, mna->sp_matrix->A_numeric, false);
+			cs_spfree(A);
+		}
+	}
+	if (options->MIXED) {
+		mixed_solve(mna->sp_matrix->A_mixed, mna->b, *x);
+		return;
 	}
 
+	double *temp_b = mna->ws->temp[0];
+	memcpy(temp_b, mna->b, mna->dimension * sizeof(double));
+
 	cs_ipvec(mna->sp_matrix->A_symbolic->pinv, temp_b, *x, mna->dimension);
 	cs_lsolve(mna->sp_matrix->A_numeric->L, *x);
 	cs_ltsolve(mna->sp_matrix->A_numeric->L, *x);
 	cs_pvec(mna->sp_matrix->A_symbolic->pinv, *x, temp_b, mna->dimension);
 
 	memcpy(*x, temp_b, mna->dimension * sizeof(double));
-	free(temp_b);
 }
 
-/* Solves the sparse mna system with Cholesky factorization and store the result in vector x */
-void solve_complex_sparse_cholesky(mna_system_t *mna, cs_complex_t *x) {
-	cs_complex_t *temp_b = (cs_complex_t *)malloc(mna->dimension * sizeof(cs_complex_t));
-	memcpy(temp_b, mna->sp_matrix->e_ac, mna->dimension * sizeof(cs_complex_t));
-
-	mna->sp_matrix->G_ac_symbolic = cs_ci_schol(1, mna->sp_matrix->G_ac);
-	mna->sp_matrix->G_ac_numeric  = cs_ci_chol(mna->sp_matrix->G_ac, mna->sp_matrix->G_ac_symbolic);
-
-	if (mna->sp_matrix->G_ac_numeric == NULL || mna->sp_matrix->G_ac_symbolic == NULL) {
-		fprintf(stderr, "\nCholesky method failed...non SPD matrix\n");
-		exit(EXIT_FAILURE);
+/*
+ * Solves the sparse SPD mna system with the domain decomposition, the interiors of the domains are
+ * factorized once and x holds the initial guess of the interface
+ */
+void solve_sparse_dd(mna_system_t *mna, cs *A, double **x, options_t *options) {
+	if (!mna->is_decomp) {
+		free_sparse_factors(mna->sp_matrix);
+		mna->sp_matrix->A_dd = dd_setup(NULL, A, options->DOMAINS, options->ORDER);
+		cs_spfree(A);
 	}
+	dd_solve(mna->sp_matrix->A_dd, *x, mna->b);
+}
 
-	cs_ci_ipvec(mna->sp_matrix->G_ac_symbolic->pinv, temp_b, x, mna->dimension);
-	cs_ci_lsolve(mna->sp_matrix->G_ac_numeric->L, x);
-	cs_ci_ltsolve(mna->sp_matrix->G_ac_numeric->L, x);
-	cs_ci_pvec(mna->sp_matrix->G_ac_symbolic->pinv, x, temp_b, mna->dimension);
+/*
+ * Solves the factorized DC system for the right-hand side b and computes only the probed unknowns of x,
+ * along the reach of b when it is sparse. The domain decomposition has no factors of the whole matrix
+ * and computes all of them from the guess in x. Returns false without the plain sparse LU or Cholesky
+ * factors (dense, ITER, BTF, MIXED or LDL), the caller has to solve for all the unknowns then.
+ */
+bool solve_mna_system_probed(mna_system_t *mna, double *b, double *x, options_t *options) {
+	sp_matrix_t *sp_matrix = mna->sp_matrix;
+	if (mna->partial != NULL && mna->is_decomp && sp_matrix->A_dd != NULL) {
+		dd_solve(sp_matrix->A_dd, x, b);
+		return true;
+	}
+	if (mna->partial == NULL || !mna->is_decomp || sp_matrix->A_numeric == NULL || sp_matrix->A_ldl != NULL) {
+		return false;
+	}
+	csn *N = sp_matrix->A_numeric;
+	css *S = sp_matrix->A_symbolic;
+	if (options->SPD) {
+		partial_solve(mna->partial, N->L, NULL, NULL, S->pinv, S->pinv, b, x);
+		return true;
+	}
+	if (sp_matrix->A_qinv == NULL && S->q != NULL) {
+		sp_matrix->A_qinv = cs_pinv(S->q, mna->dimension);
+	}
+	if (sp_matrix->A_Ut == NULL && partial_pays(mna->partial)) {
+		sp_matrix->A_Ut = cs_transpose(N->U, 1);
+	}
+	partial_solve(mna->partial, N->L, N->U, sp_matrix->A_Ut, N->pinv, sp_matrix->A_qinv, b, x);
+	return true;
+}
 
-	memcpy(x, temp_b, mna->dimension * sizeof(cs_complex_t));
-	free(temp_b);
+/* Solves the sparse Cholesky factorized mna system for a panel of k right-hand sides */
+void solve_sparse_cholesky_block(mna_system_t *mna, double *B, double *X, int k, options_t *options) {
+	if (options->MIXED) {
+		mixed_solve_block(mna->sp_matrix->A_mixed, B, X, k, mna->ws);
+		return;
+	}
+	double *temp = ws_panel(mna->ws, 0, k);
 
-	/*
-	 * Symbolic and Numeric factorizations have to be freed in every step
-	 * because in the next step/factorization the pointers will be lost otherwise
-	 */
-	cs_ci_sfree(mna->sp_matrix->G_ac_symbolic);
-	cs_ci_nfree(mna->sp_matrix->G_ac_numeric);
+	cs_ipvec_block(mna->sp_matrix->A_symbolic->pinv, B, temp, mna->dimension, k);
+	cs_lsolve_block(mna->sp_matrix->A_numeric->L, temp, k);
+	cs_ltsolve_block(mna->sp_matrix->A_numeric->L, temp, k);
+	cs_pvec_block(mna->sp_matrix->A_symbolic->pinv, temp, X, mna->dimension, k);
 }
 
 /* Gets the response value according to the transient spec */
@@ -1219,11 +1680,9 @@ void print_vector(double *b, int dimension) {
 }
 
 /* Print the complex vector */
-void print_complex_vector(gsl_vector_complex *b, int dimension) {
-	gsl_complex z;
+void print_complex_vector(cs_complex_t *b, int dimension) {
 	for (int i = 0; i < dimension; i++) {
-		z = gsl_vector_complex_get(b, i);
-		printf("% lf %s %lfi\n", GSL_REAL(z), GSL_IMAG(z) >= 0.0 ? "+" : "-", ABS(GSL_IMAG(z)));
+		printf("% lf %s %lfi\n", creal(b[i]), cimag(b[i]) >= 0.0 ? "+" : "-", fabs(cimag(b[i])));
 	}
     printf("\n");
 }
@@ -1257,30 +1716,85 @@ cs_di *_cs_di_copy(cs_di *A) {
     return C;
 }
 
+/* Prints the ordering and the info of the factorization that was used for the real sparse matrix */
+void print_factor_info(sp_matrix_t *sp_matrix, options_t *options, char *msg) {
+	if (sp_matrix->A_ldl != NULL) {
+		print_ldl_info(sp_matrix->A_ldl, msg);
+		return;
+	}
+	if (sp_matrix->A_dd != NULL) {
+		print_dd_info(sp_matrix->A_dd, msg);
+		return;
+	}
+	print_order_info(&sp_matrix->A_order, msg);
+	if (options->LDL && !options->SPD) {
+		printf("%s LDL': static pivot too small, fell back to LU\n", msg);
+	}
+	if (sp_matrix->A_btf != NULL) {
+		print_btf_info(sp_matrix->A_btf, msg);
+	}
+	else if (sp_matrix->A_mixed != NULL) {
+		print_mixed_info(sp_matrix->A_mixed, msg);
+	}
+}
+
+/* Prints the complex symmetric LDL' factorization of the AC analysis and how many frequencies fell back to LU */
+void print_ac_factor_info(sp_matrix_t *sp_matrix, options_t *options) {
+	if (!options->SPARSE || options->ITER || !(options->SPD || options->LDL)) {
+		return;
+	}
+	if (sp_matrix->G_ac_ldl != NULL) {
+		print_ldl_info(sp_matrix->G_ac_ldl, "AC");
+	}
+	if (sp_matrix->G_ac_fallbacks > 0) {
+		printf("AC LDL': static pivot too small at %d frequencies, fell back to LU\n", sp_matrix->G_ac_fallbacks);
+	}
+}
+
+/* Frees whichever factorization of the real sparse matrix exists */
+void free_sparse_factors(sp_matrix_t *sp_matrix) {
+	sp_matrix->A_symbolic = cs_di_sfree(sp_matrix->A_symbolic);
+	sp_matrix->A_numeric  = cs_di_nfree(sp_matrix->A_numeric);
+	btf_free(sp_matrix->A_btf);
+	mixed_free(sp_matrix->A_mixed);
+	ldl_free(sp_matrix->A_ldl);
+	free_dd(sp_matrix->A_dd);
+	cs_di_spfree(sp_matrix->A_Ut);
+	free(sp_matrix->A_qinv);
+	sp_matrix->A_btf   = NULL;
+	sp_matrix->A_mixed = NULL;
+	sp_matrix->A_ldl   = NULL;
+	sp_matrix->A_dd    = NULL;
+	sp_matrix->A_Ut    = NULL;
+	sp_matrix->A_qinv  = NULL;
+}
+
 /* Free all the memory allocated for the MNA system */
 void free_mna_system(mna_system_t **mna, options_t *options) {
 	if (options->SPARSE) {
 		if (options->ITER) {
 			/* This is only needed in case we have iterative solvers otherwise it is free'd inside direct methods */
 			cs_di_spfree((*mna)->sp_matrix->A);
+			free_csr((*mna)->sp_matrix->A_csr);
 			if (options->AC) {
 				cs_ci_spfree((*mna)->sp_matrix->G_ac);
+				free_complex_csr((*mna)->sp_matrix->G_ac_csr);
 			}
 			if (options->TRAN) {
 				cs_di_spfree((*mna)->sp_matrix->aGhC);
+				free_csr((*mna)->sp_matrix->aGhC_csr);
 			}
 		}
 		else { /* Direct Methods */
 			/*
-			 * Notice that the equivalent symbolic,numeric for complex AC are being freed inside the solvers,
-			 * because every time we're going to solve the AC MNA, we're gonna get new symbolic and numeric
-			 * factorizations. Thus, it's required to free them inside the functions/solvers.
+			 * Notice that the complex numeric LU factorization is freed inside the solver, because every
+			 * frequency gets a new one. The symbolic one is kept, the pattern of G_ac doesn't change.
 			 */
-			cs_di_sfree((*mna)->sp_matrix->A_symbolic);
-			cs_di_nfree((*mna)->sp_matrix->A_numeric);
+			free_sparse_factors((*mna)->sp_matrix);
 			if (options->AC) {
-				/* Free G_ac for the last step, this is freed by create_sparse_ac_mna function in the previous steps */
 				cs_ci_spfree((*mna)->sp_matrix->G_ac);
+				cs_ci_sfree((*mna)->sp_matrix->G_ac_symbolic);
+				free((*mna)->sp_matrix->G_ac_qinv);
 			}
 		}
 		/* In case there is an TRAN analysis in the netlist */
@@ -1301,6 +1815,9 @@ void free_mna_system(mna_system_t **mna, options_t *options) {
 		/* Free the complex struct for the cs routines */
 		if (options->AC) {
 			free((*mna)->sp_matrix->e_ac);
+			free((*mna)->sp_matrix->G_ac_g);
+			free((*mna)->sp_matrix->G_ac_c);
+			ldl_free((*mna)->sp_matrix->G_ac_ldl);
 		}
 		/* Free the whole sp matrix struct */
 		free((*mna)->sp_matrix);
@@ -1330,7 +1847,7 @@ void free_mna_system(mna_system_t **mna, options_t *options) {
 		if (options->AC) {
 			/* Free all the allocated complex structures from GSL */
 			gsl_matrix_complex_free((*mna)->matrix->G_ac);
-			gsl_vector_complex_free((*mna)->matrix->e_ac);
+			free((*mna)->matrix->e_ac);
 		}
 		
 		/* Free the A_base in case it exists */
@@ -1345,17 +1862,22 @@ void free_mna_system(mna_system_t **mna, options_t *options) {
 
 	/* Free the preconditioners for the iterative solvers */
 	if (options->ITER) {
-		free((*mna)->M);
+		free_precond((*mna)->M);
 		if (options->TRAN) {
-			free((*mna)->M_trans);
+			free_precond((*mna)->M_trans);
 		}
 		if (options->AC) {
-			gsl_vector_complex_free((*mna)->M_ac);
-			gsl_vector_complex_free((*mna)->M_ac_conj);
+			free_complex_precond((*mna)->M_ac);
 		}
 	}
 	/* Free b*/
 	free((*mna)->b);
+	free_workspace((*mna)->ws);
+	free_recycle((*mna)->recycle);
+	free_telemetry((*mna)->telemetry);
+	free_async((*mna)->async);
+	free_async((*mna)->async_trans);
+	free_partial((*mna)->partial);
 
 	/* Free every string allocated for the group2 elements */
 	for (int i = 0; i < (*mna)->num_g2_elem; i++) {
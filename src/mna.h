@@ -10,6 +10,17 @@
 #include "parser.h"
 #include "iter.h"
 #include "routines.h"
+#include "ordering.h"
+#include "btf.h"
+#include "mixed.h"
+#include "ldl.h"
+#include "dense.h"
+#include "workspace.h"
+#include "precond.h"
+#include "telemetry.h"
+#include "partial.h"
+#include "async.h"
+#include "dd.h"
 #include "../cx_sparse/Include/cs.h"
 
 /* Holds the transient response and the nodes that contribute to it */
@@ -37,7 +48,7 @@ typedef struct matrix {
 
 	/* Complex matrix G for the AC Analysis and RHS vector */
 	gsl_matrix_complex *G_ac;
-	gsl_vector_complex *e_ac;
+	cs_complex_t *e_ac;
 } matrix_t;
 
 /* Holds the sparse representation of the MNA */
@@ -57,16 +68,45 @@ typedef struct sp_matrix {
 	/* Hold the symbolic and numeric representation of the LU factorization */
 	css *A_symbolic;
 	csn *A_numeric;
-
-	/* Sparse data structures for AC analysis */
+	/* The fill-reducing ordering that was used for the factorization of A */
+	order_info_t A_order;
+	/* Block triangular form of A with the factorizations of its diagonal blocks, only with BTF option */
+	btf_t *A_btf;
+	/* Single precision factorization of A with iterative refinement, only with MIXED option */
+	mixed_t *A_mixed;
+	/* Symmetric indefinite LDL' factorization of A, only with LDL option */
+	ldl_t *A_ldl;
+	/* Domain decomposition of A with the factorizations of the interiors of its domains, only with DD option */
+	dd_t *A_dd;
+	/* U' and the inverse column permutation of the LU of A for the partial solves, built when first needed */
+	cs *A_Ut;
+	int *A_qinv;
+
+	/*
+	 * Sparse data structures for AC analysis. The pattern of G_ac is built once, then for every
+	 * frequency its values are set to G_ac_g + jw G_ac_c, the conductances and the C/L coefficients
+	 */
 	cs_ci *G_ac;
+	double *G_ac_g;
+	double *G_ac_c;
 
 	/* This is necessary for the sparse routines, instead of using gsl complex */
 	cs_complex_t *e_ac;
 
-	/* Hold the symbolic and numeric representation of the LU factorization */
+	/* CSR mirrors of A, aGhC and G_ac for the products of the iterative solvers, only with ITER option */
+	csr_t *A_csr;
+	csr_t *aGhC_csr;
+	complex_csr_t *G_ac_csr;
+
+	/* Hold the symbolic and numeric representation of the LU factorization, the symbolic one is kept for all frequencies */
 	cs_cis *G_ac_symbolic;
 	cs_cin *G_ac_numeric;
+	/* Inverse column permutation of the symbolic LU of G_ac for the partial solves */
+	int *G_ac_qinv;
+	/* Complex symmetric LDL' factorization of G_ac, kept from one frequency to the next, only with SPD or LDL option */
+	ldl_t *G_ac_ldl;
+	/* Number of frequencies that fell back to LU */
+	int G_ac_fallbacks;
 } sp_matrix_t;
 
 /* Keeps the indexing for the sources of group 2 */
@@ -82,17 +122,37 @@ typedef struct mna_system {
 	/* Pointer to the transient response and the nodes that contribute to it */
 	resp_t *resp;
 
-	/* Jacobi Preconditioner M, we only store the diagonal of A not zeros */
+	/* Preconditioners of the iterative solvers, Jacobi or an incomplete factorization of A */
 	/* For DC and TRANSIENT analysis */
-	double *M;
-	double *M_trans;
+	precond_t *M;
+	precond_t *M_trans;
+	/* Block factorizations of the asynchronous block-Jacobi for A and aGhC, only with ASYNC option */
+	async_t *async;
+	async_t *async_trans;
 	/* For AC analysis */
-	gsl_vector_complex *M_ac;
-	gsl_vector_complex *M_ac_conj;
+	complex_precond_t *M_ac;
+	/* Solvers of the non-SPD iterative systems, one that breaks down hands over to the next for the rest of the run */
+	iter_solver_t solver;
+	iter_solver_t complex_solver;
+	/* Restart lengths of GMRES(m), doubled for the rest of the run when it stagnates */
+	int restart;
+	int complex_restart;
+	/* ASYNC and DD options as they apply to this system, off when it isn't one they solve */
+	bool use_async;
+	bool use_dd;
 
 	/* Right hand side vector b for the Ax=b */
 	double *b;
 
+	/* Scratch vectors of the solvers and the right-hand side builders */
+	workspace_t *ws;
+	/* Previous solutions and deflation space of the iterative transient solves, only with ITER and TRAN */
+	recycle_t *recycle;
+	/* Convergence statistics of the iterative solves, only with ITER */
+	telemetry_t *telemetry;
+	/* Solves that compute only the .PLOT nodes of the DC sweep and the AC analysis, only with the sparse direct solvers */
+	partial_t *partial;
+
 	/* General info about MNA */
 	bool is_decomp;
 	int dimension;
@@ -119,16 +179,25 @@ void create_dense_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_tabl
 void create_dense_trans_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_table, options_t *options, int offset, double tr_step);
 void create_dense_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_table, options_t *options, int offset, double omega);
 void create_sparse_ac_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_table, options_t *options, int offset, double omega);
+void create_sparse_ac_pattern(mna_system_t *mna, index_t *index, hash_table_t *hash_table, int offset);
 void create_sparse_trans_mna(mna_system_t *mna, index_t *index, hash_table_t *hash_table, options_t *options, int offset, double tr_step);
-void solve_mna_system(mna_system_t *mna, double **x, gsl_vector_complex *x_complex, options_t *options);
+void solve_mna_system(mna_system_t *mna, double **x, cs_complex_t *x_complex, options_t *options);
+void solve_mna_system_block(mna_system_t *mna, double *B, double *X, int k, options_t *options);
+bool solve_mna_system_probed(mna_system_t *mna, double *b, double *x, options_t *options);
 void solve_lu(double **A, double *b, gsl_vector_view x, gsl_permutation *P, int dimension, bool is_decomp);
-void solve_complex_lu(gsl_matrix_complex *A, gsl_vector_complex *b, gsl_vector_complex *x, gsl_permutation *P, int dimension);
-void solve_sparse_lu(mna_system_t *mna, cs *A, double **x);
+void solve_complex_lu(gsl_matrix_complex *A, cs_complex_t *b, cs_complex_t *x, gsl_permutation *P, int dimension);
+void solve_sparse_lu(mna_system_t *mna, cs *A, double **x, options_t *options);
+void solve_sparse_ldl(mna_system_t *mna, cs *A, double **x, options_t *options);
+void solve_sparse_lu_block(mna_system_t *mna, double *B, double *X, int k, options_t *options);
+void solve_lu_block(double **A, gsl_permutation *P, double *B, double *X, int dimension, int k);
 void solve_complex_sparse_lu(mna_system_t *mna, cs_complex_t *x);
 void solve_cholesky(double **A, double *b, gsl_vector_view x, int dimension, bool is_decomp);
-void solve_complex_cholesky(gsl_matrix_complex *A, gsl_vector_complex *b, gsl_vector_complex *x, int dimension);
-void solve_sparse_cholesky(mna_system_t *mna, cs *A, double **x);
-void solve_complex_sparse_cholesky(mna_system_t *mna, cs_complex_t *x);
+void solve_complex_cholesky(gsl_matrix_complex *A, cs_complex_t *b, cs_complex_t *x, int dimension);
+void solve_sparse_cholesky(mna_system_t *mna, cs *A, double **x, options_t *options);
+void solve_sparse_cholesky_block(mna_system_t *mna, double *B, double *X, int k, options_t *options);
+void solve_sparse_dd(mna_system_t *mna, cs *A, double **x, options_t *options);
+void solve_cholesky_block(double **A, double *B, double *X, int dimension, int k);
+void solve_complex_sparse_ldl(mna_system_t *mna, cs_complex_t *x, options_t *options);
 double get_response_value(list1_t *curr);
 void clear_response(resp_t *resp, int dimension);
 int g2_elem_indx(g2_indx_t *g2_indx, int num_nodes, int num_g2_elem, char *element);void free_index(index_t **index);
@@ -138,9 +207,12 @@ void print_mna_system(mna_system_t *mna, options_t *options);
 void print_array(double **A, int dimension);
 void print_complex_array(gsl_matrix_complex*A, int dimension);
 void print_vector(double *b, int dimension);
-void print_complex_vector(gsl_vector_complex *b, int dimension);
+void print_complex_vector(cs_complex_t *b, int dimension);
 void print_permutation(gsl_permutation *P);
 cs_di *_cs_di_copy (cs_di *A);
+void print_factor_info(sp_matrix_t *sp_matrix, options_t *options, char *msg);
+void print_ac_factor_info(sp_matrix_t *sp_matrix, options_t *options);
+void free_sparse_factors(sp_matrix_t *sp_matrix);
 void free_mna_system(mna_system_t **mna, options_t *options);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,512 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "ordering.h"
+
+/* Workspace shared by the recursive steps of the nested dissection */
+typedef struct nd_work {
+	/* Tag of the subgraph that each node currently belongs to, -1 for separator nodes */
+	int *where;
+	int *level;
+	int *queue;
+	int *loc;
+	int next_tag;
+} nd_work_t;
+
+static void nd_dissect(cs *C, int *nodes, int cnt, int tag, nd_work_t *w);
+
+/* Returns the pattern of A+A' which is the graph that all the symmetric orderings work on */
+static cs *sym_pattern(cs *A) {
+	cs *AT = cs_transpose(A, 0);
+	assert(AT != NULL);
+	/* AT has no values, so the result holds only the pattern */
+	cs *C = cs_add(A, AT, 0, 0);
+	assert(C != NULL);
+	cs_spfree(AT);
+	return C;
+}
+
+/*
+ * Does the symbolic analysis of A for an LU or a Cholesky factorization with the requested
+ * fill-reducing ordering. In case of ORDER=AUTO every ordering is evaluated and the one with
+ * the least predicted flops is used. The selected ordering is kept in the supplied info struct.
+ */
+css *order_symbolic(cs *A, order_t order, bool lu, order_info_t *info) {
+	const order_t candidates[NUM_ORDERS] = {ORD_AMD, ORD_ND, ORD_RCM, ORD_NATURAL};
+	order_stats_t stats;
+	int *P = NULL, *P_cand;
+	int n = A->n;
+
+	info->lu = lu;
+	info->num_candidates = 0;
+	info->actual_nnz = 0.0;
+
+	if (order == ORD_AUTO) {
+		for (int k = 0; k < NUM_ORDERS; k++) {
+			/* AMD for LU works on A'A, here it's built on A+A' like the rest to be scored the same */
+			P_cand = fill_order(A, candidates[k], false);
+			predict_fill(A, P_cand, lu, &stats);
+			stats.order = candidates[k];
+			info->candidates[info->num_candidates++] = stats;
+			/* Keep the cheapest one, flops first and then the fill */
+			if (k == 0 || stats.flops < info->chosen.flops ||
+			    (stats.flops == info->chosen.flops && stats.nnz < info->chosen.nnz)) {
+				cs_free(P);
+				P = P_cand;
+				info->chosen = stats;
+			}
+			else {
+				cs_free(P_cand);
+			}
+		}
+	}
+	else {
+		P = fill_order(A, order, lu);
+		predict_fill(A, P, lu, &info->chosen);
+		info->chosen.order = order;
+	}
+
+	css *S;
+	if (lu) {
+		/* Natural ordering for the symbolic part, then use our own column permutation */
+		S = cs_sqr(0, A, 0);
+		assert(S != NULL);
+		S->q = P;
+	}
+	else {
+		/* Same as cs_schol, but with the permutation P instead of the built-in AMD */
+		S = cs_calloc(1, sizeof(css));
+		assert(S != NULL);
+		/* The natural ordering gets the identity, the callers index S->pinv */
+		if (P == NULL) {
+			P = cs_malloc(n, sizeof(int));
+			assert(P != NULL);
+			for (int k = 0; k < n; k++) P[k] = k;
+		}
+		S->pinv = cs_pinv(P, n);
+		cs_free(P);
+		cs *C = cs_symperm(A, S->pinv, 0);
+		S->parent = cs_etree(C, 0);
+		int *post = cs_post(S->parent, n);
+		int *c = cs_counts(C, S->parent, post, 0);
+		cs_free(post);
+		cs_spfree(C);
+		S->cp = cs_malloc(n + 1, sizeof(int));
+		S->unz = S->lnz = cs_cumsum(S->cp, c, n);
+		cs_free(c);
+		if (S->lnz < 0) {
+			S = cs_sfree(S);
+		}
+	}
+	return S;
+}
+
+/* Returns the fill-reducing permutation of the requested ordering, NULL is the natural ordering */
+int *fill_order(cs *A, order_t order, bool lu) {
+	switch (order) {
+		case ORD_AMD:
+			/* Exactly what cs_sqr(2, ...) and cs_schol(1, ...) use */
+			return cs_amd(lu ? 2 : 1, A);
+		case ORD_ND:
+			return nd_order(A);
+		case ORD_RCM:
+			return rcm_order(A);
+		case ORD_NATURAL:
+			return NULL;
+		default:
+			fprintf(stderr, "Error: Wrong fill-reducing ordering.\n");
+			exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Predicts nnz(L) and the flops of the Cholesky factorization of P(A+A')P' from its column counts.
+ * For LU this is an estimate, because partial pivoting might deviate from the diagonal, and it only
+ * fits orderings that were built on A+A' too.
+ */
+void predict_fill(cs *A, int *P, bool lu, order_stats_t *stats) {
+	int n = A->n;
+	double lnz = 0.0, flops = 0.0;
+
+	cs *C    = sym_pattern(A);
+	int *pinv = cs_pinv(P, n);
+	cs *PC   = cs_symperm(C, pinv, 0);
+	int *parent = cs_etree(PC, 0);
+	int *post   = cs_post(parent, n);
+	int *c      = cs_counts(PC, parent, post, 0);
+
+	for (int j = 0; j < n; j++) {
+		lnz   += c[j];
+		flops += (double)c[j] * c[j];
+	}
+	/* U has the same pattern as L' if no pivoting happens, they share the diagonal and cost twice as much */
+	stats->nnz   = lu ? 2 * lnz - n : lnz;
+	stats->flops = lu ? 2 * flops : flops;
+
+	cs_free(c);
+	cs_free(post);
+	cs_free(parent);
+	cs_free(pinv);
+	cs_spfree(PC);
+	cs_spfree(C);
+}
+
+/* Keeps the actual fill of the numeric factorization to compare it with the prediction */
+void set_actual_fill(order_info_t *info, csn *N, bool lu) {
+	info->actual_nnz = N->L->p[N->L->n];
+	if (lu) {
+		/* The unit diagonal of L isn't counted, like in the prediction */
+		info->actual_nnz += N->U->p[N->U->n] - N->U->n;
+	}
+}
+
+/* BFS inside the subgraph with the given tag, returns how many nodes were visited and their levels */
+static int nd_bfs(cs *C, int root, int tag, nd_work_t *w, int *height) {
+	int head = 0, tail = 0;
+	w->queue[tail++] = root;
+	w->level[root] = 0;
+	while (head < tail) {
+		int v = w->queue[head++];
+		for (int p = C->p[v]; p < C->p[v+1]; p++) {
+			int u = C->i[p];
+			if (w->where[u] != tag || w->level[u] >= 0) {
+				continue;
+			}
+			w->level[u] = w->level[v] + 1;
+			w->queue[tail++] = u;
+		}
+	}
+	*height = w->level[w->queue[tail-1]];
+	return tail;
+}
+
+/* Orders a small subgraph with AMD on the graph induced by its nodes */
+static void nd_leaf(cs *C, int *nodes, int cnt, int tag, nd_work_t *w) {
+	int nz = 0;
+	if (cnt <= 2) {
+		return;
+	}
+	for (int k = 0; k < cnt; k++) {
+		w->loc[nodes[k]] = k;
+		for (int p = C->p[nodes[k]]; p < C->p[nodes[k]+1]; p++) {
+			if (w->where[C->i[p]] == tag) nz++;
+		}
+	}
+	/* Pattern only matrix of the subgraph with local indexing */
+	cs *S = cs_spalloc(cnt, cnt, nz, 0, 0);
+	assert(S != NULL);
+	nz = 0;
+	for (int k = 0; k < cnt; k++) {
+		S->p[k] = nz;
+		for (int p = C->p[nodes[k]]; p < C->p[nodes[k]+1]; p++) {
+			if (w->where[C->i[p]] == tag) {
+				S->i[nz++] = w->loc[C->i[p]];
+			}
+		}
+	}
+	S->p[cnt] = nz;
+
+	int *P = cs_amd(1, S);
+	assert(P != NULL);
+	for (int k = 0; k < cnt; k++) {
+		w->queue[k] = nodes[P[k]];
+	}
+	for (int k = 0; k < cnt; k++) {
+		nodes[k] = w->queue[k];
+	}
+	cs_free(P);
+	cs_spfree(S);
+}
+
+/* Splits the subgraph into its connected components and dissects each one of them */
+static bool nd_components(cs *C, int *nodes, int cnt, int tag, nd_work_t *w) {
+	int height, first_tag = w->next_tag;
+
+	/* Quick check, in most cases the subgraph is connected */
+	if (nd_bfs(C, nodes[0], tag, w, &height) == cnt) {
+		return false;
+	}
+	for (int k = 0; k < cnt; k++) {
+		w->level[nodes[k]] = -1;
+	}
+	/* Give a new tag to every component */
+	for (int k = 0; k < cnt; k++) {
+		if (w->where[nodes[k]] != tag) {
+			continue;
+		}
+		int visited = nd_bfs(C, nodes[k], tag, w, &height);
+		int new_tag = w->next_tag++;
+		for (int i = 0; i < visited; i++) {
+			w->where[w->queue[i]] = new_tag;
+		}
+	}
+	/* Counting sort of the nodes by their component, loc holds the counts */
+	int num_comps = w->next_tag - first_tag;
+	int *start = (int *)calloc(num_comps + 1, sizeof(int));
+	assert(start != NULL);
+	for (int k = 0; k < cnt; k++) {
+		start[w->where[nodes[k]] - first_tag + 1]++;
+	}
+	for (int c = 0; c < num_comps; c++) {
+		start[c+1] += start[c];
+	}
+	for (int c = 0; c <= num_comps; c++) {
+		w->loc[c] = start[c];
+	}
+	for (int k = 0; k < cnt; k++) {
+		w->queue[w->loc[w->where[nodes[k]] - first_tag]++] = nodes[k];
+	}
+	for (int k = 0; k < cnt; k++) {
+		nodes[k] = w->queue[k];
+	}
+	for (int c = 0; c < num_comps; c++) {
+		nd_dissect(C, nodes + start[c], start[c+1] - start[c], first_tag + c, w);
+	}
+	free(start);
+	return true;
+}
+
+/*
+ * Recursive step of the nested dissection. The nodes of the subgraph are reordered in place as
+ * [first part | second part | separator], so the separator is eliminated last.
+ */
+static void nd_dissect(cs *C, int *nodes, int cnt, int tag, nd_work_t *w) {
+	int height, best_height, root, best_root, visited;
+
+	if (cnt <= ND_LEAF_SIZE) {
+		nd_leaf(C, nodes, cnt, tag, w);
+		return;
+	}
+	for (int k = 0; k < cnt; k++) {
+		w->level[nodes[k]] = -1;
+	}
+	if (nd_components(C, nodes, cnt, tag, w)) {
+		return;
+	}
+
+	/* Find a pseudo-peripheral node, so that the level structure is long and narrow */
+	root = best_root = nodes[0];
+	best_height = -1;
+	for (int sweep = 0; sweep < ND_BFS_SWEEPS; sweep++) {
+		for (int k = 0; k < cnt; k++) {
+			w->level[nodes[k]] = -1;
+		}
+		visited = nd_bfs(C, root, tag, w, &height);
+		if (height <= best_height) {
+			break;
+		}
+		best_height = height;
+		best_root   = root;
+		/* Next root is the node of the last level with the minimum degree */
+		int min_deg = -1;
+		for (int i = visited - 1; i >= 0 && w->level[w->queue[i]] == height; i--) {
+			int v = w->queue[i];
+			int deg = C->p[v+1] - C->p[v];
+			if (min_deg < 0 || deg < min_deg) {
+				min_deg = deg;
+				root = v;
+			}
+		}
+	}
+	/* The last BFS might have been worse, redo the best one */
+	if (height < best_height) {
+		for (int k = 0; k < cnt; k++) {
+			w->level[nodes[k]] = -1;
+		}
+		visited = nd_bfs(C, best_root, tag, w, &height);
+	}
+	/* Cannot split a graph with less than 3 levels */
+	if (height < 2) {
+		nd_leaf(C, nodes, cnt, tag, w);
+		return;
+	}
+
+	/* The separator is the level that splits the nodes in half */
+	int sep_level = 0, sum = 0;
+	for (int i = 0; i < visited; i++) {
+		sum++;
+		if (sum >= cnt / 2) {
+			sep_level = w->level[w->queue[i]];
+			break;
+		}
+	}
+	sep_level = MIN(MAX(sep_level, 1), height - 1);
+
+	int tag1 = w->next_tag++;
+	int tag2 = w->next_tag++;
+	for (int k = 0; k < cnt; k++) {
+		int v = nodes[k];
+		if (w->level[v] < sep_level) {
+			w->where[v] = tag1;
+		}
+		else if (w->level[v] > sep_level) {
+			w->where[v] = tag2;
+		}
+		else {
+			w->where[v] = -1;
+		}
+	}
+	/* Move to the parts the separator nodes that are not adjacent to both of them */
+	for (int k = 0; k < cnt; k++) {
+		int v = nodes[k];
+		bool adj1 = false, adj2 = false;
+		if (w->where[v] != -1) {
+			continue;
+		}
+		for (int p = C->p[v]; p < C->p[v+1]; p++) {
+			adj1 |= (w->where[C->i[p]] == tag1);
+			adj2 |= (w->where[C->i[p]] == tag2);
+		}
+		if (!adj2) {
+			w->where[v] = tag1;
+		}
+		else if (!adj1) {
+			w->where[v] = tag2;
+		}
+	}
+
+	/* Reorder the nodes as [first part | second part | separator] */
+	int cnt1 = 0, cnt2 = 0, pos = 0;
+	for (int k = 0; k < cnt; k++) {
+		if (w->where[nodes[k]] == tag1) {
+			w->queue[pos++] = nodes[k];
+			cnt1++;
+		}
+	}
+	for (int k = 0; k < cnt; k++) {
+		if (w->where[nodes[k]] == tag2) {
+			w->queue[pos++] = nodes[k];
+			cnt2++;
+		}
+	}
+	for (int k = 0; k < cnt; k++) {
+		if (w->where[nodes[k]] == -1) {
+			w->queue[pos++] = nodes[k];
+		}
+	}
+	for (int k = 0; k < cnt; k++) {
+		nodes[k] = w->queue[k];
+	}
+
+	if (cnt1 > 0) {
+		nd_dissect(C, nodes, cnt1, tag1, w);
+	}
+	if (cnt2 > 0) {
+		nd_dissect(C, nodes + cnt1, cnt2, tag2, w);
+	}
+}
+
+/* Nested dissection ordering of the graph of A+A', level structure separators and AMD on the leaves */
+int *nd_order(cs *A) {
+	int n = A->n;
+	nd_work_t w;
+
+	cs *C = sym_pattern(A);
+	int *P = (int *)cs_malloc(n + 1, sizeof(int));
+	w.where = (int *)malloc(n * sizeof(int));
+	w.level = (int *)malloc(n * sizeof(int));
+	w.queue = (int *)malloc((n + 1) * sizeof(int));
+	w.loc   = (int *)malloc((n + 1) * sizeof(int));
+	assert(P != NULL && w.where != NULL && w.level != NULL && w.queue != NULL && w.loc != NULL);
+	w.next_tag = 1;
+
+	for (int i = 0; i < n; i++) {
+		P[i] = i;
+		w.where[i] = 0;
+	}
+	if (n > 0) {
+		nd_dissect(C, P, n, 0, &w);
+	}
+
+	free(w.where);
+	free(w.level);
+	free(w.queue);
+	free(w.loc);
+	cs_spfree(C);
+	return P;
+}
+
+/* Reverse Cuthill-McKee ordering of the graph of A+A', every component starts from a minimum degree node */
+int *rcm_order(cs *A) {
+	int n = A->n, k = 0, head = 0;
+
+	cs *C = sym_pattern(A);
+	int *P       = (int *)cs_malloc(n + 1, sizeof(int));
+	int *deg     = (int *)malloc(n * sizeof(int));
+	int *by_deg  = (int *)malloc(n * sizeof(int));
+	int *cnt     = (int *)calloc(n + 1, sizeof(int));
+	bool *marked = (bool *)calloc(n, sizeof(bool));
+	assert(P != NULL && deg != NULL && by_deg != NULL && cnt != NULL && marked != NULL);
+
+	/* Degrees without the diagonal and the nodes sorted by degree with a counting sort */
+	for (int i = 0; i < n; i++) {
+		deg[i] = 0;
+		for (int p = C->p[i]; p < C->p[i+1]; p++) {
+			if (C->i[p] != i) deg[i]++;
+		}
+		cnt[deg[i]]++;
+	}
+	for (int d = 0, sum = 0; d <= n; d++) {
+		int tmp = cnt[d];
+		cnt[d] = sum;
+		sum += tmp;
+	}
+	for (int i = 0; i < n; i++) {
+		by_deg[cnt[deg[i]]++] = i;
+	}
+
+	for (int s = 0; s < n; s++) {
+		int start = by_deg[s];
+		if (marked[start]) {
+			continue;
+		}
+		/* Cuthill-McKee BFS of this component */
+		P[k++] = start;
+		marked[start] = true;
+		while (head < k) {
+			int v = P[head++];
+			int first = k;
+			for (int p = C->p[v]; p < C->p[v+1]; p++) {
+				int u = C->i[p];
+				if (!marked[u]) {
+					marked[u] = true;
+					P[k++] = u;
+				}
+			}
+			/* Visit the neighbours in increasing degree */
+			for (int i = first + 1; i < k; i++) {
+				int u = P[i], j = i - 1;
+				while (j >= first && deg[P[j]] > deg[u]) {
+					P[j+1] = P[j];
+					j--;
+				}
+				P[j+1] = u;
+			}
+		}
+	}
+	/* Reverse it */
+	for (int i = 0; i < n / 2; i++) {
+		int tmp = P[i];
+		P[i] = P[n-1-i];
+		P[n-1-i] = tmp;
+	}
+
+	free(deg);
+	free(by_deg);
+	free(cnt);
+	free(marked);
+	cs_spfree(C);
+	return P;
+}
+
+/* Prints the selected ordering with its predicted fill and flops, and the candidates in case of ORDER=AUTO */
+void print_order_info(order_info_t *info, char *msg) {
+	const char *factor = info->lu ? "L+U" : "L";
+	printf("%s ordering: %s, predicted nnz(%s) = %.0lf, flops = %.3e, actual nnz(%s) = %.0lf\n", msg,
+	       order_name(info->chosen.order), factor, info->chosen.nnz, info->chosen.flops, factor, info->actual_nnz);
+	for (int k = 0; k < info->num_candidates; k++) {
+		printf("    %-8s predicted nnz(%s) = %.0lf, flops = %.3e\n", order_name(info->candidates[k].order),
+		       factor, info->candidates[k].nnz, info->candidates[k].flops);
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef ORDERING_H
+#define ORDERING_H
+
+#include <stdbool.h>
+
+#include "parser.h"
+#include "routines.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Subgraphs with less nodes than this are not bisected any further, they are ordered with AMD */
+#define ND_LEAF_SIZE	64
+/* How many BFS sweeps we do at most in order to find a pseudo-peripheral node */
+#define ND_BFS_SWEEPS	5
+/* Number of the orderings that are evaluated when ORDER=AUTO */
+#define NUM_ORDERS		4
+
+/* Predicted cost of the factorization for a given fill-reducing ordering */
+typedef struct order_stats {
+	order_t order;
+	double nnz;
+	double flops;
+} order_stats_t;
+
+/* Holds the info of the ordering that was selected for a factorization */
+typedef struct order_info {
+	/* The selected ordering and its prediction */
+	order_stats_t chosen;
+	/* All the orderings that were evaluated, only in case of ORDER=AUTO */
+	order_stats_t candidates[NUM_ORDERS];
+	int num_candidates;
+	/* LU or Cholesky factorization */
+	bool lu;
+	/* Actual nnz(L+U) after the numeric factorization */
+	double actual_nnz;
+} order_info_t;
+
+css *order_symbolic(cs *A, order_t order, bool lu, order_info_t *info);
+int *fill_order(cs *A, order_t order, bool lu);
+int *nd_order(cs *A);
+int *rcm_order(cs *A);
+void predict_fill(cs *A, int *P, bool lu, order_stats_t *stats);
+void set_actual_fill(order_info_t *info, csn *N, bool lu);
+void print_order_info(order_info_t *info, char *msg);
+
+#endif
@@ -23,6 +23,29 @@ parser_t *init_parser() {
     parser->options->TRAN   = false;
     parser->options->AC     = false;
     parser->options->ITOL   = DEFAULT_ITOL;
+    parser->options->ORDER  = ORD_AUTO;
+    parser->options->BTF    = false;
+    parser->options->MIXED  = false;
+    parser->options->LDL    = false;
+    parser->options->DEFLATE = DEFAULT_DEFLATE;
+    parser->options->PRECOND = PRE_JACOBI;
+    parser->options->DROPTOL = DEFAULT_DROPTOL;
+    parser->options->OMEGA   = DEFAULT_OMEGA;
+    parser->options->DEGREE  = DEFAULT_DEGREE;
+    parser->options->SMOOTHER = SMO_JACOBI;
+    parser->options->SOLVER  = SOL_BICG;
+    parser->options->RESTART = DEFAULT_RESTART;
+    parser->options->PIPECG  = false;
+    parser->options->ASYNC   = false;
+    parser->options->BLOCKS  = 0;
+    parser->options->DD      = false;
+    parser->options->DOMAINS = 0;
+    parser->options->BENCH   = false;
+    parser->options->TRACE   = -1;
+    parser->options->RANDWALK   = false;
+    parser->options->RWTOL      = DEFAULT_RWTOL;
+    parser->options->CONFIDENCE = DEFAULT_CONFIDENCE;
+    parser->options->SELINV     = SELINV_NONE;
 
     /* Initializes the netlist struct that holds info about the elements */
     parser->netlist = (netlist_t *)malloc(sizeof(netlist_t));
@@ -131,7 +154,7 @@ void parse_netlist(parser_t *parser, char *file_name, index_t *index, hash_table
     FILE *file_input;
     ssize_t read;
     size_t len = 0;
-    int num_tokens = 0, dc_counter = 0, tr_counter = 0, ac_counter = 0;
+    int num_tokens = 0, dc_counter = 0, tr_counter = 0, ac_counter = 0, sweep_counter = 0;
     bool tran = false, ac = false;
     char **tokens = NULL, *line = NULL;
 
@@ -162,6 +185,101 @@ void parse_netlist(parser_t *parser, char *file_name, index_t *index, hash_table
                     if (strncasecmp("ITOL", &tokens[i][0], 4) == 0) {
                         sscanf((&tokens[i][0]) + 5, "%lf", &parser->options->ITOL);
                     }
+                    if (strcasecmp("BTF", &tokens[i][0]) == 0) {
+                        parser->options->BTF = true;
+                    }
+                    if (strcasecmp("MIXED", &tokens[i][0]) == 0) {
+                        parser->options->MIXED = true;
+                    }
+                    if (strcasecmp("LDL", &tokens[i][0]) == 0) {
+                        parser->options->LDL = true;
+                    }
+                    if (strcasecmp("BENCH", &tokens[i][0]) == 0) {
+                        parser->options->BENCH = true;
+                    }
+                    if (strcasecmp("PIPECG", &tokens[i][0]) == 0) {
+                        parser->options->PIPECG = true;
+                    }
+                    if (strcasecmp("ASYNC", &tokens[i][0]) == 0) {
+                        parser->options->ASYNC = true;
+                    }
+                    if (strncasecmp("BLOCKS=", &tokens[i][0], 7) == 0) {
+                        sscanf((&tokens[i][0]) + 7, "%d", &parser->options->BLOCKS);
+                        if (parser->options->BLOCKS < 0) {
+                            parser->options->BLOCKS = 0;
+                        }
+                    }
+                    if (strcasecmp("DD", &tokens[i][0]) == 0) {
+                        parser->options->DD = true;
+                    }
+                    if (strncasecmp("DOMAINS=", &tokens[i][0], 8) == 0) {
+                        sscanf((&tokens[i][0]) + 8, "%d", &parser->options->DOMAINS);
+                        if (parser->options->DOMAINS < 0) {
+                            parser->options->DOMAINS = 0;
+                        }
+                    }
+                    if (strcasecmp("SELINV", &tokens[i][0]) == 0 || strcasecmp("SELINV=DIAG", &tokens[i][0]) == 0) {
+                        parser->options->SELINV = SELINV_DIAG;
+                    }
+                    if (strcasecmp("SELINV=PATTERN", &tokens[i][0]) == 0) {
+                        parser->options->SELINV = SELINV_PATTERN;
+                    }
+                    if (strcasecmp("RANDWALK", &tokens[i][0]) == 0) {
+                        parser->options->RANDWALK = true;
+                    }
+                    if (strncasecmp("RWTOL=", &tokens[i][0], 6) == 0) {
+                        sscanf((&tokens[i][0]) + 6, "%lf", &parser->options->RWTOL);
+                    }
+                    if (strncasecmp("CONFIDENCE=", &tokens[i][0], 11) == 0) {
+                        sscanf((&tokens[i][0]) + 11, "%lf", &parser->options->CONFIDENCE);
+                        if (parser->options->CONFIDENCE <= 0.0 || parser->options->CONFIDENCE >= 1.0) {
+                            fprintf(stderr, "Error: CONFIDENCE of the random walks must be in (0, 1).\n");
+                            exit(EXIT_FAILURE);
+                        }
+                    }
+                    if (strncasecmp("DEFLATE=", &tokens[i][0], 8) == 0) {
+                        sscanf((&tokens[i][0]) + 8, "%d", &parser->options->DEFLATE);
+                        if (parser->options->DEFLATE < 0) {
+                            parser->options->DEFLATE = 0;
+                        }
+                    }
+                    if (strncasecmp("ORDER=", &tokens[i][0], 6) == 0) {
+                        parser->options->ORDER = parse_order(&tokens[i][6]);
+                    }
+                    if (strncasecmp("PRECOND=", &tokens[i][0], 8) == 0) {
+                        parser->options->PRECOND = parse_precond(&tokens[i][8]);
+                    }
+                    if (strncasecmp("DROPTOL=", &tokens[i][0], 8) == 0) {
+                        sscanf((&tokens[i][0]) + 8, "%lf", &parser->options->DROPTOL);
+                    }
+                    if (strncasecmp("OMEGA=", &tokens[i][0], 6) == 0) {
+                        sscanf((&tokens[i][0]) + 6, "%lf", &parser->options->OMEGA);
+                        if (parser->options->OMEGA <= 0.0 || parser->options->OMEGA >= 2.0) {
+                            fprintf(stderr, "Error: OMEGA of SSOR must be in (0, 2).\n");
+                            exit(EXIT_FAILURE);
+                        }
+                    }
+                    if (strncasecmp("DEGREE=", &tokens[i][0], 7) == 0) {
+                        sscanf((&tokens[i][0]) + 7, "%d", &parser->options->DEGREE);
+                        if (parser->options->DEGREE < 1) {
+                            parser->options->DEGREE = 1;
+                        }
+                    }
+                    if (strncasecmp("SMOOTHER=", &tokens[i][0], 9) == 0) {
+                        parser->options->SMOOTHER = parse_smoother(&tokens[i][9]);
+                    }
+                    if (strncasecmp("SOLVER=", &tokens[i][0], 7) == 0) {
+                        parser->options->SOLVER = parse_solver(&tokens[i][7]);
+                    }
+                    if (strncasecmp("TRACE=", &tokens[i][0], 6) == 0) {
+                        sscanf((&tokens[i][0]) + 6, "%d", &parser->options->TRACE);
+                    }
+                    if (strncasecmp("RESTART=", &tokens[i][0], 8) == 0) {
+                        sscanf((&tokens[i][0]) + 8, "%d", &parser->options->RESTART);
+                        if (parser->options->RESTART < 1) {
+                            parser->options->RESTART = 1;
+                        }
+                    }
                     if (strcasecmp("METHOD=BE", &tokens[i][0]) == 0) {
                         parser->options->BE = true;
                     }
@@ -177,6 +295,7 @@ void parse_netlist(parser_t *parser, char *file_name, index_t *index, hash_table
                 sscanf(tokens[3], "%lf", &parser->dc_analysis[dc_counter].start);
                 sscanf(tokens[4], "%lf", &parser->dc_analysis[dc_counter].end);
                 sscanf(tokens[5], "%lf", &parser->dc_analysis[dc_counter].increment);
+                sweep_counter++;
             }
             else if (strcasecmp(".TRAN", &tokens[1][0]) == 0) {
                 sscanf(tokens[2], "%lf", &parser->tr_analysis[tr_counter].time_step);
@@ -278,6 +397,12 @@ void parse_netlist(parser_t *parser, char *file_name, index_t *index, hash_table
     parser->netlist->ac_counter = ac_counter;
     parser->netlist->num_nodes  = hash_table->seq - 1;
 
+    /* The random walks only estimate the operating point of the .PLOT nodes, the MNA system is never built */
+    if (parser->options->RANDWALK && (sweep_counter || tr_counter || ac_counter || parser->options->SELINV != SELINV_NONE)) {
+        fprintf(stderr, "Error: RANDWALK can't run .DC, .TRAN, .AC or SELINV, give the nodes with a .PLOT alone.\n");
+        exit(EXIT_FAILURE);
+    }
+
     /* Set the appropriate flags according to the counters */
     if (parser->netlist->tr_counter) {
         parser->options->TRAN = true;
@@ -304,6 +429,148 @@ void parse_netlist(parser_t *parser, char *file_name, index_t *index, hash_table
     print_ac_analysis_options(parser->ac_analysis, ac_counter);
 }
 
+/* Returns the fill-reducing ordering that corresponds to the supplied name */
+order_t parse_order(char *name) {
+    if (strcasecmp("AUTO", name) == 0) {
+        return ORD_AUTO;
+    }
+    else if (strcasecmp("AMD", name) == 0) {
+        return ORD_AMD;
+    }
+    else if (strcasecmp("ND", name) == 0) {
+        return ORD_ND;
+    }
+    else if (strcasecmp("RCM", name) == 0) {
+        return ORD_RCM;
+    }
+    else if (strcasecmp("NATURAL", name) == 0) {
+        return ORD_NATURAL;
+    }
+    fprintf(stderr, "Error: Unknown ordering %s, use one of AUTO, AMD, ND, RCM, NATURAL.\n", name);
+    exit(EXIT_FAILURE);
+}
+
+/* Returns the name of the ordering */
+const char *order_name(order_t order) {
+    switch (order) {
+        case ORD_AUTO:
+            return "AUTO";
+        case ORD_AMD:
+            return "AMD";
+        case ORD_ND:
+            return "ND";
+        case ORD_RCM:
+            return "RCM";
+        case ORD_NATURAL:
+            return "NATURAL";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/* Returns the preconditioner of the iterative solvers that corresponds to the supplied name */
+precond_type_t parse_precond(char *name) {
+    if (strcasecmp("JACOBI", name) == 0) {
+        return PRE_JACOBI;
+    }
+    else if (strcasecmp("ILU0", name) == 0) {
+        return PRE_ILU0;
+    }
+    else if (strcasecmp("ILUT", name) == 0) {
+        return PRE_ILUT;
+    }
+    else if (strcasecmp("IC0", name) == 0) {
+        return PRE_IC0;
+    }
+    else if (strcasecmp("AMG", name) == 0) {
+        return PRE_AMG;
+    }
+    else if (strcasecmp("SSOR", name) == 0) {
+        return PRE_SSOR;
+    }
+    else if (strcasecmp("CHEBY", name) == 0) {
+        return PRE_CHEBY;
+    }
+    fprintf(stderr, "Error: Unknown preconditioner %s, use one of JACOBI, ILU0, ILUT, IC0, AMG, SSOR, CHEBY.\n",
+            name);
+    exit(EXIT_FAILURE);
+}
+
+/* Returns the name of the preconditioner */
+const char *precond_name(precond_type_t type) {
+    switch (type) {
+        case PRE_JACOBI:
+            return "JACOBI";
+        case PRE_ILU0:
+            return "ILU0";
+        case PRE_ILUT:
+            return "ILUT";
+        case PRE_IC0:
+            return "IC0";
+        case PRE_AMG:
+            return "AMG";
+        case PRE_SSOR:
+            return "SSOR";
+        case PRE_CHEBY:
+            return "CHEBY";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/* Returns the smoother of AMG that corresponds to the supplied name */
+smoother_t parse_smoother(char *name) {
+    if (strcasecmp("JACOBI", name) == 0) {
+        return SMO_JACOBI;
+    }
+    else if (strcasecmp("CHEBY", name) == 0) {
+        return SMO_CHEBY;
+    }
+    fprintf(stderr, "Error: Unknown smoother %s, use one of JACOBI, CHEBY.\n", name);
+    exit(EXIT_FAILURE);
+}
+
+/* Returns the name of the smoother */
+const char *smoother_name(smoother_t smoother) {
+    switch (smoother) {
+        case SMO_JACOBI:
+            return "JACOBI";
+        case SMO_CHEBY:
+            return "CHEBY";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/* Returns the iterative solver of the non-SPD systems that corresponds to the supplied name */
+iter_solver_t parse_solver(char *name) {
+    if (strcasecmp("BICG", name) == 0) {
+        return SOL_BICG;
+    }
+    else if (strcasecmp("BICGSTAB", name) == 0) {
+        return SOL_BICGSTAB;
+    }
+    else if (strcasecmp("GMRES", name) == 0) {
+        return SOL_GMRES;
+    }
+    fprintf(stderr, "Error: Unknown iterative solver %s, use one of BICG, BICGSTAB, GMRES.\n", name);
+    exit(EXIT_FAILURE);
+}
+
+/* Returns the name of the iterative solver */
+const char *solver_name(iter_solver_t solver) {
+    switch (solver) {
+        case SOL_BICG:
+            return "BICG";
+        case SOL_BICGSTAB:
+            return "BICGSTAB";
+        case SOL_GMRES:
+            return "GMRES";
+        default:
+            return "UNKNOWN";
+    }
+}
+
 /* Print all the specified options from the netlist */
 void print_options(options_t *options) {
     printf("\n--- Netlist Specified Options ---\n");
@@ -315,6 +582,29 @@ void print_options(options_t *options) {
     printf("BE:      %s\n", options->BE     ? "true" : "false");
     printf("AC:      %s\n", options->AC     ? "true" : "false");
     printf("ITOL:    %g\n", options->ITOL);
+    printf("ORDER:   %s\n", order_name(options->ORDER));
+    printf("BTF:     %s\n", options->BTF    ? "true" : "false");
+    printf("MIXED:   %s\n", options->MIXED  ? "true" : "false");
+    printf("LDL:     %s\n", options->LDL    ? "true" : "false");
+    printf("DEFLATE: %d\n", options->DEFLATE);
+    printf("PRECOND: %s\n", precond_name(options->PRECOND));
+    printf("DROPTOL: %g\n", options->DROPTOL);
+    printf("OMEGA:   %g\n", options->OMEGA);
+    printf("DEGREE:  %d\n", options->DEGREE);
+    printf("SMOOTHER: %s\n", smoother_name(options->SMOOTHER));
+    printf("SOLVER:  %s\n", solver_name(options->SOLVER));
+    printf("RESTART: %d\n", options->RESTART);
+    printf("PIPECG:  %s\n", options->PIPECG ? "true" : "false");
+    printf("ASYNC:   %s\n", options->ASYNC  ? "true" : "false");
+    printf("BLOCKS:  %d\n", options->BLOCKS);
+    printf("DD:      %s\n", options->DD     ? "true" : "false");
+    printf("DOMAINS: %d\n", options->DOMAINS);
+    printf("BENCH:   %s\n", options->BENCH  ? "true" : "false");
+    printf("TRACE:   %d\n", options->TRACE);
+    printf("RANDWALK: %s\n", options->RANDWALK ? "true" : "false");
+    printf("RWTOL:   %g\n", options->RWTOL);
+    printf("CONFIDENCE: %g\n", options->CONFIDENCE);
+    printf("SELINV:  %s\n", (options->SELINV == SELINV_NONE) ? "NONE" : (options->SELINV == SELINV_DIAG) ? "DIAG" : "PATTERN");
 }
 
 /* Print the number of the different netlist elements info */
@@ -7,10 +7,63 @@
 #include "hash_table.h"
 
 #define DEFAULT_ITOL    0.001
+/* Deflation vectors the iterative transient solves carry from step to step, off by default */
+#define DEFAULT_DEFLATE 0
+/* Relative drop tolerance of the ILUT preconditioner */
+#define DEFAULT_DROPTOL 1e-3
+/* Relaxation factor of the SSOR preconditioner, 1.0 is symmetric Gauss-Seidel */
+#define DEFAULT_OMEGA   1.0
+/* Steps of the Chebyshev polynomial of the CHEBY preconditioner and smoother */
+#define DEFAULT_DEGREE  3
+/* Half-width in volts of the confidence intervals of the random walks and their confidence level */
+#define DEFAULT_RWTOL      1e-3
+#define DEFAULT_CONFIDENCE 0.99
+/* Krylov vectors of GMRES before it restarts */
+#define DEFAULT_RESTART 30
 #define ANALYSIS_NUM 	5
 
 extern int errno;
 
+/* Fill-reducing orderings for the sparse direct solvers */
+typedef enum order {
+	ORD_AUTO,
+	ORD_AMD,
+	ORD_ND,
+	ORD_RCM,
+	ORD_NATURAL
+} order_t;
+
+/* Preconditioners of the iterative solvers */
+typedef enum precond_type {
+	PRE_JACOBI,
+	PRE_ILU0,
+	PRE_ILUT,
+	PRE_IC0,
+	PRE_AMG,
+	PRE_SSOR,
+	PRE_CHEBY
+} precond_type_t;
+
+/* Smoothers of the levels of AMG */
+typedef enum smoother {
+	SMO_JACOBI,
+	SMO_CHEBY
+} smoother_t;
+
+/* Selected inversion after the DC operating point, the effective resistances or also the inverse on the factor */
+typedef enum selinv {
+	SELINV_NONE,
+	SELINV_DIAG,
+	SELINV_PATTERN
+} selinv_t;
+
+/* Iterative solvers of the non-SPD systems, in the order they take over when one breaks down */
+typedef enum iter_solver {
+	SOL_BICG,
+	SOL_BICGSTAB,
+	SOL_GMRES
+} iter_solver_t;
+
 /* Struct to hold the different options for the analyses */
 typedef struct options {
 	bool SPD;
@@ -21,6 +74,37 @@ typedef struct options {
 	bool BE;
 	bool AC;
 	double ITOL;
+	order_t ORDER;
+	bool BTF;
+	bool MIXED;
+	bool LDL;
+	int DEFLATE;
+	precond_type_t PRECOND;
+	double DROPTOL;
+	/* Relaxation factor of SSOR, in (0, 2) */
+	double OMEGA;
+	/* Degree of the Chebyshev polynomials and the smoother of AMG */
+	int DEGREE;
+	smoother_t SMOOTHER;
+	iter_solver_t SOLVER;
+	int RESTART;
+	/* The SPD systems use the pipelined CG instead of the classic one */
+	bool PIPECG;
+	/* The SPD systems use the asynchronous block-Jacobi with BLOCKS blocks, 0 picks them by size */
+	bool ASYNC;
+	int BLOCKS;
+	/* The sparse SPD systems use the domain decomposition with DOMAINS domains, 0 picks them by size */
+	bool DD;
+	int DOMAINS;
+	/* Time the sparse matrix-vector products after the DC operating point */
+	bool BENCH;
+	/* Index of the iterative solve whose residual history is written, 0 is the DC operating point, -1 for none */
+	int TRACE;
+	/* Estimate the .PLOT nodes with random walks instead of solving the MNA system */
+	bool RANDWALK;
+	double RWTOL;
+	double CONFIDENCE;
+	selinv_t SELINV;
 } options_t;
 
 
@@ -91,6 +175,14 @@ parser_t *init_parser();
 int get_num_tokens(char *line);
 char **tokenizer(char *line);
 void parse_netlist(parser_t *parser, char *file_name, index_t *index, hash_table_t *hash_table);
+order_t parse_order(char *name);
+const char *order_name(order_t order);
+precond_type_t parse_precond(char *name);
+const char *precond_name(precond_type_t type);
+smoother_t parse_smoother(char *name);
+const char *smoother_name(smoother_t smoother);
+iter_solver_t parse_solver(char *name);
+const char *solver_name(iter_solver_t solver);
 void print_options(options_t *options);
 void print_netlist_info(netlist_t *netlist);
 void print_dc_sweep_analysis_options(dc_analysis_t *dc_analysis, int dc_counter);
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "partial.h"
+
+/* Allocates the partial solves of a system with dimension n, the complex vectors only for the AC analysis */
+partial_t *init_partial(int n, bool with_complex) {
+	partial_t *ps = (partial_t *)calloc(1, sizeof(partial_t));
+	assert(ps != NULL);
+	ps->n      = n;
+	ps->probes = (int *)malloc(n * sizeof(int));
+	ps->pos    = (int *)malloc(n * sizeof(int));
+	ps->rows   = (int *)malloc(n * sizeof(int));
+	ps->xl     = (int *)malloc(2 * n * sizeof(int));
+	ps->xu     = (int *)malloc(2 * n * sizeof(int));
+	ps->vals   = (double *)malloc(n * sizeof(double));
+	ps->z      = (double *)calloc(n, sizeof(double));
+	assert(ps->probes != NULL && ps->pos != NULL && ps->rows != NULL && ps->xl != NULL && ps->xu != NULL);
+	assert(ps->vals != NULL && ps->z != NULL);
+	if (with_complex) {
+		ps->complex_vals = (cs_complex_t *)malloc(n * sizeof(cs_complex_t));
+		ps->complex_z    = (cs_complex_t *)calloc(n, sizeof(cs_complex_t));
+		assert(ps->complex_vals != NULL && ps->complex_z != NULL);
+	}
+	return ps;
+}
+
+/* Sets the probed unknowns to the nodes of a .PLOT card, the ground isn't an unknown. No nodes clears them */
+void set_partial_probes(partial_t *ps, hash_table_t *hash_table, char **nodes, int num_nodes) {
+	ps->num_probes = 0;
+	for (int j = 0; j < num_nodes; j++) {
+		int id = ht_get_id(hash_table, nodes[j]);
+		if (id > 0) {
+			ps->probes[ps->num_probes++] = id - 1;
+		}
+	}
+}
+
+/* True if the probed unknowns are few enough for the partial back substitution */
+bool partial_pays(partial_t *ps) {
+	return ps->num_probes > 0 && ps->num_probes * PARTIAL_RATIO <= ps->n;
+}
+
+/* Positions of the probed unknowns in the order of the factors, qinv is the inverse column permutation */
+static void partial_positions(partial_t *ps, const int *qinv) {
+	for (int j = 0; j < ps->num_probes; j++) {
+		ps->pos[j] = qinv != NULL ? qinv[ps->probes[j]] : ps->probes[j];
+	}
+}
+
+/*
+ * Gathers the nonzeros of the permuted right-hand side P*b into rows/vals, stops as soon as there are
+ * too many of them for the reach to pay. Returns their number, or -1 if it stopped.
+ */
+static int sparse_rhs(partial_t *ps, const int *pinv, const double *b) {
+	int nz = 0, max_nz = ps->n / PARTIAL_RATIO;
+	for (int i = 0; i < ps->n; i++) {
+		if (b[i] != 0.0) {
+			if (nz == max_nz) return -1;
+			ps->rows[nz]   = pinv != NULL ? pinv[i] : i;
+			ps->vals[nz++] = b[i];
+		}
+	}
+	return nz;
+}
+
+static int complex_sparse_rhs(partial_t *ps, const int *pinv, const cs_complex_t *b) {
+	int nz = 0, max_nz = ps->n / PARTIAL_RATIO;
+	for (int i = 0; i < ps->n; i++) {
+		if (b[i] != 0.0) {
+			if (nz == max_nz) return -1;
+			ps->rows[nz]           = pinv != NULL ? pinv[i] : i;
+			ps->complex_vals[nz++] = b[i];
+		}
+	}
+	return nz;
+}
+
+/*
+ * Solves Q*R'^-1*L^-1*P*b for the probed unknowns only and stores them to x. R is the matrix whose
+ * columns are the rows of the upper factor, U' of the LU or L of the Cholesky, with the diagonal first.
+ * The back substitution goes over the reach of the probes in the graph of R in reverse topological
+ * order, so every entry it needs is already computed. Returns the top of the reach in ps->xu.
+ */
+static int partial_back_solve(partial_t *ps, cs *R, double *z) {
+	int Bp[2] = {0, ps->num_probes};
+	cs B = {.nzmax = ps->num_probes, .m = ps->n, .n = 1, .p = Bp, .i = ps->pos, .x = NULL, .nz = -1};
+	int top = cs_reach(R, &B, 0, ps->xu, NULL);
+	int *Rp = R->p, *Ri = R->i;
+	double *Rx = R->x;
+
+	for (int p = ps->n - 1; p >= top; p--) {
+		int k = ps->xu[p];
+		double value = z[k];
+		for (int q = Rp[k] + 1; q < Rp[k + 1]; q++) {
+			value -= Rx[q] * z[Ri[q]];
+		}
+		z[k] = value / Rx[Rp[k]];
+	}
+	return top;
+}
+
+static int partial_complex_back_solve(partial_t *ps, cs_ci *R, cs_complex_t *z) {
+	int Bp[2] = {0, ps->num_probes};
+	cs_ci B = {.nzmax = ps->num_probes, .m = ps->n, .n = 1, .p = Bp, .i = ps->pos, .x = NULL, .nz = -1};
+	int top = cs_ci_reach(R, &B, 0, ps->xu, NULL);
+	int *Rp = R->p, *Ri = R->i;
+	cs_complex_t *Rx = R->x;
+
+	for (int p = ps->n - 1; p >= top; p--) {
+		int k = ps->xu[p];
+		cs_complex_t value = z[k];
+		for (int q = Rp[k] + 1; q < Rp[k + 1]; q++) {
+			value -= Rx[q] * z[Ri[q]];
+		}
+		z[k] = value / Rx[Rp[k]];
+	}
+	return top;
+}
+
+/*
+ * Solves the factorized system for b and stores the probed unknowns to x, x = Q*U^-1*L^-1*P*b for
+ * the LU and x = P'*L'^-1*L^-1*P*b for the Cholesky with U NULL. pinv is the row permutation, qinv
+ * the inverse column permutation (pinv again for the Cholesky), NULL for the identity. Ut is U' of
+ * the LU, only needed when partial_pays. Either solve falls back to the full one when its side isn't
+ * small enough, with both of them full x gets all the unknowns.
+ */
+void partial_solve(partial_t *ps, cs *L, cs *U, cs *Ut, const int *pinv, const int *qinv, const double *b, double *x) {
+	int n = ps->n, ltop = -1, utop = -1;
+	double *z = ps->z;
+
+	int nz = sparse_rhs(ps, pinv, b);
+	if (nz >= 0) {
+		int Bp[2] = {0, nz};
+		cs B = {.nzmax = nz, .m = n, .n = 1, .p = Bp, .i = ps->rows, .x = ps->vals, .nz = -1};
+		ltop = cs_spsolve(L, &B, 0, ps->xl, z, NULL, 1);
+		ps->sparse_rhs++;
+	}
+	else {
+		cs_ipvec(pinv, b, z, n);
+		cs_lsolve(L, z);
+	}
+
+	if (partial_pays(ps)) {
+		partial_positions(ps, qinv);
+		utop = partial_back_solve(ps, U != NULL ? Ut : L, z);
+		for (int j = 0; j < ps->num_probes; j++) {
+			x[ps->probes[j]] = z[ps->pos[j]];
+		}
+		ps->partial_out++;
+	}
+	else {
+		if (U != NULL) {
+			cs_usolve(U, z);
+		}
+		else {
+			cs_ltsolve(L, z);
+		}
+		for (int i = 0; i < n; i++) {
+			x[i] = z[qinv != NULL ? qinv[i] : i];
+		}
+	}
+	ps->solves++;
+
+	/* Back to zero for the next solve, only the reaches were touched if both solves took them */
+	if (ltop >= 0 && utop >= 0) {
+		for (int p = ltop; p < n; p++) z[ps->xl[p]] = 0.0;
+		for (int p = utop; p < n; p++) z[ps->xu[p]] = 0.0;
+	}
+	else {
+		memset(z, 0, n * sizeof(double));
+	}
+}
+
+/* The same for the complex LU of the AC analysis */
+void partial_complex_solve(partial_t *ps, cs_ci *L, cs_ci *U, cs_ci *Ut, const int *pinv, const int *qinv,
+						   const cs_complex_t *b, cs_complex_t *x) {
+	int n = ps->n, ltop = -1, utop = -1;
+	cs_complex_t *z = ps->complex_z;
+
+	int nz = complex_sparse_rhs(ps, pinv, b);
+	if (nz >= 0) {
+		int Bp[2] = {0, nz};
+		cs_ci B = {.nzmax = nz, .m = n, .n = 1, .p = Bp, .i = ps->rows, .x = ps->complex_vals, .nz = -1};
+		ltop = cs_ci_spsolve(L, &B, 0, ps->xl, z, NULL, 1);
+		ps->sparse_rhs++;
+	}
+	else {
+		cs_ci_ipvec(pinv, b, z, n);
+		cs_ci_lsolve(L, z);
+	}
+
+	if (partial_pays(ps)) {
+		partial_positions(ps, qinv);
+		utop = partial_complex_back_solve(ps, Ut, z);
+		for (int j = 0; j < ps->num_probes; j++) {
+			x[ps->probes[j]] = z[ps->pos[j]];
+		}
+		ps->partial_out++;
+	}
+	else {
+		cs_ci_usolve(U, z);
+		for (int i = 0; i < n; i++) {
+			x[i] = z[qinv != NULL ? qinv[i] : i];
+		}
+	}
+	ps->solves++;
+
+	if (ltop >= 0 && utop >= 0) {
+		for (int p = ltop; p < n; p++) z[ps->xl[p]] = 0.0;
+		for (int p = utop; p < n; p++) z[ps->xu[p]] = 0.0;
+	}
+	else {
+		memset(z, 0, n * sizeof(cs_complex_t));
+	}
+}
+
+/* Prints how many of the solves went along the reach of the right-hand side and computed only the probes */
+void print_partial_info(partial_t *ps, char *msg) {
+	if (ps == NULL || ps->solves == 0) return;
+	printf("%s partial solves: %ld of %ld along the reach of the right-hand side, %ld only for the probed nodes\n",
+		   msg, ps->sparse_rhs, ps->solves, ps->partial_out);
+	ps->solves = ps->sparse_rhs = ps->partial_out = 0;
+}
+
+void free_partial(partial_t *ps) {
+	if (ps == NULL) return;
+	free(ps->probes);
+	free(ps->pos);
+	free(ps->rows);
+	free(ps->xl);
+	free(ps->xu);
+	free(ps->vals);
+	free(ps->z);
+	free(ps->complex_vals);
+	free(ps->complex_z);
+	free(ps);
+}
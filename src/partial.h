@@ -0,0 +1,50 @@
+#ifndef PARTIAL_H
+#define PARTIAL_H
+
+#include <stdbool.h>
+
+#include "hash_table.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* A right-hand side or a set of probed unknowns below 1/PARTIAL_RATIO of the dimension takes the sparse path */
+#define PARTIAL_RATIO	16
+
+/*
+ * Solves on the LU or Cholesky factors that compute only the unknowns the analysis writes, the .PLOT
+ * nodes. A right-hand side with few nonzeros goes through the forward solve along its reach in the
+ * graph of L (cs_spsolve). With few probed unknowns the back substitution runs only over their reach
+ * in the graph of the rows of the upper factor, the rows of U are the columns of U' and the rows of
+ * L' the columns of L, every entry outside it is never computed. The rest of x is left as it was.
+ */
+typedef struct partial {
+	int n;
+	/* The probed unknowns and their positions in the order of the factors */
+	int num_probes;
+	int *probes;
+	int *pos;
+	/* Nonzero rows of the permuted right-hand side and their values, the single column of the reach */
+	int *rows;
+	double *vals;
+	cs_complex_t *complex_vals;
+	/* Reaches of the forward and the back substitution, cs_reach needs 2n entries for its stack */
+	int *xl;
+	int *xu;
+	/* Vector of the triangular solves, zero outside the reaches of the last solve */
+	double *z;
+	cs_complex_t *complex_z;
+	/* Solves, and those that went along the reach of the right-hand side or computed only the probes */
+	long solves;
+	long sparse_rhs;
+	long partial_out;
+} partial_t;
+
+partial_t *init_partial(int n, bool with_complex);
+void set_partial_probes(partial_t *ps, hash_table_t *hash_table, char **nodes, int num_nodes);
+bool partial_pays(partial_t *ps);
+void partial_solve(partial_t *ps, cs *L, cs *U, cs *Ut, const int *pinv, const int *qinv, const double *b, double *x);
+void partial_complex_solve(partial_t *ps, cs_ci *L, cs_ci *U, cs_ci *Ut, const int *pinv, const int *qinv,
+						   const cs_complex_t *b, cs_complex_t *x);
+void print_partial_info(partial_t *ps, char *msg);
+void free_partial(partial_t *ps);
+
+#endif
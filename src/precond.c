@@ -0,0 +1,968 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <assert.h>
+
+#include "precond.h"
+
+/*
+ * Allocates a preconditioner of the given type for systems of dimension n, the Jacobi diagonal starts as 1.0.
+ * For an SPD A the ILUT is applied as LL' too, CG needs a symmetric preconditioner.
+ */
+precond_t *init_precond(int n, precond_type_t type, bool SPD) {
+	precond_t *P = (precond_t *)calloc(1, sizeof(precond_t));
+	assert(P != NULL);
+	P->type = type;
+	P->n = n;
+	P->spd = SPD;
+	P->omega = DEFAULT_OMEGA;
+	P->degree = DEFAULT_DEGREE;
+	P->smoother = SMO_JACOBI;
+	P->M = init_val_vector(n, 1.0);
+	return P;
+}
+
+/* Allocates the workspaces of the incomplete factorizations, the marks start unset */
+static void init_factor_workspace(int n, void **w, size_t entry_size, int **mark, int **list) {
+	if (*w != NULL) return;
+	*w    = malloc(n * entry_size);
+	*mark = (int *)malloc(n * sizeof(int));
+	*list = (int *)malloc(n * sizeof(int));
+	assert(*w != NULL && *mark != NULL && *list != NULL);
+}
+
+/* Sorts the n row indices a in increasing order, the columns of the factors are short */
+static void sort_rows(int *a, int n) {
+	for (int i = 1; i < n; i++) {
+		int key = a[i], j = i - 1;
+		while (j >= 0 && a[j] > key) {
+			a[j + 1] = a[j];
+			j--;
+		}
+		a[j + 1] = key;
+	}
+}
+
+/*
+ * Splits the pattern of the n x n compressed-column matrix C into the patterns of the ILU(0) factors.
+ * Column i of L is the diagonal followed by the rows below it, column i of U the rows above it in
+ * increasing order (the order of the elimination) followed by the diagonal. The diagonal is always
+ * part of the pattern, even where C has none (group 2 elements).
+ */
+static void ilu0_pattern(int n, const int *Cp, const int *Ci, int *Lp, int *Li, int *Up, int *Ui) {
+	int nl = 0, nu = 0;
+	for (int i = 0; i < n; i++) {
+		Lp[i] = nl;
+		Up[i] = nu;
+		Li[nl++] = i;
+		for (int p = Cp[i]; p < Cp[i + 1]; p++) {
+			if (Ci[p] > i) {
+				Li[nl++] = Ci[p];
+			}
+			else if (Ci[p] < i) {
+				Ui[nu++] = Ci[p];
+			}
+		}
+		sort_rows(Ui + Up[i], nu - Up[i]);
+		Ui[nu++] = i;
+	}
+	Lp[n] = nl;
+	Up[n] = nu;
+}
+
+/* Number of entries of the ILU(0) factors of C, without and with the diagonal */
+static void ilu0_count(int n, const int *Cp, const int *Ci, int *nnz_L, int *nnz_U) {
+	*nnz_L = *nnz_U = n;
+	for (int i = 0; i < n; i++) {
+		for (int p = Cp[i]; p < Cp[i + 1]; p++) {
+			if (Ci[p] > i) (*nnz_L)++;
+			else if (Ci[p] < i) (*nnz_U)++;
+		}
+	}
+}
+
+/*
+ * ILU(0) numeric factorization of C on the pattern of L and U, column by column (IKJ variant on the
+ * transpose): column i is scattered to w and eliminated with the columns k < i of L, in increasing k,
+ * dropping every update outside the pattern. A zero pivot is replaced by 1.0 like in the Jacobi one.
+ */
+static void ilu0_numeric(precond_t *P, cs *C) {
+	cs *L = P->L, *U = P->U;
+	double *w = P->w;
+	int *mark = P->mark;
+	for (int i = 0; i < P->n; i++) {
+		mark[i] = -1;
+	}
+	for (int i = 0; i < P->n; i++) {
+		for (int p = U->p[i]; p < U->p[i + 1]; p++) {
+			w[U->i[p]] = 0.0;
+			mark[U->i[p]] = i;
+		}
+		for (int p = L->p[i]; p < L->p[i + 1]; p++) {
+			w[L->i[p]] = 0.0;
+			mark[L->i[p]] = i;
+		}
+		for (int p = C->p[i]; p < C->p[i + 1]; p++) {
+			w[C->i[p]] += C->x[p];
+		}
+		/* The strict upper part of column i are the multipliers, the diagonal of U is last */
+		for (int p = U->p[i]; p < U->p[i + 1] - 1; p++) {
+			int k = U->i[p];
+			double wk = w[k] / L->x[L->p[k]];
+			w[k] = wk;
+			for (int q = L->p[k] + 1; q < L->p[k + 1]; q++) {
+				if (mark[L->i[q]] == i) {
+					w[L->i[q]] -= wk * L->x[q];
+				}
+			}
+			U->x[p] = wk;
+		}
+		U->x[U->p[i + 1] - 1] = 1.0;
+		for (int p = L->p[i]; p < L->p[i + 1]; p++) {
+			L->x[p] = w[L->i[p]];
+		}
+		if (L->x[L->p[i]] == 0.0) {
+			L->x[L->p[i]] = 1.0;
+		}
+	}
+}
+
+/*
+ * For a symmetric C the ILU(0) factors are U = inv(D)L', so M = LU = (L inv(sqrt(D)))(L inv(sqrt(D)))'.
+ * Scales the columns of L to the IC(0) factor, false if a pivot isn't positive and LL' can't be formed.
+ */
+static bool ic0_scale(cs *L) {
+	for (int k = 0; k < L->n; k++) {
+		if (L->x[L->p[k]] <= 0.0) return false;
+	}
+	for (int k = 0; k < L->n; k++) {
+		double s = 1.0 / sqrt(L->x[L->p[k]]);
+		for (int p = L->p[k]; p < L->p[k + 1]; p++) {
+			L->x[p] *= s;
+		}
+	}
+	return true;
+}
+
+/* Keeps at most lfil of the cnt rows in idx, the ones with the largest |w|, mag is a workspace */
+static int keep_largest(int *idx, int cnt, int lfil, const double *w, double *mag) {
+	if (cnt <= lfil) return cnt;
+	for (int t = 0; t < cnt; t++) {
+		mag[t] = fabs(w[idx[t]]);
+	}
+	/* Selection of the lfil-th largest magnitude, the columns are short */
+	for (int s = 0; s < lfil; s++) {
+		int best = s;
+		for (int t = s + 1; t < cnt; t++) {
+			if (mag[t] > mag[best]) best = t;
+		}
+		double m = mag[s]; mag[s] = mag[best]; mag[best] = m;
+		int j = idx[s]; idx[s] = idx[best]; idx[best] = j;
+	}
+	return lfil;
+}
+
+/* Min-heap of row indices for the elimination order of ILUT */
+static void heap_push(int *heap, int *size, int v) {
+	int c = (*size)++;
+	while (c > 0 && heap[(c - 1) / 2] > v) {
+		heap[c] = heap[(c - 1) / 2];
+		c = (c - 1) / 2;
+	}
+	heap[c] = v;
+}
+
+static int heap_pop(int *heap, int *size) {
+	int top = heap[0], v = heap[--(*size)], c = 0;
+	while (2 * c + 1 < *size) {
+		int child = 2 * c + 1;
+		if (child + 1 < *size && heap[child + 1] < heap[child]) child++;
+		if (heap[child] >= v) break;
+		heap[c] = heap[child];
+		c = child;
+	}
+	heap[c] = v;
+	return top;
+}
+
+/* Makes room for extra more entries in the compressed-column matrix A that has nz of them */
+static void ensure_room(cs *A, int nz, int extra) {
+	if (nz + extra > A->nzmax) {
+		if (!cs_sprealloc(A, 2 * (nz + extra))) {
+			fprintf(stderr, "Out of memory in the ILUT factorization.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+ * ILUT factorization of C with a dual threshold, in the spirit of cs_droptol: every entry of column i
+ * smaller than droptol times the 2-norm of column i of C is dropped, the multipliers as soon as they
+ * are formed and the rest after the elimination. Then only the ILUT_FILL * nnz(C(:,i)) largest of each
+ * of the L and U parts are kept. The elimination takes the multipliers in increasing row from a heap,
+ * since the fill of column i isn't known in advance.
+ */
+static void ilut_factor(precond_t *P, cs *C, double droptol) {
+	int n = P->n;
+	cs_spfree(P->L);
+	cs_spfree(P->U);
+	P->L = cs_spalloc(n, n, C->p[n] + n, 1, 0);
+	P->U = cs_spalloc(n, n, C->p[n] + n, 1, 0);
+	assert(P->L != NULL && P->U != NULL);
+	cs *L = P->L, *U = P->U;
+	double *w = P->w;
+	int *mark = P->mark, *list = P->list;
+	int *heap = (int *)malloc(n * sizeof(int));
+	int *idx  = (int *)malloc(n * sizeof(int));
+	double *mag = (double *)malloc(n * sizeof(double));
+	assert(heap != NULL && idx != NULL && mag != NULL);
+	for (int i = 0; i < n; i++) {
+		mark[i] = -1;
+	}
+
+	int nl = 0, nu = 0;
+	L->p[0] = U->p[0] = 0;
+	for (int i = 0; i < n; i++) {
+		int cnt = 0, size = 0;
+		double norm = 0.0;
+		mark[i] = i;
+		w[i] = 0.0;
+		list[cnt++] = i;
+		for (int p = C->p[i]; p < C->p[i + 1]; p++) {
+			int j = C->i[p];
+			if (mark[j] != i) {
+				mark[j] = i;
+				w[j] = 0.0;
+				list[cnt++] = j;
+				if (j < i) heap_push(heap, &size, j);
+			}
+			w[j] += C->x[p];
+			norm += C->x[p] * C->x[p];
+		}
+		double tau = droptol * sqrt(norm);
+
+		while (size > 0) {
+			int k = heap_pop(heap, &size);
+			double wk = w[k] / L->x[L->p[k]];
+			if (fabs(wk) < tau) {
+				w[k] = 0.0;
+				continue;
+			}
+			w[k] = wk;
+			for (int q = L->p[k] + 1; q < L->p[k + 1]; q++) {
+				int j = L->i[q];
+				if (mark[j] != i) {
+					mark[j] = i;
+					w[j] = 0.0;
+					list[cnt++] = j;
+					if (j < i) heap_push(heap, &size, j);
+				}
+				w[j] -= wk * L->x[q];
+			}
+		}
+
+		/* Column i of U: the kept multipliers and the unit diagonal last */
+		int lfil = ILUT_FILL * MAX(C->p[i + 1] - C->p[i], 1), nk = 0;
+		for (int t = 0; t < cnt; t++) {
+			if (list[t] < i && w[list[t]] != 0.0) idx[nk++] = list[t];
+		}
+		nk = keep_largest(idx, nk, lfil, w, mag);
+		ensure_room(U, nu, nk + 1);
+		for (int t = 0; t < nk; t++) {
+			U->i[nu] = idx[t];
+			U->x[nu++] = w[idx[t]];
+		}
+		U->i[nu] = i;
+		U->x[nu++] = 1.0;
+
+		/* Column i of L: the pivot first and the entries below it above the threshold */
+		nk = 0;
+		for (int t = 0; t < cnt; t++) {
+			if (list[t] > i && fabs(w[list[t]]) >= tau && w[list[t]] != 0.0) idx[nk++] = list[t];
+		}
+		nk = keep_largest(idx, nk, lfil, w, mag);
+		ensure_room(L, nl, nk + 1);
+		L->i[nl] = i;
+		L->x[nl++] = (w[i] == 0.0) ? 1.0 : w[i];
+		for (int t = 0; t < nk; t++) {
+			L->i[nl] = idx[t];
+			L->x[nl++] = w[idx[t]];
+		}
+		/* Column i ends here, the elimination of the next column reads it */
+		L->p[i + 1] = nl;
+		U->p[i + 1] = nu;
+	}
+	free(heap);
+	free(idx);
+	free(mag);
+}
+
+/*
+ * Greedy coloring of the rows of C on the pattern of C + C', every row takes the smallest color none of
+ * its neighbours has, then the rows are sorted by color. Done once per pattern.
+ */
+static void ssor_color(precond_t *P, cs *C) {
+	int n = P->n;
+	cs *T = cs_transpose(C, 0);
+	free(P->color);
+	free(P->color_ptr);
+	free(P->order);
+	P->color = (int *)malloc(n * sizeof(int));
+	P->order = (int *)malloc(n * sizeof(int));
+	int *forbid = (int *)malloc((n + 1) * sizeof(int));
+	assert(T != NULL && P->color != NULL && P->order != NULL && forbid != NULL);
+	for (int i = 0; i < n; i++) {
+		P->color[i] = -1;
+	}
+	for (int c = 0; c <= n; c++) {
+		forbid[c] = -1;
+	}
+
+	P->num_colors = 0;
+	for (int i = 0; i < n; i++) {
+		for (int p = C->p[i]; p < C->p[i + 1]; p++) {
+			if (P->color[C->i[p]] >= 0) forbid[P->color[C->i[p]]] = i;
+		}
+		for (int p = T->p[i]; p < T->p[i + 1]; p++) {
+			if (P->color[T->i[p]] >= 0) forbid[P->color[T->i[p]]] = i;
+		}
+		int c = 0;
+		while (forbid[c] == i) c++;
+		P->color[i] = c;
+		P->num_colors = MAX(P->num_colors, c + 1);
+	}
+
+	/* Counting sort of the rows by color, forbid holds the next slot of every color */
+	P->color_ptr = (int *)calloc(P->num_colors + 1, sizeof(int));
+	assert(P->color_ptr != NULL);
+	for (int i = 0; i < n; i++) {
+		P->color_ptr[P->color[i] + 1]++;
+	}
+	for (int c = 0; c < P->num_colors; c++) {
+		P->color_ptr[c + 1] += P->color_ptr[c];
+		forbid[c] = P->color_ptr[c];
+	}
+	for (int i = 0; i < n; i++) {
+		P->order[forbid[P->color[i]]++] = i;
+	}
+	free(forbid);
+	cs_spfree(T);
+}
+
+static void free_color_split(color_split_t *S) {
+	if (S == NULL) return;
+	free(S->p);
+	free(S->mid);
+	free(S->j);
+	free(S->x);
+	free(S->d);
+	free(S);
+}
+
+/*
+ * The entry of C in row r and column c is in row r of A, or in row c of A' when trans is set.
+ * Returns the position of that row in the color order and sets *col to the column of the entry.
+ */
+static inline int split_row(const int *pos, int r, int c, bool trans, int *col) {
+	*col = trans ? r : c;
+	return pos[trans ? c : r];
+}
+
+/* Allocates the split of A, or of A' when trans is set, on the pattern of C */
+static color_split_t *color_split_pattern(precond_t *P, cs *C, const int *pos, bool trans) {
+	int n = P->n, *color = P->color;
+	color_split_t *S = (color_split_t *)calloc(1, sizeof(color_split_t));
+	assert(S != NULL);
+	S->p   = (int *)calloc(n + 1, sizeof(int));
+	S->mid = (int *)calloc(n, sizeof(int));
+	S->d   = (double *)malloc(n * sizeof(double));
+	assert(S->p != NULL && S->mid != NULL && S->d != NULL);
+	/* mid counts the entries of the earlier colors and p[t + 1] the later ones, then the prefix sums */
+	for (int c = 0; c < n; c++) {
+		for (int q = C->p[c]; q < C->p[c + 1]; q++) {
+			int col, t = split_row(pos, C->i[q], c, trans, &col);
+			if (color[col] < color[P->order[t]]) S->mid[t]++;
+			else if (col != P->order[t]) S->p[t + 1]++;
+		}
+	}
+	for (int t = 0; t < n; t++) {
+		S->mid[t] += S->p[t];
+		S->p[t + 1] += S->mid[t];
+	}
+	S->j = (int *)malloc(MAX(S->p[n], 1) * sizeof(int));
+	S->x = (double *)malloc(MAX(S->p[n], 1) * sizeof(double));
+	assert(S->j != NULL && S->x != NULL);
+	return S;
+}
+
+/* Copies the values of C to the split, lo and hi are the next slots of every row */
+static void color_split_fill(precond_t *P, color_split_t *S, cs *C, const int *pos, bool trans, int *lo, int *hi) {
+	int n = P->n, *color = P->color;
+	for (int t = 0; t < n; t++) {
+		lo[t] = S->p[t];
+		hi[t] = S->mid[t];
+		S->d[t] = 0.0;
+	}
+	for (int c = 0; c < n; c++) {
+		for (int q = C->p[c]; q < C->p[c + 1]; q++) {
+			int col, t = split_row(pos, C->i[q], c, trans, &col), s;
+			if (col == P->order[t]) {
+				S->d[t] += C->x[q];
+				continue;
+			}
+			s = (color[col] < color[P->order[t]]) ? lo[t]++ : hi[t]++;
+			S->j[s] = col;
+			S->x[s] = C->x[q];
+		}
+	}
+	for (int t = 0; t < n; t++) {
+		S->d[t] = P->omega / ((S->d[t] == 0.0) ? 1.0 : S->d[t]);
+	}
+}
+
+/*
+ * Colors the rows and splits A (and A' if it isn't symmetric) when the pattern of C changed, otherwise
+ * only the values are copied over, like the refactorizations of ILU(0).
+ */
+static void ssor_build(precond_t *P, cs *C) {
+	int n = P->n;
+	int *pos = P->mark, *lo = P->list, *hi = (int *)malloc(n * sizeof(int));
+	assert(hi != NULL);
+	if (P->rows == NULL || P->nnz_A != C->p[n]) {
+		free_color_split(P->rows);
+		free_color_split(P->cols);
+		P->cols = NULL;
+		ssor_color(P, C);
+		for (int t = 0; t < n; t++) {
+			pos[P->order[t]] = t;
+		}
+		P->rows = color_split_pattern(P, C, pos, false);
+		if (!P->spd) {
+			P->cols = color_split_pattern(P, C, pos, true);
+		}
+	}
+	color_split_fill(P, P->rows, C, pos, false, lo, hi);
+	if (P->cols != NULL) {
+		color_split_fill(P, P->cols, C, pos, true, lo, hi);
+	}
+	free(hi);
+}
+
+/* Forward sweep over the rows t0 .. t1 of a color, (D/w + L) Y = R */
+static inline __attribute__((always_inline)) void ssor_forward_rows(double *Z, const double *R, const int *order,
+																	const int *p, const int *mid, const int *j,
+																	const double *x, const double *d, int k,
+																	int t0, int t1) {
+	for (int t = t0; t < t1; t++) {
+		double *z = Z + (size_t)order[t] * k;
+		const double *r = R + (size_t)order[t] * k;
+		for (int l = 0; l < k; l++) {
+			z[l] = r[l];
+		}
+		for (int q = p[t]; q < mid[t]; q++) {
+			const double *y = Z + (size_t)j[q] * k;
+			for (int l = 0; l < k; l++) {
+				z[l] -= x[q] * y[l];
+			}
+		}
+		for (int l = 0; l < k; l++) {
+			z[l] *= d[t];
+		}
+	}
+}
+
+/* Backward sweep over the rows t0 .. t1 of a color, (D/w + U) Z = (D/w) Y scaled by (2 - w)/w on the way */
+static inline __attribute__((always_inline)) void ssor_backward_rows(double *Z, const int *order, const int *p,
+																	 const int *mid, const int *j, const double *x,
+																	 const double *d, double scale, int k,
+																	 int t0, int t1) {
+	for (int t = t0; t < t1; t++) {
+		double *z = Z + (size_t)order[t] * k;
+		for (int l = 0; l < k; l++) {
+			z[l] *= scale;
+		}
+		for (int q = mid[t]; q < p[t + 1]; q++) {
+			const double *y = Z + (size_t)j[q] * k;
+			double a = d[t] * x[q];
+			for (int l = 0; l < k; l++) {
+				z[l] -= a * y[l];
+			}
+		}
+	}
+}
+
+/*
+ * Z = inv(M) R for k columns with the sweeps of S. The rows of a color only read the rows of the other
+ * colors, so every color is split among the threads in chunks. The single vector of the solvers gets
+ * its own copy of the kernels, the loops over the columns don't vectorize.
+ */
+static void ssor_sweep(double *Z, precond_t *P, color_split_t *S, double *R, int k) {
+	const int *order = P->order, *cp = P->color_ptr;
+	double scale = (2.0 - P->omega) / P->omega;
+	for (int c = 0; c < P->num_colors; c++) {
+		#pragma omp parallel for schedule(static) if (cp[c + 1] - cp[c] > SSOR_PAR_MIN)
+		for (int t = cp[c]; t < cp[c + 1]; t += SSOR_CHUNK) {
+			int t1 = MIN(t + SSOR_CHUNK, cp[c + 1]);
+			if (k == 1) ssor_forward_rows(Z, R, order, S->p, S->mid, S->j, S->x, S->d, 1, t, t1);
+			else ssor_forward_rows(Z, R, order, S->p, S->mid, S->j, S->x, S->d, k, t, t1);
+		}
+	}
+	for (int c = P->num_colors - 1; c >= 0; c--) {
+		#pragma omp parallel for schedule(static) if (cp[c + 1] - cp[c] > SSOR_PAR_MIN)
+		for (int t = cp[c]; t < cp[c + 1]; t += SSOR_CHUNK) {
+			int t1 = MIN(t + SSOR_CHUNK, cp[c + 1]);
+			if (k == 1) ssor_backward_rows(Z, order, S->p, S->mid, S->j, S->x, S->d, scale, 1, t, t1);
+			else ssor_backward_rows(Z, order, S->p, S->mid, S->j, S->x, S->d, scale, k, t, t1);
+		}
+	}
+}
+
+/*
+ * Builds the preconditioner of A (dense) or C (sparse, compressed-column). The pattern of ILU(0)/IC(0)
+ * and the coloring of SSOR are kept, so a matrix with the same pattern (the next frequency or transient)
+ * only refactorizes.
+ */
+void build_precond(precond_t *P, double **A, cs *C, double droptol, bool SPARSE) {
+	if (!SPARSE || P->type == PRE_JACOBI) {
+		jacobi_precond(P->M, A, C, P->n, SPARSE);
+		return;
+	}
+	if (P->type == PRE_AMG) {
+		free_amg(P->amg);
+		P->amg = amg_setup(C, (P->smoother == SMO_CHEBY) ? P->degree : 0);
+		P->nnz_A = C->p[P->n];
+		return;
+	}
+	if (P->type == PRE_CHEBY) {
+		free_cheby(P->cheby);
+		P->cheby = cheby_setup(C, P->degree, 0.0);
+		P->nnz_A = C->p[P->n];
+		return;
+	}
+	init_factor_workspace(P->n, (void **)&P->w, sizeof(double), &P->mark, &P->list);
+	if (P->type == PRE_SSOR) {
+		ssor_build(P, C);
+	}
+	else if (P->type == PRE_ILUT) {
+		ilut_factor(P, C, droptol);
+		P->sym = P->spd && ic0_scale(P->L);
+	}
+	else {
+		if (P->L == NULL || P->nnz_A != C->p[P->n]) {
+			int nnz_L, nnz_U;
+			cs_spfree(P->L);
+			cs_spfree(P->U);
+			ilu0_count(P->n, C->p, C->i, &nnz_L, &nnz_U);
+			P->L = cs_spalloc(P->n, P->n, nnz_L, 1, 0);
+			P->U = cs_spalloc(P->n, P->n, nnz_U, 1, 0);
+			assert(P->L != NULL && P->U != NULL);
+			ilu0_pattern(P->n, C->p, C->i, P->L->p, P->L->i, P->U->p, P->U->i);
+		}
+		ilu0_numeric(P, C);
+		P->sym = P->type == PRE_IC0 && ic0_scale(P->L);
+		if (P->type == PRE_IC0 && !P->sym) {
+			printf("IC(0) found a pivot that isn't positive, it falls back to ILU(0).\n");
+			P->type = PRE_ILU0;
+		}
+	}
+	P->nnz_A = C->p[P->n];
+}
+
+/* z = inv(M) r */
+void apply_precond(double *z, precond_t *P, double *r) {
+	if (P->type == PRE_JACOBI) {
+		precond_solve(z, P->M, r, P->n);
+		return;
+	}
+	if (P->type == PRE_AMG) {
+		amg_vcycle(P->amg, z, r);
+		return;
+	}
+	if (P->type == PRE_CHEBY) {
+		cheby_apply(P->cheby, z, r, false);
+		return;
+	}
+	if (P->type == PRE_SSOR) {
+		ssor_sweep(z, P, P->rows, r, 1);
+		return;
+	}
+	memcpy(z, r, P->n * sizeof(double));
+	cs_lsolve(P->L, z);
+	if (P->sym) {
+		cs_ltsolve(P->L, z);
+	}
+	else {
+		cs_usolve(P->U, z);
+	}
+}
+
+/*
+ * Z = inv(M) R for a panel of k columns. The incomplete factors and the SSOR sweeps are applied to all
+ * the columns in one pass, AMG and Chebyshev take them one at a time through the vectors r and z.
+ */
+void apply_precond_block(double *Z, precond_t *P, double *R, int k, double *r, double *z) {
+	int n = P->n;
+	if (P->type == PRE_JACOBI) {
+		for (int i = 0; i < n; i++) {
+			for (int c = 0; c < k; c++) {
+				Z[i * k + c] = P->M[i] * R[i * k + c];
+			}
+		}
+		return;
+	}
+	if (P->type == PRE_AMG || P->type == PRE_CHEBY) {
+		for (int c = 0; c < k; c++) {
+			for (int i = 0; i < n; i++) {
+				r[i] = R[i * k + c];
+			}
+			apply_precond(z, P, r);
+			for (int i = 0; i < n; i++) {
+				Z[i * k + c] = z[i];
+			}
+		}
+		return;
+	}
+	if (P->type == PRE_SSOR) {
+		ssor_sweep(Z, P, P->rows, R, k);
+		return;
+	}
+	memcpy(Z, R, (size_t)n * k * sizeof(double));
+	cs_lsolve_block(P->L, Z, k);
+	if (P->sym) {
+		cs_ltsolve_block(P->L, Z, k);
+	}
+	else {
+		cs_usolve_block(P->U, Z, k);
+	}
+}
+
+/* z = inv(M') r, for the shadow system of Bi-CG */
+void apply_precond_trans(double *z, precond_t *P, double *r) {
+	if (P->type == PRE_JACOBI || P->type == PRE_AMG || P->type == PRE_CHEBY || P->sym) {
+		apply_precond(z, P, r);
+		return;
+	}
+	/* The sweeps of A' in the same colors, A is symmetric when there are none */
+	if (P->type == PRE_SSOR) {
+		ssor_sweep(z, P, (P->cols != NULL) ? P->cols : P->rows, r, 1);
+		return;
+	}
+	memcpy(z, r, P->n * sizeof(double));
+	cs_utsolve(P->U, z);
+	cs_ltsolve(P->L, z);
+}
+
+/* Prints the type of the incomplete factorization and the size of its factors relative to the matrix C */
+void print_precond_info(precond_t *P, cs *C, char *msg) {
+	if (P->amg != NULL) {
+		print_amg_info(P->amg, msg);
+		return;
+	}
+	if (P->cheby != NULL) {
+		print_cheby_info(P->cheby, msg);
+		return;
+	}
+	if (P->rows != NULL) {
+		printf("%s preconditioner: SSOR, omega %g, %d colors\n", msg, P->omega, P->num_colors);
+		return;
+	}
+	if (P->L == NULL) return;
+	int nnz = P->L->p[P->n] + (P->sym ? 0 : P->U->p[P->n] - P->n);
+	printf("%s preconditioner: %s, %d entries in the factors, %.2lf times nnz(A)\n",
+	       msg, precond_name(P->type), nnz, (double)nnz / MAX(C->p[C->n], 1));
+}
+
+/* Frees the preconditioner */
+void free_precond(precond_t *P) {
+	if (P == NULL) return;
+	free(P->M);
+	cs_spfree(P->L);
+	cs_spfree(P->U);
+	free_amg(P->amg);
+	free_cheby(P->cheby);
+	free(P->color);
+	free(P->color_ptr);
+	free(P->order);
+	free_color_split(P->rows);
+	free_color_split(P->cols);
+	free(P->w);
+	free(P->mark);
+	free(P->list);
+	free(P);
+}
+
+/* The same for the complex systems of the AC analysis */
+complex_precond_t *init_complex_precond(int n, precond_type_t type, bool SPD) {
+	complex_precond_t *P = (complex_precond_t *)calloc(1, sizeof(complex_precond_t));
+	assert(P != NULL);
+	P->type = (type == PRE_AMG || type == PRE_SSOR || type == PRE_CHEBY) ? PRE_ILU0 : type;
+	P->n = n;
+	P->spd = SPD;
+	P->M = init_complex_vector(n);
+	P->M_conj = init_complex_vector(n);
+	return P;
+}
+
+static void complex_ilu0_numeric(complex_precond_t *P, cs_ci *C) {
+	cs_ci *L = P->L, *U = P->U;
+	cs_complex_t *w = P->w;
+	int *mark = P->mark;
+	for (int i = 0; i < P->n; i++) {
+		mark[i] = -1;
+	}
+	for (int i = 0; i < P->n; i++) {
+		for (int p = U->p[i]; p < U->p[i + 1]; p++) {
+			w[U->i[p]] = 0.0;
+			mark[U->i[p]] = i;
+		}
+		for (int p = L->p[i]; p < L->p[i + 1]; p++) {
+			w[L->i[p]] = 0.0;
+			mark[L->i[p]] = i;
+		}
+		for (int p = C->p[i]; p < C->p[i + 1]; p++) {
+			w[C->i[p]] += C->x[p];
+		}
+		for (int p = U->p[i]; p < U->p[i + 1] - 1; p++) {
+			int k = U->i[p];
+			cs_complex_t wk = w[k] / L->x[L->p[k]];
+			w[k] = wk;
+			for (int q = L->p[k] + 1; q < L->p[k + 1]; q++) {
+				if (mark[L->i[q]] == i) {
+					w[L->i[q]] -= CS_COMPLEX_MUL(wk, L->x[q]);
+				}
+			}
+			U->x[p] = wk;
+		}
+		U->x[U->p[i + 1] - 1] = 1.0;
+		for (int p = L->p[i]; p < L->p[i + 1]; p++) {
+			L->x[p] = w[L->i[p]];
+		}
+		if (L->x[L->p[i]] == 0.0) {
+			L->x[L->p[i]] = 1.0;
+		}
+	}
+}
+
+/* For the complex symmetric G + jwC the pivots only need to be non-zero, they have complex square roots */
+static void complex_ic0_scale(cs_ci *L) {
+	for (int k = 0; k < L->n; k++) {
+		cs_complex_t s = 1.0 / csqrt(L->x[L->p[k]]);
+		for (int p = L->p[k]; p < L->p[k + 1]; p++) {
+			L->x[p] = CS_COMPLEX_MUL(L->x[p], s);
+		}
+	}
+}
+
+static int complex_keep_largest(int *idx, int cnt, int lfil, const cs_complex_t *w, double *mag) {
+	if (cnt <= lfil) return cnt;
+	for (int t = 0; t < cnt; t++) {
+		mag[t] = cabs(w[idx[t]]);
+	}
+	for (int s = 0; s < lfil; s++) {
+		int best = s;
+		for (int t = s + 1; t < cnt; t++) {
+			if (mag[t] > mag[best]) best = t;
+		}
+		double m = mag[s]; mag[s] = mag[best]; mag[best] = m;
+		int j = idx[s]; idx[s] = idx[best]; idx[best] = j;
+	}
+	return lfil;
+}
+
+static void complex_ensure_room(cs_ci *A, int nz, int extra) {
+	if (nz + extra > A->nzmax) {
+		if (!cs_ci_sprealloc(A, 2 * (nz + extra))) {
+			fprintf(stderr, "Out of memory in the ILUT factorization.\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void complex_ilut_factor(complex_precond_t *P, cs_ci *C, double droptol) {
+	int n = P->n;
+	cs_ci_spfree(P->L);
+	cs_ci_spfree(P->U);
+	P->L = cs_ci_spalloc(n, n, C->p[n] + n, 1, 0);
+	P->U = cs_ci_spalloc(n, n, C->p[n] + n, 1, 0);
+	assert(P->L != NULL && P->U != NULL);
+	cs_ci *L = P->L, *U = P->U;
+	cs_complex_t *w = P->w;
+	int *mark = P->mark, *list = P->list;
+	int *heap = (int *)malloc(n * sizeof(int));
+	int *idx  = (int *)malloc(n * sizeof(int));
+	double *mag = (double *)malloc(n * sizeof(double));
+	assert(heap != NULL && idx != NULL && mag != NULL);
+	for (int i = 0; i < n; i++) {
+		mark[i] = -1;
+	}
+
+	int nl = 0, nu = 0;
+	L->p[0] = U->p[0] = 0;
+	for (int i = 0; i < n; i++) {
+		int cnt = 0, size = 0;
+		double norm = 0.0;
+		mark[i] = i;
+		w[i] = 0.0;
+		list[cnt++] = i;
+		for (int p = C->p[i]; p < C->p[i + 1]; p++) {
+			int j = C->i[p];
+			if (mark[j] != i) {
+				mark[j] = i;
+				w[j] = 0.0;
+				list[cnt++] = j;
+				if (j < i) heap_push(heap, &size, j);
+			}
+			w[j] += C->x[p];
+			norm += creal(C->x[p] * conj(C->x[p]));
+		}
+		double tau = droptol * sqrt(norm);
+
+		while (size > 0) {
+			int k = heap_pop(heap, &size);
+			cs_complex_t wk = w[k] / L->x[L->p[k]];
+			if (cabs(wk) < tau) {
+				w[k] = 0.0;
+				continue;
+			}
+			w[k] = wk;
+			for (int q = L->p[k] + 1; q < L->p[k + 1]; q++) {
+				int j = L->i[q];
+				if (mark[j] != i) {
+					mark[j] = i;
+					w[j] = 0.0;
+					list[cnt++] = j;
+					if (j < i) heap_push(heap, &size, j);
+				}
+				w[j] -= CS_COMPLEX_MUL(wk, L->x[q]);
+			}
+		}
+
+		int lfil = ILUT_FILL * MAX(C->p[i + 1] - C->p[i], 1), nk = 0;
+		for (int t = 0; t < cnt; t++) {
+			if (list[t] < i && w[list[t]] != 0.0) idx[nk++] = list[t];
+		}
+		nk = complex_keep_largest(idx, nk, lfil, w, mag);
+		complex_ensure_room(U, nu, nk + 1);
+		for (int t = 0; t < nk; t++) {
+			U->i[nu] = idx[t];
+			U->x[nu++] = w[idx[t]];
+		}
+		U->i[nu] = i;
+		U->x[nu++] = 1.0;
+
+		nk = 0;
+		for (int t = 0; t < cnt; t++) {
+			if (list[t] > i && cabs(w[list[t]]) >= tau && w[list[t]] != 0.0) idx[nk++] = list[t];
+		}
+		nk = complex_keep_largest(idx, nk, lfil, w, mag);
+		complex_ensure_room(L, nl, nk + 1);
+		L->i[nl] = i;
+		L->x[nl++] = (w[i] == 0.0) ? 1.0 : w[i];
+		for (int t = 0; t < nk; t++) {
+			L->i[nl] = idx[t];
+			L->x[nl++] = w[idx[t]];
+		}
+		/* Column i ends here, the elimination of the next column reads it */
+		L->p[i + 1] = nl;
+		U->p[i + 1] = nu;
+	}
+	free(heap);
+	free(idx);
+	free(mag);
+}
+
+void build_complex_precond(complex_precond_t *P, gsl_matrix_complex *A, cs_ci *C, double droptol, bool SPARSE) {
+	if (!SPARSE || P->type == PRE_JACOBI) {
+		for (int i = 0; i < P->n; i++) {
+			P->M[i] = 1.0;
+		}
+		complex_jacobi_precond(P->M, A, C, P->n, SPARSE);
+		for (int i = 0; i < P->n; i++) {
+			P->M_conj[i] = conj(P->M[i]);
+		}
+		return;
+	}
+	init_factor_workspace(P->n, (void **)&P->w, sizeof(cs_complex_t), &P->mark, &P->list);
+	if (P->type == PRE_ILUT) {
+		complex_ilut_factor(P, C, droptol);
+	}
+	else {
+		if (P->L == NULL || P->nnz_A != C->p[P->n]) {
+			int nnz_L, nnz_U;
+			cs_ci_spfree(P->L);
+			cs_ci_spfree(P->U);
+			ilu0_count(P->n, C->p, C->i, &nnz_L, &nnz_U);
+			P->L = cs_ci_spalloc(P->n, P->n, nnz_L, 1, 0);
+			P->U = cs_ci_spalloc(P->n, P->n, nnz_U, 1, 0);
+			assert(P->L != NULL && P->U != NULL);
+			ilu0_pattern(P->n, C->p, C->i, P->L->p, P->L->i, P->U->p, P->U->i);
+		}
+		complex_ilu0_numeric(P, C);
+	}
+	P->sym = P->type == PRE_IC0 || (P->type == PRE_ILUT && P->spd);
+	if (P->sym) {
+		complex_ic0_scale(P->L);
+	}
+	P->nnz_A = C->p[P->n];
+}
+
+/* x = conj(x), the complex cs_ltsolve solves with L^H and IC(0) needs L' */
+static void conjugate(cs_complex_t *x, int n) {
+	for (int i = 0; i < n; i++) {
+		x[i] = conj(x[i]);
+	}
+}
+
+/* z = inv(M) r, the factors work in place on z */
+void apply_complex_precond(cs_complex_t *x, complex_precond_t *P, cs_complex_t *r) {
+	if (P->type == PRE_JACOBI) {
+		complex_precond_solve(x, P->M, r, P->n);
+		return;
+	}
+	memcpy(x, r, P->n * sizeof(cs_complex_t));
+	cs_ci_lsolve(P->L, x);
+	if (P->sym) {
+		/* L'x = y as conj(L^H conj(x)) = y */
+		conjugate(x, P->n);
+		cs_ci_ltsolve(P->L, x);
+		conjugate(x, P->n);
+	}
+	else {
+		cs_ci_usolve(P->U, x);
+	}
+}
+
+/* z = inv(M^H) r, for the shadow system of Bi-CG */
+void apply_complex_precond_herm(cs_complex_t *x, complex_precond_t *P, cs_complex_t *r) {
+	if (P->type == PRE_JACOBI) {
+		complex_precond_solve(x, P->M_conj, r, P->n);
+		return;
+	}
+	memcpy(x, r, P->n * sizeof(cs_complex_t));
+	if (P->sym) {
+		/* M^H = conj(L) L^H */
+		conjugate(x, P->n);
+		cs_ci_lsolve(P->L, x);
+		conjugate(x, P->n);
+		cs_ci_ltsolve(P->L, x);
+	}
+	else {
+		/* M^H = U^H L^H */
+		cs_ci_utsolve(P->U, x);
+		cs_ci_ltsolve(P->L, x);
+	}
+}
+
+void free_complex_precond(complex_precond_t *P) {
+	if (P == NULL) return;
+	free(P->M);
+	free(P->M_conj);
+	cs_ci_spfree(P->L);
+	cs_ci_spfree(P->U);
+	free(P->w);
+	free(P->mark);
+	free(P->list);
+	free(P);
+}
@@ -0,0 +1,118 @@
+#ifndef PRECOND_H
+#define PRECOND_H
+
+#include <stdbool.h>
+#include <gsl/gsl_vector.h>
+
+#include "parser.h"
+#include "routines.h"
+#include "amg.h"
+#include "chebyshev.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* ILUT keeps at most ILUT_FILL times the entries of the column of A in each of the L and U parts of a column */
+#define ILUT_FILL		5
+/* Below this many rows in a color its SSOR sweep runs on a single thread */
+#define SSOR_PAR_MIN	(1 << 12)
+/* Rows of the chunks the threads take in a color */
+#define SSOR_CHUNK		512
+
+/*
+ * One direction of the SSOR sweeps: the rows of A in the color order, row t being row order[t] of A.
+ * The entries of row t in the columns of earlier colors are j/x[p[t] .. mid[t]), the ones of later
+ * colors j/x[mid[t] .. p[t + 1]), the columns are indices of A. d holds omega over the diagonal,
+ * a zero one taken as 1.0 like in the Jacobi one.
+ */
+typedef struct color_split {
+	int *p;
+	int *mid;
+	int *j;
+	double *x;
+	double *d;
+} color_split_t;
+
+/*
+ * Preconditioner M of the iterative solvers, applied as z = inv(M) r.
+ * JACOBI: M holds the inverted diagonal of A.
+ * ILU0/ILUT: M = LU. L is lower triangular with the pivots on its diagonal, U is unit upper triangular,
+ * both compressed-column with the diagonal first in every column of L and last in every column of U,
+ * the layout cs_lsolve/cs_usolve and their transposes expect. ILU0 keeps the pattern of A (plus the
+ * diagonal), ILUT drops the entries below DROPTOL times the norm of their column of A.
+ * IC0: M = LL' on the pattern of A, U only keeps the pattern of the refactorizations. The ILUT of an
+ * SPD A is also applied as LL' from its scaled L, CG needs a symmetric M, sym is set for both.
+ * AMG: one V-cycle of the smoothed aggregation hierarchy of amg, for the SPD systems of CG.
+ * SSOR: M = w/(2-w) (D/w + L) inv(D/w) (D/w + U), one forward and one backward Gauss-Seidel sweep
+ * with relaxation omega. The rows are greedily colored on the symmetrized pattern of A so that no two
+ * rows of a color are coupled, L and U are the parts of A in the columns of the earlier and the later
+ * colors and every color of a sweep is updated in parallel. M is symmetric for a symmetric A.
+ * CHEBY: inv(M) = p(inv(D)A) inv(D), the Chebyshev polynomial of cheby with degree steps, for the SPD
+ * systems of CG. It takes products with A and vector updates only, no inner products. AMG smooths its
+ * levels with it too when smoother is CHEBY.
+ * The incomplete factorizations and AMG need a sparse A, the dense solvers always use Jacobi.
+ */
+typedef struct precond {
+	precond_type_t type;
+	int n;
+	bool spd;
+	/* M = LL' */
+	bool sym;
+	double *M;
+	cs *L;
+	cs *U;
+	amg_t *amg;
+	cheby_t *cheby;
+	int degree;
+	smoother_t smoother;
+	/* SSOR: the color of every row, the rows of color c are order[color_ptr[c] .. color_ptr[c + 1]) */
+	double omega;
+	int num_colors;
+	int *color;
+	int *color_ptr;
+	int *order;
+	/* The sweeps on A and, when it isn't symmetric, on A' for inv(M') */
+	color_split_t *rows;
+	color_split_t *cols;
+	/* Workspaces of the factorization */
+	double *w;
+	int *mark;
+	int *list;
+	/* nnz of the last A that was factorized */
+	int nnz_A;
+} precond_t;
+
+/*
+ * The complex one of the AC analysis, the same layout for G + jwC. The Bi-CG also needs inv(M^H),
+ * M_conj is the conjugate of the Jacobi diagonal and the factors are applied conjugate transposed.
+ * IC0 of the complex symmetric G + jwC is M = LL' with a plain (not conjugate) transpose.
+ * There is no complex AMG, SSOR or Chebyshev, they take ILU0.
+ */
+typedef struct complex_precond {
+	precond_type_t type;
+	int n;
+	bool spd;
+	bool sym;
+	cs_complex_t *M;
+	cs_complex_t *M_conj;
+	cs_ci *L;
+	cs_ci *U;
+	cs_complex_t *w;
+	int *mark;
+	int *list;
+	int nnz_A;
+} complex_precond_t;
+
+precond_t *init_precond(int n, precond_type_t type, bool SPD);
+void build_precond(precond_t *P, double **A, cs *C, double droptol, bool SPARSE);
+void apply_precond(double *z, precond_t *P, double *r);
+void apply_precond_block(double *Z, precond_t *P, double *R, int k, double *r, double *z);
+void apply_precond_trans(double *z, precond_t *P, double *r);
+void print_precond_info(precond_t *P, cs *C, char *msg);
+void free_precond(precond_t *P);
+
+complex_precond_t *init_complex_precond(int n, precond_type_t type, bool SPD);
+void build_complex_precond(complex_precond_t *P, gsl_matrix_complex *A, cs_ci *C, double droptol, bool SPARSE);
+void apply_complex_precond(cs_complex_t *z, complex_precond_t *P, cs_complex_t *r);
+void apply_complex_precond_herm(cs_complex_t *z, complex_precond_t *P, cs_complex_t *r);
+void free_complex_precond(complex_precond_t *P);
+
+#endif
@@ -0,0 +1,289 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <assert.h>
+
+#include "random_walk.h"
+#include "routines.h"
+
+/* splitmix64, every walk seeds its own stream so the estimates don't depend on the number of threads */
+static inline uint64_t splitmix64(uint64_t *s) {
+	uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* Uniform in [0, 1) */
+static inline double uniform(uint64_t *s) {
+	return (double)(splitmix64(s) >> 11) * 0x1.0p-53;
+}
+
+/* Standard normal quantile of p in (0.5, 1), Abramowitz and Stegun 26.2.23, error below 4.5e-4 */
+static double normal_quantile(double p) {
+	double t = sqrt(-2.0 * log(1.0 - p));
+	return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) /
+			   (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+static void rw_graph_error(list1_t *curr, char *msg) {
+	fprintf(stderr, "Error: element %s %s, the random walks need a grid of resistors, current sources and voltage "
+			"sources to ground.\n", curr->element, msg);
+	exit(EXIT_FAILURE);
+}
+
+/*
+ * Builds the transition graph from the elements of list1. The resistors are the edges, the current
+ * sources the rewards and the grounded voltage sources the pads, the capacitors are open at DC.
+ */
+rw_graph_t *rw_build_graph(index_t *index, hash_table_t *hash_table, int num_nodes) {
+	int n = num_nodes + 1;
+	rw_graph_t *graph = (rw_graph_t *)malloc(sizeof(rw_graph_t));
+	assert(graph != NULL);
+	graph->n      = n;
+	graph->p      = (int *)calloc(n + 1, sizeof(int));
+	graph->reward = (double *)calloc(n, sizeof(double));
+	graph->pad    = (bool *)calloc(n, sizeof(bool));
+	graph->fixed  = (double *)calloc(n, sizeof(double));
+	double *G     = (double *)calloc(n, sizeof(double));
+	int *next     = (int *)malloc(n * sizeof(int));
+	assert(graph->p != NULL && graph->reward != NULL && graph->pad != NULL && graph->fixed != NULL);
+	assert(G != NULL && next != NULL);
+
+	/* Degrees, total conductances, injected currents and pads */
+	list1_t *curr;
+	for (curr = index->head1; curr != NULL; curr = curr->next) {
+		int a = ht_get_id(hash_table, curr->probe1);
+		int b = ht_get_id(hash_table, curr->probe2);
+		double value = curr->value;
+		if (curr->type == 'R' || curr->type == 'r') {
+			if (a == b) continue;
+			if (value <= 0.0) rw_graph_error(curr, "isn't a positive resistance");
+			if (a > 0) {
+				graph->p[a + 1]++;
+				G[a] += 1.0 / value;
+			}
+			if (b > 0) {
+				graph->p[b + 1]++;
+				G[b] += 1.0 / value;
+			}
+		}
+		else if (curr->type == 'I' || curr->type == 'i') {
+			/* The current flows out of probe1 and into probe2, like the right-hand side of the MNA */
+			if (a > 0) graph->reward[a] -= value;
+			if (b > 0) graph->reward[b] += value;
+		}
+		else if (curr->type == 'V' || curr->type == 'v') {
+			if (b == 0 && a > 0) {
+				graph->pad[a] = true;
+				graph->fixed[a] = value;
+			}
+			else if (a == 0 && b > 0) {
+				graph->pad[b] = true;
+				graph->fixed[b] = -value;
+			}
+			else {
+				rw_graph_error(curr, "isn't grounded");
+			}
+		}
+		else if (curr->type != 'C' && curr->type != 'c') {
+			rw_graph_error(curr, "isn't supported");
+		}
+	}
+	for (int i = 0; i < n; i++) {
+		graph->p[i + 1] += graph->p[i];
+		next[i] = graph->p[i];
+	}
+	graph->adj = (int *)malloc(MAX(graph->p[n], 1) * sizeof(int));
+	graph->cum = (double *)malloc(MAX(graph->p[n], 1) * sizeof(double));
+	assert(graph->adj != NULL && graph->cum != NULL);
+
+	/* The edges with their conductances, then the cumulative probabilities */
+	for (curr = index->head1; curr != NULL; curr = curr->next) {
+		if (curr->type != 'R' && curr->type != 'r') continue;
+		int a = ht_get_id(hash_table, curr->probe1);
+		int b = ht_get_id(hash_table, curr->probe2);
+		if (a == b) continue;
+		if (a > 0) {
+			graph->adj[next[a]] = b;
+			graph->cum[next[a]++] = 1.0 / curr->value;
+		}
+		if (b > 0) {
+			graph->adj[next[b]] = a;
+			graph->cum[next[b]++] = 1.0 / curr->value;
+		}
+	}
+	for (int i = 1; i < n; i++) {
+		double s = 0.0;
+		for (int q = graph->p[i]; q < graph->p[i + 1]; q++) {
+			s += graph->cum[q];
+			graph->cum[q] = s / G[i];
+		}
+		if (graph->p[i + 1] > graph->p[i]) {
+			graph->cum[graph->p[i + 1] - 1] = 1.0;
+			graph->reward[i] /= G[i];
+		}
+	}
+	free(G);
+	free(next);
+	return graph;
+}
+
+/* One walk from node, returns its total and the steps it took, -1 if it never ended */
+static double walk(rw_graph_t *graph, int node, uint64_t seed, long *steps) {
+	const int *p = graph->p, *adj = graph->adj;
+	const double *cum = graph->cum;
+	double total = 0.0;
+	long k = 0;
+	while (!graph->pad[node]) {
+		if (++k > RW_MAX_STEPS) {
+			*steps = -1;
+			return 0.0;
+		}
+		total += graph->reward[node];
+		double u = uniform(&seed);
+		int q = p[node];
+		while (cum[q] <= u) q++;
+		node = adj[q];
+		if (node == 0) {
+			*steps = k;
+			return total;
+		}
+	}
+	*steps = k;
+	return total + graph->fixed[node];
+}
+
+/*
+ * Estimates the voltage of node as the mean of its walks. The walks run in parallel batches of RW_BATCH
+ * until the half-width of the confidence interval of the mean is at most tol, at least RW_MIN_WALKS and
+ * at most RW_MAX_WALKS of them. The totals are shifted by the first walk, the variance doesn't cancel out.
+ */
+rw_estimate_t rw_estimate_node(rw_graph_t *graph, int node, double tol, double confidence) {
+	rw_estimate_t est = {0.0, 0.0, 0, 0.0};
+	if (graph->pad[node]) {
+		est.voltage = graph->fixed[node];
+		return est;
+	}
+	if (graph->p[node + 1] == graph->p[node]) {
+		fprintf(stderr, "Error: node %d has no resistor, it floats.\n", node);
+		exit(EXIT_FAILURE);
+	}
+
+	double z = normal_quantile(0.5 * (1.0 + confidence));
+	uint64_t base = (uint64_t)node << 32;
+	long shift_steps;
+	double shift = walk(graph, node, splitmix64(&base), &shift_steps);
+	double sum = 0.0, sum_sq = 0.0;
+	long total_steps = 0;
+	bool floating = shift_steps < 0;
+
+	while (!floating && est.walks < RW_MAX_WALKS) {
+		long first = est.walks;
+		#pragma omp parallel for reduction(+:sum, sum_sq, total_steps) reduction(||:floating) schedule(dynamic, 64)
+		for (long w = first; w < first + RW_BATCH; w++) {
+			uint64_t seed = ((uint64_t)node << 32) + (uint64_t)w + 1;
+			long steps;
+			double v = walk(graph, node, splitmix64(&seed), &steps) - shift;
+			floating = floating || steps < 0;
+			sum += v;
+			sum_sq += v * v;
+			total_steps += steps;
+		}
+		est.walks += RW_BATCH;
+		double mean = sum / est.walks;
+		double var = MAX(sum_sq / est.walks - mean * mean, 0.0) * est.walks / (est.walks - 1);
+		est.voltage = shift + mean;
+		est.half_width = z * sqrt(var / est.walks);
+		if (est.walks >= RW_MIN_WALKS && est.half_width <= tol) break;
+	}
+	if (floating) {
+		fprintf(stderr, "Error: the walks from node %d reach neither a pad nor ground, it floats.\n", node);
+		exit(EXIT_FAILURE);
+	}
+	est.avg_steps = (double)total_steps / est.walks;
+	return est;
+}
+
+/* Appends the id and the name of every .PLOT node of an analysis to nodes and keys, once, returns their number */
+static int add_plot_nodes(char **names, int num_names, hash_table_t *hash_table, bool *seen, int *nodes, char **keys,
+						  int cnt) {
+	for (int j = 0; j < num_names; j++) {
+		int id = ht_get_id(hash_table, names[j]);
+		if (id < 0) {
+			fprintf(stderr, "Error: unknown .PLOT node %s.\n", names[j]);
+			exit(EXIT_FAILURE);
+		}
+		if (id == 0 || seen[id]) continue;
+		seen[id] = true;
+		keys[cnt] = names[j];
+		nodes[cnt++] = id;
+	}
+	return cnt;
+}
+
+/*
+ * Estimates the DC voltages of the .PLOT nodes of all the analyses with random walks, to the RWTOL
+ * half-width at the CONFIDENCE level, and writes them with their intervals to RW_FILE. The MNA system
+ * is never built, the walks only visit the neighbourhoods of the nodes.
+ */
+void random_walk_analysis(index_t *index, hash_table_t *hash_table, parser_t *parser) {
+	netlist_t *netlist = parser->netlist;
+	options_t *options = parser->options;
+	printf("Random Walk Analysis.....");
+
+	bool *seen = (bool *)calloc(netlist->num_nodes + 1, sizeof(bool));
+	int *nodes = (int *)malloc((netlist->num_nodes + 1) * sizeof(int));
+	char **keys = (char **)malloc((netlist->num_nodes + 1) * sizeof(char *));
+	assert(seen != NULL && nodes != NULL && keys != NULL);
+	int cnt = 0, unconverged = 0;
+	for (int i = 0; i < netlist->dc_counter; i++) {
+		cnt = add_plot_nodes(parser->dc_analysis[i].nodes, parser->dc_analysis[i].num_nodes, hash_table, seen, nodes,
+							 keys, cnt);
+	}
+	for (int i = 0; i < netlist->tr_counter; i++) {
+		cnt = add_plot_nodes(parser->tr_analysis[i].nodes, parser->tr_analysis[i].num_nodes, hash_table, seen, nodes,
+							 keys, cnt);
+	}
+	for (int i = 0; i < netlist->ac_counter; i++) {
+		cnt = add_plot_nodes(parser->ac_analysis[i].nodes, parser->ac_analysis[i].num_nodes, hash_table, seen, nodes,
+							 keys, cnt);
+	}
+
+	rw_graph_t *graph = rw_build_graph(index, hash_table, netlist->num_nodes);
+	FILE *file_out = fopen(RW_FILE, "w");
+	if (file_out == NULL) {
+		fprintf(stderr, "Error opening file: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(file_out, "# %g%% confidence intervals\n", 100.0 * options->CONFIDENCE);
+	fprintf(file_out, "%-30s%-24s%-20s%-12s%-14s\n", "Node", "Voltage (V)", "Half-width (V)", "Walks", "Avg steps");
+	for (int k = 0; k < cnt; k++) {
+		rw_estimate_t est = rw_estimate_node(graph, nodes[k], options->RWTOL, options->CONFIDENCE);
+		fprintf(file_out, "%-30s%-24.12lf%-20.6e%-12ld%-14.1lf\n", keys[k], est.voltage, est.half_width, est.walks,
+				est.avg_steps);
+		unconverged += est.half_width > options->RWTOL;
+	}
+	fclose(file_out);
+	printf("%sOK\n", (cnt == 0) ? "no .PLOT nodes, " : "");
+	if (unconverged > 0) {
+		printf("%d nodes stopped at %d walks above RWTOL, see %s\n", unconverged, RW_MAX_WALKS, RW_FILE);
+	}
+	free_rw_graph(graph);
+	free(seen);
+	free(nodes);
+	free(keys);
+}
+
+void free_rw_graph(rw_graph_t *graph) {
+	if (graph == NULL) return;
+	free(graph->p);
+	free(graph->adj);
+	free(graph->cum);
+	free(graph->reward);
+	free(graph->pad);
+	free(graph->fixed);
+	free(graph);
+}
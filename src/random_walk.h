@@ -0,0 +1,50 @@
+#ifndef RANDOM_WALK_H
+#define RANDOM_WALK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "hash_table.h"
+#include "parser.h"
+
+#define RW_FILE				"rw_operating_point.txt"
+/* Walks of a node run in batches, the confidence interval is checked after every batch */
+#define RW_BATCH			1024
+#define RW_MIN_WALKS		(4 * RW_BATCH)
+#define RW_MAX_WALKS		(1 << 22)
+/* A walk that takes this many steps never reaches a pad or ground, the node floats */
+#define RW_MAX_STEPS		100000000L
+
+/*
+ * Transition graph of the random walks on a resistive grid, built from the list1_t elements without
+ * the MNA matrix. From node i a walk gains reward[i] and moves to a neighbour j of p[i] .. p[i + 1]
+ * with probability g_ij / G_i, G_i the total conductance at i; cum holds the cumulative probabilities.
+ * A walk ends at ground (node 0) with 0 or at a pad, a node fixed by a grounded voltage source, with
+ * its voltage. The voltage of i is the expected total of the walks from i.
+ */
+typedef struct rw_graph {
+	int n;
+	int *p;
+	int *adj;
+	double *cum;
+	double *reward;
+	bool *pad;
+	double *fixed;
+} rw_graph_t;
+
+/* Estimate of the voltage of a node from its walks */
+typedef struct rw_estimate {
+	double voltage;
+	/* Half-width of the confidence interval */
+	double half_width;
+	long walks;
+	double avg_steps;
+} rw_estimate_t;
+
+rw_graph_t *rw_build_graph(index_t *index, hash_table_t *hash_table, int num_nodes);
+rw_estimate_t rw_estimate_node(rw_graph_t *graph, int node, double tol, double confidence);
+void random_walk_analysis(index_t *index, hash_table_t *hash_table, parser_t *parser);
+void free_rw_graph(rw_graph_t *graph);
+
+#endif
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <assert.h>
+
+#include "recycle.h"
+#include "routines.h"
+
+/* A collected direction is dropped if orthogonalization leaves less than this fraction of its norm */
+#define RECYCLE_DROP_TOL	1e-8
+/* Ritz values below this fraction of the largest one are not deflated, W'AW would be close to singular */
+#define RECYCLE_MIN_THETA	1e-12
+/* Maximum sweeps of the Jacobi eigenvalue iteration */
+#define RECYCLE_MAX_SWEEPS	50
+/* Rows per block of the projections on the deflation space */
+#define RECYCLE_BLOCK		512
+
+/* Allocates the recycling information of a system of dimension n with up to max_m deflation vectors */
+recycle_t *init_recycle(int n, int max_m) {
+	recycle_t *rc = (recycle_t *)calloc(1, sizeof(recycle_t));
+	assert(rc != NULL);
+	rc->n = n;
+	rc->max_m = max_m;
+	for (int i = 0; i < RECYCLE_HISTORY; i++) {
+		rc->hist[i] = init_vector(n);
+	}
+	if (max_m > 0) {
+		int k = max_m + RECYCLE_COLLECT;
+		rc->V     = (double *)malloc((size_t)n * k * sizeof(double));
+		rc->AV    = (double *)malloc((size_t)n * k * sizeof(double));
+		rc->theta = (double *)malloc(max_m * sizeof(double));
+		rc->mu    = (double *)malloc(max_m * sizeof(double));
+		rc->H     = (double *)malloc(k * k * sizeof(double));
+		rc->Y     = (double *)malloc(k * k * sizeof(double));
+		assert(rc->V != NULL && rc->AV != NULL && rc->theta != NULL && rc->mu != NULL && rc->H != NULL && rc->Y != NULL);
+	}
+	rc->min_iters = INT_MAX;
+	recycle_reset(rc, NULL);
+	return rc;
+}
+
+/*
+ * Forgets the previous solutions and the deflation space, when the matrix changes. x0 is the
+ * solution the next steps start from (e.g. the DC operating point), or NULL. The statistics are kept.
+ */
+void recycle_reset(recycle_t *rc, double *x0) {
+	rc->num_hist = 0;
+	rc->order = 0;
+	rc->m = rc->c = 0;
+	rc->num_refresh = 0;
+	rc->best_iters = INT_MAX;
+	if (x0 != NULL) {
+		recycle_push(rc, x0);
+	}
+}
+
+/* Entry i of the extrapolation of the previous solutions with a polynomial of the given order */
+static inline double extrapolate(recycle_t *rc, int order, int i) {
+	switch (order) {
+		case 0:
+			return rc->hist[0][i];
+		case 1:
+			return 2.0 * rc->hist[0][i] - rc->hist[1][i];
+		default:
+			return 3.0 * rc->hist[0][i] - 3.0 * rc->hist[1][i] + rc->hist[2][i];
+	}
+}
+
+/* Sets x to the extrapolation of the previous solutions, with the order that predicted the last step best */
+void recycle_guess(recycle_t *rc, double *x) {
+	if (rc->num_hist == 0) return;
+	int order = MIN(rc->order, rc->num_hist - 1);
+	for (int i = 0; i < rc->n; i++) {
+		x[i] = extrapolate(rc, order, i);
+	}
+}
+
+/*
+ * Adds the solution x of the current step to the history. The orders of extrapolation are checked
+ * against x first: a smooth waveform favours the higher orders, while the alternating components
+ * of stiff modes under the trapezoidal method are amplified by them, so the best one is kept.
+ */
+void recycle_push(recycle_t *rc, double *x) {
+	double best_err = INFINITY;
+	for (int order = 0; order < rc->num_hist; order++) {
+		double err = 0.0;
+		for (int i = 0; i < rc->n; i++) {
+			double d = x[i] - extrapolate(rc, order, i);
+			err += d * d;
+		}
+		if (err < best_err) {
+			best_err = err;
+			rc->order = order;
+		}
+	}
+
+	double *oldest = rc->hist[RECYCLE_HISTORY - 1];
+	for (int i = RECYCLE_HISTORY - 1; i > 0; i--) {
+		rc->hist[i] = rc->hist[i - 1];
+	}
+	rc->hist[0] = oldest;
+	memcpy(oldest, x, rc->n * sizeof(double));
+	rc->num_hist = MIN(rc->num_hist + 1, RECYCLE_HISTORY);
+}
+
+/* mu = diag(theta)^-1 * U'y, for U the m columns of V or AV, y is read in blocks that stay in cache */
+static void project(recycle_t *rc, const double *U, const double *y) {
+	int n = rc->n, m = rc->m;
+	double mu[m];
+	for (int j = 0; j < m; j++) {
+		mu[j] = 0.0;
+	}
+	for (int i0 = 0; i0 < n; i0 += RECYCLE_BLOCK) {
+		int len = MIN(RECYCLE_BLOCK, n - i0);
+		for (int j = 0; j < m; j++) {
+			const double *u = U + (size_t)j * n + i0;
+			double sum = 0.0;
+			for (int i = 0; i < len; i++) {
+				sum += u[i] * y[i0 + i];
+			}
+			mu[j] += sum;
+		}
+	}
+	for (int j = 0; j < m; j++) {
+		rc->mu[j] = mu[j] / rc->theta[j];
+	}
+}
+
+/* y = y + a*U*mu, blocked like project */
+static void expand(recycle_t *rc, double a, const double *U, double *y) {
+	int n = rc->n, m = rc->m;
+	for (int i0 = 0; i0 < n; i0 += RECYCLE_BLOCK) {
+		int len = MIN(RECYCLE_BLOCK, n - i0);
+		for (int j = 0; j < m; j++) {
+			const double *u = U + (size_t)j * n + i0;
+			double c = a * rc->mu[j];
+			for (int i = 0; i < len; i++) {
+				y[i0 + i] += c * u[i];
+			}
+		}
+	}
+}
+
+/*
+ * Start of a solve with initial guess x and residual r = b - Ax. The guess is corrected with the
+ * Galerkin projection on the deflation space, x = x + W (W'AW)^-1 W'r, and r is updated to match.
+ */
+void recycle_start(recycle_t *rc, double *x, double *r) {
+	rc->c = 0;
+	if (rc->m == 0) return;
+	project(rc, rc->V, r);
+	expand(rc,  1.0, rc->V,  x);
+	expand(rc, -1.0, rc->AV, r);
+}
+
+/* Makes the search direction p A-orthogonal to the deflation space, p = p - W (W'AW)^-1 (AW)'z */
+void recycle_deflate(recycle_t *rc, double *p, double *z) {
+	if (rc->m == 0) return;
+	project(rc, rc->AV, z);
+	expand(rc, -1.0, rc->V, p);
+}
+
+/* Keeps the search direction p and q = A*p for the next refresh, only the first RECYCLE_COLLECT of a solve */
+void recycle_collect(recycle_t *rc, double *p, double *q) {
+	if (rc->max_m == 0 || rc->c == RECYCLE_COLLECT) return;
+	size_t col = (size_t)(rc->m + rc->c) * rc->n;
+	memcpy(rc->V  + col, p, rc->n * sizeof(double));
+	memcpy(rc->AV + col, q, rc->n * sizeof(double));
+	rc->c++;
+}
+
+/* Eigenvalues (diagonal of H on return) and eigenvectors Y of the symmetric k x k matrix H, cyclic Jacobi */
+static void recycle_eigen(double *H, double *Y, int k) {
+	for (int i = 0; i < k; i++) {
+		for (int j = 0; j < k; j++) {
+			Y[i * k + j] = (i == j) ? 1.0 : 0.0;
+		}
+	}
+	for (int sweep = 0; sweep < RECYCLE_MAX_SWEEPS; sweep++) {
+		double off = 0.0, total = 0.0;
+		for (int p = 0; p < k; p++) {
+			for (int q = 0; q < k; q++) {
+				total += H[p * k + q] * H[p * k + q];
+				if (p != q) off += H[p * k + q] * H[p * k + q];
+			}
+		}
+		if (off <= 1e-28 * total) break;
+
+		for (int p = 0; p < k - 1; p++) {
+			for (int q = p + 1; q < k; q++) {
+				if (H[p * k + q] == 0.0) continue;
+				double tau = (H[q * k + q] - H[p * k + p]) / (2.0 * H[p * k + q]);
+				double t = ((tau >= 0.0) ? 1.0 : -1.0) / (fabs(tau) + sqrt(1.0 + tau * tau));
+				double c = 1.0 / sqrt(1.0 + t * t), s = t * c;
+				/* H = J'HJ and Y = YJ */
+				for (int r = 0; r < k; r++) {
+					double hp = H[r * k + p], hq = H[r * k + q];
+					H[r * k + p] = c * hp - s * hq;
+					H[r * k + q] = s * hp + c * hq;
+				}
+				for (int r = 0; r < k; r++) {
+					double hp = H[p * k + r], hq = H[q * k + r];
+					H[p * k + r] = c * hp - s * hq;
+					H[q * k + r] = s * hp + c * hq;
+				}
+				for (int r = 0; r < k; r++) {
+					double yp = Y[r * k + p], yq = Y[r * k + q];
+					Y[r * k + p] = c * yp - s * yq;
+					Y[r * k + q] = s * yp + c * yq;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Rayleigh-Ritz on the span of the deflation vectors and the collected directions. The new
+ * deflation vectors are the Ritz vectors of the smallest Ritz values, AV is transformed the
+ * same way so no extra products with A are needed.
+ */
+static void recycle_refresh(recycle_t *rc) {
+	int n = rc->n, k = rc->m + rc->c, kk = 0;
+	double *V = rc->V, *AV = rc->AV;
+
+	/* Orthonormalize V with two passes of modified Gram-Schmidt, dependent columns are dropped */
+	for (int j = 0; j < k; j++) {
+		double *v = V + (size_t)j * n, *av = AV + (size_t)j * n;
+		double norm0 = norm2(v, n);
+		for (int pass = 0; pass < 2; pass++) {
+			for (int i = 0; i < kk; i++) {
+				double h = dot_product(V + (size_t)i * n, v, n);
+				axpy(v,  -h, V  + (size_t)i * n, v,  n);
+				axpy(av, -h, AV + (size_t)i * n, av, n);
+			}
+		}
+		double norm = norm2(v, n);
+		if (norm == 0.0 || norm <= RECYCLE_DROP_TOL * norm0) continue;
+		for (int i = 0; i < n; i++) {
+			v[i]  /= norm;
+			av[i] /= norm;
+		}
+		if (kk != j) {
+			memcpy(V  + (size_t)kk * n, v,  n * sizeof(double));
+			memcpy(AV + (size_t)kk * n, av, n * sizeof(double));
+		}
+		kk++;
+	}
+
+	/* H = V'AV, symmetrized */
+	double *H = rc->H, *Y = rc->Y;
+	for (int a = 0; a < kk; a++) {
+		for (int b = 0; b <= a; b++) {
+			double h = 0.5 * (dot_product(V + (size_t)a * n, AV + (size_t)b * n, n) +
+			                  dot_product(V + (size_t)b * n, AV + (size_t)a * n, n));
+			H[a * kk + b] = H[b * kk + a] = h;
+		}
+	}
+	recycle_eigen(H, Y, kk);
+
+	/* Pick the smallest Ritz values in increasing order, by insertion */
+	int sel[kk + 1], num_sel = 0;
+	double max_theta = 0.0;
+	for (int a = 0; a < kk; a++) {
+		max_theta = MAX(max_theta, H[a * kk + a]);
+	}
+	for (int a = 0; a < kk; a++) {
+		double theta = H[a * kk + a];
+		if (theta <= RECYCLE_MIN_THETA * max_theta) continue;
+		int s = num_sel;
+		while (s > 0 && H[sel[s - 1] * kk + sel[s - 1]] > theta) {
+			sel[s] = sel[s - 1];
+			s--;
+		}
+		sel[s] = a;
+		num_sel = MIN(num_sel + 1, rc->max_m);
+	}
+
+	/* W = VY and AW = AV*Y for the selected columns of Y, row by row in place */
+	for (int i = 0; i < n; i++) {
+		double w[num_sel + 1], aw[num_sel + 1];
+		for (int s = 0; s < num_sel; s++) {
+			w[s] = aw[s] = 0.0;
+			for (int a = 0; a < kk; a++) {
+				w[s]  += V[(size_t)a * n + i]  * Y[a * kk + sel[s]];
+				aw[s] += AV[(size_t)a * n + i] * Y[a * kk + sel[s]];
+			}
+		}
+		for (int s = 0; s < num_sel; s++) {
+			V[(size_t)s * n + i]  = w[s];
+			AV[(size_t)s * n + i] = aw[s];
+		}
+	}
+	for (int s = 0; s < num_sel; s++) {
+		rc->theta[s] = H[sel[s] * kk + sel[s]];
+	}
+	rc->m = num_sel;
+	rc->c = 0;
+	rc->num_refresh++;
+}
+
+/* End of a solve that took iters iterations, updates the statistics and refreshes the deflation space if needed */
+void recycle_update(recycle_t *rc, int iters) {
+	rc->num_solves++;
+	rc->total_iters += iters;
+	rc->min_iters = MIN(rc->min_iters, iters);
+	rc->max_iters = MAX(rc->max_iters, iters);
+	if (rc->max_m == 0 || rc->c == 0) return;
+
+	if (rc->num_refresh < RECYCLE_WARMUP || iters > RECYCLE_GROWTH * rc->best_iters) {
+		recycle_refresh(rc);
+		rc->best_iters = INT_MAX;
+	}
+	else {
+		rc->best_iters = MIN(rc->best_iters, iters);
+	}
+	rc->c = 0;
+}
+
+/* Prints the iterations per step and the size of the deflation space */
+void print_recycle_info(recycle_t *rc, char *msg) {
+	if (rc->num_solves == 0) return;
+	printf("%s: %d steps, %ld iterations, per step min %d / avg %.1lf / max %d, %d deflation vectors, %d refreshes\n",
+	       msg, rc->num_solves, rc->total_iters, rc->min_iters, (double)rc->total_iters / rc->num_solves,
+	       rc->max_iters, rc->m, rc->num_refresh);
+}
+
+/* Frees the recycling information */
+void free_recycle(recycle_t *rc) {
+	if (rc == NULL) return;
+	for (int i = 0; i < RECYCLE_HISTORY; i++) {
+		free(rc->hist[i]);
+	}
+	free(rc->V);
+	free(rc->AV);
+	free(rc->theta);
+	free(rc->mu);
+	free(rc->H);
+	free(rc->Y);
+	free(rc);
+}
@@ -0,0 +1,69 @@
+#ifndef RECYCLE_H
+#define RECYCLE_H
+
+#include <stdbool.h>
+
+/* Number of previous solutions the initial guess is extrapolated from, up to quadratic extrapolation */
+#define RECYCLE_HISTORY		3
+/* Search directions of a solve that are kept to refresh the deflation space */
+#define RECYCLE_COLLECT		8
+/*
+ * The deflation space is refreshed after every one of the first RECYCLE_WARMUP solves, after that only
+ * when a solve needs more than RECYCLE_GROWTH times the iterations of the best solve since the last refresh
+ */
+#define RECYCLE_WARMUP		4
+#define RECYCLE_GROWTH		1.5
+
+/*
+ * Information that the iterative solves of the transient analysis carry from one time step to the next,
+ * since all of them are on the same matrix. The initial guess of every step is extrapolated from the
+ * previous solutions. For CG the approximate eigenvectors of the smallest eigenvalues (Ritz vectors of
+ * the previous Krylov spaces) are also deflated: every solve starts from the Galerkin projection on them
+ * and keeps its search directions A-orthogonal to them (deflated CG).
+ */
+typedef struct recycle {
+	int n;
+
+	/* Previous solutions, hist[0] is the latest, how many of them are set and the order of extrapolation */
+	double *hist[RECYCLE_HISTORY];
+	int num_hist;
+	int order;
+
+	/*
+	 * V holds the m deflation vectors W followed by the c directions collected from the current solve,
+	 * AV = A*V, both column by column. theta are the Ritz values of W, so W'AW = diag(theta).
+	 */
+	int max_m;
+	int m;
+	int c;
+	double *V;
+	double *AV;
+	double *theta;
+	/* Dense work of the Rayleigh-Ritz step */
+	double *H;
+	double *Y;
+	double *mu;
+
+	/* Refreshes of the deflation space and the best iteration count since the last one */
+	int num_refresh;
+	int best_iters;
+
+	/* Iteration statistics of all the solves */
+	int num_solves;
+	long total_iters;
+	int min_iters;
+	int max_iters;
+} recycle_t;
+
+recycle_t *init_recycle(int n, int max_m);
+void recycle_reset(recycle_t *rc, double *x0);
+void recycle_guess(recycle_t *rc, double *x);
+void recycle_push(recycle_t *rc, double *x);
+void recycle_start(recycle_t *rc, double *x, double *r);
+void recycle_deflate(recycle_t *rc, double *p, double *z);
+void recycle_collect(recycle_t *rc, double *p, double *q);
+void recycle_update(recycle_t *rc, int iters);
+void print_recycle_info(recycle_t *rc, char *msg);
+void free_recycle(recycle_t *rc);
+
+#endif
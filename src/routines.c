@@ -1,31 +1,181 @@
 #include <math.h>
+#include <string.h>
+#include <assert.h>
 
 #include "routines.h"
 
 /* Computes the dest = a*x + y , x and y are vectors and a is a constant */
 void axpy(double *dest, double a, double *x, double *y, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++)
 		dest[i] = a * x[i] + y[i];
 }
 
-/* Computes the dest = a*x + y , x and y are vectors and a is a constant */
-void complex_axpy(gsl_vector_complex *dest, gsl_complex a, gsl_vector_complex *x, gsl_vector_complex *y, int n) {
-	gsl_complex xi, yi, ax, axy;
+/*
+ * The fused kernels below do the vector work of a CG or Bi-CG iteration in as few passes as they can.
+ * d is the inverted diagonal of the Jacobi preconditioner, which is applied on the fly instead of
+ * storing z = d.*r, or NULL for the other preconditioners.
+ */
+
+/* Computes the sum of x[i]*d[i]*y[i] */
+double scaled_dot_product(double *x, double *d, double *y, int n) {
+	double sum = 0.0;
+	#pragma omp parallel for reduction(+:sum) schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		sum += x[i] * d[i] * y[i];
+	}
+	return sum;
+}
+
+/* p = d.*r + b*p */
+void jacobi_xpby(double *p, double *d, double *r, double b, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		p[i] = d[i] * r[i] + b * p[i];
+	}
+}
+
+/* x = x + a*p, r = r - a*q and returns r*r, with d also rz = r*(d.*r) for the next rho of CG */
+double cg_update(double *x, double *r, double *p, double *q, double a, double *d, double *rz, int n) {
+	double rr = 0.0, rdr = 0.0;
+	if (d != NULL) {
+		#pragma omp parallel for reduction(+:rr, rdr) schedule(static) if (n > VEC_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] += a * p[i];
+			double ri = r[i] - a * q[i];
+			r[i] = ri;
+			rr  += ri * ri;
+			rdr += ri * d[i] * ri;
+		}
+		*rz = rdr;
+	}
+	else {
+		#pragma omp parallel for reduction(+:rr) schedule(static) if (n > VEC_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] += a * p[i];
+			double ri = r[i] - a * q[i];
+			r[i] = ri;
+			rr += ri * ri;
+		}
+	}
+	return rr;
+}
+
+/*
+ * x = x + a*p, r = r - a*q, r_tilde = r_tilde - a*q_tilde and returns r*r, with d also
+ * rz = r_tilde*(d.*r) for the next rho of Bi-CG
+ */
+double bicg_update(double *x, double *r, double *r_tilde, double *p, double *q, double *q_tilde, double a,
+				   double *d, double *rz, int n) {
+	double rr = 0.0, rdr = 0.0;
+	if (d != NULL) {
+		#pragma omp parallel for reduction(+:rr, rdr) schedule(static) if (n > VEC_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] += a * p[i];
+			double ri = r[i] - a * q[i];
+			double rti = r_tilde[i] - a * q_tilde[i];
+			r[i] = ri;
+			r_tilde[i] = rti;
+			rr  += ri * ri;
+			rdr += rti * d[i] * ri;
+		}
+		*rz = rdr;
+	}
+	else {
+		#pragma omp parallel for reduction(+:rr) schedule(static) if (n > VEC_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] += a * p[i];
+			double ri = r[i] - a * q[i];
+			r[i] = ri;
+			r_tilde[i] -= a * q_tilde[i];
+			rr += ri * ri;
+		}
+	}
+	return rr;
+}
+
+/*
+ * The complex routines work on interleaved C99 complex vectors. The products are written out with
+ * CS_COMPLEX_MUL, the default complex multiplication checks every one for infinities and NaNs and
+ * keeps the loops from vectorizing.
+ */
+
+/* Computes the dest = a*x + y , x and y are complex vectors and a is a complex constant */
+void complex_axpy(cs_complex_t *dest, cs_complex_t a, cs_complex_t *x, cs_complex_t *y, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
-		/* Get the current complex numbers from the vectors */
-		xi = gsl_vector_complex_get(x, i);
-		yi = gsl_vector_complex_get(y, i);
-		/* Multiply the first with alpha */
-		ax = gsl_complex_mul(a, xi);
-		/* Add them together */
-		axy = gsl_complex_add(ax, yi);
-		/* Save it to dest */
-		gsl_vector_complex_set(dest, i, axy);
+		dest[i] = CS_COMPLEX_MUL(a, x[i]) + y[i];
+	}
+}
+
+/*
+ * The vector work of an iteration of the pipelined CG in one pass, with b = beta and a = alpha:
+ * z = n + b*z, q = m + b*q, s = w + b*s, p = u + b*p, then x = x + a*p, r = r - a*s, u = u - a*q,
+ * w = w - a*z. It also computes gamma = r*u and delta = w*u of the next iteration and returns r*r,
+ * the single reduction of the iteration.
+ */
+double pipe_cg_update(double *x, double *r, double *u, double *w, double *p, double *s, double *q, double *z,
+					  double *m, double *n, double a, double b, double *gamma, double *delta, int len) {
+	double rr = 0.0, ru = 0.0, wu = 0.0;
+	#pragma omp parallel for reduction(+:rr, ru, wu) schedule(static) if (len > VEC_PAR_MIN)
+	for (int i = 0; i < len; i++) {
+		double zi = n[i] + b * z[i];
+		double qi = m[i] + b * q[i];
+		double si = w[i] + b * s[i];
+		double pi = u[i] + b * p[i];
+		z[i] = zi;
+		q[i] = qi;
+		s[i] = si;
+		p[i] = pi;
+		x[i] += a * pi;
+		double ri = r[i] - a * si;
+		double ui = u[i] - a * qi;
+		double wi = w[i] - a * zi;
+		r[i] = ri;
+		u[i] = ui;
+		w[i] = wi;
+		rr += ri * ri;
+		ru += ri * ui;
+		wu += wi * ui;
+	}
+	*gamma = ru;
+	*delta = wu;
+	return rr;
+}
+
+/*
+ * x = x + a*p, r = r - a*q and returns r*r, the vector work of a complex CG iteration in one pass.
+ * For Bi-CG also r_tilde = r_tilde - conj(a)*q_tilde, r_tilde is NULL for CG.
+ */
+double complex_cg_update(cs_complex_t *x, cs_complex_t *r, cs_complex_t *p, cs_complex_t *q, cs_complex_t a,
+						 cs_complex_t *r_tilde, cs_complex_t *q_tilde, int n) {
+	double rr = 0.0;
+	if (r_tilde != NULL) {
+		cs_complex_t a_conj = conj(a);
+		#pragma omp parallel for reduction(+:rr) schedule(static) if (n > VEC_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] += CS_COMPLEX_MUL(a, p[i]);
+			cs_complex_t ri = r[i] - CS_COMPLEX_MUL(a, q[i]);
+			r[i] = ri;
+			r_tilde[i] -= CS_COMPLEX_MUL(a_conj, q_tilde[i]);
+			rr += creal(ri) * creal(ri) + cimag(ri) * cimag(ri);
+		}
+	}
+	else {
+		#pragma omp parallel for reduction(+:rr) schedule(static) if (n > VEC_PAR_MIN)
+		for (int i = 0; i < n; i++) {
+			x[i] += CS_COMPLEX_MUL(a, p[i]);
+			cs_complex_t ri = r[i] - CS_COMPLEX_MUL(a, q[i]);
+			r[i] = ri;
+			rr += creal(ri) * creal(ri) + cimag(ri) * cimag(ri);
+		}
 	}
+	return rr;
 }
 
 /* Substracts two vectors and stores the result in dest */
 void sub_vector(double *dest, double *x, double *y, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
 		dest[i] = x[i] - y[i];
 	}
@@ -41,29 +191,22 @@ void add_vector(double *dest, double *x, double *y, int n) {
 /* Computes the dot product of vectors x and y */
 double dot_product(double *x, double *y, int n) {
 	double sum = 0.0;
+	#pragma omp parallel for reduction(+:sum) schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
 		sum += x[i] * y[i];
 	}
 	return sum;
 }
 
-/* Computes the complex dot product of complex vectors x and y */
-gsl_complex complex_dot_product(gsl_vector_complex *x, gsl_vector_complex *y, int n) {
-	gsl_complex z, xy, xi, yi;
-	/* Initialize to z = 0.0 + i0.0 */
-	GSL_SET_COMPLEX(&z, 0.0, 0.0);
+/* Computes the complex dot product of complex vectors x and y, the first one is conjugated */
+cs_complex_t complex_dot_product(cs_complex_t *x, cs_complex_t *y, int n) {
+	double re = 0.0, im = 0.0;
+	#pragma omp parallel for reduction(+:re, im) schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
-		/* Get the current complex number from the vectors */
-		xi = gsl_vector_complex_get(x, i);
-		yi = gsl_vector_complex_get(y, i);
-		/* Get the conjugate of the first */
-		xi = __gsl_complex_conj(xi);
-		/* Get their multiplication */
-		xy = gsl_complex_mul(xi, yi);
-		/* Get the sum */
-		z  = gsl_complex_add(z, xy);
+		re += creal(x[i]) * creal(y[i]) + cimag(x[i]) * cimag(y[i]);
+		im += creal(x[i]) * cimag(y[i]) - cimag(x[i]) * creal(y[i]);
 	}
-	return z;
+	return CMPLX(re, im);
 }
 
 /* Computes the euclidean norm of vector x */
@@ -71,28 +214,16 @@ double norm2(double *x, int n) {
 	return sqrt(dot_product(x, x, n));
 }
 
-/* Computes the euclidean norm of complex vector x */
-double complex_norm2(gsl_vector_complex *x, int n) {
-	/* 1. ||x|| = sqrt(Σ(xr^2 + xi^2)) for i...n */
-	/* 2. ||x|| = sqrt(Σ(z*z_conj)) for i...n */
-	/* Method 1 is used below */
-	gsl_complex z;
-	double z_real, z_imag, sum = 0.0;
+/* Computes the euclidean norm of complex vector x, ||x|| = sqrt(Σ(xr^2 + xi^2)) */
+double complex_norm2(cs_complex_t *x, int n) {
+	double sum = 0.0;
+	#pragma omp parallel for reduction(+:sum) schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
-		/* Get current complex number from vector */
-		z = gsl_vector_complex_get(x, i);
-		z_real = GSL_REAL(z) * GSL_REAL(z);
-		z_imag = GSL_IMAG(z) * GSL_IMAG(z);
-		sum += z_real + z_imag;
+		sum += creal(x[i]) * creal(x[i]) + cimag(x[i]) * cimag(x[i]);
 	}
 	return sqrt(sum);
 }
 
-/* Returns the absolute value of the complex vector */
-double complex_abs(gsl_complex z) {
-	return sqrt(GSL_REAL(z) * GSL_REAL(z) + GSL_IMAG(z) * GSL_IMAG(z));
-}
-
 /* Multiplies matrix A with vector x and stores the reuslt in supplied vector Ax */
 void mat_vec_mul(double *Ax, double **A, double *x, int n) {
 	for (int i = 0; i < n; i++) {
@@ -132,56 +263,276 @@ void cs_mat_vec_mul_trans(double *Ax, cs *A, double *x) {
 	}
 }
 
-/* Multiplies complex matrix A with complex vector x and stores the reuslt in supplied vector Ax */
-void complex_cs_mat_vec_mul(gsl_vector_complex *Ax, cs_ci *A, gsl_vector_complex *x) {
-	cs_complex_t cs_xj, cs_axpxj;
-	gsl_complex gsl_xj, gsl_axip, gsl_axpxj;
+/*
+ * The block routines below work on panels of k right-hand sides. A panel of n rows is stored
+ * row by row, so that X[i * k + c] is the i-th entry of column c. This way every entry of the
+ * factor is loaded once and applied to all k columns with a contiguous inner loop.
+ */
+
+/* X(p) = B for a panel, or X = B if p is NULL */
+void cs_ipvec_block(int *p, double *B, double *X, int n, int k) {
+	for (int i = 0; i < n; i++) {
+		memcpy(&X[(p ? p[i] : i) * k], &B[i * k], k * sizeof(double));
+	}
+}
+
+/* X = B(p) for a panel, or X = B if p is NULL */
+void cs_pvec_block(int *p, double *B, double *X, int n, int k) {
+	for (int i = 0; i < n; i++) {
+		memcpy(&X[i * k], &B[(p ? p[i] : i) * k], k * sizeof(double));
+	}
+}
+
+/* Solves LX = B in place for a panel, L is lower triangular with the diagonal first in every column */
+void cs_lsolve_block(cs *L, double *X, int k) {
+	for (int j = 0; j < L->n; j++) {
+		double *x_j = &X[j * k];
+		double diag = L->x[L->p[j]];
+		for (int c = 0; c < k; c++) {
+			x_j[c] /= diag;
+		}
+		for (int p = L->p[j] + 1; p < L->p[j+1]; p++) {
+			double *x_i = &X[L->i[p] * k];
+			double l = L->x[p];
+			for (int c = 0; c < k; c++) {
+				x_i[c] -= l * x_j[c];
+			}
+		}
+	}
+}
 
-	/* Set zero to the Ax vector to avoid adding previous values */
-	gsl_vector_complex_set_zero(Ax);
+/* Solves L'X = B in place for a panel, L is lower triangular with the diagonal first in every column */
+void cs_ltsolve_block(cs *L, double *X, int k) {
+	for (int j = L->n - 1; j >= 0; j--) {
+		double *x_j = &X[j * k];
+		for (int p = L->p[j] + 1; p < L->p[j+1]; p++) {
+			double *x_i = &X[L->i[p] * k];
+			double l = L->x[p];
+			for (int c = 0; c < k; c++) {
+				x_j[c] -= l * x_i[c];
+			}
+		}
+		double diag = L->x[L->p[j]];
+		for (int c = 0; c < k; c++) {
+			x_j[c] /= diag;
+		}
+	}
+}
 
-	/* Ax[A->i[p]] += A->x[p] * x[j] */
+/* Solves UX = B in place for a panel, U is upper triangular with the diagonal last in every column */
+void cs_usolve_block(cs *U, double *X, int k) {
+	for (int j = U->n - 1; j >= 0; j--) {
+		double *x_j = &X[j * k];
+		double diag = U->x[U->p[j+1] - 1];
+		for (int c = 0; c < k; c++) {
+			x_j[c] /= diag;
+		}
+		for (int p = U->p[j]; p < U->p[j+1] - 1; p++) {
+			double *x_i = &X[U->i[p] * k];
+			double u = U->x[p];
+			for (int c = 0; c < k; c++) {
+				x_i[c] -= u * x_j[c];
+			}
+		}
+	}
+}
+
+/* Y = AX for a panel, A in CCF */
+void cs_mat_mat_mul(double *Y, cs *A, double *X, int k) {
+	memset(Y, 0, (size_t)A->m * k * sizeof(double));
 	for (int j = 0; j < A->n; j++) {
-		/* Get the current complex number from the x */
-		gsl_xj = gsl_vector_complex_get(x, j);
-		/* Convert it to cs_complex_t */
-		cs_xj = GSL_REAL(gsl_xj) + GSL_IMAG(gsl_xj) * I;
+		double *x_j = &X[j * k];
 		for (int p = A->p[j]; p < A->p[j+1]; p++) {
-			/* Get the previous value */
-			gsl_axip = gsl_vector_complex_get(Ax, A->i[p]);
-			/* Both are cs_complex_t so the multiplications is okay */
-			cs_axpxj = A->x[p] * cs_xj;
-			/* Convert the multiplication result into a gsl complex */
-			gsl_axpxj = gsl_complex_rect(creal(cs_axpxj), cimag(cs_axpxj));
-			/* Set it to the gsl vector at A->i[p] */
-			gsl_vector_complex_set(Ax, A->i[p], gsl_complex_add(gsl_axip, gsl_axpxj));
+			double *y_i = &Y[A->i[p] * k];
+			double a = A->x[p];
+			for (int c = 0; c < k; c++) {
+				y_i[c] += a * x_j[c];
+			}
 		}
 	}
 }
 
-/* Multiplies complex matrix A with complex vector x and stores the reuslt in supplied vector Ax */
-void complex_cs_mat_vec_mul_herm(gsl_vector_complex *Ax, cs_ci *A, gsl_vector_complex *x) {
-	cs_complex_t cs_axpxip, cs_xip;
-	gsl_complex gsl_xip, gsl_axj, gsl_axpxip;
+/* Y = AX for a panel with the dense A */
+void mat_mat_mul(double *Y, double **A, double *X, int n, int k) {
+	for (int i = 0; i < n; i++) {
+		double *y_i = &Y[i * k];
+		memset(y_i, 0, k * sizeof(double));
+		for (int j = 0; j < n; j++) {
+			double *x_j = &X[j * k];
+			double a = A[i][j];
+			for (int c = 0; c < k; c++) {
+				y_i[c] += a * x_j[c];
+			}
+		}
+	}
+}
 
-	/* Set zero to the Ax vector to avoid adding previous values */
-	gsl_vector_complex_set_zero(Ax);
+/*
+ * The panel kernels of the block CG below. The panels it works on are often a few columns wide, so the
+ * widths up to 4 get a copy of the kernel each with the width known, which unrolls the short loops over
+ * the columns and keeps the sums in registers. The rows are split in chunks of BLOCK_CHUNK.
+ */
+static inline __attribute__((always_inline)) void dot_rows(double *restrict G, const double *U, int ldu, int ku,
+														   const double *V, int ldv, int kv, int i0, int i1) {
+	for (int i = i0; i < i1; i++) {
+		const double *u_i = &U[i * ldu];
+		const double *v_i = &V[i * ldv];
+		for (int t = 0; t < ku; t++) {
+			double u = u_i[t];
+			for (int c = 0; c < kv; c++) {
+				G[t * kv + c] += u * v_i[c];
+			}
+		}
+	}
+}
+
+static void dot_chunk(double *G, double *U, int ldu, int ku, double *V, int ldv, int kv, int i0, int i1) {
+	if (ku == kv) {
+		switch (kv) {
+			case 1: dot_rows(G, U, ldu, 1, V, ldv, 1, i0, i1); return;
+			case 2: dot_rows(G, U, ldu, 2, V, ldv, 2, i0, i1); return;
+			case 3: dot_rows(G, U, ldu, 3, V, ldv, 3, i0, i1); return;
+			case 4: dot_rows(G, U, ldu, 4, V, ldv, 4, i0, i1); return;
+		}
+	}
+	else if (ku == 1) {
+		switch (kv) {
+			case 2: dot_rows(G, U, ldu, 1, V, ldv, 2, i0, i1); return;
+			case 3: dot_rows(G, U, ldu, 1, V, ldv, 3, i0, i1); return;
+			case 4: dot_rows(G, U, ldu, 1, V, ldv, 4, i0, i1); return;
+		}
+	}
+	dot_rows(G, U, ldu, ku, V, ldv, kv, i0, i1);
+}
 
-	/* Ax[j] += A->x[p] * x[A->i[p]] */
+/*
+ * G = U'V for the ku columns of the panel U and the kv columns of V, G is ku x kv by rows. The rows of U
+ * and V are ldu and ldv apart, so a column of a panel is passed as the panel plus its index with ku = 1.
+ */
+void block_dot(double *G, double *U, int ldu, int ku, double *V, int ldv, int kv, int n) {
+	int m = ku * kv;
+	assert(ku <= BLOCK_MAX_WIDTH && kv <= BLOCK_MAX_WIDTH);
+	memset(G, 0, m * sizeof(double));
+	#pragma omp parallel for reduction(+:G[:m]) schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i += BLOCK_CHUNK) {
+		double sum[BLOCK_MAX_WIDTH * BLOCK_MAX_WIDTH];
+		memset(sum, 0, m * sizeof(double));
+		dot_chunk(sum, U, ldu, ku, V, ldv, kv, i, MIN(i + BLOCK_CHUNK, n));
+		for (int q = 0; q < m; q++) {
+			G[q] += sum[q];
+		}
+	}
+}
+
+/* Squared norms of the k columns of the panel X */
+void block_norms(double *norms, double *X, int k, int n) {
+	memset(norms, 0, k * sizeof(double));
+	#pragma omp parallel for reduction(+:norms[:k]) schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		for (int c = 0; c < k; c++) {
+			norms[c] += X[i * k + c] * X[i * k + c];
+		}
+	}
+}
+
+static inline __attribute__((always_inline)) void axpy_rows(double *Y, double a, const double *P, int kp,
+															const double *restrict W, int k, int i0, int i1) {
+	for (int i = i0; i < i1; i++) {
+		double *y_i = &Y[i * k];
+		for (int t = 0; t < kp; t++) {
+			double p = a * P[i * kp + t];
+			for (int c = 0; c < k; c++) {
+				y_i[c] += p * W[t * k + c];
+			}
+		}
+	}
+}
+
+static void axpy_chunk(double *Y, double a, double *P, int kp, double *W, int k, int i0, int i1) {
+	if (kp == k) {
+		switch (k) {
+			case 1: axpy_rows(Y, a, P, 1, W, 1, i0, i1); return;
+			case 2: axpy_rows(Y, a, P, 2, W, 2, i0, i1); return;
+			case 3: axpy_rows(Y, a, P, 3, W, 3, i0, i1); return;
+			case 4: axpy_rows(Y, a, P, 4, W, 4, i0, i1); return;
+		}
+	}
+	axpy_rows(Y, a, P, kp, W, k, i0, i1);
+}
+
+/* Y = Y + a*PW for the panel P of kp columns and the kp x k matrix W by rows, Y has k columns */
+void block_axpy(double *Y, double a, double *P, int kp, double *W, int k, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i += BLOCK_CHUNK) {
+		axpy_chunk(Y, a, P, kp, W, k, i, MIN(i + BLOCK_CHUNK, n));
+	}
+}
+
+/* X(:, map) = X(:, map) + PW for the panel X of ldx columns, the k columns of W go to the columns map of X */
+void block_scatter_axpy(double *X, int ldx, int *map, double *P, int kp, double *W, int k, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		double *x_i = &X[i * ldx];
+		double *p_i = &P[i * kp];
+		for (int c = 0; c < k; c++) {
+			double sum = 0.0;
+			for (int t = 0; t < kp; t++) {
+				sum += p_i[t] * W[t * k + c];
+			}
+			x_i[map[c]] += sum;
+		}
+	}
+}
+
+/* Multiplies complex matrix A with complex vector x and stores the reuslt in supplied vector Ax */
+void complex_cs_mat_vec_mul(cs_complex_t *Ax, cs_ci *A, cs_complex_t *x) {
+	for (int i = 0; i < A->m; i++) {
+		Ax[i] = 0.0;
+	}
 	for (int j = 0; j < A->n; j++) {
-		for (int p = A->p[j]; p < A->p[j + 1]; p++) {
-			/* Get the current complex number from the x */
-			gsl_xip = gsl_vector_complex_get(x, A->i[p]);
-			/* Convert it to cs_complex_t */
-			cs_xip = GSL_REAL(gsl_xip) + GSL_IMAG(gsl_xip) * I;
-			/* Get the previous value */
-			gsl_axj = gsl_vector_complex_get(Ax, j);
-			/* Both are cs_complex_t so the multiplications is okay */
-			cs_axpxip = CS_COMPLEX_CONJ(A->x[p]) * cs_xip;
-			/* Convert the multiplication result into a gsl complex */
-			gsl_axpxip = gsl_complex_rect(creal(cs_axpxip), cimag(cs_axpxip));
-			/* Set it to the gsl vector at A->i[p] */
-			gsl_vector_complex_set(Ax, j, gsl_complex_add(gsl_axj, gsl_axpxip));
+		for (int p = A->p[j]; p < A->p[j+1]; p++) {
+			Ax[A->i[p]] += CS_COMPLEX_MUL(A->x[p], x[j]);
+		}
+	}
+}
+
+/* Multiplies the Hermitian of complex matrix A with complex vector x and stores the reuslt in supplied vector Ax */
+void complex_cs_mat_vec_mul_herm(cs_complex_t *Ax, cs_ci *A, cs_complex_t *x) {
+	for (int j = 0; j < A->n; j++) {
+		cs_complex_t sum = 0.0;
+		for (int p = A->p[j]; p < A->p[j+1]; p++) {
+			sum += CS_COMPLEX_MUL(conj(A->x[p]), x[A->i[p]]);
+		}
+		Ax[j] = sum;
+	}
+}
+
+/*
+ * Multiplies the dense complex matrix A with complex vector x and stores the result in supplied vector Ax,
+ * on the rows of the gsl matrix in place
+ */
+void complex_mat_vec_mul(cs_complex_t *Ax, gsl_matrix_complex *A, cs_complex_t *x, int n) {
+	#pragma omp parallel for schedule(static) if ((long)n * n > VEC_PAR_MIN)
+	for (int i = 0; i < n; i++) {
+		cs_complex_t *row = (cs_complex_t *)(A->data + 2 * i * A->tda);
+		double re = 0.0, im = 0.0;
+		for (int j = 0; j < n; j++) {
+			re += creal(row[j]) * creal(x[j]) - cimag(row[j]) * cimag(x[j]);
+			im += creal(row[j]) * cimag(x[j]) + cimag(row[j]) * creal(x[j]);
+		}
+		Ax[i] = CMPLX(re, im);
+	}
+}
+
+/* The same with the Hermitian of A, Ax = sum of conj(A(i, :)) x[i] over the rows */
+void complex_mat_vec_mul_herm(cs_complex_t *Ax, gsl_matrix_complex *A, cs_complex_t *x, int n) {
+	for (int j = 0; j < n; j++) {
+		Ax[j] = 0.0;
+	}
+	for (int i = 0; i < n; i++) {
+		cs_complex_t *row = (cs_complex_t *)(A->data + 2 * i * A->tda);
+		for (int j = 0; j < n; j++) {
+			Ax[j] += CS_COMPLEX_MUL(conj(row[j]), x[i]);
 		}
 	}
 }
@@ -211,52 +562,38 @@ void jacobi_precond(double *M, double **A, cs *C, int n, bool SPARSE) {
 }
 
 /* Creation of a complex Jacobi preconditioner and stores it in supplied vector M, zeros are not stored */
-void complex_jacobi_precond(gsl_vector_complex *M, gsl_matrix_complex *A, cs_ci *C, int n, bool SPARSE) {
+void complex_jacobi_precond(cs_complex_t *M, gsl_matrix_complex *A, cs_ci *C, int n, bool SPARSE) {
 	if (SPARSE) {
-		gsl_complex z;
 		for (int j = 0; j < C->n; j++) {
 			for (int p = C->p[j]; p < C->p[j+1]; p++) {
 				if (C->i[p] == j) {
-					/* Convert the cs_complex_t to gsl_complex */
-					z = gsl_complex_rect(creal(C->x[p]), cimag(C->x[p]));
-					// M[j] =  1 / C->x[p];
-					gsl_vector_complex_set(M, j, gsl_complex_div(GSL_COMPLEX_ONE, z));
+					M[j] = 1.0 / C->x[p];
 				}
 			}
 		}
 	}
 	else {
 		for (int i = 0; i < n; i++) {
+			cs_complex_t a = ((cs_complex_t *)A->data)[i * (A->tda + 1)];
 			/* We don't want to add zeros, we replace them with 1 + 0i instead */
-			if (COMPLEX_ZERO(gsl_matrix_complex_get(A, i, i))) {
-				gsl_vector_complex_set(M, i, GSL_COMPLEX_ONE);
-			}
-			else {
-				/* We set M to 1/A[i][i] */
-				gsl_vector_complex_set(M, i, gsl_complex_div(GSL_COMPLEX_ONE, gsl_matrix_complex_get(A, i, i)));
-			}
+			M[i] = a == 0.0 ? 1.0 : 1.0 / a;
 		}
 	}
 }
 
 /* Apply Jacobi preconditioner and store it in vector M_fin */
 void precond_solve(double *M_fin, double *M, double *x, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
 		M_fin[i] = M[i] * x[i];
 	}
 }
 
 /* Apply complex Jacobi preconditioner and store it in vector M_fin */
-void complex_precond_solve(gsl_vector_complex *M_fin, gsl_vector_complex *M, gsl_vector_complex *x, int n) {
-	gsl_complex z, mi, xi;
+void complex_precond_solve(cs_complex_t *M_fin, cs_complex_t *M, cs_complex_t *x, int n) {
+	#pragma omp parallel for schedule(static) if (n > VEC_PAR_MIN)
 	for (int i = 0; i < n; i++) {
-		/* Get the current complex number from the vectors */
-		mi = gsl_vector_complex_get(M, i);
-		xi = gsl_vector_complex_get(x, i);
-		/* Get their multiplication */
-		z = gsl_complex_mul(mi, xi);
-		/* Set the result to vector M_fin at i */
-		gsl_vector_complex_set(M_fin, i, z);
+		M_fin[i] = CS_COMPLEX_MUL(M[i], x[i]);
 	}
 }
 
@@ -284,10 +621,10 @@ void set_vec_val(double *x, double val, int dimension) {
 }
 
 /* Converts the complex z into polar form */
-ac_spec_t rect_to_polar(gsl_complex z) {
+ac_spec_t rect_to_polar(cs_complex_t z) {
 	ac_spec_t ac;
-	double real  = GSL_REAL(z);
-	double imag  = GSL_IMAG(z);
+	double real  = creal(z);
+	double imag  = cimag(z);
 	ac.magnitude = sqrt(real * real + imag * imag);
 	ac.phase     = to_degrees(atan2(imag, real));
 	return ac;
@@ -313,18 +650,6 @@ double to_radians(double degrees) {
 	return radians;
 }
 
-/* Converts a real vector x to a gsl complex one with 0 imaginary parts */
-void real_to_gsl_complex_vector(gsl_vector_complex *x_complex, double *x, int dimension) {
-	/* Set a zero complex number 0 + 0i */
-	gsl_complex z = GSL_COMPLEX_ZERO;
-	for (int i = 0; i < dimension; i++) {
-		/* Set the real part of z to x[i] */
-		GSL_SET_REAL(&z, x[i]);
-		/* Set z to v[i] */
-		gsl_vector_complex_set(x_complex, i, z);
-	}
-}
-
 /* Converts a real vector x to a complex one with 0 imaginary parts */
 void real_to_cs_complex_vector(cs_complex_t *x_complex, double *x, int dimension) {
 	for (int i = 0; i < dimension; i++) {
@@ -333,17 +658,6 @@ void real_to_cs_complex_vector(cs_complex_t *x_complex, double *x, int dimension
 	}
 }
 
-/* Computes the conjugate of a vector M and stores it to vector M_conj */
-void vector_conjugate(gsl_vector_complex *M_conj, gsl_vector_complex *M, int dimension) {
-	gsl_complex z;
-	for (int i = 0; i < dimension; i++) {
-		/* Get the current complex number from the vector */
-		z = gsl_vector_complex_get(M, i);
-		/* Save its conjugate to vector M_conj */
-		gsl_vector_complex_set(M_conj, i, __gsl_complex_conj(z));
-	}
-}
-
 /* Allocate memory for the matrix of the MNA system */
 double **init_array(int row, int col) {
 	double **array = (double **)malloc(row * sizeof(double *));
@@ -370,9 +684,9 @@ gsl_matrix_complex *init_gsl_complex_array(int row, int col) {
 	return matrix;
 }
 
-/* Allocate memory for the complex gsl vector of the MNA system */
-gsl_vector_complex *init_gsl_complex_vector(int row) {
-	gsl_vector_complex *vector = gsl_vector_complex_calloc(row);
+/* Allocate memory for the complex vector of the AC analysis */
+cs_complex_t *init_complex_vector(int row) {
+	cs_complex_t *vector = (cs_complex_t *)calloc(row, sizeof(cs_complex_t));
 	assert(vector != NULL);
 	return vector;
 }
@@ -393,71 +707,6 @@ gsl_permutation *init_permutation(int dimension) {
 	return P;
 }
 
-/* Convert gsl_vector_complex to cs_complex_t */
-void gsl_to_cs_complex(cs_complex_t *dst, gsl_vector_complex *src, int dimension) {
-	gsl_complex z;
-	cs_complex_t x;
-	for (int i = 0; i < dimension; i++) {
-		/* Get the current complex number from the vector */
-		z = gsl_vector_complex_get(src, i);
-		/* Create a complex number cs_complex_t */
-		x = GSL_REAL(z) + GSL_IMAG(z) * I;
-		/* Set the complex number to the cs_complex_t vector */
-		dst[i] = x;
-	}
-}
-
-/* Convert cs_complex_t vector to a gsl_vector_complex */
-void cs_complex_to_gsl(gsl_vector_complex *dst, cs_complex_t *src, int dimension) {
-	gsl_complex z;
-	cs_complex_t x;
-	for (int i = 0; i < dimension; i++) {
-		/* Get the current complex number from the vector */
-		x = src[i];
-		/* Create a gsl_complex from the x */
-		z = gsl_complex_rect(creal(x), cimag(x));
-		/* Set the gsl_complex into the gsl_vector_complex */
-		gsl_vector_complex_set(dst, i, z);
-	}
-}
-
-/* 
- * Returns the complex conjugate of the gsl complex number x without
- * putting a negative sign in case there is 0 in imaginary part.
- */
-gsl_complex __gsl_complex_conj(gsl_complex x) {
-	gsl_complex z;
-	GSL_SET_REAL(&z, GSL_REAL(x));
-	if (GSL_IMAG(x) == 0.0) {
-		GSL_SET_IMAG(&z, GSL_IMAG(x));
-	}
-	else {
-		GSL_SET_IMAG(&z, -GSL_IMAG(x));
-	}
-	return z;
-}
-
-/* 
- * Returns the complex negative of the gsl complex number x without
- * putting a negative sign in case there is 0 in imaginary part.
- */
-gsl_complex __gsl_complex_neg(gsl_complex x) {
-	gsl_complex z;
-	if (GSL_REAL(x) == 0.0) {
-		GSL_SET_REAL(&z, 0.0);
-	}
-	else {
-		GSL_SET_REAL(&z, -GSL_REAL(x));
-	}
-	if (GSL_IMAG(x) == 0.0) {
-		GSL_SET_IMAG(&z, GSL_IMAG(x));
-	}
-	else {
-		GSL_SET_IMAG(&z, -GSL_IMAG(x));
-	}
-	return z;
-}
-
 /* Returns the negative of the cs_complex_t x considering the 0.0 case */
 cs_complex_t __cs_complex_neg(cs_complex_t x) {
 	cs_complex_t z = 0.0 + 0.0 * I;
@@ -479,15 +728,6 @@ cs_complex_t __cs_complex_conj(cs_complex_t x) {
 	return z;
 }
 
-/* Converts from polar to rectangular form. Phase is measured in degrees */
-gsl_complex __gsl_pol_to_rect(double magnitude, double phase) {
-	gsl_complex z;
-	/* Convert from degrees to radians in order to use the trigonometric functions */
-	phase = to_radians(phase);
-	GSL_SET_REAL(&z, magnitude * cos(phase)); GSL_SET_IMAG(&z, magnitude * sin(phase));
-	return z;
-}
-
 /* Converts from polar to rectangular form. Phase is measured in degrees */
 cs_complex_t __cs_pol_to_rect(double magnitude, double phase) {
 	/* Convert from degrees to radians in order to use the trigonometric functions */
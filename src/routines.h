@@ -19,54 +19,79 @@
 #define MIN(a, b) ((a) < (b) ? (a)  : (b))
 #define ABS(x)    ((x) < 0.0 ? (-x) : (x))
 
+/* Below this length the vector routines run on a single thread */
+#define VEC_PAR_MIN (1 << 15)
+/* Widest panel of the block kernels and the rows they take at a time */
+#define BLOCK_MAX_WIDTH	32
+#define BLOCK_CHUNK		1024
+
 #define RAD_CONST (180.0 / M_PI)
 #define DEG_CONST (M_PI / 180.0)
 
-#define COMPLEX_ZERO(z)    ((GSL_REAL(z) == 0.0 && GSL_IMAG(z) == 0.0))
 #define CS_COMPLEX_NEG(z)  __cs_complex_neg(z)
 #define CS_COMPLEX_CONJ(z) __cs_complex_conj(z)
+#define CS_COMPLEX_MUL(a, b) __cs_complex_mul(a, b)
 
 double dot_product(double *x, double *y, int n);
-gsl_complex complex_dot_product(gsl_vector_complex *x, gsl_vector_complex *y, int n);
+cs_complex_t complex_dot_product(cs_complex_t *x, cs_complex_t *y, int n);
 double norm2(double *x, int n);
-double complex_norm2(gsl_vector_complex *x, int n);
+double complex_norm2(cs_complex_t *x, int n);
 void axpy(double *dest, double a, double *x, double *y, int n);
-void complex_axpy(gsl_vector_complex *dest, gsl_complex a, gsl_vector_complex *x, gsl_vector_complex *y, int n);
+double scaled_dot_product(double *x, double *d, double *y, int n);
+void jacobi_xpby(double *p, double *d, double *r, double b, int n);
+double cg_update(double *x, double *r, double *p, double *q, double a, double *d, double *rz, int n);
+double bicg_update(double *x, double *r, double *r_tilde, double *p, double *q, double *q_tilde, double a,
+				   double *d, double *rz, int n);
+void complex_axpy(cs_complex_t *dest, cs_complex_t a, cs_complex_t *x, cs_complex_t *y, int n);
+double pipe_cg_update(double *x, double *r, double *u, double *w, double *p, double *s, double *q, double *z,
+					  double *m, double *n, double a, double b, double *gamma, double *delta, int len);
+double complex_cg_update(cs_complex_t *x, cs_complex_t *r, cs_complex_t *p, cs_complex_t *q, cs_complex_t a,
+						 cs_complex_t *r_tilde, cs_complex_t *q_tilde, int n);
 void mat_vec_mul(double *Ax, double **A, double *x, int n);
 void mat_vec_mul_trans(double *Ax, double **A, double *x, int n);
 void cs_mat_vec_mul(double *dest, cs *A, double *x);
 void cs_mat_vec_mul_trans(double *dest, cs *A, double *x);
-void complex_cs_mat_vec_mul(gsl_vector_complex *Ax, cs_ci *A, gsl_vector_complex *x);
-void complex_cs_mat_vec_mul_herm(gsl_vector_complex *Ax, cs_ci *A, gsl_vector_complex *x);
+void cs_ipvec_block(int *p, double *B, double *X, int n, int k);
+void cs_pvec_block(int *p, double *B, double *X, int n, int k);
+void cs_lsolve_block(cs *L, double *X, int k);
+void cs_ltsolve_block(cs *L, double *X, int k);
+void cs_usolve_block(cs *U, double *X, int k);
+void cs_mat_mat_mul(double *Y, cs *A, double *X, int k);
+void mat_mat_mul(double *Y, double **A, double *X, int n, int k);
+void block_dot(double *G, double *U, int ldu, int ku, double *V, int ldv, int kv, int n);
+void block_norms(double *norms, double *X, int k, int n);
+void block_axpy(double *Y, double a, double *P, int kp, double *W, int k, int n);
+void block_scatter_axpy(double *X, int ldx, int *map, double *P, int kp, double *W, int k, int n);
+void complex_cs_mat_vec_mul(cs_complex_t *Ax, cs_ci *A, cs_complex_t *x);
+void complex_cs_mat_vec_mul_herm(cs_complex_t *Ax, cs_ci *A, cs_complex_t *x);
+void complex_mat_vec_mul(cs_complex_t *Ax, gsl_matrix_complex *A, cs_complex_t *x, int n);
+void complex_mat_vec_mul_herm(cs_complex_t *Ax, gsl_matrix_complex *A, cs_complex_t *x, int n);
 void jacobi_precond(double *M, double **A, cs *C, int n, bool SPARSE);
-void complex_jacobi_precond(gsl_vector_complex *M, gsl_matrix_complex *A, cs_ci *C, int n, bool SPARSE);
+void complex_jacobi_precond(cs_complex_t *M, gsl_matrix_complex *A, cs_ci *C, int n, bool SPARSE);
 void precond_solve(double *M_fin, double *M, double *x, int n);
-void complex_precond_solve();
+void complex_precond_solve(cs_complex_t *M_fin, cs_complex_t *M, cs_complex_t *x, int n);
 void sub_vector(double *dest, double *x, double *y, int n);
 void add_vector(double *dest, double *x, double *y, int n);
 void zero_out_vector(double *x, int dimension);
 void zero_out_matrix(double **matrix, int row, int col);
 void set_vec_val(double *x, double val, int dimension);
-ac_spec_t rect_to_polar(gsl_complex z);
+ac_spec_t rect_to_polar(cs_complex_t z);
 double to_degrees(double radians);
 double to_radians(double degrees);
-double complex_abs(gsl_complex z);
-void real_to_gsl_complex_vector(gsl_vector_complex *x_complex, double *x, int dimension);
 void real_to_cs_complex_vector(cs_complex_t *x_complex, double *x, int dimension);
-void vector_conjugate(gsl_vector_complex *M_conj, gsl_vector_complex *M, int dimension);
 double **init_array(int row, int col);
 double *init_vector(int row);
 gsl_matrix_complex *init_gsl_complex_array(int row, int col);
-gsl_vector_complex *init_gsl_complex_vector(int row);
+cs_complex_t *init_complex_vector(int row);
 double *init_val_vector(int row, double val);
 gsl_permutation *init_permutation(int dimension);
-void gsl_to_cs_complex(cs_complex_t *dst, gsl_vector_complex *src, int dimension);
-void cs_complex_to_gsl(gsl_vector_complex *dst, cs_complex_t *src, int dimension);
-gsl_complex __gsl_complex_conj(gsl_complex x);
-gsl_complex __gsl_complex_neg(gsl_complex x);
-gsl_complex __gsl_pol_to_rect(double magnitude, double phase);
 cs_complex_t __cs_pol_to_rect(double magnitude, double phase);
 cs_complex_t __cs_complex_neg(cs_complex_t x);
 cs_complex_t __cs_complex_conj(cs_complex_t x);
 
+/* Complex product without the inf/nan recovery of the default one, so that the loops using it vectorize */
+static inline cs_complex_t __cs_complex_mul(cs_complex_t a, cs_complex_t b) {
+	return CMPLX(creal(a) * creal(b) - cimag(a) * cimag(b), creal(a) * cimag(b) + cimag(a) * creal(b));
+}
+
 #endif
\ No newline at end of file
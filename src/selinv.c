@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "selinv.h"
+#include "ordering.h"
+
+/*
+ * Selected inversion of A = LL' with the Takahashi equations: Z = inv(A) on the pattern of the Cholesky
+ * factor L, in the layout of L->x. Column j of ZL = inv(L') gives, from the last column backwards,
+ *   Z_ij = -(sum_{k > j} Z_ik l_kj) / l_jj for i > j and Z_jj = (1 / l_jj - sum_{k > j} Z_kj l_kj) / l_jj,
+ * where only the Z_ik with i, k in the pattern of column j are needed and those are on the pattern of L
+ * too. The column j of L is scattered to w, so every Z_ik, i > k, of column k serves both Z_ij and Z_kj.
+ * The rows of column k outside column j meet a zero in w and leave garbage in y that is never read,
+ * which is cheaper than testing them. The cost is a small multiple of the factorization. The diagonal of
+ * L has to be the first entry of every column, like cs_chol builds it. w and y are workspaces of n entries.
+ */
+void selected_inversion(cs *L, double *Z, double *w, double *y) {
+	int n = L->n, *Lp = L->p, *Li = L->i;
+	double *Lx = L->x;
+	for (int i = 0; i < n; i++) {
+		w[i] = 0.0;
+	}
+	for (int j = n - 1; j >= 0; j--) {
+		double ljj = Lx[Lp[j]];
+		for (int q = Lp[j] + 1; q < Lp[j + 1]; q++) {
+			w[Li[q]] = Lx[q];
+			y[Li[q]] = 0.0;
+		}
+		for (int q = Lp[j] + 1; q < Lp[j + 1]; q++) {
+			int k = Li[q];
+			double lkj = Lx[q], yk = Z[Lp[k]] * lkj;
+			for (int r = Lp[k] + 1; r < Lp[k + 1]; r++) {
+				y[Li[r]] += Z[r] * lkj;
+				yk += Z[r] * w[Li[r]];
+			}
+			y[k] += yk;
+		}
+		double s = 0.0;
+		for (int q = Lp[j] + 1; q < Lp[j + 1]; q++) {
+			Z[q] = -y[Li[q]] / ljj;
+			s += Z[q] * Lx[q];
+			w[Li[q]] = 0.0;
+		}
+		Z[Lp[j]] = (1.0 / ljj - s) / ljj;
+	}
+}
+
+/* Root of the class of node i, with path halving */
+static int find_class(int *parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+/*
+ * Conductance matrix of the resistors between the classes of nodes that the voltage sources and the
+ * inductors short, the supply is the class of ground and it's left out. cls[id] is the row of node id,
+ * -1 for the supply. The current sources and the capacitors are open.
+ */
+static cs *class_conductance(index_t *index, hash_table_t *hash_table, int num_nodes, int *cls, int *m) {
+	int *parent = (int *)malloc((num_nodes + 1) * sizeof(int));
+	assert(parent != NULL);
+	for (int i = 0; i <= num_nodes; i++) {
+		parent[i] = i;
+	}
+	list1_t *curr;
+	int nz = 0;
+	for (curr = index->head1; curr != NULL; curr = curr->next) {
+		char type = curr->type;
+		if (type == 'V' || type == 'v' || type == 'L' || type == 'l') {
+			int a = find_class(parent, ht_get_id(hash_table, curr->probe1));
+			int b = find_class(parent, ht_get_id(hash_table, curr->probe2));
+			/* Ground stays the root of its class */
+			if (a < b) parent[b] = a;
+			else parent[a] = b;
+		}
+		else if (type == 'R' || type == 'r') {
+			nz += 4;
+		}
+	}
+	*m = 0;
+	for (int i = 0; i <= num_nodes; i++) {
+		int root = find_class(parent, i);
+		cls[i] = (root == 0) ? -1 : (root == i) ? (*m)++ : -2;
+	}
+	for (int i = 0; i <= num_nodes; i++) {
+		if (cls[i] == -2) cls[i] = cls[find_class(parent, i)];
+	}
+	free(parent);
+
+	cs *T = cs_spalloc(*m, *m, MAX(nz, 1), 1, 1);
+	assert(T != NULL);
+	for (curr = index->head1; curr != NULL; curr = curr->next) {
+		if (curr->type != 'R' && curr->type != 'r') continue;
+		int a = cls[ht_get_id(hash_table, curr->probe1)];
+		int b = cls[ht_get_id(hash_table, curr->probe2)];
+		double g = 1.0 / curr->value;
+		if (a == b) continue;
+		if (a >= 0) cs_entry(T, a, a, g);
+		if (b >= 0) cs_entry(T, b, b, g);
+		if (a >= 0 && b >= 0) {
+			cs_entry(T, a, b, -g);
+			cs_entry(T, b, a, -g);
+		}
+	}
+	cs *G = cs_compress(T);
+	assert(G != NULL && cs_dupl(G));
+	cs_spfree(T);
+	return G;
+}
+
+/*
+ * Effective resistance from every node to the supply, the diagonal of inv(A) on the rows of the nodes
+ * with the voltage sources and the inductors shorted, and with SELINV=PATTERN the entries of inv(A) on
+ * the pattern of the Cholesky factor too. The conductance matrix is factorized once with the ordering
+ * of ORDER and inverted on that pattern, instead of a pair of triangular solves per node.
+ */
+void effective_resistance_analysis(index_t *index, hash_table_t *hash_table, parser_t *parser) {
+	int num_nodes = parser->netlist->num_nodes, m;
+	printf("Effective Resistance.....");
+
+	int *cls = (int *)malloc((num_nodes + 1) * sizeof(int));
+	char **names = (char **)calloc(num_nodes + 1, sizeof(char *));
+	assert(cls != NULL && names != NULL);
+	for (int b = 0; b < (int)hash_table->size; b++) {
+		for (entry_t *e = hash_table->table[b]; e != NULL; e = e->next) {
+			names[e->id] = e->key;
+		}
+	}
+	cs *G = class_conductance(index, hash_table, num_nodes, cls, &m);
+
+	order_info_t info;
+	css *S = (m > 0) ? order_symbolic(G, parser->options->ORDER, false, &info) : NULL;
+	csn *N = (S != NULL) ? cs_chol(G, S) : NULL;
+	if (m > 0 && N == NULL) {
+		fprintf(stderr, "\nError: the conductance matrix isn't positive definite, a node floats from the supply.\n");
+		exit(EXIT_FAILURE);
+	}
+	/* Every node is shorted to the supply, an empty factor */
+	cs *L = (N != NULL) ? N->L : G;
+	double *Z = (double *)malloc(MAX(L->p[m], 1) * sizeof(double));
+	double *w = (double *)malloc(MAX(m, 1) * sizeof(double));
+	double *y = (double *)malloc(MAX(m, 1) * sizeof(double));
+	assert(Z != NULL && w != NULL && y != NULL);
+	selected_inversion(L, Z, w, y);
+
+	FILE *file_out = fopen(SELINV_FILE, "w");
+	if (file_out == NULL) {
+		fprintf(stderr, "Error opening file: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(file_out, "%-30s%-30s\n", "Node", "R_eff (Ohm)");
+	fprintf(file_out, "-----------------------------------------\n");
+	for (int i = 1; i <= num_nodes; i++) {
+		double r = (cls[i] < 0) ? 0.0 : Z[L->p[S->pinv[cls[i]]]];
+		fprintf(file_out, "%-30s%-30.12le\n", names[i], r);
+	}
+	fclose(file_out);
+
+	/* Every entry of the pattern as a pair of nodes, the first node of each class stands for it */
+	if (parser->options->SELINV == SELINV_PATTERN) {
+		int *node_of = (int *)malloc(MAX(m, 1) * sizeof(int));
+		assert(node_of != NULL);
+		for (int i = num_nodes; i >= 1; i--) {
+			if (cls[i] >= 0) node_of[S->pinv[cls[i]]] = i;
+		}
+		file_out = fopen(SELINV_PATTERN_FILE, "w");
+		if (file_out == NULL) {
+			fprintf(stderr, "Error opening file: %s\n", strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		fprintf(file_out, "%-30s%-30s%-30s\n", "Node i", "Node j", "inv(A)_ij");
+		for (int j = 0; j < m; j++) {
+			for (int q = L->p[j]; q < L->p[j + 1]; q++) {
+				fprintf(file_out, "%-30s%-30s%-30.12le\n", names[node_of[L->i[q]]], names[node_of[j]], Z[q]);
+			}
+		}
+		fclose(file_out);
+		free(node_of);
+	}
+	printf("OK (%d unknowns, %d entries of the inverse)\n", m, L->p[m]);
+
+	cs_spfree(G);
+	cs_sfree(S);
+	cs_nfree(N);
+	free(Z);
+	free(w);
+	free(y);
+	free(cls);
+	free(names);
+}
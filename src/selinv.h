@@ -0,0 +1,15 @@
+#ifndef SELINV_H
+#define SELINV_H
+
+#include "list.h"
+#include "hash_table.h"
+#include "parser.h"
+#include "../cx_sparse/Include/cs.h"
+
+#define SELINV_FILE		"effective_resistance.txt"
+#define SELINV_PATTERN_FILE	"selected_inverse.txt"
+
+void selected_inversion(cs *L, double *Z, double *w, double *y);
+void effective_resistance_analysis(index_t *index, hash_table_t *hash_table, parser_t *parser);
+
+#endif
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <assert.h>
+#include <omp.h>
+
+#include "telemetry.h"
+#include "routines.h"
+
+/* Allocates the telemetry, the solve with index trace keeps its residual history, -1 for none */
+telemetry_t *init_telemetry(int trace) {
+	telemetry_t *tm = (telemetry_t *)calloc(1, sizeof(telemetry_t));
+	assert(tm != NULL);
+	tm->trace = trace;
+	return tm;
+}
+
+/*
+ * Starts the record of a new analysis, the solves that follow are counted in it. card is the index of
+ * the .DC/.TRAN/.AC card, -1 for the DC operating point. Does nothing without ITER.
+ */
+void telemetry_begin(telemetry_t *tm, const char *analysis, int card) {
+	if (tm == NULL) return;
+	if (tm->num_records == tm->max_records) {
+		tm->max_records = MAX(2 * tm->max_records, 4);
+		tm->records = (telemetry_record_t *)realloc(tm->records, tm->max_records * sizeof(telemetry_record_t));
+		assert(tm->records != NULL);
+	}
+	telemetry_record_t *rec = &tm->records[tm->num_records++];
+	memset(rec, 0, sizeof(telemetry_record_t));
+	if (card < 0) {
+		snprintf(rec->name, TELEMETRY_NAME, "%s", analysis);
+	}
+	else {
+		snprintf(rec->name, TELEMETRY_NAME, "%s:%d", analysis, card);
+	}
+	rec->solver = "-";
+	rec->first_solve = tm->num_solves;
+	rec->min_iters = INT_MAX;
+}
+
+/* Called before a solve, starts its timer and the residual history if it's the traced one */
+void telemetry_start_solve(telemetry_t *tm, workspace_t *ws) {
+	if (tm->num_records == 0) {
+		telemetry_begin(tm, "unnamed", -1);
+	}
+	ws->residual = 0.0;
+	if (tm->num_solves == tm->trace) {
+		ws->trace_len = 0;
+		ws->tracing = true;
+	}
+	tm->start = omp_get_wtime();
+}
+
+/* A solver broke down and handed over to the next one */
+void telemetry_breakdown(telemetry_t *tm) {
+	if (tm != NULL && tm->num_records > 0) {
+		tm->records[tm->num_records - 1].breakdowns++;
+	}
+}
+
+/* Writes the residual history of the traced solve */
+static void write_trace(telemetry_t *tm, workspace_t *ws, const char *solver) {
+	FILE *file_out = fopen(TRACE_FILE, "w");
+	if (file_out == NULL) {
+		fprintf(stderr, "Error opening file: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(file_out, "# solve %d of %s, %s\n", tm->num_solves, tm->records[tm->num_records - 1].name, solver);
+	fprintf(file_out, "%-12s%-30s\n", "iteration", "relative_residual");
+	for (int i = 0; i < ws->trace_len; i++) {
+		fprintf(file_out, "%-12d%-30.6e\n", i, ws->trace[i]);
+	}
+	fclose(file_out);
+}
+
+/* Called after a solve, adds its iterations, final residual and time to the record of the analysis */
+void telemetry_end_solve(telemetry_t *tm, workspace_t *ws, const char *solver, int iterations, int maxiter,
+						 double itol) {
+	double time = omp_get_wtime() - tm->start;
+	telemetry_record_t *rec = &tm->records[tm->num_records - 1];
+
+	rec->solver = solver;
+	rec->solves++;
+	rec->iterations += iterations;
+	rec->min_iters = MIN(rec->min_iters, iterations);
+	rec->max_iters = MAX(rec->max_iters, iterations);
+	rec->maxiter = MAX(rec->maxiter, maxiter);
+	rec->max_residual = MAX(rec->max_residual, ws->residual);
+	rec->unconverged += ws->residual > itol;
+	rec->time += time;
+
+	if (ws->tracing) {
+		write_trace(tm, ws, solver);
+		ws->tracing = false;
+	}
+	tm->num_solves++;
+}
+
+/*
+ * Writes one line per analysis with the iterations of its solves, the largest final relative residual,
+ * how many solves didn't reach itol or broke down and the time per solve and per iteration
+ */
+void write_telemetry(telemetry_t *tm, char *file_name) {
+	if (tm == NULL) return;
+	FILE *file_out = fopen(file_name, "w");
+	if (file_out == NULL) {
+		fprintf(stderr, "Error opening file: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	fprintf(file_out, "%-24s%-10s%-8s%-8s%-12s%-10s%-12s%-10s%-10s%-14s%-12s%-12s%-14s%-14s\n",
+			"analysis", "solver", "first", "solves", "iterations", "min_iter", "avg_iter", "max_iter", "maxiter",
+			"max_residual", "unconverged", "breakdowns", "time_s", "us_per_iter");
+	for (int i = 0; i < tm->num_records; i++) {
+		telemetry_record_t *rec = &tm->records[i];
+		if (rec->solves == 0) continue;
+		fprintf(file_out, "%-24s%-10s%-8d%-8d%-12ld%-10d%-12.2lf%-10d%-10d%-14.6e%-12d%-12d%-14.6lf%-14.3lf\n",
+				rec->name, rec->solver, rec->first_solve, rec->solves, rec->iterations, rec->min_iters,
+				(double)rec->iterations / rec->solves, rec->max_iters, rec->maxiter, rec->max_residual,
+				rec->unconverged, rec->breakdowns, rec->time,
+				rec->iterations > 0 ? rec->time / rec->iterations * 1e6 : 0.0);
+	}
+	fclose(file_out);
+}
+
+void free_telemetry(telemetry_t *tm) {
+	if (tm == NULL) return;
+	free(tm->records);
+	free(tm);
+}
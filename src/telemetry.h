@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdio.h>
+
+#include "workspace.h"
+
+/* Summary of the iterative solves and the residual history of the traced solve */
+#define TELEMETRY_FILE		"iter_summary.txt"
+#define TRACE_FILE			"residual_history.txt"
+#define TELEMETRY_NAME		48
+
+/* Statistics of the iterative solves of one analysis, the DC operating point or a .DC/.TRAN/.AC card */
+typedef struct telemetry_record {
+	char name[TELEMETRY_NAME];
+	/* The solver of the last solve, after any breakdowns */
+	const char *solver;
+	/* Index of the first solve of the analysis among all the solves of the run, for TRACE option */
+	int first_solve;
+	int solves;
+	long iterations;
+	int min_iters;
+	int max_iters;
+	int maxiter;
+	/* Largest final relative residual, solves that stopped above itol and breakdowns */
+	double max_residual;
+	int unconverged;
+	int breakdowns;
+	/* Seconds spent in the solves */
+	double time;
+} telemetry_record_t;
+
+/*
+ * Convergence telemetry of the iterative solvers. Every solve records its iterations, the final relative
+ * residual ||b - Ax|| / ||b|| the solver reached, its breakdowns and its time into the record of the current
+ * analysis. The solve with index trace also keeps the relative residual of every iteration.
+ */
+typedef struct telemetry {
+	telemetry_record_t *records;
+	int num_records;
+	int max_records;
+	int num_solves;
+	int trace;
+	/* Start of the current solve */
+	double start;
+} telemetry_t;
+
+telemetry_t *init_telemetry(int trace);
+void telemetry_begin(telemetry_t *tm, const char *analysis, int card);
+void telemetry_start_solve(telemetry_t *tm, workspace_t *ws);
+void telemetry_breakdown(telemetry_t *tm);
+void telemetry_end_solve(telemetry_t *tm, workspace_t *ws, const char *solver, int iterations, int maxiter,
+						 double itol);
+void write_telemetry(telemetry_t *tm, char *file_name);
+void free_telemetry(telemetry_t *tm);
+
+#endif
@@ -8,6 +8,8 @@ void tr_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 	/* Set the flag that we're currently on an Transient analysis */
 	mna->tr_analysis_init = true;
 	double *prev_response = NULL;
+	/* Heap allocations of the time steps, the first step may factorize so it isn't counted */
+	long step_allocs = 0;
 
 	/* Run all the TRAN analyses according to tr_counter */
 	int tr_counter = parser->netlist->tr_counter;
@@ -38,6 +40,10 @@ void tr_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 
 		/* Store the initial values to the prev_ vectors */
 		memcpy(prev_sol, dc_op, mna->dimension * sizeof(double));
+		/* New matrix, the iterative steps start over from the DC operating point */
+		if (parser->options->ITER) {
+			recycle_reset(mna->recycle, dc_op);
+		}
 		if (parser->options->TR) {
 			memcpy(prev_response, mna->resp->value, mna->dimension * sizeof(double));
 		}
@@ -48,6 +54,8 @@ void tr_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 		/* Find how many steps are required, exlcude 1 because at t=0 we use the DC operating point */
 		int n_steps = (parser->tr_analysis[i].fin_time / parser->tr_analysis[i].time_step);
 
+		telemetry_begin(mna->telemetry, "tran", i);
+		long alloc_start = alloc_count();
 		for (int step = 1; step <= n_steps; step++) {
 			if (parser->options->TR) {
 				set_trapezoidal_rhs(mna, curr_response, prev_response, prev_sol, parser->tr_analysis[i].time_step, step, parser->options->SPARSE);
@@ -55,13 +63,22 @@ void tr_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 			else {
 				set_backward_euler_rhs(mna, curr_response, prev_sol, parser->tr_analysis[i].time_step, step, parser->options->SPARSE);
 			}
+			/* The iterative solvers start from the extrapolation of the previous solutions */
+			if (parser->options->ITER) {
+				recycle_guess(mna->recycle, sol_x);
+			}
 			/* Solve the system */
 			solve_mna_system(mna, &sol_x, NULL, parser->options);
+			if (parser->options->ITER) {
+				recycle_push(mna->recycle, sol_x);
+			}
 			/* Print the output to files */
 			write_tr_out_files(files, parser->tr_analysis[i], hash_table, sol_x, step);
 			/* Copy current solution to prev to use for next iteration */
 			memcpy(prev_sol, sol_x, mna->dimension * sizeof(double));
+			if (step == 1) alloc_start = alloc_count();
 		}
+		step_allocs += alloc_count() - alloc_start;
 		/* Close the file descriptors for the current transient analysis */
 		for (int j = 0; j < parser->tr_analysis[i].num_nodes; j++) {
 		    fclose(files[j]);
@@ -83,6 +100,21 @@ void tr_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, pa
 	mna->tr_analysis_init = false;
 	if (tr_counter) {
 		printf("OK\n");
+		if (parser->options->SPARSE && !parser->options->ITER) {
+			print_factor_info(mna->sp_matrix, parser->options, "Transient");
+		}
+		if (parser->options->SPARSE && parser->options->ITER) {
+			print_precond_info(mna->M_trans, mna->sp_matrix->aGhC, "Transient");
+			print_async_info(mna->async_trans, "Transient");
+		}
+		if (parser->options->ITER) {
+			/* The solver of the last step, after any breakdowns */
+			char label[32];
+			const char *solver = mna->use_async ? "ASYNC" : parser->options->PIPECG ? "PIPECG" : "CG";
+			snprintf(label, sizeof(label), "Transient %s", parser->options->SPD ? solver : solver_name(mna->solver));
+			print_recycle_info(mna->recycle, label);
+		}
+		print_alloc_count("Transient", step_allocs);
 	}
 }
 
@@ -100,8 +132,7 @@ void init_transient_state(mna_system_t *mna, parser_t *parser, int dimension) {
 			cs_di_spfree(mna->sp_matrix->aGhC);
 		}
 		else {
-			cs_di_sfree(mna->sp_matrix->A_symbolic);
-			cs_di_nfree(mna->sp_matrix->A_numeric);
+			free_sparse_factors(mna->sp_matrix);
 		}
 		/* sGhC only exists in Trapezoidal method */
 		if (parser->options->TR) {
@@ -138,9 +169,9 @@ void set_trapezoidal_rhs(mna_system_t *mna, double *curr_response, double *prev_
 	/* curr_response is e(tk) and prev_response is e(tk-1) */
 	/* Set the values of the e(tk) vector */
 	set_response_vector(curr_response, mna->resp, h * k, mna->dimension);
-	/* Compute: e(tk) + e(tk-1) - sGhC*x(tk-1) and save it to the provided b vector */
-	double *response_add = init_vector(mna->dimension);
-	double *sGhc_x       = init_vector(mna->dimension);
+	/* Compute: e(tk) + e(tk-1) - sGhC*x(tk-1) and save it to the provided b vector, the temporaries are in the workspace */
+	double *response_add = mna->ws->temp[0];
+	double *sGhc_x       = mna->ws->temp[1];
 	add_vector(response_add, curr_response, prev_response, mna->dimension);
 	if (SPARSE) {
 		cs_mat_vec_mul(sGhc_x, mna->sp_matrix->sGhC, prev_sol);
@@ -152,10 +183,6 @@ void set_trapezoidal_rhs(mna_system_t *mna, double *curr_response, double *prev_
 
 	/* Copy the curr_response to prev_response to use for the next call */
 	memcpy(prev_response, curr_response, mna->dimension * sizeof(double));
-
-	/* Free everything we allocated */
-	free(response_add);
-	free(sGhc_x);
 }
 
 /* 
@@ -165,7 +192,7 @@ void set_trapezoidal_rhs(mna_system_t *mna, double *curr_response, double *prev_
 void set_backward_euler_rhs(mna_system_t *mna, double *curr_response, double *prev_sol, double h, int k, bool SPARSE) {
 	/* Set the values of the curr_response e(tk) vector */
 	set_response_vector(curr_response, mna->resp, h * k, mna->dimension);
-	double *hC_x = init_vector(mna->dimension);
+	double *hC_x = mna->ws->temp[0];
 	/* Compute: e(tk) + (1/h)C*x(tk-1) and save it to the mna->b vector */
 	if (SPARSE) {
 		cs_mat_vec_mul(hC_x, mna->sp_matrix->hC, prev_sol);
@@ -174,9 +201,6 @@ void set_backward_euler_rhs(mna_system_t *mna, double *curr_response, double *pr
 		mat_vec_mul(hC_x, mna->matrix->hC, prev_sol, mna->dimension);
 	}
 	add_vector(mna->b, curr_response, hC_x, mna->dimension);
-
-	/* Free everything we allocated */
-	free(hC_x);
 }
 
 /* Set the values of the e(tk) vector */
@@ -286,7 +310,7 @@ void create_tr_out_files(FILE *files[], tr_analysis_t tr_analysis) {
 	/* Open different files for each node in plot/print array */
 	for (int j = 0; j < tr_analysis.num_nodes; j++) {
 		/* Create the name of the output file */
-		sprintf(file_name, "%s%s)_%g_%g.txt", prefix, tr_analysis.nodes[j], tr_analysis.time_step, tr_analysis.fin_time);
+		snprintf(file_name, MAX_FILE_NAME, "%s%s)_%g_%g.txt", prefix, tr_analysis.nodes[j], tr_analysis.time_step, tr_analysis.fin_time);
 		/* Open the output file */
 		files[j] = fopen(file_name, "w");
 		if (files[j] == NULL) {
@@ -5,7 +5,7 @@
 #include "list.h"
 #include "routines.h"
 
-#define MAX_FILE_NAME 50
+#define MAX_FILE_NAME 256
 
 void tr_analysis(index_t *index, hash_table_t *hash_table, mna_system_t *mna, parser_t *parser, double *dc_op, double *sol_x);
 void set_trapezoidal_rhs(mna_system_t *mna, double *curr_response, double *prev_response, double *prev_sol, double h,
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "workspace.h"
+#include "routines.h"
+
+/* Allocate the workspace of an MNA system of the given dimension, only what the options need */
+workspace_t *init_workspace(int dimension, options_t *options) {
+	workspace_t *ws = (workspace_t *)calloc(1, sizeof(workspace_t));
+	assert(ws != NULL);
+	ws->dimension = dimension;
+
+	if (options->ITER) {
+		for (int i = 0; i < WS_ITER_VECTORS; i++) {
+			ws->iter[i] = init_vector(dimension);
+		}
+		if (options->AC) {
+			for (int i = 0; i < WS_ITER_VECTORS; i++) {
+				ws->complex_iter[i] = init_complex_vector(dimension);
+			}
+		}
+	}
+	for (int i = 0; i < WS_TEMP_VECTORS; i++) {
+		ws->temp[i] = init_vector(dimension);
+		if (options->AC) {
+			ws->complex_temp[i] = (cs_complex_t *)malloc(dimension * sizeof(cs_complex_t));
+			assert(ws->complex_temp[i] != NULL);
+		}
+	}
+	return ws;
+}
+
+/*
+ * Returns panel i of the workspace with room for k columns. It's allocated the first time and
+ * again only if a wider panel is asked for, so a sweep allocates it once for its first panel.
+ */
+double *ws_panel(workspace_t *ws, int i, int k) {
+	assert(i < WS_PANELS);
+	if (k > ws->panel_width[i]) {
+		free(ws->panel[i]);
+		ws->panel[i] = (double *)malloc((size_t)ws->dimension * k * sizeof(double));
+		assert(ws->panel[i] != NULL);
+		ws->panel_width[i] = k;
+	}
+	return ws->panel[i];
+}
+
+/* Entries of the Hessenberg matrix of GMRES(m) with the Givens rotations c, s, the right-hand side g and y */
+#define HESSENBERG_SIZE(m)	((size_t)((m) + 1) * ((m) + 4))
+
+/* Returns the Krylov basis of GMRES(m) and its Hessenberg matrix in H, allocated like the panels */
+double *ws_krylov(workspace_t *ws, int m, double **H) {
+	if (m > ws->krylov_m) {
+		free(ws->krylov);
+		free(ws->hessenberg);
+		ws->krylov = (double *)malloc((size_t)ws->dimension * (m + 1) * sizeof(double));
+		ws->hessenberg = (double *)malloc(HESSENBERG_SIZE(m) * sizeof(double));
+		assert(ws->krylov != NULL && ws->hessenberg != NULL);
+		ws->krylov_m = m;
+	}
+	*H = ws->hessenberg;
+	return ws->krylov;
+}
+
+/* The same for the complex GMRES(m) */
+cs_complex_t *ws_complex_krylov(workspace_t *ws, int m, cs_complex_t **H) {
+	if (m > ws->complex_krylov_m) {
+		free(ws->complex_krylov);
+		free(ws->complex_hessenberg);
+		ws->complex_krylov = (cs_complex_t *)malloc((size_t)ws->dimension * (m + 1) * sizeof(cs_complex_t));
+		ws->complex_hessenberg = (cs_complex_t *)malloc(HESSENBERG_SIZE(m) * sizeof(cs_complex_t));
+		assert(ws->complex_krylov != NULL && ws->complex_hessenberg != NULL);
+		ws->complex_krylov_m = m;
+	}
+	*H = ws->complex_hessenberg;
+	return ws->complex_krylov;
+}
+
+/* Appends a residual to the history of the traced solve, which grows like the panels */
+void ws_trace_push(workspace_t *ws, double residual) {
+	if (ws->trace_len == ws->trace_cap) {
+		ws->trace_cap = MAX(2 * ws->trace_cap, 64);
+		ws->trace = (double *)realloc(ws->trace, ws->trace_cap * sizeof(double));
+		assert(ws->trace != NULL);
+	}
+	ws->trace[ws->trace_len++] = residual;
+}
+
+/* Free the workspace and everything in it */
+void free_workspace(workspace_t *ws) {
+	for (int i = 0; i < WS_ITER_VECTORS; i++) {
+		free(ws->iter[i]);
+		free(ws->complex_iter[i]);
+	}
+	for (int i = 0; i < WS_TEMP_VECTORS; i++) {
+		free(ws->temp[i]);
+		free(ws->complex_temp[i]);
+	}
+	for (int i = 0; i < WS_PANELS; i++) {
+		free(ws->panel[i]);
+	}
+	free(ws->krylov);
+	free(ws->hessenberg);
+	free(ws->complex_krylov);
+	free(ws->complex_hessenberg);
+	free(ws->trace);
+	free(ws);
+}
+
+#ifdef ALLOC_COUNT
+/*
+ * Test hook: with the alloc_count target the allocators are wrapped at link time (ld --wrap), so every
+ * heap allocation of the simulator and of CXSparse goes through the functions below and is counted.
+ * The gsl vector allocators are wrapped too, in case gsl is a shared library.
+ */
+static long num_allocs = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t num, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+gsl_vector_complex *__real_gsl_vector_complex_alloc(size_t n);
+gsl_vector_complex *__real_gsl_vector_complex_calloc(size_t n);
+
+void *__wrap_malloc(size_t size) {
+	#pragma omp atomic
+	num_allocs++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t num, size_t size) {
+	#pragma omp atomic
+	num_allocs++;
+	return __real_calloc(num, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+	#pragma omp atomic
+	num_allocs++;
+	return __real_realloc(ptr, size);
+}
+
+gsl_vector_complex *__wrap_gsl_vector_complex_alloc(size_t n) {
+	#pragma omp atomic
+	num_allocs++;
+	return __real_gsl_vector_complex_alloc(n);
+}
+
+gsl_vector_complex *__wrap_gsl_vector_complex_calloc(size_t n) {
+	#pragma omp atomic
+	num_allocs++;
+	return __real_gsl_vector_complex_calloc(n);
+}
+#endif
+
+/* Number of heap allocations so far, -1 if the allocators aren't counted */
+long alloc_count(void) {
+#ifdef ALLOC_COUNT
+	return num_allocs;
+#else
+	return -1;
+#endif
+}
+
+/* Prints the number of heap allocations of the steps of an analysis, only when they are counted */
+void print_alloc_count(char *msg, long count) {
+#ifdef ALLOC_COUNT
+	printf("%s heap allocations after the first step: %ld\n", msg, count);
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "parser.h"
+#include "csr.h"
+#include "../cx_sparse/Include/cs.h"
+
+/* Vectors of the iterative solvers, conj_grad uses the first WS_CG_VECTORS of them, bi_conj_grad and bicgstab all */
+#define WS_CG_VECTORS		5
+#define WS_ITER_VECTORS		9
+/* Scratch vectors of the direct solves and the right-hand side builders */
+#define WS_TEMP_VECTORS		2
+/* Panels of the block solves, the block CG needs the most of them */
+#define WS_PANELS			6
+
+/*
+ * Scratch memory of the solvers and the right-hand side builders, allocated once per MNA system and
+ * sized to its dimension, so the time steps, the sweep steps and the frequencies don't touch the heap.
+ * Only what the options need is allocated, the rest is NULL.
+ */
+typedef struct workspace {
+	int dimension;
+
+	/* Vectors of the real and complex CG/Bi-CG, only with ITER option */
+	double *iter[WS_ITER_VECTORS];
+	cs_complex_t *complex_iter[WS_ITER_VECTORS];
+	/* CSR mirror of the sparse matrix of the current iterative solve, NULL to use the CCF */
+	csr_t *csr;
+	complex_csr_t *complex_csr;
+	/* Final relative residual of the last iterative solve, every solver sets it when it returns */
+	double residual;
+	/* Relative residual of every iteration of the traced solve, only while tracing is set */
+	bool tracing;
+	double *trace;
+	int trace_len;
+	int trace_cap;
+
+	/* Scratch vectors, the complex ones only with AC option */
+	double *temp[WS_TEMP_VECTORS];
+	cs_complex_t *complex_temp[WS_TEMP_VECTORS];
+
+	/*
+	 * Krylov basis of GMRES(m), m + 1 vectors one after the other, and the (m + 1) x m Hessenberg matrix
+	 * followed by the Givens rotations and the right-hand side of the least squares problem, allocated the
+	 * first time GMRES runs
+	 */
+	double *krylov;
+	double *hessenberg;
+	int krylov_m;
+	cs_complex_t *complex_krylov;
+	cs_complex_t *complex_hessenberg;
+	int complex_krylov_m;
+
+	/* Panels of the block solves, allocated the first time they are needed, panel i fits panel_width[i] columns */
+	double *panel[WS_PANELS];
+	int panel_width[WS_PANELS];
+} workspace_t;
+
+workspace_t *init_workspace(int dimension, options_t *options);
+void ws_trace_push(workspace_t *ws, double residual);
+double *ws_panel(workspace_t *ws, int i, int k);
+double *ws_krylov(workspace_t *ws, int m, double **H);
+cs_complex_t *ws_complex_krylov(workspace_t *ws, int m, cs_complex_t **H);
+void free_workspace(workspace_t *ws);
+long alloc_count(void);
+void print_alloc_count(char *msg, long count);
+
+/* Keeps the relative residual of an iteration when the solve is traced */
+static inline void ws_trace(workspace_t *ws, double residual) {
+	if (ws->tracing) {
+		ws_trace_push(ws, residual);
+	}
+}
+
+#endif